@@ -0,0 +1,501 @@
+#include "FamiTrackerModule.h"
+#include "FamiTrackerEnv.h"
+#include "Compiler.h"
+#include "CompilerCache.h"
+#include "DocumentFile.h"
+#include "FamiTrackerDocIO.h"
+#include "FamiTrackerDocOldIO.h"
+#include "FamiTrackerDocIOJson.h"
+#include "ModuleException.h"
+#include "SimpleFile.h"
+#include "ExportVerifier.h"
+#include "ModulePlayer.h"
+#include "WaveRenderer.h"
+#include "WaveRendererFactory.h"
+#include "ft0cc/enum_traits.h"
+
+#include <iostream>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+#include <filesystem>
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <string>
+#include <cstdio>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Mixer settings used by the tracker's default configuration
+const int MIXER_LOW_CUT = 30;
+const int MIXER_HIGH_CUT = 12000;
+const int MIXER_HIGH_DAMP = 24;
+const int MIXER_VOLUME = 100;
+
+const unsigned MAX_JOBS = 64;
+const unsigned VERIFY_FRAMES = 60 * 60;
+
+enum export_format_t : unsigned {
+	FMT_NSF  = 1u << 0,
+	FMT_NSFE = 1u << 1,
+	FMT_NES  = 1u << 2,
+	FMT_PRG  = 1u << 3,
+	FMT_BIN  = 1u << 4,
+	FMT_ASM  = 1u << 5,
+	FMT_JSON = 1u << 6,
+	FMT_WAV  = 1u << 7,
+};
+
+const struct {
+	const char *Name;
+	unsigned Flag;
+} FORMAT_NAMES[] = {
+	{"nsf", FMT_NSF},
+	{"nsfe", FMT_NSFE},
+	{"nes", FMT_NES},
+	{"prg", FMT_PRG},
+	{"bin", FMT_BIN},
+	{"asm", FMT_ASM},
+	{"json", FMT_JSON},
+	{"wav", FMT_WAV},
+};
+
+struct stOptions {
+	std::vector<fs::path> Inputs;
+	fs::path OutputDir;
+	unsigned Formats = FMT_NSF;
+	unsigned Jobs = 0;
+	render_type_t WavType = render_type_t::Loops;
+	unsigned WavParam = 1;
+	bool Verify = false;
+	fs::path CacheFile;
+};
+
+struct stJobResult {
+	bool Success = false;
+	std::string Summary;
+};
+
+class CStringLog : public CCompilerLog {
+public:
+	void WriteLog(std::string_view text) override {
+		log_ += text;
+	}
+	void Clear() override {
+		log_.clear();
+	}
+	const std::string &GetLog() const {
+		return log_;
+	}
+
+private:
+	std::string log_;
+};
+
+void PrintUsage(const char *name) {
+	std::cerr << "Usage: " << name << " [options] <module|directory|pattern|@listfile>...\n"
+		"Exports FamiTracker modules in parallel.\n\n"
+		"Options:\n"
+		"  -f FORMATS         comma-separated list of nsf, nsfe, nes, prg, bin, asm, json, wav\n"
+		"                     (default: nsf)\n"
+		"  -o DIR             output directory (default: next to each module)\n"
+		"  -j N               number of worker threads (default: number of cores)\n"
+		"  --wav-loops N      render WAV files for N loops of each track (default: 1)\n"
+		"  --wav-seconds N    render WAV files for N seconds of each track\n"
+		"  --verify           check exported NSF files against the tracker's sound driver\n"
+		"  --cache FILE       reuse compiled patterns stored in FILE and update it afterwards\n"
+		"  -h, --help         show this message\n\n"
+		"Directories are scanned recursively for .0cc and .ftm files. Patterns may use * and ?\n"
+		"in the file name. A @listfile contains one input per line.\n"
+		"Each module gets a <name>.log file next to its outputs. The exit status is 0 if every\n"
+		"module was exported, 1 if any export failed, and 2 on invalid arguments.\n";
+}
+
+bool IsModuleFile(const fs::path &path) {
+	auto ext = path.extension().string();
+	std::transform(ext.begin(), ext.end(), ext.begin(), [] (unsigned char c) { return std::tolower(c); });
+	return ext == ".0cc" || ext == ".ftm";
+}
+
+bool MatchPattern(std::string_view pattern, std::string_view str) {
+	if (pattern.empty())
+		return str.empty();
+	if (pattern.front() == '*')
+		return MatchPattern(pattern.substr(1), str) || (!str.empty() && MatchPattern(pattern, str.substr(1)));
+	if (str.empty() || (pattern.front() != '?' && pattern.front() != str.front()))
+		return false;
+	return MatchPattern(pattern.substr(1), str.substr(1));
+}
+
+bool AddInput(std::vector<fs::path> &Inputs, const std::string &arg) {
+	if (arg.find_first_of("*?") != std::string::npos) {
+		// Only the file name may contain wildcards
+		fs::path pattern {arg};
+		fs::path dir = pattern.has_parent_path() ? pattern.parent_path() : fs::path {"."};
+		const std::string name = pattern.filename().string();
+		std::error_code ec;
+		std::vector<fs::path> matches;
+		for (const auto &entry : fs::directory_iterator {dir, ec})
+			if (entry.is_regular_file() && MatchPattern(name, entry.path().filename().string()))
+				matches.push_back(entry.path());
+		if (matches.empty()) {
+			std::cerr << "No files match " << arg << '\n';
+			return false;
+		}
+		std::sort(matches.begin(), matches.end());
+		Inputs.insert(Inputs.end(), matches.begin(), matches.end());
+		return true;
+	}
+
+	fs::path path {arg};
+	std::error_code ec;
+	if (fs::is_directory(path, ec)) {
+		std::vector<fs::path> matches;
+		for (const auto &entry : fs::recursive_directory_iterator {path, ec})
+			if (entry.is_regular_file() && IsModuleFile(entry.path()))
+				matches.push_back(entry.path());
+		std::sort(matches.begin(), matches.end());
+		Inputs.insert(Inputs.end(), matches.begin(), matches.end());
+		return true;
+	}
+	if (!fs::is_regular_file(path, ec)) {
+		std::cerr << "Cannot find " << arg << '\n';
+		return false;
+	}
+	Inputs.push_back(std::move(path));
+	return true;
+}
+
+bool ParseFormats(unsigned &Formats, const std::string &arg) {
+	Formats = 0;
+	std::istringstream ss {arg};
+	std::string name;
+	while (std::getline(ss, name, ',')) {
+		auto it = std::find_if(std::begin(FORMAT_NAMES), std::end(FORMAT_NAMES), [&] (const auto &x) { return name == x.Name; });
+		if (it == std::end(FORMAT_NAMES)) {
+			std::cerr << "Unknown export format: " << name << '\n';
+			return false;
+		}
+		Formats |= it->Flag;
+	}
+	return Formats != 0;
+}
+
+bool ParseNumber(unsigned &Value, const std::string &arg) {
+	try {
+		std::size_t pos = 0;
+		unsigned long x = std::stoul(arg, &pos);
+		if (pos != arg.size() || !x)
+			return false;
+		Value = static_cast<unsigned>(x);
+		return true;
+	}
+	catch (std::exception &) {
+		return false;
+	}
+}
+
+bool ParseArguments(stOptions &Options, int argc, char *argv[]) {
+	for (int i = 1; i < argc; ++i) {
+		const std::string arg = argv[i];
+		auto next = [&] () -> const char * {
+			return i + 1 < argc ? argv[++i] : nullptr;
+		};
+
+		if (arg == "-h" || arg == "--help")
+			return false;
+		else if (arg == "-f") {
+			auto val = next();
+			if (!val || !ParseFormats(Options.Formats, val))
+				return false;
+		}
+		else if (arg == "-o") {
+			auto val = next();
+			if (!val)
+				return false;
+			Options.OutputDir = val;
+		}
+		else if (arg == "-j") {
+			auto val = next();
+			if (!val || !ParseNumber(Options.Jobs, val))
+				return false;
+		}
+		else if (arg == "--wav-loops" || arg == "--wav-seconds") {
+			auto val = next();
+			if (!val || !ParseNumber(Options.WavParam, val))
+				return false;
+			Options.WavType = arg == "--wav-loops" ? render_type_t::Loops : render_type_t::Seconds;
+		}
+		else if (arg == "--verify")
+			Options.Verify = true;
+		else if (arg == "--cache") {
+			auto val = next();
+			if (!val)
+				return false;
+			Options.CacheFile = val;
+		}
+		else if (arg.size() > 1 && arg.front() == '@') {
+			std::ifstream list {arg.substr(1)};
+			if (!list) {
+				std::cerr << "Cannot open list file " << arg.substr(1) << '\n';
+				return false;
+			}
+			std::string line;
+			while (std::getline(list, line)) {
+				if (!line.empty() && line.back() == '\r')
+					line.pop_back();
+				if (!line.empty() && !AddInput(Options.Inputs, line))
+					return false;
+			}
+		}
+		else if (arg.size() > 1 && arg.front() == '-') {
+			std::cerr << "Unknown option: " << arg << '\n';
+			return false;
+		}
+		else if (!AddInput(Options.Inputs, arg))
+			return false;
+	}
+
+	return !Options.Inputs.empty();
+}
+
+// Same loading sequence as CFamiTrackerDoc::OpenDocument
+void LoadModule(CFamiTrackerModule &modfile, const fs::path &path) {
+	CDocumentFile file;
+	file.Open(path, std::ios::in | std::ios::binary);
+	file.ValidateFile();
+
+	if (file.GetFileVersion() < 0x0200U) {
+		if (!compat::OpenDocumentOld(modfile, file.GetCSimpleFile()))
+			file.RaiseModuleException("General error");
+	}
+	else if (!CFamiTrackerDocIO {file, module_error_level_t::MODULE_ERROR_DEFAULT}.Load(modfile))
+		file.RaiseModuleException("Failed to load file");
+}
+
+class CModuleExporter {
+public:
+	CModuleExporter(const stOptions &Options, const fs::path &Input, std::shared_ptr<CCompilerCache> pCache) :
+		options_(Options), input_(Input), log_(std::make_shared<CStringLog>()), cache_(std::move(pCache))
+	{
+		fs::path dir = Options.OutputDir.empty() ? Input.parent_path() : Options.OutputDir;
+		stem_ = dir / Input.stem();
+	}
+
+	stJobResult Run() {
+		stJobResult Result;
+		try {
+			Log("Opened: " + input_.string() + '\n');
+			LoadModule(modfile_, input_);
+			Result.Success = Export();
+		}
+		catch (CModuleException &e) {
+			Log("Error: " + e.GetErrorString() + '\n');
+		}
+		catch (std::exception &e) {
+			Log(std::string {"Error: "} + e.what() + '\n');
+		}
+
+		Log(Result.Success ? "\nExport complete.\n" : "\nExport failed.\n");
+		std::ofstream {Output(".log"), std::ios::out} << log_->GetLog();
+
+		Result.Summary = (Result.Success ? "OK      " : "FAILED  ") + input_.string();
+		if (!Result.Success)
+			Result.Summary += " (see " + Output(".log").string() + ')';
+		return Result;
+	}
+
+private:
+	bool Export() {
+		bool Success = true;
+		const int Machine = value_cast(modfile_.GetMachine());
+		const bool PAL = modfile_.GetMachine() == machine_t::PAL;
+
+		// The compiler creates empty patterns as it reads the module, so save the JSON file first
+		if (options_.Formats & FMT_JSON)
+			Success &= ExportJson();
+		if (options_.Formats & FMT_NSF)
+			Success &= ExportFile(".nsf", [&] (CSimpleFile &file) { return MakeCompiler()->ExportNSF(file, Machine); });
+		if (options_.Formats & FMT_NSFE)
+			Success &= ExportFile(".nsfe", [&] (CSimpleFile &file) { return MakeCompiler()->ExportNSFE(file, Machine); });
+		if (options_.Formats & FMT_NES)
+			Success &= ExportFile(".nes", [&] (CSimpleFile &file) { return MakeCompiler()->ExportNES(file, PAL); });
+		if (options_.Formats & FMT_PRG)
+			Success &= ExportFile(".prg", [&] (CSimpleFile &file) { return MakeCompiler()->ExportPRG(file, PAL); });
+		if (options_.Formats & FMT_BIN)
+			Success &= ExportFile(".bin", [&] (CSimpleFile &file) {
+				return ExportFile("_samples.bin", [&] (CSimpleFile &dpcm) { return MakeCompiler()->ExportBIN(file, dpcm); });
+			});
+		if (options_.Formats & FMT_ASM)
+			Success &= ExportFile(".asm", [&] (CSimpleFile &file) { return MakeCompiler()->ExportASM(file); });
+		if (options_.Formats & FMT_WAV)
+			Success &= ExportWave();
+		if (options_.Verify && (options_.Formats & FMT_NSF) && Success)
+			Success &= VerifyNSF();
+
+		return Success;
+	}
+
+	std::unique_ptr<CCompiler> MakeCompiler() const {
+		// Each export uses a fresh compiler; compiled patterns are shared between all jobs
+		auto pCompiler = std::make_unique<CCompiler>(modfile_, log_);
+		pCompiler->SetCache(cache_);
+		return pCompiler;
+	}
+
+	template <typename F>
+	bool ExportFile(const char *suffix, F f) {
+		const fs::path path = Output(suffix);
+		bool Success = false;
+		{
+			CSimpleFile file {path, std::ios::out | std::ios::binary};
+			if (!file)
+				Log("Error: Could not open output file " + path.string() + ": " + file.GetErrorMessage() + '\n');
+			else if (f(file) && file) {
+				Log("Wrote " + path.string() + '\n');
+				Success = true;
+			}
+		}
+		if (!Success) {
+			std::error_code ec;
+			fs::remove(path, ec);
+		}
+		return Success;
+	}
+
+	bool ExportJson() {
+		const fs::path path = Output(".json");
+		bool Success = false;
+		{
+			std::ofstream file {path, std::ios::out | std::ios::binary};
+			if (file) {
+				WriteModuleJson(file, modfile_);
+				file << '\n';
+			}
+			if (!file)
+				Log("Error: Could not write output file " + path.string() + '\n');
+			else {
+				Log("Wrote " + path.string() + '\n');
+				Success = true;
+			}
+		}
+		if (!Success) {
+			std::error_code ec;
+			fs::remove(path, ec);
+		}
+		return Success;
+	}
+
+	bool ExportWave() {
+		const unsigned Tracks = modfile_.GetSongCount();
+		for (unsigned i = 0; i < Tracks; ++i) {
+			char suffix[16] = { };
+			std::snprintf(suffix, std::size(suffix), Tracks > 1 ? "_%02u.wav" : ".wav", i + 1);
+			const fs::path path = Output(suffix);
+
+			auto pFile = std::make_shared<CSimpleFile>(path, std::ios::out | std::ios::binary);
+			if (!*pFile) {
+				Log("Error: Could not open output file " + path.string() + ": " + pFile->GetErrorMessage() + '\n');
+				return false;
+			}
+			auto pRenderer = CWaveRendererFactory::Make(modfile_, i, options_.WavType, options_.WavParam);
+			pRenderer->SetOutputStream(std::make_unique<COutputWaveStream>(pFile,
+				CWaveFileFormat {CWaveFileFormat::format_code::pcm, 1u, CModulePlayer::SAMPLE_RATE, 16u}));
+
+			CModulePlayer Player(modfile_);
+			Player.SetupMixer(MIXER_LOW_CUT, MIXER_HIGH_CUT, MIXER_HIGH_DAMP, MIXER_VOLUME);
+			Player.Render(*pRenderer);
+			pRenderer->CloseOutputStream();
+			Log("Wrote " + path.string() + '\n');
+		}
+		return true;
+	}
+
+	bool VerifyNSF() {
+		std::ifstream nsfin(Output(".nsf"), std::ios::in | std::ios::binary);
+		std::vector<unsigned char> nsf {std::istreambuf_iterator<char> {nsfin}, std::istreambuf_iterator<char> { }};
+
+		bool Success = true;
+		CExportVerifier verifier(modfile_);
+		for (unsigned i = 0, n = modfile_.GetSongCount(); i < n; ++i) {
+			auto Result = verifier.Verify(nsf, i, VERIFY_FRAMES);
+			Log("\nTrack " + std::to_string(i + 1) + ": " + verifier.FormatResult(Result));
+			Success &= Result.Completed && !Result.Divergence;
+		}
+		return Success;
+	}
+
+	fs::path Output(const char *suffix) const {
+		return fs::path {stem_} += suffix;
+	}
+
+	void Log(std::string_view text) {
+		log_->WriteLog(text);
+	}
+
+private:
+	const stOptions &options_;
+	const fs::path &input_;
+	fs::path stem_;
+	CFamiTrackerModule modfile_;
+	std::shared_ptr<CStringLog> log_;
+	std::shared_ptr<CCompilerCache> cache_;
+};
+
+} // namespace
+
+int main(int argc, char *argv[]) try {
+	stOptions Options;
+	if (!ParseArguments(Options, argc, argv)) {
+		PrintUsage(argv[0]);
+		return 2;
+	}
+	if (!Options.OutputDir.empty())
+		fs::create_directories(Options.OutputDir);
+
+	const std::size_t Count = Options.Inputs.size();
+	const unsigned Workers = std::min<unsigned>(Count,
+		Options.Jobs ? std::min(Options.Jobs, MAX_JOBS) : std::clamp(std::thread::hardware_concurrency(), 1u, MAX_JOBS));
+
+	auto pCache = std::make_shared<CCompilerCache>();
+	if (!Options.CacheFile.empty())
+		pCache->Load(Options.CacheFile);
+
+	std::vector<stJobResult> Results(Count);
+	std::atomic<std::size_t> next {0};
+	std::mutex output_lock;
+	auto worker = [&] {
+		for (std::size_t i = next++; i < Count; i = next++) {
+			Results[i] = CModuleExporter {Options, Options.Inputs[i], pCache}.Run();
+			std::lock_guard<std::mutex> lock {output_lock};
+			std::cout << Results[i].Summary << std::endl;
+		}
+	};
+
+	std::vector<std::future<void>> futures;
+	for (unsigned i = 1; i < Workers; ++i)
+		futures.push_back(std::async(std::launch::async, worker));
+	worker();
+	for (auto &f : futures)
+		f.get();
+
+	if (!Options.CacheFile.empty()) {
+		pCache->Prune();
+		if (!pCache->Save(Options.CacheFile))
+			std::cerr << "Cannot write cache file " << Options.CacheFile.string() << '\n';
+	}
+
+	const auto Failed = std::count_if(Results.begin(), Results.end(), [] (const stJobResult &x) { return !x.Success; });
+	std::cout << (Count - Failed) << " of " << Count << " module(s) exported successfully\n";
+	return Failed ? 1 : 0;
+}
+catch (std::exception &e) {
+	std::cerr << "C++ exception: " << e.what() << '\n';
+	return 1;
+}
@@ -6,11 +6,21 @@
 #include "Kraid.h"
 #include "FamiTrackerDocIOJson.h"
 #include "SimpleFile.h"
+#include "NSFProfiler.h"
+#include "ExportVerifier.h"
+#include "SequenceEnvelope.h"
+#include "SongFlowGraph.h"
+#include "SongView.h"
+#include "PatternData.h"
+#include "SongData.h"
+#include "TrackData.h"
 
 #include "FamiTrackerDocIO.h"
 #include "DocumentFile.h"
 
 #include <iostream>
+#include <fstream>
+#include <iterator>
 
 class CStdoutLog : public CCompilerLog {
 public:
@@ -31,6 +41,80 @@ int main() try {
 	compiler.ExportNSF(nsffile, 0);
 	nsffile.Close();
 
+	std::ifstream nsfin("kraid.nsf", std::ios::in | std::ios::binary);
+	std::vector<unsigned char> nsf {std::istreambuf_iterator<char> {nsfin}, std::istreambuf_iterator<char> { }};
+	CNSFProfiler profiler;
+	if (profiler.Load(nsf)) {
+		for (const auto &sym : compiler.GetDriverSymbols())
+			profiler.AddSymbol(sym.Address, sym.Name, sym.Size);
+		std::cout << profiler.FormatReport(profiler.Run(0, 60 * 60));
+	}
+	CExportVerifier verifier(modfile);
+	const auto result = verifier.Verify(nsf, 0, 60 * 60);
+	std::cout << verifier.FormatResult(result);
+	if (!result.Completed || result.Divergence) {
+		std::cerr << "Exported NSF differs from the tracker's playback\n";
+		return 1;
+	}
+
+	// expansion chips with their own reset states must verify as well
+	for (auto chip : {sound_chip_t::FDS, sound_chip_t::VRC7}) {
+		CFamiTrackerModule expfile;
+		expfile.SetChannelMap(FTEnv.GetSoundChipService()->MakeChannelMap(CSoundChipSet {sound_chip_t::APU}.WithChip(chip), 0));
+		Kraid { }(expfile);
+		CSimpleFile expfileout("kraid_exp.nsf", std::ios::out | std::ios::binary);
+		CCompiler {expfile, std::make_unique<CStdoutLog>()}.ExportNSF(expfileout, 0);
+		expfileout.Close();
+		std::ifstream expin("kraid_exp.nsf", std::ios::in | std::ios::binary);
+		std::vector<unsigned char> expnsf {std::istreambuf_iterator<char> {expin}, std::istreambuf_iterator<char> { }};
+		CExportVerifier expverifier(expfile);
+		const auto expresult = expverifier.Verify(expnsf, 0, 60 * 60);
+		std::cout << expverifier.FormatResult(expresult);
+		if (!expresult.Completed || expresult.Divergence) {
+			std::cerr << "Exported NSF with " << FTEnv.GetSoundChipService()->GetChipFullName(chip) << " differs from the tracker's playback\n";
+			return 1;
+		}
+	}
+
+	// envelopes must be rebuilt after a sequence is assigned over another one
+	CSequence seqA {sequence_t::Volume}, seqB {sequence_t::Volume};
+	seqA.SetItemCount(1);
+	seqA.SetItem(0, 15);
+	seqB.SetItemCount(1);		// same number of edits as seqA
+	seqB.SetItem(0, 3);
+	CSequenceEnvelope env;
+	env.Compile(seqB);
+	seqB = seqA;
+	const bool stale = env.IsCompiled(seqB);
+	env.Compile(seqB);
+	if (stale || !env.IsCompiled(seqA) || env.GetValue(0) != 15) {
+		std::cerr << "Sequence envelope was not invalidated by assignment\n";
+		return 1;
+	}
+
+	// cached flow graphs must match rebuilt ones after incremental updates
+	auto &graphs = modfile.GetSongFlowGraphs();
+	const auto Lengths = [] (CSongFlowGraph &graph) {
+		return std::make_pair(graph.GetRowCount(), graph.GetSecondsCount());
+	};
+	const auto original = graphs.Visit(0, Lengths);
+	auto pSongView = modfile.MakeSongView(0, false);
+	auto &pattern = pSongView->GetPatternOnFrame(0, 0);
+	const auto oldNote = pattern.GetNoteOn(0);
+	auto newNote = oldNote;
+	newNote.Effects[0] = {effect_t::HALT, 0};
+	pattern.SetNoteOn(0, newNote);
+	graphs.Visit(0, [] (CSongFlowGraph &graph) { graph.UpdateRow(0, 0); });
+	const auto halted = graphs.Visit(0, Lengths);
+	pattern.SetNoteOn(0, oldNote);
+	graphs.Visit(0, [] (CSongFlowGraph &graph) { graph.UpdateRow(0, 0); });
+	CSongFlowGraph rebuilt {modfile, *pSongView};
+	if (halted.first != std::make_pair(1u, 0u) ||
+		graphs.Visit(0, Lengths) != original || Lengths(rebuilt) != original) {
+		std::cerr << "Cached song flow graph differs from the song\n";
+		return 1;
+	}
+
 	auto j = nlohmann::json(modfile);
 //	std::cout << j.dump(2) << '\n';
 	std::ofstream("kraid.json", std::ios::out) << j.dump() << '\n';
@@ -40,6 +124,29 @@ int main() try {
 	CFamiTrackerDocIO io {outfile, module_error_level_t::MODULE_ERROR_DEFAULT};
 	io.Save(modfile);
 	outfile.Close();
+
+	// lazily loaded patterns must match eagerly loaded ones
+	auto reload = [] (bool lazy) {
+		CFamiTrackerModule reloaded;
+		CDocumentFile infile;
+		infile.Open("kraid.0cc", std::ios::in | std::ios::binary);
+		infile.ValidateFile();
+		CFamiTrackerDocIO {infile, module_error_level_t::MODULE_ERROR_DEFAULT}.Load(reloaded, true, lazy);
+		if (lazy)		// copies of tracks that are not decoded yet must not share their loaders
+			reloaded.VisitSongs([] (CSongData &song) {
+				song.VisitTracks([] (CTrackData &track) {
+					CTrackData copy = track;
+					(void)track.GetPattern(0);
+					track = copy;
+				});
+			});
+		CPatternPrefetcher prefetch {reloaded};
+		return nlohmann::json(reloaded);
+	};
+	if (reload(true) != reload(false)) {
+		std::cerr << "Lazily loaded module differs from eagerly loaded module\n";
+		return 1;
+	}
 }
 catch (std::exception &e) {
 	std::cerr << "C++ exception: " << e.what() << '\n';
@@ -29,6 +29,17 @@ bool CAction::Merge(const CAction &Other) {		// // //
 	return false;
 }
 
+std::size_t CAction::GetMemoryUsage() const {		// // //
+	return sizeof(CAction);
+}
+
+module_block_set_t CAction::GetModifiedBlocks() const {		// // //
+	return ALL_MODULE_BLOCKS;
+}
+
+void CAction::UpdateFlowGraph(CMainFrame &cxt) const {		// // //
+}
+
 bool CAction::Commit(CMainFrame &cxt) {
 	if (done_)
 		return false;
@@ -37,6 +48,7 @@ bool CAction::Commit(CMainFrame &cxt) {
 		return false; // Operation cancelled
 	Redo(cxt);
 	SaveRedoState(cxt);
+	UpdateFlowGraph(cxt);		// // //
 	UpdateViews(cxt);
 	return done_ = true;
 }
@@ -47,6 +59,7 @@ void CAction::PerformUndo(CMainFrame &cxt) {
 		RestoreRedoState(cxt);
 		Undo(cxt);
 		RestoreUndoState(cxt);
+		UpdateFlowGraph(cxt);		// // //
 		UpdateViews(cxt);
 	}
 }
@@ -55,6 +68,7 @@ void CAction::PerformRedo(CMainFrame &cxt) {
 		RestoreUndoState(cxt);
 		Redo(cxt);
 		RestoreRedoState(cxt);
+		UpdateFlowGraph(cxt);		// // //
 		UpdateViews(cxt);
 	}
 }
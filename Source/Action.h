@@ -23,6 +23,9 @@
 
 #pragma once
 
+#include <cstddef>
+#include "ModuleBlockCache.h"		// // //
+
 class CMainFrame;		// // //
 
 // Base class for action commands
@@ -39,6 +42,10 @@ public:
 	void PerformRedo(CMainFrame &cxt);		// // //
 	// combine current action with another one, return true if permissible
 	virtual bool Merge(const CAction &Other);		// // //
+	// // // approximate number of bytes held by the action for undo / redo
+	virtual std::size_t GetMemoryUsage() const;
+	// // // module file blocks that may change when the action is performed or undone
+	virtual module_block_set_t GetModifiedBlocks() const;
 
 protected:
 	friend class CCompoundAction;		// // //
@@ -67,5 +74,8 @@ protected:
 	// // // Update views after every action
 	virtual void UpdateViews(CMainFrame &cxt) const = 0;
 
+	// // // Update the cached song flow graphs after every action
+	virtual void UpdateFlowGraph(CMainFrame &cxt) const;
+
 	bool done_ = false;
 };
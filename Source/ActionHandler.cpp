@@ -26,8 +26,8 @@
 #include "stdafx.h" // ???
 #endif
 
-CActionHandler::CActionHandler(unsigned capacity) :
-	redoPtr_(undoList_.cbegin()), capacity_(capacity)
+CActionHandler::CActionHandler(std::size_t budget) :
+	redoPtr_(undoList_.cbegin()), budget_(budget)
 {
 }
 
@@ -35,26 +35,48 @@ bool CActionHandler::AddAction(CMainFrame &cxt, std::unique_ptr<CAction> pAction
 	if (!pAction || !pAction->Commit(cxt))
 		return false;
 
+	for (auto it = redoPtr_; it != undoList_.cend(); ++it)
+		usage_ -= it->size;
 	redoPtr_ = undoList_.erase(redoPtr_, undoList_.cend());
-	if (!(CanUndo() && (*std::prev(redoPtr_))->Merge(*pAction))) {
-		undoList_.push_back(std::move(pAction));
-		if (undoList_.size() > capacity_) {
-			undoList_.pop_front();
-			lost_ = true;
+
+	if (CanUndo()) {
+		auto &last = undoList_.back();
+		if (last.action->Merge(*pAction)) {
+			usage_ -= last.size;
+			last.size = last.action->GetMemoryUsage();
+			usage_ += last.size;
+			return true;
 		}
 	}
 
+	std::size_t size = pAction->GetMemoryUsage();
+	undoList_.push_back({std::move(pAction), size});
+	usage_ += size;
+
+	// always keep the most recent action, even if it alone exceeds the budget
+	while (usage_ > budget_ && undoList_.size() > 1) {
+		usage_ -= undoList_.front().size;
+		undoList_.pop_front();
+		lost_ = true;
+	}
+
 	return true;
 }
 
-void CActionHandler::UndoLastAction(CMainFrame &cxt) {		// // //
-	if (CanUndo())
-		(*--redoPtr_)->PerformUndo(cxt);
+const CAction *CActionHandler::UndoLastAction(CMainFrame &cxt) {		// // //
+	if (!CanUndo())
+		return nullptr;
+	CAction *pAction = (--redoPtr_)->action.get();
+	pAction->PerformUndo(cxt);
+	return pAction;
 }
 
-void CActionHandler::RedoLastAction(CMainFrame &cxt) {		// // //
-	if (CanRedo())
-		(*redoPtr_++)->PerformRedo(cxt);
+const CAction *CActionHandler::RedoLastAction(CMainFrame &cxt) {		// // //
+	if (!CanRedo())
+		return nullptr;
+	CAction *pAction = (redoPtr_++)->action.get();
+	pAction->PerformRedo(cxt);
+	return pAction;
 }
 
 bool CActionHandler::ActionsLost() const {		// // //
@@ -70,3 +92,15 @@ bool CActionHandler::CanRedo() const
 {
 	return redoPtr_ != undoList_.cend();
 }
+
+std::size_t CActionHandler::GetActionCount() const {		// // //
+	return undoList_.size();
+}
+
+std::size_t CActionHandler::GetMemoryUsage() const {		// // //
+	return usage_;
+}
+
+std::size_t CActionHandler::GetMemoryBudget() const {		// // //
+	return budget_;
+}
@@ -25,6 +25,7 @@
 
 #include <list>
 #include <memory>
+#include <cstddef>		// // //
 
 class CAction;
 class CMainFrame;
@@ -33,13 +34,15 @@ class CMainFrame;
 class CActionHandler
 {
 public:
-	explicit CActionHandler(unsigned capacity);
+	// // // Actions are evicted once their total memory usage exceeds the budget in bytes
+	explicit CActionHandler(std::size_t budget);
 
 	// Add new action to undo list, return true if action is performed
 	bool AddAction(CMainFrame &cxt, std::unique_ptr<CAction> pAction);		// // //
 
-	void UndoLastAction(CMainFrame &cxt);		// // //
-	void RedoLastAction(CMainFrame &cxt);		// // //
+	// // // Undo / redo the last action, return the action performed or nullptr
+	const CAction *UndoLastAction(CMainFrame &cxt);
+	const CAction *RedoLastAction(CMainFrame &cxt);
 
 	// // // Returns true if actions are lost due to undo level exceeding limit
 	bool ActionsLost() const;
@@ -50,9 +53,24 @@ public:
 	// Returns true if there are redo objects available
 	bool CanRedo() const;
 
+	// // // Returns the number of stored undo / redo actions
+	std::size_t GetActionCount() const;
+
+	// // // Returns the approximate number of bytes held by all stored actions
+	std::size_t GetMemoryUsage() const;
+
+	// // // Returns the maximum number of bytes to retain
+	std::size_t GetMemoryBudget() const;
+
 private:
-	std::list<std::unique_ptr<CAction>> undoList_;
-	std::list<std::unique_ptr<CAction>>::const_iterator redoPtr_;
-	unsigned capacity_;
+	struct undo_entry_t {
+		std::unique_ptr<CAction> action;
+		std::size_t size;
+	};
+
+	std::list<undo_entry_t> undoList_;
+	std::list<undo_entry_t>::const_iterator redoPtr_;
+	std::size_t budget_;
+	std::size_t usage_ = 0u;
 	bool lost_ = false;
 };
@@ -0,0 +1,79 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2018 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+** Library General Public License for more details.  To obtain a
+** copy of the GNU Library General Public License, write to the Free
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+#pragma once
+
+#include <string_view>
+#include <cstdint>
+#include "array_view.h"
+
+// // // bounds-checked little-endian reader over a mapped file
+class CByteReader {
+public:
+	explicit CByteReader(array_view<unsigned char> data) : data_(data) { }
+
+	bool Good() const {
+		return good_;
+	}
+	bool Finished() const {
+		return pos_ == data_.size();
+	}
+
+	std::uint32_t ReadInt(std::size_t bytes) {
+		if (!Require(bytes))
+			return 0u;
+		std::uint32_t x = 0u;
+		for (std::size_t i = 0; i < bytes; ++i)
+			x |= static_cast<std::uint32_t>(data_[pos_++]) << (i * 8);
+		return x;
+	}
+	std::uint64_t ReadInt64() {
+		std::uint64_t lo = ReadInt(4);
+		return lo | (static_cast<std::uint64_t>(ReadInt(4)) << 32);
+	}
+	std::string_view ReadBytes(std::size_t count) {
+		if (!Require(count))
+			return { };
+		std::string_view sv {reinterpret_cast<const char *>(data_.data() + pos_), count};
+		pos_ += count;
+		return sv;
+	}
+	std::string_view ReadString() {
+		return ReadBytes(ReadInt(4));
+	}
+	void Skip(std::size_t count) {
+		if (Require(count))
+			pos_ += count;
+	}
+
+private:
+	bool Require(std::size_t count) {
+		if (good_ && count > data_.size() - pos_)
+			good_ = false;
+		return good_;
+	}
+
+	array_view<unsigned char> data_;
+	std::size_t pos_ = 0u;
+	bool good_ = true;
+};
@@ -29,6 +29,7 @@
 #include "InstHandler.h"		// // //
 #include "InstHandlerVRC7.h"		// // //
 #include "ChipHandlerVRC7.h"		// // //
+#include <algorithm>		// // //
 
 namespace {
 
@@ -250,7 +251,7 @@ void CChannelHandlerVRC7::RefreshChannel()
 //	int Note = m_iTriggeredNote;
 	int Volume = CalculateVolume();
 	int Fnum = CalculatePeriod();		// // //
-	int Bnum = !m_bLinearPitch ? m_iOctave :
+	int Bnum = !m_bLinearPitch ? std::max(m_iOctave, 0) :		// // // no octave before the first note
 		((GetPeriod() + GetVibrato() - GetFinePitch() - GetPitch()) >> LINEAR_PITCH_AMOUNT) / NOTE_RANGE;
 
 	if (m_iPatch != -1) {		// // //
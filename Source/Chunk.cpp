@@ -23,18 +23,45 @@
 #include "Chunk.h"
 #include "Assertion.h"		// // //
 
+// // // CChunkLabelTable
+
+std::size_t CChunkLabelTable::stLabelHash::operator()(const stChunkLabel &label) const noexcept {
+	std::size_t h = label.Type;
+	for (unsigned x : {label.Param1, label.Param2, label.Param3})
+		h = h * 0x9E3779B1u + x;
+	return h;
+}
+
+unsigned CChunkLabelTable::GetId(const stChunkLabel &label) {
+	auto [it, inserted] = m_Ids.try_emplace(label, (unsigned)m_vLabels.size());
+	if (inserted)
+		m_vLabels.push_back(label);
+	return it->second;
+}
+
+const stChunkLabel &CChunkLabelTable::GetLabel(unsigned id) const {
+	return m_vLabels[id];
+}
+
+unsigned CChunkLabelTable::GetCount() const {
+	return m_vLabels.size();
+}
+
 /**
  * CChunk - Stores NSF data
  *
  */
 
-CChunk::CChunk(const stChunkLabel &label) : m_stChunkLabel(label)		// // //
+CChunk::CChunk(const stChunkLabel &label, CChunkLabelTable &labels) :		// // //
+	m_stChunkLabel(label), m_iLabelId(labels.GetId(label)), m_pLabels(&labels)
 {
 }
 
 void CChunk::Clear()
 {
-	m_vChunkData.clear();
+	m_vBuffer.clear();		// // //
+	m_vItems.clear();
+	m_vRelocs.clear();
 }
 
 chunk_type_t CChunk::GetType() const
@@ -52,6 +79,11 @@ void CChunk::SetBank(unsigned char Bank)
 	m_iBank = Bank;
 }
 
+unsigned CChunk::GetLabelId() const		// // //
+{
+	return m_iLabelId;
+}
+
 unsigned char CChunk::GetBank() const
 {
 	return m_iBank;
@@ -60,116 +92,164 @@ unsigned char CChunk::GetBank() const
 int CChunk::GetLength() const
 {
 	// Return number of data items in the collection
-	return m_vChunkData.size();
+	return m_vItems.size();
 }
 
 unsigned short CChunk::GetData(int index) const
 {
-	return m_vChunkData[index]->GetData();
+	const auto &item = m_vItems[index];		// // //
+	switch (item.Kind) {
+	case chunk_data_t::byte: case chunk_data_t::bank:
+		return m_vBuffer[item.Offset];
+	case chunk_data_t::word: case chunk_data_t::pointer:
+		return m_vBuffer[item.Offset] | (m_vBuffer[item.Offset + 1] << 8);
+	default:
+		return 0;	// Invalid for strings
+	}
 }
 
 unsigned short CChunk::GetDataSize(int index) const
 {
-	return m_vChunkData[index]->GetSize();
+	return m_vItems[index].Size;		// // //
 }
 
 void CChunk::StoreByte(unsigned char data)
 {
-	DoAddChunk<CChunkDataByte>(data);		// // //
+	AddItem(chunk_data_t::byte, {&data, 1});		// // //
 }
 
 void CChunk::StoreWord(unsigned short data)
 {
-	DoAddChunk<CChunkDataWord>(data);		// // //
+	const unsigned char bytes[] = {(unsigned char)(data & 0xFF), (unsigned char)(data >> 8)};		// // //
+	AddItem(chunk_data_t::word, bytes);
 }
 
 void CChunk::StorePointer(const stChunkLabel &label)		// // //
 {
-	DoAddChunk<CChunkDataPointer>(label);
+	const unsigned char bytes[] = {0xFF, 0xFF};
+	AddItem(chunk_data_t::pointer, bytes, AddReloc(label));
 }
 
 void CChunk::StoreBankReference(const stChunkLabel &label, int bank)		// // //
 {
-	DoAddChunk<CChunkDataBank>(label, bank);
+	const unsigned char byte = bank;
+	AddItem(chunk_data_t::bank, {&byte, 1}, AddReloc(label));
 }
 
 void CChunk::StoreString(const std::vector<unsigned char> &data)		// // //
 {
-	DoAddChunk<CChunkDataString>(data);		// // //
+	AddItem(chunk_data_t::string, data);		// // //
 }
 
 void CChunk::ChangeByte(int index, unsigned char data)
 {
-	GetChunkData<CChunkDataByte>(index).m_data = data;		// // //
+	m_vBuffer[GetItem(index, chunk_data_t::byte).Offset] = data;		// // //
 }
 
 void CChunk::SetupBankData(int index, unsigned char bank)
 {
-	GetChunkData<CChunkDataBank>(index).m_bank = bank;
+	m_vBuffer[GetItem(index, chunk_data_t::bank).Offset] = bank;		// // //
 }
 
 unsigned char CChunk::GetStringData(int index, int pos) const
 {
-	return GetChunkData<const CChunkDataString>(index).m_vData[pos];
+	return GetStringData(index)[pos];		// // //
 }
 
-const std::vector<unsigned char> &CChunk::GetStringData(int index) const
+array_view<unsigned char> CChunk::GetStringData(int index) const		// // //
 {
-	return GetChunkData<const CChunkDataString>(index).m_vData;
+	const auto &item = GetItem(index, chunk_data_t::string);
+	return {m_vBuffer.data() + item.Offset, item.Size};
+}
+
+array_view<unsigned char> CChunk::GetBuffer() const		// // //
+{
+	return m_vBuffer;
 }
 
 stChunkLabel CChunk::GetDataPointerTarget(int index) const		// // //
 {
-	auto pChunkData = dynamic_cast<CChunkDataPointer *>(m_vChunkData[index].get());
-	return pChunkData ? pChunkData->m_Label : stChunkLabel { };
+	auto pReloc = GetReloc(index, chunk_data_t::pointer);
+	return pReloc ? m_pLabels->GetLabel(pReloc->LabelId) : stChunkLabel { };
+}
+
+void CChunk::SetDataPointerTarget(int index, const stChunkLabel &label, unsigned offset)		// // //
+{
+	SetDataPointerId(index, m_pLabels->GetId(label), offset);
 }
 
-void CChunk::SetDataPointerTarget(int index, const stChunkLabel &label)		// // //
+unsigned CChunk::GetDataPointerOffset(int index) const		// // //
 {
-	if (auto pChunkData = dynamic_cast<CChunkDataPointer *>(m_vChunkData[index].get()))
-		pChunkData->m_Label = label;
+	auto pReloc = GetReloc(index, chunk_data_t::pointer);
+	return pReloc ? pReloc->Offset : 0u;
+}
+
+unsigned CChunk::GetDataPointerId(int index) const		// // //
+{
+	auto pReloc = GetReloc(index, chunk_data_t::pointer);
+	return pReloc ? pReloc->LabelId : CChunkLabelTable::NO_LABEL;
+}
+
+void CChunk::SetDataPointerId(int index, unsigned id, unsigned offset)		// // //
+{
+	if (m_vItems[index].Kind == chunk_data_t::pointer) {
+		auto &reloc = m_vRelocs[m_vItems[index].Reloc];
+		reloc.LabelId = id;
+		reloc.Offset = offset;
+	}
 }
 
 bool CChunk::IsDataPointer(int index) const
 {
-	return dynamic_cast<CChunkDataPointer *>(m_vChunkData[index].get()) != nullptr;
+	return m_vItems[index].Kind == chunk_data_t::pointer;		// // //
 }
 
 bool CChunk::IsDataBank(int index) const
 {
-	return dynamic_cast<CChunkDataBank *>(m_vChunkData[index].get()) != nullptr;
+	return m_vItems[index].Kind == chunk_data_t::bank;		// // //
 }
 
 unsigned int CChunk::CountDataSize() const
 {
-	return m_iTotalSize;		// // //
+	return m_vBuffer.size();		// // //
 }
 
-void CChunk::AssignLabels(std::map<stChunkLabel, int> &labelMap)		// // //
+void CChunk::AssignLabels(const std::vector<int> &Offsets)		// // //
 {
-	for (auto &x : m_vChunkData)
-		if (auto pChunkData = dynamic_cast<CChunkDataPointer *>(x.get())) {
-			if (auto it = labelMap.find(pChunkData->m_Label); it != labelMap.end())		// // //
-				pChunkData->ref = it->second;
-			else
-				DEBUG_BREAK();
-		}
+	for (const auto &reloc : m_vRelocs) {		// // //
+		const auto &item = m_vItems[reloc.Item];
+		if (item.Kind != chunk_data_t::pointer)
+			continue;
+		if (reloc.LabelId < Offsets.size() && Offsets[reloc.LabelId] >= 0)		// // //
+			WriteWord(item.Offset, Offsets[reloc.LabelId] + reloc.Offset);		// // //
+		else
+			DEBUG_BREAK();
+	}
 }
 
 // // //
-template <typename T>
-T &CChunk::GetChunkData(std::size_t index) const {
-#ifdef _DEBUG		// // //
-	return dynamic_cast<T &>(*m_vChunkData.at(index));
-#else
-	return static_cast<T &>(*m_vChunkData[index]);
-#endif
-}
-
-template <typename T, typename... Args>
-void CChunk::DoAddChunk(Args&&... args) {
-	if (auto ptr = std::make_unique<T>(std::forward<Args>(args)...)) {
-		m_iTotalSize += ptr->GetSize();
-		m_vChunkData.push_back(std::move(ptr));
-	}
+void CChunk::AddItem(chunk_data_t Kind, array_view<unsigned char> Data, unsigned Reloc) {
+	m_vItems.push_back({(unsigned)m_vBuffer.size(), (unsigned)Data.size(), Kind, Reloc});
+	m_vBuffer.insert(m_vBuffer.end(), Data.begin(), Data.end());
+}
+
+unsigned CChunk::AddReloc(const stChunkLabel &Label) {
+	m_vRelocs.push_back({(unsigned)m_vItems.size(), m_pLabels->GetId(Label), 0u});
+	return m_vRelocs.size() - 1;
+}
+
+const CChunk::stChunkItem &CChunk::GetItem(int index, chunk_data_t Kind) const {
+	const auto &item = m_vItems[index];
+	Assert(item.Kind == Kind);
+	return item;
+}
+
+const CChunk::stChunkReloc *CChunk::GetReloc(int index, chunk_data_t Kind) const {
+	const auto &item = m_vItems[index];
+	return item.Kind == Kind ? &m_vRelocs[item.Reloc] : nullptr;
+}
+
+void CChunk::WriteWord(unsigned Offset, unsigned short data) {
+	m_vBuffer[Offset] = data & 0xFF;
+	m_vBuffer[Offset + 1] = data >> 8;
 }
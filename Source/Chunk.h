@@ -25,7 +25,9 @@
 
 #include <vector>		// // //
 #include <memory>		// // //
-#include <map>		// // //
+#include <tuple>		// // //
+#include <unordered_map>		// // //
+#include "array_view.h"		// // //
 
 // Helper classes/objects for NSF compiling
 
@@ -72,67 +74,32 @@ struct stChunkLabel {
 	}
 };
 
-class CChunkData
-{
-protected:		// // //
-	CChunkData() = default;
-
-public:
-	virtual ~CChunkData() = default;
-	virtual int GetSize() const = 0;
-	virtual unsigned short GetData() const = 0;
-};
-
-class CChunkDataByte : public CChunkData
-{
-public:
-	CChunkDataByte(unsigned char data) : CChunkData(), m_data(data) { }
-	int GetSize() const override { return 1; }
-
-	unsigned short GetData() const override { return m_data; }
-	unsigned char m_data;
-};
-
-class CChunkDataWord : public CChunkData
-{
-public:
-	CChunkDataWord(unsigned short data) : CChunkData(), m_data(data) { }
-	int GetSize() const override { return 2; }
-
-	unsigned short GetData() const override { return m_data; }
-	unsigned short m_data;
-};
-
-class CChunkDataPointer : public CChunkData
+// // // Assigns dense ids to chunk labels, so that labels can be resolved by indexing
+class CChunkLabelTable
 {
 public:
-	CChunkDataPointer(const stChunkLabel &label) : CChunkData(), m_Label(label) { }		// // //
-	int GetSize() const override { return 2; }
-	unsigned short GetData() const override { return ref; }
+	static constexpr unsigned NO_LABEL = (unsigned)-1;
 
-	stChunkLabel m_Label;
-	unsigned short ref = 0xFFFF;
-};
+	unsigned		GetId(const stChunkLabel &label);
+	const stChunkLabel &GetLabel(unsigned id) const;
+	unsigned		GetCount() const;
 
-class CChunkDataBank : public CChunkData
-{
-public:
-	CChunkDataBank(const stChunkLabel &label, int bank) : CChunkData(), m_Label(label), m_bank(bank) { }		// // //
-	int GetSize() const override { return 1; }
-	unsigned short GetData() const override { return m_bank; }
+private:
+	struct stLabelHash {
+		std::size_t operator()(const stChunkLabel &label) const noexcept;
+	};
 
-	stChunkLabel m_Label;		// // // Reference to a label which belongs to the bank this data should point to
-	unsigned int m_bank;
+	std::unordered_map<stChunkLabel, unsigned, stLabelHash> m_Ids;
+	std::vector<stChunkLabel> m_vLabels;
 };
 
-class CChunkDataString : public CChunkData
-{
-public:
-	CChunkDataString(const std::vector<unsigned char> &data) : CChunkData(), m_vData(data) { }
-	int GetSize() const override { return m_vData.size(); }
-	unsigned short GetData() const override { return 0; }	// Invalid for this type
-
-	std::vector<unsigned char> m_vData;		// // //
+// // // Kinds of data items stored in a chunk
+enum class chunk_data_t : unsigned char {
+	byte,
+	word,
+	pointer,		// word resolved from a label
+	bank,			// byte resolved from the bank of a label
+	string,
 };
 
 //
@@ -142,12 +109,13 @@ public:
 class CChunk
 {
 public:
-	explicit CChunk(const stChunkLabel &label);		// // //
+	CChunk(const stChunkLabel &label, CChunkLabelTable &labels);		// // //
 
 	void			Clear();
 
 	chunk_type_t	GetType() const;
 	const stChunkLabel &GetLabel() const;		// // //
+	unsigned		GetLabelId() const;		// // //
 	void			SetBank(unsigned char Bank);
 	unsigned char	GetBank() const;
 
@@ -166,25 +134,49 @@ public:
 	void			SetupBankData(int index, unsigned char bank);
 
 	stChunkLabel	GetDataPointerTarget(int index) const;		// // //
-	void			SetDataPointerTarget(int index, const stChunkLabel &label);		// // //
+	void			SetDataPointerTarget(int index, const stChunkLabel &label, unsigned offset = 0);		// // //
+	unsigned		GetDataPointerOffset(int index) const;		// // //
+	unsigned		GetDataPointerId(int index) const;		// // //
+	void			SetDataPointerId(int index, unsigned id, unsigned offset = 0);		// // //
 
 	bool			IsDataPointer(int index) const;
 	bool			IsDataBank(int index) const;
 
 	unsigned char	GetStringData(int index, int pos) const;
-	const std::vector<unsigned char> &GetStringData(int index) const;
+	array_view<unsigned char> GetStringData(int index) const;		// // //
 
-	void			AssignLabels(std::map<stChunkLabel, int> &labelMap);		// // //
+	array_view<unsigned char> GetBuffer() const;		// // //
 
-private:
-	template <typename T>		// // //
-	T &GetChunkData(std::size_t index) const;
-	template <typename T, typename... Args>
-	void DoAddChunk(Args&&... args);
+	void			AssignLabels(const std::vector<int> &Offsets);		// // //
 
-	std::vector<std::unique_ptr<CChunkData>> m_vChunkData;		// // // List of data stored in this chunk
+private:
+	// // // Data item, refers to a range of the byte buffer
+	struct stChunkItem {
+		unsigned Offset;
+		unsigned Size;
+		chunk_data_t Kind;
+		unsigned Reloc;		// index into the relocation table for pointers and bank references
+	};
+
+	// // // Data item which must be resolved from a label
+	struct stChunkReloc {
+		unsigned Item;
+		unsigned LabelId;		// target of a pointer, or a label in the bank a bank reference points to
+		unsigned Offset;		// byte offset from the label
+	};
+
+	void AddItem(chunk_data_t Kind, array_view<unsigned char> Data, unsigned Reloc = -1);
+	unsigned AddReloc(const stChunkLabel &Label);
+	const stChunkItem &GetItem(int index, chunk_data_t Kind) const;
+	const stChunkReloc *GetReloc(int index, chunk_data_t Kind) const;
+	void WriteWord(unsigned Offset, unsigned short data);
+
+	std::vector<unsigned char> m_vBuffer;		// // // Little-endian contents of this chunk
+	std::vector<stChunkItem> m_vItems;		// // // List of data stored in this chunk
+	std::vector<stChunkReloc> m_vRelocs;		// // //
 
 	stChunkLabel m_stChunkLabel;		// // // Label of this chunk
+	unsigned m_iLabelId;		// // //
+	CChunkLabelTable *m_pLabels;		// // //
 	unsigned char m_iBank = 0;		// The bank this chunk will be stored in
-	unsigned m_iTotalSize = 0;		// // // cache
 };
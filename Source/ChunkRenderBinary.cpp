@@ -72,15 +72,7 @@ void CChunkRenderBinary::StoreSamples(const std::vector<std::shared_ptr<const ft
 
 void CChunkRenderBinary::StoreChunk(const CChunk &Chunk)		// // //
 {
-	for (int i = 0, n = Chunk.GetLength(); i < n; ++i) {
-		if (Chunk.GetType() == CHUNK_PATTERN)
-			Store(Chunk.GetStringData(CCompiler::PATTERN_CHUNK_INDEX));
-		else {
-			unsigned short data = Chunk.GetData(i);
-			unsigned short size = Chunk.GetDataSize(i);
-			Store({reinterpret_cast<const std::uint8_t *>(&data), size});
-		}
-	}
+	Store(Chunk.GetBuffer());
 }
 
 void CChunkRenderBinary::StoreSample(const ft0cc::doc::dpcm_sample &DSample)
@@ -143,15 +135,22 @@ void CChunkRenderNSF::StoreSamples(const std::vector<std::shared_ptr<const ft0cc
 		StoreSample(*ptr);
 }
 
-void CChunkRenderNSF::StoreSamplesBankswitched(const std::vector<std::shared_ptr<const ft0cc::doc::dpcm_sample>> &Samples)
+void CChunkRenderNSF::StoreSamplesBankswitched(const std::vector<std::vector<std::shared_ptr<const ft0cc::doc::dpcm_sample>>> &Windows)
 {
 	// Start samples on a clean bank
 	if ((GetAbsoluteAddr() & 0xFFF) != 0)
 		AllocateNewBank();
 
-	m_iSampleAddr = CCompiler::PAGE_SAMPLES;
-	for (auto ptr : Samples)		// // //
-		StoreSampleBankswitched(*ptr);
+	// // // Each sample window occupies a fixed number of banks
+	int WindowBank = GetBank();
+	for (const auto &Samples : Windows) {
+		while (GetBank() < WindowBank)
+			AllocateNewBank();
+		m_iSampleAddr = CCompiler::PAGE_SAMPLES;
+		for (auto ptr : Samples)		// // //
+			StoreSampleBankswitched(*ptr);
+		WindowBank += CCompiler::DPCM_PAGE_WINDOW;
+	}
 }
 
 void CChunkRenderNSF::StoreSample(const ft0cc::doc::dpcm_sample &DSample)
@@ -165,13 +164,7 @@ void CChunkRenderNSF::StoreSampleBankswitched(const ft0cc::doc::dpcm_sample &DSa
 {
 	unsigned int SampleSize = DSample.size();
 
-	if (m_iSampleAddr + SampleSize >= (unsigned)CCompiler::DPCM_SWITCH_ADDRESS) {
-		// Allocate new bank
-		if (GetRemainingSize() != 0x1000)	// Skip if already on beginning of new bank
-			AllocateNewBank();
-		m_iSampleAddr = CCompiler::PAGE_SAMPLES;
-	}
-
+	// // // Window changes are laid out by the compiler
 	int Adjust = CCompiler::AdjustSampleAddress(m_iSampleAddr + SampleSize);
 	Store(DSample);
 	Fill(Adjust);
@@ -200,15 +193,7 @@ void CChunkRenderNSF::StoreChunkBankswitched(const CChunk &Chunk)		// // //
 
 void CChunkRenderNSF::StoreChunk(const CChunk &Chunk)		// // //
 {
-	for (int i = 0, n = Chunk.GetLength(); i < n; ++i) {
-		if (Chunk.GetType() == CHUNK_PATTERN)
-			Store(Chunk.GetStringData(CCompiler::PATTERN_CHUNK_INDEX));
-		else {
-			unsigned short data = Chunk.GetData(i);
-			unsigned short size = Chunk.GetDataSize(i);
-			Store({reinterpret_cast<const std::uint8_t *>(&data), size});
-		}
-	}
+	Store(Chunk.GetBuffer());
 }
 
 int CChunkRenderNSF::GetRemainingSize() const
@@ -79,7 +79,7 @@ public:
 	void StoreChunks(const std::vector<std::shared_ptr<CChunk>> &Chunks);		// // //
 	void StoreChunksBankswitched(const std::vector<std::shared_ptr<CChunk>> &Chunks);
 	void StoreSamples(const std::vector<std::shared_ptr<const ft0cc::doc::dpcm_sample>> &Samples);
-	void StoreSamplesBankswitched(const std::vector<std::shared_ptr<const ft0cc::doc::dpcm_sample>> &Samples);
+	void StoreSamplesBankswitched(const std::vector<std::vector<std::shared_ptr<const ft0cc::doc::dpcm_sample>>> &Windows);		// // //
 	int  GetBankCount() const;
 
 protected:
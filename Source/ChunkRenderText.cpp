@@ -244,7 +244,7 @@ void CChunkRenderText::StoreInstrumentChunk(const CChunk *pChunk)
 void CChunkRenderText::StoreSequenceChunk(const CChunk *pChunk)
 {
 	std::string str = GetLabelString(pChunk->GetLabel()) + ":\n";
-	str += GetByteString(pChunk, DEFAULT_LINE_BREAK);		// // //
+	str += GetByteString(pChunk->GetBuffer(), DEFAULT_LINE_BREAK);		// // //
 
 	m_sequenceStrings.push_back(std::move(str));
 }
@@ -301,7 +301,7 @@ void CChunkRenderText::StoreGrooveChunk(const CChunk *pChunk)		// // //
 	std::string str;
 
 	// std::string str = GetLabelString(pChunk->GetLabel()) + ":\n";
-	str += GetByteString(pChunk, DEFAULT_LINE_BREAK);
+	str += GetByteString(pChunk->GetBuffer(), DEFAULT_LINE_BREAK);
 
 	m_grooveStrings.push_back(std::move(str));
 }
@@ -361,6 +361,8 @@ void CChunkRenderText::StoreFrameChunk(const CChunk *pChunk)
 			if (j++ > 0)
 				str += ", ";
 			str += GetLabelString(pChunk->GetDataPointerTarget(i));
+			if (unsigned Offset = pChunk->GetDataPointerOffset(i))		// // // shared pattern data
+				str += "+" + conv::from_uint(Offset);
 		}
 	}
 
@@ -386,8 +388,8 @@ void CChunkRenderText::StorePatternChunk(const CChunk *pChunk)
 	std::string str = "; Bank " + conv::from_uint(pChunk->GetBank()) + "\n";
 	str += GetLabelString(pChunk->GetLabel()) + ":\n";
 
-	const std::vector<unsigned char> &vec = pChunk->GetStringData(0);		// // //
-	str += GetByteString(vec, DEFAULT_LINE_BREAK).data();
+	auto vec = pChunk->GetStringData(0);		// // //
+	str += GetByteString(vec, DEFAULT_LINE_BREAK);
 /*
 	len = vec.size();
 	for (int i = 0; i < len; ++i) {
@@ -483,22 +485,3 @@ std::string CChunkRenderText::GetByteString(array_view<unsigned char> Data, int
 	str += '\n';
 	return str;
 }
-
-std::string CChunkRenderText::GetByteString(const CChunk *pChunk, int LineBreak) {		// // //
-	int len = pChunk->GetLength();
-
-	std::string str = "\t.byte ";
-
-	for (int i = 0; i < len; ++i) {
-		str += '$';
-		str += conv::sv_from_uint_hex(pChunk->GetData(i), 2);
-
-		if ((i % LineBreak == (LineBreak - 1)) && (i < len - 1))
-			str += "\n\t.byte ";
-		else if (i < len - 1)
-			str += ", ";
-	}
-
-	str += '\n';
-	return str;
-}
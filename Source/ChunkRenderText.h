@@ -60,7 +60,6 @@ private:
 	static const stChunkRenderFunc RENDER_FUNCTIONS[];
 	static std::string GetLabelString(const stChunkLabel &label);		// // //
 	static std::string GetByteString(array_view<unsigned char> Data, int LineBreak);		// // //
-	static std::string GetByteString(const CChunk *pChunk, int LineBreak);		// // //
 
 private:
 	void DumpStrings(std::string_view preStr, std::string_view postStr, const std::vector<std::string> &stringArray) const;		// // //
@@ -44,11 +44,16 @@
 #include "InstrumentService.h"		// // //
 #include "InstCompiler.h"		// // //
 #include "SongLengthScanner.h"		// // //
+#include "CompilerCache.h"		// // //
 #include "NumConv.h"		// // //
 #include "str_conv/str_conv.hpp"		// // //
 #include "SoundChipService.h"		// // //
 #include "SimpleFile.h"		// // //
 #include "Assertion.h"		// // //
+#include <algorithm>		// // //
+#include <atomic>		// // //
+#include <future>		// // //
+#include <thread>		// // //
 
 //
 // This is the new NSF data compiler, music is compiled to an object list instead of a binary chunk
@@ -62,7 +67,6 @@
  *  - Remove the bank value in CHUNK_SONG??
  *  - Derive classes for each output format instead of separate functions
  *  - Create a config file for NSF driver optimizations
- *  - Pattern hash collisions prevents detecting similar patterns, fix that
  *  - Add bankswitching schemes for other memory mappers
  *
  */
@@ -99,6 +103,9 @@
 // Remove duplicated patterns (default on)
 #define REMOVE_DUPLICATE_PATTERNS
 
+// Point patterns into longer patterns which contain them (default on)
+#define SHARE_PATTERN_DATA
+
 // Don't remove patterns across different tracks (default off)
 //#define LOCAL_DUPLICATE_PATTERN_REMOVAL
 
@@ -108,6 +115,88 @@
 // // //
 inline constexpr std::size_t DATA_HEADER_SIZE = 8u;
 
+// // // Maximum number of threads used to compile patterns
+inline constexpr unsigned MAX_PATTERN_WORKERS = 16u;
+
+namespace {
+
+// // // collects the messages of a single pattern so they can be printed in order
+class CCompilerLogBuffer final : public CCompilerLog {
+public:
+	void WriteLog(std::string_view text) override {
+		buf_ += text;
+	}
+	void Clear() override {
+		buf_.clear();
+	}
+	std::string Take() {
+		return std::exchange(buf_, std::string { });
+	}
+
+private:
+	std::string buf_;
+};
+
+// // // 64-bit FNV-1a over compiled pattern data
+std::uint64_t HashPatternData(const std::vector<unsigned char> &data) {
+	std::uint64_t h = 0xCBF29CE484222325ull;
+	for (unsigned char x : data) {
+		h ^= x;
+		h *= 0x100000001B3ull;
+	}
+	return h;
+}
+
+// // // identifies the pattern compiler and sound driver build whose output a pattern cache holds
+std::string GetCacheRevision() {
+	std::uint64_t h = 0xCBF29CE484222325ull;
+	auto hash = [&h] (auto data) {
+		for (auto x : data)
+			for (std::size_t i = 0; i < sizeof(x); ++i) {
+				h ^= (static_cast<std::uint64_t>(x) >> (i * 8)) & 0xFFu;
+				h *= 0x100000001B3ull;
+			}
+	};
+	for (const driver_t *pDriver : {&DRIVER_PACK_2A03, &DRIVER_PACK_VRC6, &DRIVER_PACK_VRC7, &DRIVER_PACK_MMC5,
+		&DRIVER_PACK_FDS, &DRIVER_PACK_N163, &DRIVER_PACK_S5B, &DRIVER_PACK_ALL}) {
+		hash(pDriver->driver);
+		hash(pDriver->word_reloc);
+		hash(pDriver->freq_table);
+		hash(pDriver->adr_reloc);
+	}
+
+	return std::string {Get0CCFTVersionString()} + ' ' + conv::from_uint_hex(CPatternCompiler::GetBuildFlags(), 8) +
+		' ' + conv::from_uint_hex(h, 16);
+}
+
+// // // suffix array of a symbol string by prefix doubling
+std::vector<std::uint32_t> BuildSuffixArray(const std::vector<unsigned> &text) {
+	const std::size_t n = text.size();
+	std::vector<std::uint32_t> sa(n);
+	std::vector<unsigned> rank(text), tmp(n);
+	for (std::size_t i = 0; i < n; ++i)
+		sa[i] = static_cast<std::uint32_t>(i);
+
+	for (std::size_t k = 1; n > 1; k <<= 1) {
+		const auto key = [&] (std::uint32_t i) {
+			return std::make_pair(rank[i], i + k < n ? rank[i + k] + 1 : 0u);
+		};
+		std::sort(sa.begin(), sa.end(), [&] (std::uint32_t a, std::uint32_t b) {
+			return key(a) < key(b);
+		});
+		tmp[sa[0]] = 0;
+		for (std::size_t i = 1; i < n; ++i)
+			tmp[sa[i]] = tmp[sa[i - 1]] + (key(sa[i - 1]) < key(sa[i]) ? 1 : 0);
+		rank.swap(tmp);
+		if (rank[sa[n - 1]] == n - 1)
+			break;
+	}
+
+	return sa;
+}
+
+} // namespace
+
 const int CCompiler::PATTERN_CHUNK_INDEX		= 0;		// Fixed at 0 for the moment
 
 const int CCompiler::PAGE_SIZE					= 0x1000;
@@ -141,6 +230,7 @@ CCompiler::CCompiler(const CFamiTrackerModule &modfile, std::shared_ptr<CCompile
 	title_(m_pModule->GetModuleName()),
 	artist_(m_pModule->GetModuleArtist()),
 	copyright_(m_pModule->GetModuleCopyright()),
+	m_pLabels(std::make_unique<CChunkLabelTable>()),		// // //
 	m_pLogger(std::move(pLogger))
 {
 	ClearLog();		// // //
@@ -191,8 +281,7 @@ std::size_t NSFEWriteBlocks(CSimpleFile &file, const CFamiTrackerModule &modfile
 	NSFEWriteBlockIdent(file, "time", iTimeSize);
 
 	modfile.VisitSongs([&] (const CSongData &song, unsigned i) {
-		auto pSongView = modfile.MakeSongView(i, false);
-		CSongLengthScanner scanner {modfile, *pSongView};
+		CSongLengthScanner scanner {modfile, i};		// // //
 		auto [FirstLoop, SecondLoop] = scanner.GetSecondsCount();
 		file.WriteInt32(static_cast<int>((FirstLoop + SecondLoop) * 1000.0 + 0.5));
 	});
@@ -210,12 +299,12 @@ std::size_t NSFEWriteBlocks(CSimpleFile &file, const CFamiTrackerModule &modfile
 
 } // namespace
 
-void CCompiler::ExportNSF_NSFE(CSimpleFile &file, int MachineType, bool isNSFE) {
+bool CCompiler::ExportNSF_NSFE(CSimpleFile &file, int MachineType, bool isNSFE) {		// // //
 	if (m_bBankSwitched) {
 		// Expand and allocate label addresses
 		AddBankswitching();
 		if (!ResolveLabelsBankswitched()) {
-			return;
+			return false;
 		}
 		// Write bank data
 		UpdateFrameBanks();
@@ -273,7 +362,7 @@ void CCompiler::ExportNSF_NSFE(CSimpleFile &file, int MachineType, bool isNSFE)
 	if (m_bBankSwitched) {
 		Render.StoreDriver(Driver);
 		Render.StoreChunksBankswitched(m_vChunks);
-		Render.StoreSamplesBankswitched(m_vSamples);
+		Render.StoreSamplesBankswitched(m_vSampleWindows);		// // //
 	}
 	else {
 		if (bCompressedMode) {
@@ -313,12 +402,13 @@ void CCompiler::ExportNSF_NSFE(CSimpleFile &file, int MachineType, bool isNSFE)
 	}
 
 	Print("Done, total file size: " + conv::from_uint(file.GetPosition()) + " bytes\n");
+	return true;
 }
 
-void CCompiler::ExportNES_PRG(CSimpleFile &file, bool EnablePAL, bool isPRG) {
+bool CCompiler::ExportNES_PRG(CSimpleFile &file, bool EnablePAL, bool isPRG) {		// // //
 	if (m_bBankSwitched) {
 		Print("Error: Can't write bankswitched songs!\n");
-		return;
+		return false;
 	}
 
 	// Convert to binary
@@ -363,12 +453,13 @@ void CCompiler::ExportNES_PRG(CSimpleFile &file, bool EnablePAL, bool isPRG) {
 	Print(" * Driver size: " + conv::from_int(m_iDriverSize) + " bytes\n");
 	Print(" * Song data size: " + conv::from_int(m_iMusicDataSize) + " bytes (" + conv::from_int(Percent) + "%)\n");
 	Print("Done, total file size: " + conv::from_int(0x8000 + (isPRG ? 0 : std::size(NES_HEADER))) + " bytes\n");
+	return true;
 }
 
-void CCompiler::ExportBIN_ASM(CSimpleFile &binFile, CSimpleFile *dpcmFile, bool isASM) {
+bool CCompiler::ExportBIN_ASM(CSimpleFile &binFile, CSimpleFile *dpcmFile, bool isASM) {		// // //
 	if (m_bBankSwitched) {
 		Print("Error: Can't write bankswitched songs!\n");
-		return;
+		return false;
 	}
 
 	// Convert to binary
@@ -397,51 +488,64 @@ void CCompiler::ExportBIN_ASM(CSimpleFile &binFile, CSimpleFile *dpcmFile, bool
 	Print(" * Music data size: " + conv::from_int(m_iMusicDataSize) + " bytes\n");
 	Print(" * DPCM samples size: " + conv::from_int(m_iSamplesSize) + " bytes\n");
 	Print("Done\n");
+	return true;
 }
 
-void CCompiler::ExportNSF(CSimpleFile &file, int MachineType) {		// // //
+bool CCompiler::ExportNSF(CSimpleFile &file, int MachineType) {		// // //
 	if (!CompileData())
-		return;
-	ExportNSF_NSFE(file, MachineType, false);		// // //
+		return false;
+	return ExportNSF_NSFE(file, MachineType, false);		// // //
 }
 
-void CCompiler::ExportNSFE(CSimpleFile &file, int MachineType) {		// // //
+bool CCompiler::ExportNSFE(CSimpleFile &file, int MachineType) {		// // //
 	if (!CompileData())
-		return;
-	ExportNSF_NSFE(file, MachineType, true);
+		return false;
+	return ExportNSF_NSFE(file, MachineType, true);
 }
 
-void CCompiler::ExportNES(CSimpleFile &file, bool EnablePAL) {
+bool CCompiler::ExportNES(CSimpleFile &file, bool EnablePAL) {		// // //
 	if (m_pModule->HasExpansionChips()) {
 		Print("Error: Expansion chips are currently not supported for this export format.\n");
-		return;
+		return false;
 	}
 	if (!CompileData())
-		return;
-	ExportNES_PRG(file, EnablePAL, false);		// // //
+		return false;
+	return ExportNES_PRG(file, EnablePAL, false);		// // //
 }
 
-void CCompiler::ExportPRG(CSimpleFile &file, bool EnablePAL) {
+bool CCompiler::ExportPRG(CSimpleFile &file, bool EnablePAL) {		// // //
 	// Same as export to .NES but without the header
 	if (m_pModule->HasExpansionChips()) {
 		Print("Error: Expansion chips are currently not supported for this export format.\n");
-		return;
+		return false;
 	}
 	if (!CompileData())
-		return;
-	ExportNES_PRG(file, EnablePAL, true);		// // //
+		return false;
+	return ExportNES_PRG(file, EnablePAL, true);		// // //
 }
 
-void CCompiler::ExportBIN(CSimpleFile &binFile, CSimpleFile &dpcmFile) {
+bool CCompiler::ExportBIN(CSimpleFile &binFile, CSimpleFile &dpcmFile) {		// // //
 	if (!CompileData())
-		return;
-	ExportBIN_ASM(binFile, &dpcmFile, false);		// // //
+		return false;
+	return ExportBIN_ASM(binFile, &dpcmFile, false);		// // //
 }
 
-void CCompiler::ExportASM(CSimpleFile &file) {
+bool CCompiler::ExportASM(CSimpleFile &file) {		// // //
 	if (!CompileData())
-		return;
-	ExportBIN_ASM(file, nullptr, true);		// // //
+		return false;
+	return ExportBIN_ASM(file, nullptr, true);		// // //
+}
+
+void CCompiler::SetCache(std::shared_ptr<CCompilerCache> pCache) {		// // //
+	m_pCache = std::move(pCache);
+}
+
+std::vector<stDriverSymbol> CCompiler::GetDriverSymbols() const {		// // //
+	return {
+		{"ft_driver", static_cast<uint16_t>(m_iDriverAddress), static_cast<uint16_t>(m_iDriverSize)},
+		{"ft_music_init", static_cast<uint16_t>(m_iInitAddress), 0u},
+		{"ft_music_play", static_cast<uint16_t>(m_iInitAddress + 3), 0u},
+	};
 }
 
 void CCompiler::SetMetadata(std::string_view title, std::string_view artist, std::string_view copyright) {		// // //
@@ -624,37 +728,89 @@ void CCompiler::UpdateSamplePointers(unsigned int Origin)
 
 	Assert(m_pSamplePointersChunk != NULL);
 
-	unsigned int Address = Origin;
+	std::vector<unsigned int> Addresses(m_vSamples.size(), 0u);		// // //
+	std::vector<unsigned int> Banks(m_vSamples.size(), 0u);
 	unsigned int Bank = m_iFirstSampleBank;
 
-	if (!m_bBankSwitched)
-		Bank = 0;			// Disable DPCM bank switching
+	if (m_bBankSwitched) {
+		// // // Each window maps DPCM_PAGE_WINDOW banks to $C000, samples may not reach DPCM_SWITCH_ADDRESS
+		const unsigned int WINDOW_SIZE = DPCM_SWITCH_ADDRESS - PAGE_SAMPLES;
+		const auto Pack = [&] (const std::vector<std::size_t> &Order, bool FirstFit) {
+			std::vector<std::vector<std::size_t>> Windows;
+			std::vector<unsigned int> Used;
+			for (std::size_t i : Order) {
+				unsigned int Size = m_vSamples[i]->size();
+				std::size_t w = FirstFit ? 0 : Windows.size() - std::min<std::size_t>(Windows.size(), 1);
+				while (w < Windows.size() && Used[w] + Size >= WINDOW_SIZE)
+					++w;
+				if (w == Windows.size()) {
+					Windows.emplace_back();
+					Used.push_back(0u);
+				}
+				Windows[w].push_back(i);
+				Used[w] += Size + AdjustSampleAddress(Size);
+			}
+			unsigned int Span = Windows.empty() ? 0u : (Windows.size() - 1) * WINDOW_SIZE + Used.back();
+			return std::make_pair(std::move(Windows), Span);
+		};
+
+		// Keep list order unless first-fit decreasing takes less space
+		std::vector<std::size_t> Order(m_vSamples.size());
+		for (std::size_t i = 0; i < Order.size(); ++i)
+			Order[i] = i;
+		auto [Windows, Span] = Pack(Order, false);
+		std::stable_sort(Order.begin(), Order.end(), [&] (std::size_t a, std::size_t b) {
+			return m_vSamples[a]->size() > m_vSamples[b]->size();
+		});
+		if (auto [Packed, PackedSpan] = Pack(Order, true); PackedSpan < Span) {
+			Print(" * DPCM sample layout: " + conv::from_uint(Packed.size()) + " window(s), " +
+				conv::from_uint(Span - PackedSpan) + " bytes saved\n");
+			Windows = std::move(Packed);
+		}
+
+		m_vSampleWindows.clear();
+		for (const auto &Window : Windows) {
+			unsigned int Address = PAGE_SAMPLES;
+			auto &Samples = m_vSampleWindows.emplace_back();
+			for (std::size_t i : Window) {
+				Addresses[i] = Address;
+				Banks[i] = Bank;
+				Samples.push_back(m_vSamples[i]);
+				Address += m_vSamples[i]->size();
+				Address += AdjustSampleAddress(Address);
+			}
+			Bank += DPCM_PAGE_WINDOW;
+		}
+		if (!Windows.empty())
+			Bank -= DPCM_PAGE_WINDOW;
+	}
+	else {
+		// Disable DPCM bank switching
+		unsigned int Address = Origin;
+		for (std::size_t i = 0; i < m_vSamples.size(); ++i) {
+			Addresses[i] = Address;
+			Address += m_vSamples[i]->size();
+			Address += AdjustSampleAddress(Address);
+		}
+		Bank = 0;
+	}
 
 	m_pSamplePointersChunk->Clear();
 
 	// The list is stored in the same order as the samples vector
 
-	for (auto pDSample : m_vSamples) {
-		unsigned int Size = pDSample->size();
-
-		if (m_bBankSwitched) {
-			if ((Address + Size) >= DPCM_SWITCH_ADDRESS) {
-				Address = PAGE_SAMPLES;
-				Bank += DPCM_PAGE_WINDOW;
-			}
-		}
+	for (std::size_t i = 0; i < m_vSamples.size(); ++i) {
+		unsigned int Size = m_vSamples[i]->size();
 
 		// Store
-		m_pSamplePointersChunk->StoreByte(Address >> 6);
+		m_pSamplePointersChunk->StoreByte(Addresses[i] >> 6);
 		m_pSamplePointersChunk->StoreByte(Size >> 4);
-		m_pSamplePointersChunk->StoreByte(Bank);
+		m_pSamplePointersChunk->StoreByte(Banks[i]);
 
 #ifdef _DEBUG
-		Print(" * DPCM sample " + std::string {pDSample->name()} + ": $" + conv::from_uint_hex(Address, 4) +
-			", bank " + conv::from_uint(Bank) + " (" + conv::from_uint(Size) + " bytes)\n");
+		Print(" * DPCM sample " + std::string {m_vSamples[i]->name()} + ": $" + conv::from_uint_hex(Addresses[i], 4) +
+			", bank " + conv::from_uint(Banks[i]) + " (" + conv::from_uint(Size) + " bytes)\n");
 #endif
-		Address += Size;
-		Address += AdjustSampleAddress(Address);
 	}
 #ifdef _DEBUG
 	Print(" * DPCM sample banks: " + conv::from_uint(Bank - m_iFirstSampleBank + DPCM_PAGE_WINDOW) + "\n");
@@ -669,11 +825,12 @@ void CCompiler::UpdateFrameBanks()
 	// Write bank numbers to frame lists (can only be used when bankswitching is used)
 
 	int Channels = m_ChannelOrder.GetChannelCount();		// // //
+	const auto Chunks = GetChunksById();		// // //
 
 	for (CChunk *pChunk : m_vFrameChunks) {
 		// Add bank data
 		for (int j = 0; j < Channels; ++j) {
-			unsigned char bank = GetObjectByLabel(pChunk->GetDataPointerTarget(j))->GetBank();
+			unsigned char bank = Chunks[pChunk->GetDataPointerId(j)]->GetBank();		// // //
 			if (bank < PATTERN_SWITCH_BANK)
 				bank = PATTERN_SWITCH_BANK;
 			pChunk->SetupBankData(j + Channels, bank);
@@ -684,8 +841,9 @@ void CCompiler::UpdateFrameBanks()
 void CCompiler::UpdateSongBanks()
 {
 	// Write bank numbers to song lists (can only be used when bankswitching is used)
+	const auto Chunks = GetChunksById();		// // //
 	for (CChunk *pChunk : m_vSongChunks) {
-		int bank = GetObjectByLabel(pChunk->GetDataPointerTarget(0))->GetBank();
+		int bank = Chunks[pChunk->GetDataPointerId(0)]->GetBank();		// // //
 		if (bank < PATTERN_SWITCH_BANK)
 			bank = PATTERN_SWITCH_BANK;
 		pChunk->SetupBankData(m_iSongBankReference, bank);
@@ -711,42 +869,44 @@ void CCompiler::EnableBankswitching()
 void CCompiler::ResolveLabels()
 {
 	// Resolve label addresses, no banks since bankswitching is disabled
-	std::map<stChunkLabel, int> labelMap;		// // //
+	std::vector<int> Offsets;		// // // indexed by label id
 
 	// Pass 1, collect labels
-	CollectLabels(labelMap);
+	CollectLabels(Offsets);
 
 	// Pass 2
-	AssignLabels(labelMap);
+	AssignLabels(Offsets);
 }
 
 bool CCompiler::ResolveLabelsBankswitched()
 {
 	// Resolve label addresses and banks
-	std::map<stChunkLabel, int> labelMap;		// // //
+	std::vector<int> Offsets;		// // // indexed by label id
 
 	// Pass 1, collect labels
-	if (!CollectLabelsBankswitched(labelMap))
+	if (!CollectLabelsBankswitched(Offsets))
 		return false;
 
 	// Pass 2
-	AssignLabels(labelMap);
+	AssignLabels(Offsets);
 
 	return true;
 }
 
-void CCompiler::CollectLabels(std::map<stChunkLabel, int> &labelMap) const		// // //
+void CCompiler::CollectLabels(std::vector<int> &Offsets) const		// // //
 {
 	// Collect labels and assign offsets
+	Offsets.assign(m_pLabels->GetCount(), -1);		// // //
 	int Offset = 0;
 	for (const auto &pChunk : m_vChunks) {
-		labelMap[pChunk->GetLabel()] = Offset;
+		Offsets[pChunk->GetLabelId()] = Offset;
 		Offset += pChunk->CountDataSize();
 	}
 }
 
-bool CCompiler::CollectLabelsBankswitched(std::map<stChunkLabel, int> &labelMap)		// // //
+bool CCompiler::CollectLabelsBankswitched(std::vector<int> &Offsets)		// // //
 {
+	Offsets.assign(m_pLabels->GetCount(), -1);		// // //
 	int Offset = 0;
 	int Bank = PATTERN_SWITCH_BANK;
 
@@ -760,7 +920,7 @@ bool CCompiler::CollectLabelsBankswitched(std::map<stChunkLabel, int> &labelMap)
 			case CHUNK_PATTERN:
 				break;
 			default:
-				labelMap[pChunk->GetLabel()] = Offset;
+				Offsets[pChunk->GetLabelId()] = Offset;
 				Offset += Size;
 		}
 	}
@@ -771,39 +931,106 @@ bool CCompiler::CollectLabelsBankswitched(std::map<stChunkLabel, int> &labelMap)
 		return false;
 	}
 
-	unsigned int Track = 0;
+	// // // The switchable area is $B000-$C000, frame lists and patterns are packed
+	// into it with first-fit decreasing. The first bin continues after the
+	// instrument data, every other bin is a 4 kB switchable bank.
+	struct stBankItem {
+		int Size;
+		std::size_t Bin;
+	};
+	struct stBankBin {
+		int Capacity;
+		int Used;
+	};
 
-	// The switchable area is $B000-$C000
-	for (auto &pChunk : m_vChunks) {
-		int Size = pChunk->CountDataSize();
+	// A frame list and its frames must be stored together in one bank
+	std::vector<stBankItem> Items;
+	std::vector<std::size_t> ChunkItem(m_vChunks.size(), static_cast<std::size_t>(-1));
+	for (std::size_t i = 0; i < m_vChunks.size(); ++i) {
+		switch (m_vChunks[i]->GetType()) {
+			case CHUNK_FRAME:
+				Assert(!Items.empty());
+				Items.back().Size += m_vChunks[i]->CountDataSize();
+				ChunkItem[i] = Items.size() - 1;
+				break;
+			case CHUNK_FRAME_LIST:
+			case CHUNK_PATTERN:
+				Items.push_back({m_vChunks[i]->CountDataSize(), 0u});
+				ChunkItem[i] = Items.size() - 1;
+			default:
+				break;
+		}
+	}
+
+	std::vector<std::size_t> Order(Items.size());
+	for (std::size_t i = 0; i < Order.size(); ++i)
+		Order[i] = i;
+	std::stable_sort(Order.begin(), Order.end(), [&] (std::size_t a, std::size_t b) {		// ties keep list order
+		return Items[a].Size > Items[b].Size;
+	});
 
+	std::vector<stBankBin> Bins {{0x4000 - static_cast<int>(m_iDriverSize) - Offset, 0}};
+	for (std::size_t i : Order) {
+		auto &Item = Items[i];
+		auto it = std::find_if(Bins.begin(), Bins.end(), [&] (const stBankBin &Bin) {
+			return Bin.Used + Item.Size <= Bin.Capacity;
+		});
+		if (it == Bins.end()) {		// oversized items still get a bank of their own
+			Bins.push_back({PAGE_SIZE, 0});
+			it = Bins.end() - 1;
+		}
+		Item.Bin = it - Bins.begin();
+		it->Used += Item.Size;
+	}
+
+	// Reorder the chunk list so that the renderer writes each bank in one piece
+	std::vector<std::size_t> Perm(m_vChunks.size());
+	for (std::size_t i = 0; i < Perm.size(); ++i)
+		Perm[i] = i;
+	const auto BinOf = [&] (std::size_t i) {
+		return ChunkItem[i] == static_cast<std::size_t>(-1) ? 0u : Items[ChunkItem[i]].Bin + 1;
+	};
+	std::stable_sort(Perm.begin(), Perm.end(), [&] (std::size_t a, std::size_t b) {
+		return BinOf(a) < BinOf(b);
+	});
+	std::vector<std::shared_ptr<CChunk>> Sorted;
+	std::vector<std::size_t> SortedItem;
+	Sorted.reserve(m_vChunks.size());
+	SortedItem.reserve(m_vChunks.size());
+	for (std::size_t i : Perm) {
+		Sorted.push_back(std::move(m_vChunks[i]));
+		SortedItem.push_back(ChunkItem[i]);
+	}
+	m_vChunks = std::move(Sorted);
+
+	// Assign addresses and banks
+	std::size_t CurrentBin = 0;
+	for (std::size_t i = 0; i < m_vChunks.size(); ++i) {
+		auto &pChunk = m_vChunks[i];
 		switch (pChunk->GetType()) {
 			case CHUNK_FRAME_LIST:
-				// Make sure the entire frame list will fit, if not then allocate a new bank
-				if (Offset + m_iDriverSize + m_iTrackFrameSize[Track++] > 0x4000) {
+			case CHUNK_PATTERN:
+				while (CurrentBin < Items[SortedItem[i]].Bin) {
 					Offset = 0x3000 - m_iDriverSize;
 					++Bank;
+					++CurrentBin;
 				}
 				[[fallthrough]];		// // //
 			case CHUNK_FRAME:
-				labelMap[pChunk->GetLabel()] = Offset;
+				Offsets[pChunk->GetLabelId()] = Offset;
 				pChunk->SetBank(Bank < 4 ? ((Offset + m_iDriverSize) >> 12) : Bank);
-				Offset += Size;
-				break;
-			case CHUNK_PATTERN:
-				// Make sure entire pattern will fit
-				if (Offset + m_iDriverSize + Size > 0x4000) {
-					Offset = 0x3000 - m_iDriverSize;
-					++Bank;
-				}
-				labelMap[pChunk->GetLabel()] = Offset;
-				pChunk->SetBank(Bank < 4 ? ((Offset + m_iDriverSize) >> 12) : Bank);
-				Offset += Size;
+				Offset += pChunk->CountDataSize();
 			default:
 				break;
 		}
 	}
 
+	for (std::size_t i = 0; i < Bins.size(); ++i) {
+		std::string Name = i ? "bank " + conv::from_uint(PATTERN_SWITCH_BANK + i) : std::string {"fixed area"};
+		Print(" * Pattern data " + Name + ": " + conv::from_int(Bins[i].Used) + " / " + conv::from_int(Bins[i].Capacity) +
+			" bytes (" + conv::from_int(Bins[i].Used * 100 / Bins[i].Capacity) + "%)\n");
+	}
+
 	if (m_bBankSwitched)
 		m_iFirstSampleBank = ((Bank < 4) ? ((Offset + m_iDriverSize) >> 12) : Bank) + 1;
 
@@ -812,11 +1039,11 @@ bool CCompiler::CollectLabelsBankswitched(std::map<stChunkLabel, int> &labelMap)
 	return true;
 }
 
-void CCompiler::AssignLabels(std::map<stChunkLabel, int> &labelMap)		// // //
+void CCompiler::AssignLabels(const std::vector<int> &Offsets)		// // //
 {
 	// Pass 2: assign addresses to labels
 	for (auto &pChunk : m_vChunks)
-		pChunk->AssignLabels(labelMap);
+		pChunk->AssignLabels(Offsets);
 }
 
 bool CCompiler::CompileData()
@@ -1412,6 +1639,8 @@ void CCompiler::StoreSongs()
 	m_iSongBankReference = m_vSongChunks[0]->GetLength() - 1;	// Save bank value position (all songs are equal)
 
 	// Store actual songs
+	CompilePatterns();		// // //
+
 	m_pModule->VisitSongs([this] (const CSongData &, unsigned i) {
 		Print(" * Song " + conv::from_int(i) + ": ");
 		// Store frames
@@ -1423,9 +1652,9 @@ void CCompiler::StoreSongs()
 	if (m_iDuplicatePatterns > 0)
 		Print(" * " + conv::from_int(m_iDuplicatePatterns) + " duplicated pattern(s) removed\n");
 
-#ifdef _DEBUG
-	Print("Hash collisions: " + conv::from_uint(m_iHashCollisions) + " (of " + conv::from_uint(m_PatternMap.size()) + " items)\r\n");		// // //
-#endif
+#ifdef SHARE_PATTERN_DATA
+	SharePatternData();		// // //
+#endif /* SHARE_PATTERN_DATA */
 }
 
 // Frames
@@ -1481,6 +1710,91 @@ void CCompiler::CreateFrameList(unsigned int Track)
 
 // Patterns
 
+void CCompiler::CompilePatterns()		// // //
+{
+	/*
+	 * Compile the patterns of all songs
+	 *
+	 * Patterns are independent of each other, so they are compiled on worker threads;
+	 * StorePatterns consumes the results in the same order as a serial compilation
+	 *
+	 */
+
+	struct stJob {
+		unsigned Track;
+		stCompiledPattern *pResult;
+		std::string Key { };		// // // cache key
+		bool Cached = false;
+	};
+
+	m_vCompiledPatterns.assign(m_pModule->GetSongCount(), { });
+	m_pModule->VisitSongs([&] (const CSongData &song, unsigned Track) {
+		auto &results = m_vCompiledPatterns[Track];
+		for (unsigned i = 0; i < MAX_PATTERN; ++i)
+			m_ChannelOrder.ForeachChannel([&] (stChannelID j) {
+				// And store only used ones
+				if (IsPatternAddressed(Track, i, j)) {
+					(void)song.GetPattern(j, i);		// patterns must be loaded before the workers start
+					results.push_back({i, j, 0u, { }, { }});
+				}
+			});
+	});
+
+	if (m_pCache)		// // //
+		m_pCache->SetRevision(GetCacheRevision());
+
+	std::vector<stJob> jobs;
+	for (unsigned Track = 0; Track < m_vCompiledPatterns.size(); ++Track)
+		for (auto &x : m_vCompiledPatterns[Track])
+			jobs.push_back({Track, &x});
+
+	std::atomic<std::size_t> next {0u};
+	auto worker = [&] {
+		auto pLog = std::make_shared<CCompilerLogBuffer>();
+		CPatternCompiler PatternCompiler(*m_pModule, m_iAssignedInstruments, (const DPCM_List_t *)m_iSamplesLookUp.data(), pLog);		// // //
+		for (std::size_t i = next++; i < jobs.size(); i = next++) {
+			auto &result = *jobs[i].pResult;
+			if (m_pCache) {		// // //
+				jobs[i].Key = PatternCompiler.GetCacheKey(jobs[i].Track, result.Pattern, result.Channel);
+				if (auto Entry = m_pCache->Find(jobs[i].Key)) {
+					result.Data = std::move(Entry->Data);
+					result.Hash = HashPatternData(result.Data);
+					result.Log = std::move(Entry->Log);
+					jobs[i].Cached = true;
+					continue;
+				}
+			}
+			PatternCompiler.CompileData(jobs[i].Track, result.Pattern, result.Channel);
+			result.Data = PatternCompiler.GetData();
+			result.Hash = HashPatternData(result.Data);		// // //
+			result.Log = pLog->Take();
+		}
+	};
+
+	const unsigned workers = static_cast<unsigned>(std::min<std::size_t>(
+		std::clamp(std::thread::hardware_concurrency(), 1u, MAX_PATTERN_WORKERS), jobs.size()));
+	std::vector<std::future<void>> futures;
+	for (unsigned i = 1; i < workers; ++i)
+		futures.push_back(std::async(std::launch::async, worker));
+	worker();
+	for (auto &f : futures)
+		f.get();
+
+	// // // Update the cache once the workers are done reading it
+	if (m_pCache) {
+		std::size_t Reused = 0;
+		for (auto &job : jobs) {
+			if (job.Cached) {
+				m_pCache->Keep(job.Key);
+				++Reused;
+			}
+			else
+				m_pCache->Insert(std::move(job.Key), {job.pResult->Data, job.pResult->Log});
+		}
+		Print(" * Pattern cache: " + conv::from_uint(Reused) + " of " + conv::from_uint(jobs.size()) + " pattern(s) reused\n");
+	}
+}
+
 void CCompiler::StorePatterns(unsigned int Track)
 {
 	/*
@@ -1488,77 +1802,188 @@ void CCompiler::StorePatterns(unsigned int Track)
 	 *
 	 */
 
-	CPatternCompiler PatternCompiler(*m_pModule, m_iAssignedInstruments, (const DPCM_List_t *)m_iSamplesLookUp.data(), m_pLogger);		// // //
-
 	int PatternCount = 0;
 	int PatternSize = 0;
 
-	// Iterate through all patterns
-	for (unsigned i = 0; i < MAX_PATTERN; ++i) {
-		m_ChannelOrder.ForeachChannel([&] (stChannelID j) {		// // //
-			// And store only used ones
-			if (IsPatternAddressed(Track, i, j)) {
+	// Iterate through all patterns compiled by CompilePatterns
+	for (auto &Compiled : m_vCompiledPatterns[Track]) {		// // //
+		if (!Compiled.Log.empty())
+			Print(Compiled.Log);
 
-				// Compile pattern data
-				PatternCompiler.CompileData(Track, i, j);
+		auto label = stChunkLabel {CHUNK_PATTERN, Track, Compiled.Pattern, Compiled.Channel.ToInteger()};		// // //
 
-				auto label = stChunkLabel {CHUNK_PATTERN, Track, i, j.ToInteger()};		// // //
-
-				bool StoreNew = true;
+		bool StoreNew = true;
 
 #ifdef REMOVE_DUPLICATE_PATTERNS
-				unsigned int Hash = PatternCompiler.GetHash();
-
-				// Check for duplicate patterns
-				if (auto it = m_PatternMap.find(Hash); it != m_PatternMap.end()) {
-					const CChunk *pDuplicate = it->second;
-					// Hash only indicates that patterns may be equal, check exact data
-					if (PatternCompiler.CompareData(pDuplicate->GetStringData(PATTERN_CHUNK_INDEX))) {
-						// Duplicate was found, store a reference to existing pattern
-						m_DuplicateMap.try_emplace(label, pDuplicate->GetLabel());		// // //
-						++m_iDuplicatePatterns;
-						StoreNew = false;
-					}
-				}
+		// // // Check for duplicate patterns, patterns with the same hash are compared in full
+		auto &Candidates = m_PatternMap[Compiled.Hash];
+		for (const CChunk *pDuplicate : Candidates)
+			if (pDuplicate->GetStringData(PATTERN_CHUNK_INDEX) == Compiled.Data) {
+				// Duplicate was found, store a reference to existing pattern
+				unsigned id = m_pLabels->GetId(label);		// // //
+				if (id >= m_vDuplicateMap.size())
+					m_vDuplicateMap.resize(m_pLabels->GetCount(), CChunkLabelTable::NO_LABEL);
+				if (m_vDuplicateMap[id] == CChunkLabelTable::NO_LABEL)
+					m_vDuplicateMap[id] = pDuplicate->GetLabelId();
+				++m_iDuplicatePatterns;
+				StoreNew = false;
+				break;
+			}
 #endif /* REMOVE_DUPLICATE_PATTERNS */
 
-				if (StoreNew) {
-					// Store new pattern
-					CChunk &Chunk = CreateChunk(label);		// // //
+		if (StoreNew) {
+			// Store new pattern
+			CChunk &Chunk = CreateChunk(label);		// // //
 
 #ifdef REMOVE_DUPLICATE_PATTERNS
-					if (m_PatternMap.count(Hash))
-						++m_iHashCollisions;
-					m_PatternMap[Hash] = &Chunk;
+			Candidates.push_back(&Chunk);		// // //
 #endif /* REMOVE_DUPLICATE_PATTERNS */
 
-					// Store pattern data as string
-					Chunk.StoreString(PatternCompiler.GetData());
+			// Store pattern data as string
+			Chunk.StoreString(Compiled.Data);
 
-					PatternSize += PatternCompiler.GetDataSize();
-					++PatternCount;
-				}
-			}
-		});
+			PatternSize += Compiled.Data.size();
+			++PatternCount;
+		}
+
+		Compiled.Data = std::vector<unsigned char> { };
 	}
 
 #ifdef REMOVE_DUPLICATE_PATTERNS
 	// Update references to duplicates
 	for (const auto pChunk : m_vFrameChunks)
 		for (int j = 0, n = pChunk->GetLength(); j < n; ++j)
-			if (auto it = m_DuplicateMap.find(pChunk->GetDataPointerTarget(j)); it != m_DuplicateMap.cend())		// // //
-				pChunk->SetDataPointerTarget(j, it->second);
+			if (unsigned id = pChunk->GetDataPointerId(j); id < m_vDuplicateMap.size() && m_vDuplicateMap[id] != CChunkLabelTable::NO_LABEL)		// // //
+				pChunk->SetDataPointerId(j, m_vDuplicateMap[id]);
 #endif /* REMOVE_DUPLICATE_PATTERNS */
 
 #ifdef LOCAL_DUPLICATE_PATTERN_REMOVAL
 	// Forget patterns when one whole track is stored
-	m_PatternMap.RemoveAll();
-	m_DuplicateMap.RemoveAll();
+	m_PatternMap.clear();		// // //
+	m_vDuplicateMap.clear();
 #endif /* LOCAL_DUPLICATE_PATTERN_REMOVAL */
 
 	Print(conv::from_int(PatternCount) + " patterns (" + conv::from_int(PatternSize) + " bytes)\r\n");
 }
 
+void CCompiler::SharePatternData()		// // //
+{
+	/*
+	 * Remove patterns whose data appears verbatim inside another pattern
+	 *
+	 * The driver reads a fixed number of rows from a pattern pointer, so a pattern
+	 * that equals a substring of a longer pattern (most often its tail) can be
+	 * addressed as the longer pattern's label plus an offset. Occurrences are
+	 * located with a suffix array over all stored pattern streams.
+	 *
+	 */
+
+	std::vector<CChunk *> Patterns;
+	for (const auto &pChunk : m_vChunks)
+		if (pChunk->GetType() == CHUNK_PATTERN)
+			Patterns.push_back(pChunk.get());
+	if (Patterns.size() < 2)
+		return;
+
+	// Concatenate all streams, each one followed by a separator outside the byte range
+	const unsigned SEPARATOR = 0x100;
+	std::vector<unsigned> Text;
+	std::vector<std::uint32_t> Owner;		// pattern index of each position
+	std::vector<std::uint32_t> Start;		// position of each pattern
+	for (std::size_t i = 0; i < Patterns.size(); ++i) {
+		Start.push_back(static_cast<std::uint32_t>(Text.size()));
+		for (unsigned char x : Patterns[i]->GetStringData(PATTERN_CHUNK_INDEX)) {
+			Text.push_back(x);
+			Owner.push_back(static_cast<std::uint32_t>(i));
+		}
+		Text.push_back(SEPARATOR);
+		Owner.push_back(static_cast<std::uint32_t>(i));
+	}
+	const std::vector<std::uint32_t> SA = BuildSuffixArray(Text);
+
+	// Longer patterns are resolved first so that they can host the shorter ones
+	std::vector<std::uint32_t> Order(Patterns.size());
+	std::vector<std::uint32_t> OrderPos(Patterns.size());
+	for (std::size_t i = 0; i < Order.size(); ++i)
+		Order[i] = static_cast<std::uint32_t>(i);
+	std::stable_sort(Order.begin(), Order.end(), [&] (std::uint32_t a, std::uint32_t b) {
+		return Patterns[a]->GetStringData(PATTERN_CHUNK_INDEX).size() > Patterns[b]->GetStringData(PATTERN_CHUNK_INDEX).size();
+	});
+	for (std::size_t i = 0; i < Order.size(); ++i)
+		OrderPos[Order[i]] = static_cast<std::uint32_t>(i);
+
+	struct stSharedPattern {
+		std::uint32_t Root;
+		unsigned Offset;
+	};
+	std::vector<stSharedPattern> Shared(Patterns.size());
+	std::vector<bool> IsShared(Patterns.size(), false);
+	int SharedCount = 0;
+	int SharedSize = 0;
+
+	for (std::uint32_t i : Order) {
+		Shared[i] = {i, 0u};
+		const auto &Data = Patterns[i]->GetStringData(PATTERN_CHUNK_INDEX);
+		if (Data.empty())
+			continue;
+
+		// Find the range of suffixes beginning with this pattern's data
+		const auto Compare = [&] (std::uint32_t pos) {
+			for (std::size_t k = 0; k < Data.size(); ++k) {
+				if (pos + k >= Text.size() || Text[pos + k] < Data[k])
+					return -1;
+				if (Text[pos + k] > Data[k])
+					return 1;
+			}
+			return 0;
+		};
+		auto First = std::partition_point(SA.begin(), SA.end(), [&] (std::uint32_t pos) { return Compare(pos) < 0; });
+		auto Last = std::partition_point(First, SA.end(), [&] (std::uint32_t pos) { return Compare(pos) == 0; });
+
+		// Take the occurrence inside the earliest resolved pattern
+		std::uint32_t Host = i;
+		unsigned Offset = 0;
+		for (auto it = First; it != Last; ++it) {
+			std::uint32_t j = Owner[*it];
+			if (OrderPos[j] >= OrderPos[Host])
+				continue;
+#ifdef LOCAL_DUPLICATE_PATTERN_REMOVAL
+			if (Patterns[j]->GetLabel().Param1 != Patterns[i]->GetLabel().Param1)
+				continue;
+#endif /* LOCAL_DUPLICATE_PATTERN_REMOVAL */
+			Host = j;
+			Offset = *it - Start[j];
+		}
+		if (Host == i)
+			continue;
+
+		Shared[i] = {Shared[Host].Root, Shared[Host].Offset + Offset};
+		IsShared[i] = true;
+		++SharedCount;
+		SharedSize += Data.size();
+	}
+
+	if (!SharedCount)
+		return;
+
+	// Redirect frame list references
+	std::vector<std::pair<unsigned, unsigned>> Redirect(m_pLabels->GetCount(), {CChunkLabelTable::NO_LABEL, 0u});		// indexed by label id
+	for (std::size_t i = 0; i < Patterns.size(); ++i)
+		if (IsShared[i])
+			Redirect[Patterns[i]->GetLabelId()] = {Patterns[Shared[i].Root]->GetLabelId(), Shared[i].Offset};
+	for (const auto pChunk : m_vFrameChunks)
+		for (int j = 0, n = pChunk->GetLength(); j < n; ++j)
+			if (unsigned id = pChunk->GetDataPointerId(j); id != CChunkLabelTable::NO_LABEL && Redirect[id].first != CChunkLabelTable::NO_LABEL)
+				pChunk->SetDataPointerId(j, Redirect[id].first, Redirect[id].second);
+
+	m_PatternMap.clear();
+	m_vChunks.erase(std::remove_if(m_vChunks.begin(), m_vChunks.end(), [&] (const std::shared_ptr<CChunk> &pChunk) {
+		return pChunk->GetType() == CHUNK_PATTERN && Redirect[pChunk->GetLabelId()].first != CChunkLabelTable::NO_LABEL;
+	}), m_vChunks.end());
+
+	Print(" * " + conv::from_int(SharedCount) + " pattern(s) shared with longer patterns, " + conv::from_int(SharedSize) + " bytes saved\n");
+}
+
 bool CCompiler::IsPatternAddressed(unsigned int Track, int Pattern, stChannelID Channel) const
 {
 	// Scan the frame list to see if a pattern is accessed for that frame
@@ -1585,7 +2010,7 @@ void CCompiler::AddWavetable(CInstrumentFDS *pInstrument, CChunk *pChunk)
 // Object list functions
 
 CChunk &CCompiler::CreateChunk(const stChunkLabel &Label) {		// // //
-	return *m_vChunks.emplace_back(std::make_shared<CChunk>(Label));
+	return *m_vChunks.emplace_back(std::make_shared<CChunk>(Label, *m_pLabels));
 }
 
 CChunk &CCompiler::AddChunkToList(CChunk &Chunk, const stChunkLabel &Label) {		// // //
@@ -1604,10 +2029,10 @@ int CCompiler::CountData() const
 	return Offset;
 }
 
-CChunk *CCompiler::GetObjectByLabel(const stChunkLabel &Label) const		// // //
+std::vector<const CChunk *> CCompiler::GetChunksById() const		// // //
 {
+	std::vector<const CChunk *> Chunks(m_pLabels->GetCount(), nullptr);
 	for (const auto &pChunk : m_vChunks)
-		if (Label == pChunk->GetLabel())		// // //
-			return pChunk.get();
-	return nullptr;
+		Chunks[pChunk->GetLabelId()] = pChunk.get();
+	return Chunks;
 }
@@ -27,7 +27,7 @@
 #include <array>		// // //
 #include <memory>
 #include <string>		// // //
-#include <map>		// // //
+#include <unordered_map>		// // //
 #include <cstdint>		// // //
 #include "SoundChipSet.h"		// // //
 #include "ChannelOrder.h"		// // //
@@ -53,6 +53,13 @@ struct stNSFHeader {
 	uint8_t		Reserved[4] = { };
 };
 
+// // // Named address in an exported driver
+struct stDriverSymbol {
+	std::string Name;
+	uint16_t	Address;
+	uint16_t	Size;		// 0 for entry points
+};
+
 struct stNSFeHeader {		// // //
 	uint8_t		NSFeIdent[4] = {'N', 'S', 'F', 'E'};
 	uint32_t	InfoSize = 12;
@@ -72,6 +79,7 @@ struct stNSFeHeader {		// // //
 
 struct driver_t;
 class CChunk;
+class CChunkLabelTable;		// // //
 enum chunk_type_t : int;
 struct stChunkLabel;		// // //
 namespace ft0cc::doc {
@@ -82,6 +90,7 @@ class CSequence;		// // //
 class CInstrumentFDS;		// // //
 class CConstSongView;		// // //
 class CSimpleFile;		// // //
+class CCompilerCache;		// // //
 
 /*
  * Logger class
@@ -103,19 +112,22 @@ public:
 	CCompiler(const CFamiTrackerModule &modfile, std::shared_ptr<CCompilerLog> pLogger);		// // //
 	~CCompiler();
 
-	void	ExportNSF(CSimpleFile &file, int MachineType);		// // //
-	void	ExportNSFE(CSimpleFile &file, int MachineType);		// // //
-	void	ExportNES(CSimpleFile &file, bool EnablePAL);
-	void	ExportBIN(CSimpleFile &binFile, CSimpleFile &dpcmFile);
-	void	ExportPRG(CSimpleFile &file, bool EnablePAL);
-	void	ExportASM(CSimpleFile &file);
+	bool	ExportNSF(CSimpleFile &file, int MachineType);		// // //
+	bool	ExportNSFE(CSimpleFile &file, int MachineType);		// // //
+	bool	ExportNES(CSimpleFile &file, bool EnablePAL);		// // //
+	bool	ExportBIN(CSimpleFile &binFile, CSimpleFile &dpcmFile);		// // //
+	bool	ExportPRG(CSimpleFile &file, bool EnablePAL);		// // //
+	bool	ExportASM(CSimpleFile &file);		// // //
 
 	void	SetMetadata(std::string_view title, std::string_view artist, std::string_view copyright);		// // //
+	void	SetCache(std::shared_ptr<CCompilerCache> pCache);		// // // reuse compiled patterns from earlier exports
+
+	std::vector<stDriverSymbol> GetDriverSymbols() const;		// // // driver location and entry points of the last export
 
 private:
-	void	ExportNSF_NSFE(CSimpleFile &file, int MachineType, bool isNSFE);		// // //
-	void	ExportNES_PRG(CSimpleFile &file, bool EnablePAL, bool isPRG);		// // //
-	void	ExportBIN_ASM(CSimpleFile &binFile, CSimpleFile *dpcmFile, bool isASM);		// // //
+	bool	ExportNSF_NSFE(CSimpleFile &file, int MachineType, bool isNSFE);		// // //
+	bool	ExportNES_PRG(CSimpleFile &file, bool EnablePAL, bool isPRG);		// // //
+	bool	ExportBIN_ASM(CSimpleFile &binFile, CSimpleFile *dpcmFile, bool isASM);		// // //
 
 	stNSFHeader CreateHeader(int MachineType) const;		// // //
 	stNSFeHeader CreateNSFeHeader(int MachineType);		// // //
@@ -127,9 +139,9 @@ private:
 	bool	CompileData();
 	void	ResolveLabels();
 	bool	ResolveLabelsBankswitched();
-	void	CollectLabels(std::map<stChunkLabel, int> &labelMap) const;		// // //
-	bool	CollectLabelsBankswitched(std::map<stChunkLabel, int> &labelMap);
-	void	AssignLabels(std::map<stChunkLabel, int> &labelMap);
+	void	CollectLabels(std::vector<int> &Offsets) const;		// // //
+	bool	CollectLabelsBankswitched(std::vector<int> &Offsets);
+	void	AssignLabels(const std::vector<int> &Offsets);
 	void	AddBankswitching();
 
 	void	ScanSong();
@@ -146,7 +158,9 @@ private:
 	void	StoreSamples();
 	void	StoreGrooves();		// // //
 	void	StoreSongs();
+	void	CompilePatterns();		// // //
 	void	StorePatterns(unsigned int Track);
+	void	SharePatternData();		// // //
 
 	// Bankswitching functions
 	void	UpdateSamplePointers(unsigned int Origin);
@@ -161,7 +175,7 @@ private:
 	// Object list functions
 	CChunk	&CreateChunk(const stChunkLabel &Label);		// // //
 	CChunk	&AddChunkToList(CChunk &Chunk, const stChunkLabel &Label);		// // //
-	CChunk	*GetObjectByLabel(const stChunkLabel &Label) const;		// // //
+	std::vector<const CChunk *> GetChunksById() const;		// // //
 	int		CountData() const;
 
 	// Debugging
@@ -199,6 +213,7 @@ private:
 
 	// Object lists
 	std::vector<std::shared_ptr<CChunk>> m_vChunks;		// // //
+	std::unique_ptr<CChunkLabelTable> m_pLabels;		// // // Label ids of all chunks and pointers
 	std::vector<CChunk*> m_vSongChunks;
 	std::vector<CChunk*> m_vFrameChunks;
 	//std::vector<CChunk*> m_vWaveChunks;
@@ -209,6 +224,7 @@ private:
 
 	// Samples
 	std::vector<std::shared_ptr<const ft0cc::doc::dpcm_sample>> m_vSamples;		// // //
+	std::vector<std::vector<std::shared_ptr<const ft0cc::doc::dpcm_sample>>> m_vSampleWindows;		// // // bankswitched layout
 
 	// Flags
 	bool			m_bBankSwitched = false;
@@ -259,13 +275,22 @@ private:
 	// FDS
 	unsigned int	m_iWaveTables = 0;
 
+	// // // Compiled pattern data of every song, in the order they are stored
+	struct stCompiledPattern {
+		unsigned Pattern;
+		stChannelID Channel;
+		std::uint64_t Hash;
+		std::vector<unsigned char> Data;
+		std::string Log;
+	};
+	std::vector<std::vector<stCompiledPattern>> m_vCompiledPatterns;
+
 	// Optimization
-	std::map<unsigned, const CChunk *> m_PatternMap;		// // //
-	std::map<stChunkLabel, stChunkLabel> m_DuplicateMap;		// // //
+	std::unordered_map<std::uint64_t, std::vector<const CChunk *>> m_PatternMap;		// // // keyed by content hash
+	std::vector<unsigned> m_vDuplicateMap;		// // // label id of a removed pattern -> label id of its duplicate
+
+	std::shared_ptr<CCompilerCache> m_pCache;		// // //
 
 	// Debugging
 	std::shared_ptr<CCompilerLog> m_pLogger;		// // //
-
-	// Diagnostics
-	unsigned int	m_iHashCollisions = 0u;
 };
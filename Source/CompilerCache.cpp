@@ -0,0 +1,149 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2018 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+** Library General Public License for more details.  To obtain a
+** copy of the GNU Library General Public License, write to the Free
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+#include "CompilerCache.h"
+#include "MappedFile.h"
+#include "SimpleFile.h"
+#include "ByteReader.h"
+#include <algorithm>
+#include <mutex>
+
+namespace {
+
+const std::string_view CACHE_HEADER = "FTCC";
+const std::uint32_t CACHE_VERSION = 2u;
+
+} // namespace
+
+void CCompilerCache::SetRevision(std::string_view revision) {
+	std::unique_lock<std::shared_mutex> lock {m_};
+	if (revision_ != revision) {
+		entries_.clear();
+		revision_ = revision;
+	}
+}
+
+std::optional<CCompilerCache::stEntry> CCompilerCache::Find(const std::string &key) const {
+	std::shared_lock<std::shared_mutex> lock {m_};
+	if (auto it = entries_.find(key); it != entries_.end())
+		return it->second.Entry;
+	return std::nullopt;
+}
+
+void CCompilerCache::Insert(std::string key, stEntry entry) {
+	std::unique_lock<std::shared_mutex> lock {m_};
+	entries_[std::move(key)] = stItem {std::move(entry), true};
+}
+
+void CCompilerCache::Keep(const std::string &key) {
+	std::unique_lock<std::shared_mutex> lock {m_};
+	if (auto it = entries_.find(key); it != entries_.end())
+		it->second.Used = true;
+}
+
+void CCompilerCache::Prune() {
+	std::unique_lock<std::shared_mutex> lock {m_};
+	for (auto it = entries_.begin(); it != entries_.end(); )
+		if (it->second.Used) {
+			it->second.Used = false;
+			++it;
+		}
+		else
+			it = entries_.erase(it);
+}
+
+void CCompilerCache::Clear() {
+	std::unique_lock<std::shared_mutex> lock {m_};
+	entries_.clear();
+}
+
+std::size_t CCompilerCache::GetCount() const {
+	std::shared_lock<std::shared_mutex> lock {m_};
+	return entries_.size();
+}
+
+bool CCompilerCache::Load(const fs::path &cache) {
+	std::unique_lock<std::shared_mutex> lock {m_};
+	entries_.clear();
+	revision_.clear();
+
+	CMappedFile file;
+	if (!file.Open(cache))
+		return false;
+
+	CByteReader r {file.GetData()};
+	if (r.ReadBytes(CACHE_HEADER.size()) != CACHE_HEADER || r.ReadInt(4) != CACHE_VERSION)
+		return false;
+
+	auto revision = r.ReadString();
+	decltype(entries_) entries;
+	for (std::uint32_t n = r.ReadInt(4); r.Good() && n; --n) {
+		auto key = r.ReadString();
+		auto data = r.ReadString();
+		auto log = r.ReadString();
+		auto &item = entries[std::string {key}];
+		item.Entry.Data.assign(data.begin(), data.end());
+		item.Entry.Log = log;
+	}
+	if (!r.Good() || !r.Finished())
+		return false;
+
+	entries_ = std::move(entries);
+	revision_ = revision;
+	return true;
+}
+
+bool CCompilerCache::Save(const fs::path &cache) const {
+	std::shared_lock<std::shared_mutex> lock {m_};
+	CSimpleFile file {cache, std::ios::out | std::ios::binary};
+	if (!file)
+		return false;
+
+	file.WriteBytes(CACHE_HEADER);
+	file.WriteInt32(CACHE_VERSION);
+	file.WriteString(revision_);
+	file.WriteInt32(static_cast<std::int32_t>(entries_.size()));
+
+	// write in key order so that equal caches produce equal files
+	std::vector<const decltype(entries_)::value_type *> items;
+	items.reserve(entries_.size());
+	for (const auto &x : entries_)
+		items.push_back(&x);
+	std::sort(items.begin(), items.end(), [] (const auto *lhs, const auto *rhs) {
+		return lhs->first < rhs->first;
+	});
+
+	for (const auto *x : items) {
+		const auto &[key, item] = *x;
+		file.WriteString(key);
+		file.WriteString({reinterpret_cast<const char *>(item.Entry.Data.data()), item.Entry.Data.size()});
+		file.WriteString(item.Entry.Log);
+	}
+
+	return static_cast<bool>(file);
+}
+
+fs::path CCompilerCache::GetDefaultPath() {
+	std::error_code ec;
+	fs::path dir = fs::temp_directory_path(ec);
+	return ec ? fs::path { } : dir / "0CC-FamiTracker.ftcc";
+}
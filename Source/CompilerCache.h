@@ -0,0 +1,102 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2018 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+** Library General Public License for more details.  To obtain a
+** copy of the GNU Library General Public License, write to the Free
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <optional>
+#include <shared_mutex>
+#include <cstdint>
+#include "ft0cc/fs.h"
+
+/*!
+	\brief A cache of compiled pattern data that can be shared between exports.
+	\details Entries are keyed by a serialization of everything the pattern compiler reads for a
+	pattern, so a pattern is only compiled again when its cells or their instrument and effect context
+	change. Keys are compared in full, so distinct inputs never share an entry. The cache also holds
+	the revision of the compiler that produced its entries; changing the revision discards them. The
+	cache can be saved to and loaded from a file in order to persist between sessions, and it may be
+	shared by compilers running on different threads.
+*/
+class CCompilerCache {
+public:
+	struct stEntry {
+		std::vector<unsigned char> Data;		// compiled pattern data
+		std::string Log;						// messages printed while compiling the pattern
+	};
+
+	/*!	\brief Sets the revision of the compiler that uses the cache.
+		\details All entries are removed if the revision differs from the one they were compiled with.
+		\param revision A string identifying the compiler and sound driver build. */
+	void SetRevision(std::string_view revision);
+
+	/*!	\brief Looks up a compiled pattern.
+		\param key The pattern input key.
+		\return A copy of the cached entry, or nothing if none exists. */
+	std::optional<stEntry> Find(const std::string &key) const;
+
+	/*!	\brief Adds a compiled pattern to the cache, replacing any existing entry.
+		\param key The pattern input key.
+		\param entry The compiled pattern. */
+	void Insert(std::string key, stEntry entry);
+
+	/*!	\brief Marks an entry as used so that it is retained by the next call to Prune.
+		\param key The pattern input key. */
+	void Keep(const std::string &key);
+
+	/*!	\brief Removes all entries that were neither inserted nor kept since the cache was loaded
+		or last pruned. */
+	void Prune();
+
+	/*!	\brief Removes all entries. */
+	void Clear();
+
+	/*!	\brief Obtains the number of cached patterns. */
+	std::size_t GetCount() const;
+
+	/*!	\brief Replaces the cache with the contents of a cache file.
+		\param cache Path to the cache file.
+		\return Whether the cache file was read successfully. */
+	bool Load(const fs::path &cache);
+
+	/*!	\brief Writes the cache to a file.
+		\param cache Path to the cache file.
+		\return Whether the cache file was written successfully. */
+	bool Save(const fs::path &cache) const;
+
+	/*!	\brief Obtains the location of the cache file shared by all exports of the current user. */
+	static fs::path GetDefaultPath();
+
+private:
+	struct stItem {
+		stEntry Entry;
+		bool Used = false;
+	};
+
+	std::unordered_map<std::string, stItem> entries_;
+	std::string revision_;
+	mutable std::shared_mutex m_;
+};
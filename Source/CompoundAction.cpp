@@ -43,6 +43,7 @@ bool CCompoundAction::Commit(CMainFrame &MainFrm) {
 	}
 
 	SaveRedoState(MainFrm);
+	UpdateFlowGraph(MainFrm);		// // //
 	return done_ = true;
 }
 
@@ -87,7 +88,28 @@ void CCompoundAction::UpdateViews(CMainFrame &MainFrm) const {
 	m_pActionList.back()->UpdateViews(MainFrm); // temp
 }
 
+void CCompoundAction::UpdateFlowGraph(CMainFrame &MainFrm) const {		// // //
+	for (auto &x : m_pActionList)
+		x->UpdateFlowGraph(MainFrm);
+}
+
 void CCompoundAction::JoinAction(std::unique_ptr<CAction> pAction)
 {
 	m_pActionList.push_back(std::move(pAction));
 }
+
+std::size_t CCompoundAction::GetMemoryUsage() const		// // //
+{
+	std::size_t Size = sizeof(CCompoundAction);
+	for (const auto &x : m_pActionList)
+		Size += x->GetMemoryUsage();
+	return Size;
+}
+
+module_block_set_t CCompoundAction::GetModifiedBlocks() const		// // //
+{
+	module_block_set_t Blocks;
+	for (const auto &x : m_pActionList)
+		Blocks |= x->GetModifiedBlocks();
+	return Blocks;
+}
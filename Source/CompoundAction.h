@@ -38,6 +38,9 @@ public:
 		\param pAction Pointer to the action object. */
 	void JoinAction(std::unique_ptr<CAction> pAction);
 
+	std::size_t GetMemoryUsage() const override;		// // //
+	module_block_set_t GetModifiedBlocks() const override;		// // //
+
 private:
 	bool Commit(CMainFrame &MainFrm) override;
 
@@ -51,6 +54,7 @@ private:
 	void RestoreRedoState(CMainFrame &MainFrm) const override;
 
 	void UpdateViews(CMainFrame &MainFrm) const override;
+	void UpdateFlowGraph(CMainFrame &MainFrm) const override;		// // //
 
 	std::vector<std::unique_ptr<CAction>> m_pActionList;
 };
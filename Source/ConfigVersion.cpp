@@ -61,6 +61,7 @@ BEGIN_MESSAGE_MAP(CConfigVersion, CPropertyPage)
 	ON_WM_VSCROLL()
 	ON_WM_HSCROLL()
 	ON_NOTIFY(NM_CUSTOMDRAW, IDC_SLIDER_VERSION_ERRORLEVEL, OnNMCustomdrawSliderVersionErrorlevel)
+	ON_BN_CLICKED(IDC_CHECK_VERSION_COMPRESS, OnBnClickedCheckVersionCompress)
 END_MESSAGE_MAP()
 
 
@@ -76,6 +77,9 @@ BOOL CConfigVersion::OnInitDialog()
 	m_cSliderErrorLevel.SetRange(MODULE_ERROR_NONE, MODULE_ERROR_STRICT);
 	m_cSliderErrorLevel.SetPos(MODULE_ERROR_STRICT - m_iModuleErrorLevel);
 
+	m_bCompressBlocks = FTEnv.GetSettings()->Version.bCompressBlocks;		// // //
+	CheckDlgButton(IDC_CHECK_VERSION_COMPRESS, m_bCompressBlocks ? BST_CHECKED : BST_UNCHECKED);
+
 	UpdateInfo();
 
 	return TRUE;  // return TRUE unless you set the focus to a control
@@ -91,6 +95,7 @@ BOOL CConfigVersion::OnApply()
 	}
 #endif
 	FTEnv.GetSettings()->Version.iErrorLevel = enum_cast<module_error_level_t>(m_iModuleErrorLevel);
+	FTEnv.GetSettings()->Version.bCompressBlocks = m_bCompressBlocks;		// // //
 
 	return CPropertyPage::OnApply();
 }
@@ -117,3 +122,9 @@ void CConfigVersion::OnNMCustomdrawSliderVersionErrorlevel(NMHDR *pNMHDR, LRESUL
 
 	*pResult = 0;
 }
+
+void CConfigVersion::OnBnClickedCheckVersionCompress()		// // //
+{
+	m_bCompressBlocks = IsDlgButtonChecked(IDC_CHECK_VERSION_COMPRESS) != 0;
+	SetModified();
+}
@@ -45,6 +45,7 @@ protected:
 
 protected:
 	int m_iModuleErrorLevel;
+	bool m_bCompressBlocks;		// // //
 
 	CSliderCtrl m_cSliderErrorLevel;
 
@@ -55,4 +56,5 @@ public:
 	afx_msg void OnVScroll(UINT nSBCode, UINT nPos, CScrollBar* pScrollBar);
 	afx_msg void OnHScroll(UINT nSBCode, UINT nPos, CScrollBar* pScrollBar);
 	afx_msg void OnNMCustomdrawSliderVersionErrorlevel(NMHDR *pNMHDR, LRESULT *pResult);
+	afx_msg void OnBnClickedCheckVersionCompress();		// // //
 };
@@ -23,10 +23,13 @@
 #define _SCL_SECURE_NO_WARNINGS
 #include "DocumentFile.h"
 #include "SimpleFile.h"
+#include "MappedFile.h"		// // //
+#include "LZCodec.h"		// // //
 #include "ModuleException.h"
 #include "array_view.h"
 #include "NumConv.h"
 #include <cstring>		// // //
+#include <algorithm>		// // //
 #include "Assertion.h"		// // //
 
 //
@@ -35,6 +38,7 @@
 
 // Class constants
 const unsigned int CDocumentFile::FILE_VER		 = 0x0440;			// Current file version (4.40)
+const unsigned int CDocumentFile::FILE_VER_COMPRESSED = 0x0460;		// // // File version of modules with compressed blocks
 const unsigned int CDocumentFile::COMPATIBLE_VER = 0x0100;			// Compatible file version (1.0)
 
 //const std::string_view CDocumentFile::FILE_HEADER_ID = {"FamiTracker Module", 18};		// // //
@@ -60,9 +64,22 @@ CSimpleFile &CDocumentFile::GetCSimpleFile() {
 
 void CDocumentFile::Open(const fs::path &fname, std::ios::openmode nOpenFlags) {		// // //
 	m_pFile->Open(fname, nOpenFlags);
+
+	// // // modules opened for reading are also mapped, so blocks can be parsed in place
+	m_pMapping.reset();
+	if (!(nOpenFlags & std::ios::out)) {
+		auto pMapping = std::make_shared<CMappedFile>();
+		if (pMapping->Open(fname)) {
+			m_pMapping = std::move(pMapping);
+			m_iMapPosition = 0u;
+		}
+	}
 }
 
 void CDocumentFile::Close() {
+	m_BlockView = { };		// // //
+	m_Blocks.clear();
+	m_pMapping.reset();
 	m_pFile->Close();
 }
 
@@ -73,18 +90,40 @@ bool CDocumentFile::Finished() const
 	return m_bFileDone;
 }
 
+void CDocumentFile::SetCompressionEnabled(bool Enable)		// // //
+{
+	m_bCompression = Enable;
+}
+
+bool CDocumentFile::IsCompressionEnabled() const		// // //
+{
+	return m_bCompression;
+}
+
 void CDocumentFile::BeginDocument()		// // //
 {
+	// the version is raised in EndDocument if any block ends up compressed
+	const unsigned int Version = FILE_VER;
+	m_bWroteCompressed = false;
 	Write(reinterpret_cast<const unsigned char *>(FILE_HEADER_ID.data()), FILE_HEADER_ID.size());		// // //
-	Write(reinterpret_cast<const unsigned char *>(&FILE_VER), sizeof(FILE_VER));
+	m_iVersionPosition = m_pFile->GetPosition();
+	Write(reinterpret_cast<const unsigned char *>(&Version), sizeof(Version));
 }
 
 void CDocumentFile::EndDocument()
 {
 	Write(reinterpret_cast<const unsigned char *>(FILE_END_ID.data()), FILE_END_ID.size());		// // //
+
+	if (m_bWroteCompressed) {		// // //
+		const unsigned int Version = FILE_VER_COMPRESSED;
+		const std::size_t End = m_pFile->GetPosition();
+		m_pFile->Seek(m_iVersionPosition);
+		m_pFile->WriteBytes({reinterpret_cast<const unsigned char *>(&Version), sizeof(Version)});
+		m_pFile->Seek(End);
+	}
 }
 
-void CDocumentFile::CreateBlock(std::string_view ID, int Version)		// // //
+void CDocumentFile::CreateBlock(std::string_view ID, int Version, bool Compressible)		// // //
 {
 	Assert(ID.size() < BLOCK_HEADER_SIZE);		// // //
 	m_cBlockID.fill(0);		// // //
@@ -94,6 +133,7 @@ void CDocumentFile::CreateBlock(std::string_view ID, int Version)		// // //
 	m_iBlockPointer = 0;
 	m_iBlockSize	= 0;
 	m_iBlockVersion = Version & 0xFFFF;
+	m_bCompressBlock = m_bCompression && Compressible;		// // //
 
 	m_iMaxBlockSize = BLOCK_SIZE;
 
@@ -166,10 +206,15 @@ bool CDocumentFile::FlushBlock()
 		return false;
 
 	if (m_iBlockPointer) {		// // //
+		unsigned Version = m_iBlockVersion;
+		auto Data = EncodeBlock(Version);
+		unsigned Size = Data.size();
 		Write(reinterpret_cast<unsigned char *>(m_cBlockID.data()), std::size(m_cBlockID) * sizeof(char));
-		Write(reinterpret_cast<unsigned char *>(&m_iBlockVersion), sizeof(m_iBlockVersion));
-		Write(reinterpret_cast<unsigned char *>(&m_iBlockPointer), sizeof(m_iBlockPointer));
-		Write(m_pBlockData.data(), m_iBlockPointer);		// // //
+		Write(reinterpret_cast<unsigned char *>(&Version), sizeof(Version));
+		Write(reinterpret_cast<unsigned char *>(&Size), sizeof(Size));
+		Write(Data.data(), Data.size());		// // //
+		if (Version & BLOCK_COMPRESSED)
+			m_bWroteCompressed = true;
 	}
 
 	m_pBlockData.clear();		// // //
@@ -177,6 +222,90 @@ bool CDocumentFile::FlushBlock()
 	return true;
 }
 
+bool CDocumentFile::FlushBlock(std::vector<unsigned char> &Image)		// // //
+{
+	// same as FlushBlock(), but also returns the bytes written for the block
+	if (m_pBlockData.empty())
+		return false;
+
+	Image.clear();
+	if (m_iBlockPointer) {
+		auto Append = [&] (const void *Data, std::size_t Size) {
+			auto ptr = static_cast<const unsigned char *>(Data);
+			Image.insert(Image.end(), ptr, ptr + Size);
+		};
+		unsigned Version = m_iBlockVersion;
+		auto Data = EncodeBlock(Version);
+		unsigned Size = Data.size();
+		Image.reserve(std::size(m_cBlockID) + sizeof(Version) + sizeof(Size) + Size);
+		Append(m_cBlockID.data(), std::size(m_cBlockID) * sizeof(char));
+		Append(&Version, sizeof(Version));
+		Append(&Size, sizeof(Size));
+		Append(Data.data(), Data.size());
+		WriteBlockImage(Image);
+	}
+
+	m_pBlockData.clear();
+
+	return true;
+}
+
+void CDocumentFile::WriteBlockImage(array_view<unsigned char> Image)		// // //
+{
+	if (Image.empty())
+		return;
+
+	unsigned Version = 0u;
+	if (Image.size() >= BLOCK_HEADER_SIZE + sizeof(Version)) {
+		std::memcpy(&Version, Image.data() + BLOCK_HEADER_SIZE, sizeof(Version));
+		if (Version & BLOCK_COMPRESSED)
+			m_bWroteCompressed = true;
+	}
+	Write(Image.data(), Image.size());
+}
+
+array_view<unsigned char> CDocumentFile::EncodeBlock(unsigned &Version)		// // //
+{
+	// Compressed blocks are stored only when they are actually smaller
+	array_view<unsigned char> Raw {m_pBlockData.data(), m_iBlockPointer};
+	m_pPackedData.clear();
+	if (!m_bCompressBlock)
+		return Raw;
+
+	std::vector<unsigned char> Packed = lz::compress(Raw);
+	if (Packed.size() + sizeof(std::uint32_t) >= Raw.size())
+		return Raw;
+
+	const std::uint32_t Size = m_iBlockPointer;
+	m_pPackedData.resize(sizeof(Size));
+	std::memcpy(m_pPackedData.data(), &Size, sizeof(Size));
+	m_pPackedData.insert(m_pPackedData.end(), Packed.begin(), Packed.end());
+	Version |= BLOCK_COMPRESSED;
+	return m_pPackedData;
+}
+
+void CDocumentFile::InflateBlock()		// // //
+{
+	// Replaces the current block view with the decompressed block
+	const unsigned MAX_INFLATED_SIZE = 50000000;
+
+	std::uint32_t Size = 0u;
+	std::memcpy(&Size, ConsumeBlock(sizeof(Size)), sizeof(Size));
+	if (Size > MAX_INFLATED_SIZE)
+		RaiseModuleException("Compressed block is too large");
+
+	auto pData = std::make_shared<std::vector<unsigned char>>(Size);
+	if (!lz::decompress(m_BlockView.subview(sizeof(Size)), pData->data(), Size))
+		RaiseModuleException("Compressed block data is corrupt");
+
+	m_pInflated = std::move(pData);
+	m_BlockView = *m_pInflated;
+	m_pBlockData.clear();
+	m_iBlockVersion &= ~BLOCK_COMPRESSED;
+	m_iBlockSize = Size;
+	m_iBlockPointer = 0;
+}
+
 void CDocumentFile::ValidateFile()
 {
 	// Checks if loaded file is valid
@@ -199,12 +328,100 @@ void CDocumentFile::ValidateFile()
 			"), expected 0x" + conv::from_int_hex(COMPATIBLE_VER) + " or above");
 
 	// // // File version is too new
-	if (GetFileVersion() > 0x450u /*FILE_VER*/)		// // // 050B
+	if (GetFileVersion() > 0x450u /*FILE_VER*/ && GetFileVersion() != FILE_VER_COMPRESSED)		// // // 050B
 		throw CModuleException::WithMessage("FamiTracker module version too new (0x" + conv::from_int_hex(GetFileVersion()) +
 			"), expected 0x" + conv::from_int_hex(0x450u) + " or below");
 
 	m_bFileDone = false;
 	m_bIncomplete = false;
+
+	if (m_pMapping) {		// // //
+		m_pFile->Seek(m_iMapPosition);		// old modules are still read from the stream
+		BuildBlockDirectory();
+	}
+}
+
+void CDocumentFile::BuildBlockDirectory()		// // //
+{
+	// Visits all block headers in the same way as successive calls to ReadBlock would
+	const auto data = m_pMapping->GetData();
+	std::size_t pos = m_iMapPosition;
+	const auto ReadField = [&] (void *Buffer, std::size_t Count) {
+		std::size_t n = std::min(Count, data.size() - pos);
+		std::memcpy(Buffer, data.data() + pos, n);
+		pos += n;
+		return n;
+	};
+
+	unsigned Version = 0u;
+	unsigned Size = 0u;
+	m_Blocks.clear();
+	m_iNextBlock = 0u;
+
+	while (true) {
+		stBlockEntry &Block = m_Blocks.emplace_back();
+		const std::size_t IDSize = ReadField(Block.ID.data(), Block.ID.size());
+		ReadField(&Version, sizeof(Version));
+		ReadField(&Size, sizeof(Size));
+		Block.Version = Version;
+		Block.Size = Size;
+
+		if (Size > 50000000) {
+			// File is probably corrupt
+			Block.ID.fill(0);
+			Block.Corrupt = true;
+			break;
+		}
+
+		Block.Offset = pos;
+		Block.Available = std::min<std::size_t>(Size, data.size() - pos);
+		pos += Block.Available;
+
+		const bool IsEnd = array_view<char> {Block.ID.data(), FILE_END_ID.size()} == FILE_END_ID;
+		if (IDSize == 0 || (IsEnd && Block.Available == FILE_END_ID.size()))
+			Block.Last = true;
+		if (Block.Last || (IsEnd && !Block.ID[FILE_END_ID.size()]))
+			break;
+	}
+}
+
+const std::vector<CDocumentFile::stBlockEntry> &CDocumentFile::GetBlockDirectory() const		// // //
+{
+	return m_Blocks;
+}
+
+bool CDocumentFile::IsMapped() const		// // //
+{
+	return static_cast<bool>(m_pMapping);
+}
+
+std::unique_ptr<CDocumentFile> CDocumentFile::ForkBlock() const		// // //
+{
+	// Creates a reader for the current block only, sharing the mapped file
+	Assert(m_pMapping && m_iNextBlock > 0);
+
+	auto pFile = std::make_unique<CDocumentFile>();
+	pFile->m_pMapping = m_pMapping;
+	pFile->m_iFileVersion = m_iFileVersion;
+	pFile->m_bFileDone = false;
+	pFile->m_bIncomplete = false;
+	pFile->m_Blocks.push_back(m_Blocks[m_iNextBlock - 1]);
+	if (m_pInflated) {
+		// share the decompressed block instead of decompressing it again
+		pFile->m_iNextBlock = 1u;
+		pFile->m_cBlockID = m_cBlockID;
+		pFile->m_iBlockVersion = m_iBlockVersion;
+		pFile->m_iBlockSize = m_iBlockSize;
+		pFile->m_iBlockPointer = 0;
+		pFile->m_iPreviousPointer = 0;
+		pFile->m_iFilePosition = pFile->m_iPreviousPosition = pFile->m_Blocks.back().Offset;
+		pFile->m_pInflated = m_pInflated;
+		pFile->m_BlockView = *m_pInflated;
+		pFile->m_bFileDone = pFile->m_Blocks.back().Last;
+	}
+	else
+		pFile->ReadMappedBlock();
+	return pFile;
 }
 
 unsigned int CDocumentFile::GetFileVersion() const
@@ -214,6 +431,9 @@ unsigned int CDocumentFile::GetFileVersion() const
 
 bool CDocumentFile::ReadBlock()
 {
+	if (m_pMapping)		// // //
+		return ReadMappedBlock();
+
 	m_iBlockPointer = 0;
 
 	m_cBlockID.fill(0);		// // //
@@ -229,12 +449,17 @@ bool CDocumentFile::ReadBlock()
 	}
 
 	m_pBlockData = std::vector<unsigned char>(m_iBlockSize);		// // //
+	m_BlockView = m_pBlockData;
+	m_pInflated.reset();
 	if (Read(m_pBlockData.data(), m_iBlockSize) == FILE_END_ID.size())		// // //
 		if (array_view<char> {m_cBlockID.data(), FILE_END_ID.size()} == FILE_END_ID)
 			m_bFileDone = true;
 
 	if (BytesRead == 0)
 		m_bFileDone = true;
+
+	if ((m_iBlockVersion & BLOCK_COMPRESSED) && !IsEndBlock())		// // // the end marker reuses the last header fields
+		InflateBlock();
 /*
 	if (GetPosition() == GetLength() && !m_bFileDone) {
 		// Parts of file is missing
@@ -246,6 +471,53 @@ bool CDocumentFile::ReadBlock()
 	return false;
 }
 
+bool CDocumentFile::ReadMappedBlock()		// // //
+{
+	m_iBlockPointer = 0;
+
+	if (m_iNextBlock >= m_Blocks.size()) {
+		m_cBlockID.fill(0);
+		m_BlockView = { };
+		m_bFileDone = true;
+		return false;
+	}
+
+	const stBlockEntry &Block = m_Blocks[m_iNextBlock++];
+	m_cBlockID = Block.ID;
+	m_iBlockVersion = Block.Version;
+	m_iBlockSize = Block.Size;
+	if (Block.Corrupt)
+		return true;
+
+	m_iPreviousPosition = Block.Offset - sizeof(m_iBlockSize);
+	m_iFilePosition = Block.Offset;
+	m_iMapPosition = Block.Offset + Block.Available;
+
+	const auto data = m_pMapping->GetData();
+	m_pInflated.reset();
+	if (Block.Available == Block.Size) {
+		m_pBlockData.clear();
+		m_BlockView = data.subview(Block.Offset, Block.Size);
+	}
+	else {
+		// Truncated block, pad with zeroes like the stream reader does
+		m_pBlockData = std::vector<unsigned char>(Block.Size);
+		std::memcpy(m_pBlockData.data(), data.data() + Block.Offset, Block.Available);
+		m_BlockView = m_pBlockData;
+	}
+
+	if (Block.Last)
+		m_bFileDone = true;
+	if ((m_iBlockVersion & BLOCK_COMPRESSED) && !IsEndBlock())		// // // the end marker reuses the last header fields
+		InflateBlock();
+	return false;
+}
+
+bool CDocumentFile::IsEndBlock() const		// // //
+{
+	return array_view<char> {m_cBlockID.data(), FILE_END_ID.size()} == FILE_END_ID && !m_cBlockID[FILE_END_ID.size()];
+}
+
 const char *CDocumentFile::GetBlockHeaderID() const		// // //
 {
 	return m_cBlockID.data();
@@ -264,26 +536,29 @@ void CDocumentFile::RollbackPointer(int count)
 	m_iPreviousPosition -= count;
 }
 
+const unsigned char *CDocumentFile::ConsumeBlock(std::size_t Size)		// // //
+{
+	m_iPreviousPointer = m_iBlockPointer;
+	m_iPreviousPosition = m_iFilePosition;
+	if (m_iBlockPointer > m_BlockView.size() || Size > m_BlockView.size() - m_iBlockPointer)
+		RaiseModuleException("Unexpected end of block");
+
+	const unsigned char *ptr = m_BlockView.data() + m_iBlockPointer;
+	m_iBlockPointer += Size;
+	m_iFilePosition += Size;
+	return ptr;
+}
+
 int CDocumentFile::GetBlockInt()
 {
 	int Value;
-	std::memcpy(&Value, m_pBlockData.data() + m_iBlockPointer, sizeof(Value));		// // //
-	m_iPreviousPointer = m_iBlockPointer;
-	m_iBlockPointer += sizeof(Value);
-	m_iPreviousPosition = m_iFilePosition;		// // //
-	m_iFilePosition += sizeof(Value);
+	std::memcpy(&Value, ConsumeBlock(sizeof(Value)), sizeof(Value));		// // //
 	return Value;
 }
 
 char CDocumentFile::GetBlockChar()
 {
-	char Value;
-	std::memcpy(&Value, m_pBlockData.data() + m_iBlockPointer, sizeof(Value));		// // //
-	m_iPreviousPointer = m_iBlockPointer;
-	m_iBlockPointer += sizeof(Value);
-	m_iPreviousPosition = m_iFilePosition;		// // //
-	m_iFilePosition += sizeof(Value);
-	return Value;
+	return static_cast<char>(*ConsumeBlock(sizeof(char)));		// // //
 }
 
 std::string CDocumentFile::ReadString()
@@ -300,15 +575,15 @@ std::string CDocumentFile::ReadString()
 	return CStringW(str);
 	*/
 
-	std::string str;
-	int str_ptr = 0;
+	const std::size_t MAX_LENGTH = 65536;		// // // read the string in place
 
 	unsigned int Previous = m_iBlockPointer;
-	while (str_ptr++ < 65536)
-		if (char c = GetBlockChar())
-			str.push_back(c);
-		else
-			break;
+	auto Remaining = m_BlockView.subview(std::min<std::size_t>(m_iBlockPointer, m_BlockView.size()));
+	auto Chars = Remaining.subview(0, MAX_LENGTH);
+	auto Length = std::find(Chars.begin(), Chars.end(), '\0') - Chars.begin();
+	std::string str(reinterpret_cast<const char *>(ConsumeBlock(Length)), Length);
+	if (Length < MAX_LENGTH)
+		ConsumeBlock(1u);		// fails if the block ends before the terminator
 	m_iPreviousPointer = Previous;
 
 	return str;
@@ -319,11 +594,12 @@ void CDocumentFile::GetBlock(void *Buffer, int Size)
 	Assert(Size < MAX_BLOCK_SIZE);
 	Assert(Buffer != NULL);
 
-	std::memcpy(Buffer, m_pBlockData.data() + m_iBlockPointer, Size);		// // //
-	m_iPreviousPointer = m_iBlockPointer;
-	m_iBlockPointer += Size;
-	m_iPreviousPosition = m_iFilePosition;		// // //
-	m_iFilePosition += Size;
+	std::memcpy(Buffer, ConsumeBlock(Size), Size);		// // //
+}
+
+array_view<unsigned char> CDocumentFile::GetBlockView(std::size_t Size)		// // //
+{
+	return {ConsumeBlock(Size), Size};
 }
 
 bool CDocumentFile::BlockDone() const
@@ -371,6 +647,14 @@ void CDocumentFile::RaiseModuleException(const std::string &Msg) const		// // //
 unsigned CDocumentFile::Read(unsigned char *lpBuf, std::size_t nCount)		// // //
 {
 	m_iPreviousPosition = m_iFilePosition;
+	if (m_pMapping) {
+		const auto data = m_pMapping->GetData();
+		m_iFilePosition = m_iMapPosition;
+		std::size_t n = std::min(nCount, data.size() - std::min(m_iMapPosition, data.size()));
+		std::memcpy(lpBuf, data.data() + m_iMapPosition, n);
+		m_iMapPosition += n;
+		return n;
+	}
 	m_iFilePosition = m_pFile->GetPosition();
 	return m_pFile->ReadBytes(lpBuf, nCount);
 }
@@ -35,6 +35,7 @@
 // CDocumentFile, class for reading/writing document files
 
 class CSimpleFile;
+class CMappedFile;		// // //
 class CModuleException;
 
 class CDocumentFile {
@@ -50,10 +51,15 @@ public:
 	bool		Finished() const;
 
 	// Write functions
+	/*!	\brief Enables compression of blocks created with the compressible flag. Modules that
+		contain at least one compressed block use a newer file version, so that older readers
+		reject them. */
+	void		SetCompressionEnabled(bool Enable);		// // //
+	bool		IsCompressionEnabled() const;		// // //
 	void		BeginDocument();		// // //
 	void		EndDocument();
 
-	void		CreateBlock(std::string_view ID, int Version);		// // //
+	void		CreateBlock(std::string_view ID, int Version, bool Compressible = false);		// // //
 	void		WriteBlock(array_view<unsigned char> Data);		// // //
 	void		WriteBlockInt(int Value);
 	void		WriteBlockChar(char Value);
@@ -61,6 +67,8 @@ public:
 	void		WriteStringPadded(std::string_view sv, std::size_t n);		// // //
 	void		WriteStringCounted(std::string_view sv);		// // //
 	bool		FlushBlock();
+	bool		FlushBlock(std::vector<unsigned char> &Image);		// // //
+	void		WriteBlockImage(array_view<unsigned char> Image);		// // //
 
 	// Read functions
 	void		ValidateFile();		// // //
@@ -68,6 +76,7 @@ public:
 
 	bool		ReadBlock();
 	void		GetBlock(void *Buffer, int Size);
+	array_view<unsigned char> GetBlockView(std::size_t Size);		// // //
 	int			GetBlockVersion() const;
 	bool		BlockDone() const;
 	const char	*GetBlockHeaderID() const;		// // //
@@ -83,6 +92,9 @@ public:
 
 	bool		IsFileIncomplete() const;
 
+	bool		IsMapped() const;		// // //
+	std::unique_ptr<CDocumentFile> ForkBlock() const;		// // //
+
 	// // // exception
 	CModuleException GetException() const;
 	void SetDefaultFooter(CModuleException &e) const;
@@ -95,6 +107,7 @@ private:		// // //
 public:
 	// Constants
 	static const unsigned int FILE_VER;
+	static const unsigned int FILE_VER_COMPRESSED;		// // //
 	static const unsigned int COMPATIBLE_VER;
 
 	static constexpr std::string_view FILE_HEADER_ID = "FamiTracker Module";		// // //
@@ -103,6 +116,21 @@ public:
 	static const unsigned int MAX_BLOCK_SIZE;
 	static const unsigned int BLOCK_SIZE;
 	static const unsigned int BLOCK_HEADER_SIZE = 16;		// // //
+	// // // set in the version field of blocks stored as an LZ stream, preceded by the uncompressed size
+	static constexpr unsigned int BLOCK_COMPRESSED = 0x80000000u;
+
+	// // // location of a block inside a memory-mapped module
+	struct stBlockEntry {
+		std::array<char, BLOCK_HEADER_SIZE> ID = { };
+		unsigned Version = 0u;
+		unsigned Size = 0u;
+		std::size_t Offset = 0u;		// start of block data in the file
+		std::size_t Available = 0u;		// bytes actually present, less than Size if the file is truncated
+		bool Corrupt = false;
+		bool Last = false;
+	};
+
+	const std::vector<stBlockEntry> &GetBlockDirectory() const;		// // //
 
 private:
 	template <typename T>
@@ -110,9 +138,16 @@ private:
 
 protected:
 	void ReallocateBlock();
+	array_view<unsigned char> EncodeBlock(unsigned &Version);		// // //
+	void InflateBlock();		// // //
+	bool IsEndBlock() const;		// // //
+	void BuildBlockDirectory();		// // //
+	bool ReadMappedBlock();		// // //
+	const unsigned char *ConsumeBlock(std::size_t Size);		// // //
 
 protected:
 	std::unique_ptr<CSimpleFile> m_pFile;		// // //
+	std::shared_ptr<CMappedFile> m_pMapping;		// // //
 
 	unsigned int	m_iFileVersion;
 	bool			m_bFileDone;
@@ -122,6 +157,17 @@ protected:
 	unsigned int	m_iBlockSize;
 	unsigned int	m_iBlockVersion;
 	std::vector<unsigned char> m_pBlockData;		// // //
+	array_view<unsigned char> m_BlockView;		// // // either m_pBlockData, m_pInflated or a range of the mapped file
+	std::shared_ptr<const std::vector<unsigned char>> m_pInflated;		// // // decompressed block, shared with forks
+	std::vector<unsigned char> m_pPackedData;		// // //
+	bool			m_bCompression = false;		// // //
+	bool			m_bCompressBlock = false;		// // //
+	bool			m_bWroteCompressed = false;		// // //
+	std::size_t		m_iVersionPosition = 0u;		// // //
+
+	std::vector<stBlockEntry> m_Blocks;		// // //
+	std::size_t		m_iNextBlock = 0u;
+	std::size_t		m_iMapPosition = 0u;
 
 	unsigned int	m_iMaxBlockSize;
 
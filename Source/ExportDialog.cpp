@@ -33,6 +33,7 @@
 #include "FamiTrackerModule.h"		// // //
 #include "DSampleManager.h"		// // //
 #include "Compiler.h"
+#include "CompilerCache.h"		// // //
 #include "Settings.h"
 #include "FileDialogs.h"		// // //
 #include "SimpleFile.h"		// // //
@@ -59,6 +60,26 @@ const exportFunc_t CExportDialog::DEFAULT_EXPORT_FUNCS[] = {
 
 const int CExportDialog::DEFAULT_EXPORTERS = 6;		// // //
 
+namespace {
+
+// // // Patterns compiled by the previous export are reused by the next one, also across sessions
+std::shared_ptr<CCompilerCache> GetSessionCache() {
+	static const auto pCache = [] {
+		auto pCache = std::make_shared<CCompilerCache>();
+		pCache->Load(CCompilerCache::GetDefaultPath());
+		return pCache;
+	}();
+	return pCache;
+}
+
+void SaveSessionCache() {
+	auto pCache = GetSessionCache();
+	pCache->Prune();
+	pCache->Save(CCompilerCache::GetDefaultPath());
+}
+
+} // namespace
+
 // Remember last option when dialog is closed
 int CExportDialog::m_iExportOption = 0;
 
@@ -178,6 +199,7 @@ void CExportDialog::OnBnClickedExport()
 	// Check built in exporters
 	if (m_iExportOption < DEFAULT_EXPORTERS) {		// // //
 		(this->*DEFAULT_EXPORT_FUNCS[m_iExportOption])();
+		SaveSessionCache();		// // //
 	}
 }
 
@@ -217,6 +239,7 @@ void CExportDialog::CreateNSF()
 		CWaitCursor wait;
 
 		CCompiler Compiler(*pDoc->GetModule(), std::make_unique<CEditLog>(GetDlgItem(IDC_OUTPUT)));
+		Compiler.SetCache(GetSessionCache());		// // //
 		UpdateMetadata(Compiler);		// // //
 		Compiler.ExportNSF(OutputFile, GetMachineType());
 	});
@@ -230,6 +253,7 @@ void CExportDialog::CreateNSFe()		// // //
 		CWaitCursor wait;
 
 		CCompiler Compiler(*pDoc->GetModule(), std::make_unique<CEditLog>(GetDlgItem(IDC_OUTPUT)));
+		Compiler.SetCache(GetSessionCache());		// // //
 		UpdateMetadata(Compiler);		// // //
 		Compiler.ExportNSFE(OutputFile, GetMachineType());
 	});
@@ -261,6 +285,7 @@ void CExportDialog::CreateNES()
 		CWaitCursor wait;
 
 		CCompiler Compiler(*pDoc->GetModule(), std::make_unique<CEditLog>(GetDlgItem(IDC_OUTPUT)));
+		Compiler.SetCache(GetSessionCache());		// // //
 		Compiler.ExportNES(OutputFile, IsDlgButtonChecked(IDC_PAL) == BST_CHECKED);
 	});
 }
@@ -289,6 +314,7 @@ void CExportDialog::CreateBIN()
 				CWaitCursor wait;
 
 				CCompiler Compiler(*pDoc->GetModule(), std::make_unique<CEditLog>(GetDlgItem(IDC_OUTPUT)));
+				Compiler.SetCache(GetSessionCache());		// // //
 				Compiler.ExportBIN(*BINFile, *DPCMFile);
 				FTEnv.GetSettings()->SetPath(path->parent_path(), PATH_NSF);
 			}
@@ -302,6 +328,7 @@ void CExportDialog::CreatePRG()
 		CWaitCursor wait;
 
 		CCompiler Compiler(*CFamiTrackerDoc::GetDoc()->GetModule(), std::make_unique<CEditLog>(GetDlgItem(IDC_OUTPUT)));
+		Compiler.SetCache(GetSessionCache());		// // //
 		Compiler.ExportPRG(OutputFile, IsDlgButtonChecked(IDC_PAL) == BST_CHECKED);
 	});
 }
@@ -312,6 +339,7 @@ void CExportDialog::CreateASM()
 		CWaitCursor wait;
 
 		CCompiler Compiler(*CFamiTrackerDoc::GetDoc()->GetModule(), std::make_unique<CEditLog>(GetDlgItem(IDC_OUTPUT)));
+		Compiler.SetCache(GetSessionCache());		// // //
 		Compiler.ExportASM(OutputFile);
 	});
 }
@@ -325,6 +353,7 @@ void CExportDialog::OnBnClickedPlay()
 	if (auto file = OpenFile(fname)) {
 		CFamiTrackerDoc *pDoc = CFamiTrackerDoc::GetDoc();
 		CCompiler Compiler(*pDoc->GetModule(), std::make_unique<CEditLog>(GetDlgItem(IDC_OUTPUT)));
+		Compiler.SetCache(GetSessionCache());		// // //
 		Compiler.ExportNSF(*file, IsDlgButtonChecked(IDC_PAL) == BST_CHECKED);
 		ShellExecuteW(NULL, L"open", fname, NULL, NULL, SW_SHOWNORMAL);
 	}
@@ -0,0 +1,180 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2018 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+** Library General Public License for more details.  To obtain a
+** copy of the GNU Library General Public License, write to the Free
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+#include "ExportVerifier.h"
+#include "NSFPlayer.h"
+#include "APU/APU.h"
+#include "ModulePlayer.h"
+#include "FamiTrackerModule.h"
+#include "FamiTrackerEnv.h"
+#include "SoundChipService.h"
+#include "SoundChipSet.h"
+#include "NumConv.h"
+#include "RegisterState.h"
+#include <vector>
+
+namespace {
+
+struct stRegister {
+	sound_chip_t Chip;
+	unsigned Address;
+	stChannelID Channel;
+};
+
+void AddRegisters(std::vector<stRegister> &Regs, sound_chip_t Chip, unsigned Low, unsigned High, stChannelID Channel = { }) {
+	for (unsigned i = Low; i <= High; ++i)
+		Regs.push_back({Chip, i, Channel});
+}
+
+// Sound registers compared by the verifier, in the order they are checked
+std::vector<stRegister> MakeRegisterList(CSoundChipSet Chips, unsigned NamcoChannels) {
+	std::vector<stRegister> Regs;
+
+	AddRegisters(Regs, sound_chip_t::APU, 0x4000, 0x4003, apu_subindex_t::pulse1);
+	AddRegisters(Regs, sound_chip_t::APU, 0x4004, 0x4007, apu_subindex_t::pulse2);
+	AddRegisters(Regs, sound_chip_t::APU, 0x4008, 0x400B, apu_subindex_t::triangle);
+	AddRegisters(Regs, sound_chip_t::APU, 0x400C, 0x400F, apu_subindex_t::noise);
+	AddRegisters(Regs, sound_chip_t::APU, 0x4010, 0x4013, apu_subindex_t::dpcm);
+
+	if (Chips.ContainsChip(sound_chip_t::VRC6)) {
+		AddRegisters(Regs, sound_chip_t::VRC6, 0x9000, 0x9002, vrc6_subindex_t::pulse1);
+		AddRegisters(Regs, sound_chip_t::VRC6, 0xA000, 0xA002, vrc6_subindex_t::pulse2);
+		AddRegisters(Regs, sound_chip_t::VRC6, 0xB000, 0xB002, vrc6_subindex_t::sawtooth);
+	}
+	if (Chips.ContainsChip(sound_chip_t::VRC7)) {
+		AddRegisters(Regs, sound_chip_t::VRC7, 0x00, 0x07);		// custom patch
+		for (std::uint8_t i = 0; i < MAX_CHANNELS_VRC7; ++i)
+			for (unsigned Reg : {0x10u, 0x20u, 0x30u})
+				AddRegisters(Regs, sound_chip_t::VRC7, Reg + i, Reg + i, {sound_chip_t::VRC7, i});
+	}
+	if (Chips.ContainsChip(sound_chip_t::FDS)) {
+		AddRegisters(Regs, sound_chip_t::FDS, 0x4040, 0x407F, fds_subindex_t::wave);		// wave RAM
+		AddRegisters(Regs, sound_chip_t::FDS, 0x4080, 0x408A, fds_subindex_t::wave);
+	}
+	if (Chips.ContainsChip(sound_chip_t::MMC5)) {
+		AddRegisters(Regs, sound_chip_t::MMC5, 0x5000, 0x5003, mmc5_subindex_t::pulse1);
+		AddRegisters(Regs, sound_chip_t::MMC5, 0x5004, 0x5007, mmc5_subindex_t::pulse2);
+	}
+	if (Chips.ContainsChip(sound_chip_t::N163)) {
+		// Channel registers are stored downwards from the end of the internal RAM
+		const unsigned WaveEnd = 0x80 - NamcoChannels * 8;
+		AddRegisters(Regs, sound_chip_t::N163, 0x00, WaveEnd - 1);
+		for (unsigned i = WaveEnd; i < 0x80; ++i)
+			AddRegisters(Regs, sound_chip_t::N163, i, i, {sound_chip_t::N163, static_cast<std::uint8_t>((0x7F - i) / 8)});
+	}
+	if (Chips.ContainsChip(sound_chip_t::S5B)) {
+		for (std::uint8_t i = 0; i < MAX_CHANNELS_S5B; ++i) {
+			AddRegisters(Regs, sound_chip_t::S5B, i * 2, i * 2 + 1, {sound_chip_t::S5B, i});
+			AddRegisters(Regs, sound_chip_t::S5B, 0x08 + i, 0x08 + i, {sound_chip_t::S5B, i});
+		}
+		AddRegisters(Regs, sound_chip_t::S5B, 0x06, 0x07);		// noise, mixer
+		AddRegisters(Regs, sound_chip_t::S5B, 0x0B, 0x0D);		// envelope
+	}
+
+	return Regs;
+}
+
+} // namespace
+
+CExportVerifier::CExportVerifier(const CFamiTrackerModule &modfile) : modfile_(modfile) {
+}
+
+CExportVerifier::stResult CExportVerifier::Verify(array_view<unsigned char> NSF, unsigned Track, unsigned Frames) {
+	stResult Result;
+	const CSongData *pSong = modfile_.GetSong(Track);
+	CNSFPlayer Player;
+	if (!pSong || !Player.Load(NSF) || Track >= Player.GetTrackCount() || !Player.Init(Track))
+		return Result;
+
+	CModulePlayer Tracker(modfile_);
+	Tracker.StartPlayer(Track);
+
+	const auto Regs = MakeRegisterList(modfile_.GetSoundChipSet(), modfile_.GetNamcoChannels());
+	const CAPU &APU = Tracker.GetAPU();
+	const CAPU &NSFAPU = Player.GetAPU();
+
+	// Both drivers silence channels differently (e.g. the tracker disables FDS modulation once
+	// with $00, the NSF driver writes $80 every frame), so the registers are cleared after
+	// initialization, and each register is only compared once both sides have written to it
+	for (const auto &r : Regs)
+		for (const CAPU *pAPU : {&APU, &NSFAPU})
+			if (CRegisterState *pReg = pAPU->GetRegState(r.Chip, r.Address))
+				pReg->Reset();
+
+	enum : std::uint8_t {TRACKER_WRITTEN = 0x01, NSF_WRITTEN = 0x02, BOTH_WRITTEN = 0x03};
+	const auto HasWritten = [] (const CRegisterState *pReg) {
+		return pReg && pReg->GetLastUpdatedTime() < CRegisterState::DECAY_RATE;
+	};
+	std::vector<std::uint8_t> Written(Regs.size());
+
+	Result.Completed = true;
+	for (; Result.Frames < Frames; ++Result.Frames) {
+		Tracker.PlayFrame();
+		if (!Tracker.IsPlaying())
+			break;
+
+		if (!Player.Play()) {
+			Result.Completed = false;
+			break;
+		}
+
+		for (std::size_t i = 0; i < Regs.size(); ++i) {
+			const auto &r = Regs[i];
+			if (HasWritten(APU.GetRegState(r.Chip, r.Address)))
+				Written[i] |= TRACKER_WRITTEN;
+			if (HasWritten(NSFAPU.GetRegState(r.Chip, r.Address)))
+				Written[i] |= NSF_WRITTEN;
+			if (Written[i] != BOTH_WRITTEN)
+				continue;
+
+			auto Expected = APU.GetReg(r.Chip, r.Address);
+			auto Actual = NSFAPU.GetReg(r.Chip, r.Address);
+			if (Expected != Actual) {
+				Result.Divergence = stDivergence {Result.Frames, r.Chip, r.Channel, r.Address, Expected, Actual};
+				return Result;
+			}
+		}
+	}
+
+	return Result;
+}
+
+std::string CExportVerifier::FormatResult(const stResult &Result) const {
+	std::string str = "Export verification: " + conv::from_uint(Result.Frames) + " frame(s) compared\n";
+	if (!Result.Completed)
+		str += " * Warning: the NSF could not be played to the end\n";
+	if (!Result.Divergence) {
+		str += Result.Completed ? " * All sound registers match\n" : "";
+		return str;
+	}
+
+	const auto &d = *Result.Divergence;
+	const auto *pSCS = FTEnv.GetSoundChipService();
+	str += " * First divergence in frame " + conv::from_uint(d.Frame) + ", ";
+	if (d.Channel.Chip != sound_chip_t::none)
+		str += "channel " + std::string {pSCS->GetChannelFullName(d.Channel)};
+	else
+		str += "chip " + std::string {pSCS->GetChipFullName(d.Chip)};
+	str += ", register $" + conv::from_uint_hex(d.Register, d.Register > 0xFF ? 4 : 2) +
+		": tracker $" + conv::from_uint_hex(d.Expected, 2) + ", NSF $" + conv::from_uint_hex(d.Actual, 2) + "\n";
+	return str;
+}
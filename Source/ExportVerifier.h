@@ -0,0 +1,73 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2018 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+** Library General Public License for more details.  To obtain a
+** copy of the GNU Library General Public License, write to the Free
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+#pragma once
+
+#include <string>
+#include <optional>
+#include <cstdint>
+#include "array_view.h"
+#include "APU/Types.h"
+
+class CFamiTrackerModule;
+
+/*!
+	\brief Checks that an exported NSF plays a track the same way as the tracker does.
+	\details The NSF is run on an emulated 2A03 while the module is played by CSoundDriver, each
+	writing into its own CAPU instance. After every frame the sound registers of both APUs are
+	compared, and the first register holding different values is reported. Writes made while the
+	players initialize are ignored, and a register is only compared once both players have written
+	to it, so that the different reset states of both drivers are not reported.
+*/
+class CExportVerifier {
+public:
+	struct stDivergence {
+		unsigned Frame = 0;
+		sound_chip_t Chip = sound_chip_t::none;
+		stChannelID Channel;			// channel owning the register, none for chip-wide registers
+		unsigned Register = 0;
+		std::uint8_t Expected = 0;		// value written by the tracker
+		std::uint8_t Actual = 0;		// value written by the NSF driver
+	};
+
+	struct stResult {
+		unsigned Frames = 0;			// number of frames that were compared
+		bool Completed = false;			// false if the NSF could not be played to the end
+		std::optional<stDivergence> Divergence;
+	};
+
+	explicit CExportVerifier(const CFamiTrackerModule &modfile);
+
+	/*!	\brief Plays a track of the module and of its exported NSF side by side.
+		\param NSF Contents of the NSF file exported from the module.
+		\param Track Zero-based track index.
+		\param Frames Maximum number of frames to compare. Verification also stops when the
+		track is halted by a Cxx effect.
+		\return The comparison result. */
+	stResult Verify(array_view<unsigned char> NSF, unsigned Track, unsigned Frames);
+
+	/*!	\brief Formats a comparison result as a text report. */
+	std::string FormatResult(const stResult &Result) const;
+
+private:
+	const CFamiTrackerModule &modfile_;
+};
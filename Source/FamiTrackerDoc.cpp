@@ -31,6 +31,7 @@
 #include "SoundChipService.h"		// // //
 #include "MainFrm.h"		// // //
 #include "ChannelMap.h"		// // //
+#include "SongFlowGraph.h"		// // //
 #include "FamiTrackerDocIO.h"		// // //
 #include "FamiTrackerDocOldIO.h"		// // //
 #include "str_conv/str_conv.hpp"		// // //
@@ -58,7 +59,7 @@ CFamiTrackerDoc::CFamiTrackerDoc() :
 
 CFamiTrackerDoc::~CFamiTrackerDoc()
 {
-	// // //
+	m_pPrefetcher.reset();		// // // joins the prefetch thread
 }
 
 //
@@ -186,7 +187,9 @@ void CFamiTrackerDoc::DeleteContents()
 		m_bBackupDone = true;	// No backup on new modules
 
 		UpdateAllViews(NULL, UPDATE_CLOSE);	// TODO remove
+		m_pPrefetcher.reset();		// // //
 		module_ = std::make_unique<CFamiTrackerModule>();		// // //
+		m_BlockCache.Clear();		// // //
 		FTEnv.GetSoundGenerator()->DocumentPropertiesChanged(this);		// // // rebind module
 		FTEnv.GetSoundGenerator()->ModuleChipChanged();
 
@@ -203,6 +206,16 @@ void CFamiTrackerDoc::DeleteContents()
 }
 
 void CFamiTrackerDoc::SetModifiedFlag(BOOL bModified)
+{
+	// // // changes not made through actions may affect any block
+	if (bModified) {
+		m_BlockCache.MarkDirty(ALL_MODULE_BLOCKS);
+		module_->GetSongFlowGraphs().Clear();
+	}
+	UpdateModifiedFlag(bModified);
+}
+
+void CFamiTrackerDoc::UpdateModifiedFlag(BOOL bModified)		// // //
 {
 	// Trigger auto-save in 10 seconds
 #ifdef AUTOSAVE
@@ -255,6 +268,16 @@ void CFamiTrackerDoc::ModifyIrreversible() {
 	SetModifiedFlag(TRUE);
 	SetExceededFlag(TRUE);
 }
+
+void CFamiTrackerDoc::ModifyBlocks(const module_block_set_t &Blocks) {		// // //
+	m_BlockCache.MarkDirty(Blocks);
+	// actions update the flow graphs of edited patterns and frames themselves; the other blocks
+	// hold the song speed, the effect column counts, the grooves and the speed split point
+	if ((Blocks & MakeBlockSet({module_block_t::params, module_block_t::header, module_block_t::grooves,
+		module_block_t::params_extra})).any())
+		module_->GetSongFlowGraphs().Clear();
+	UpdateModifiedFlag(TRUE);
+}
 //
 // Messages
 //
@@ -314,7 +337,8 @@ BOOL CFamiTrackerDoc::SaveDocument(LPCWSTR lpszPathName) const
 		return FALSE;
 	}
 
-	if (!CFamiTrackerDocIO {DocumentFile, FTEnv.GetSettings()->Version.iErrorLevel}.Save(*GetModule())) {		// // //
+	DocumentFile.SetCompressionEnabled(FTEnv.GetSettings()->Version.bCompressBlocks);		// // //
+	if (!CFamiTrackerDocIO {DocumentFile, FTEnv.GetSettings()->Version.iErrorLevel}.Save(*GetModule(), &m_BlockCache)) {		// // //
 		// The save process failed, delete temp file
 		DocumentFile.Close();
 		fs::remove(TempFile);
@@ -362,7 +386,7 @@ BOOL CFamiTrackerDoc::SaveDocument(LPCWSTR lpszPathName) const
 // Document load functions
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-BOOL CFamiTrackerDoc::OpenDocument(LPCWSTR lpszPathName)
+BOOL CFamiTrackerDoc::OpenDocument(LPCWSTR lpszPathName, bool lazy)
 {
 	m_bFileLoadFailed = true;
 
@@ -402,8 +426,10 @@ BOOL CFamiTrackerDoc::OpenDocument(LPCWSTR lpszPathName)
 			m_bForceBackup = true;
 		}
 		else {
-			if (!CFamiTrackerDocIO {OpenFile, FTEnv.GetSettings()->Version.iErrorLevel}.Load(*GetModule()))
+			if (!CFamiTrackerDocIO {OpenFile, FTEnv.GetSettings()->Version.iErrorLevel}.Load(*GetModule(), true, lazy))		// // //
 				OpenFile.RaiseModuleException((LPCSTR)CStringA(MAKEINTRESOURCEA(IDS_FILE_LOAD_ERROR)));
+			if (lazy)
+				m_pPrefetcher = std::make_unique<CPatternPrefetcher>(*GetModule());		// // //
 		}
 	}
 	catch (CModuleException &e) {
@@ -432,7 +458,7 @@ std::unique_ptr<CFamiTrackerDoc> CFamiTrackerDoc::LoadImportFile(LPCWSTR lpszPat
 	pImported->CreateEmpty();
 
 	// Load into a new document
-	if (!pImported->OpenDocument(lpszPathName))
+	if (!pImported->OpenDocument(lpszPathName, true))		// // // only the patterns of imported songs are decoded
 		return nullptr;
 
 	return pImported;
@@ -27,6 +27,7 @@
 #include <memory>		// // //
 #include <type_traits>		// // //
 #include "ft0cc/fs.h"		// // //
+#include "ModuleBlockCache.h"		// // //
 
 // #define AUTOSAVE
 // #define DISABLE_SAVE		// // //
@@ -34,6 +35,7 @@
 // External classes
 class CFamiTrackerModule;		// // //
 class CDocumentFile;
+class CPatternPrefetcher;		// // //
 
 // // // + move core data fields into CFamiTrackerModule
 // // // + move high-level pattern operations to CSongView
@@ -84,6 +86,8 @@ public:
 
 	void			Modify(bool Change);
 	void			ModifyIrreversible();
+	// // // marks the document as modified, invalidating only the given file blocks for saving
+	void			ModifyBlocks(const module_block_set_t &Blocks);
 
 	// Synchronization
 
@@ -118,7 +122,9 @@ private:
 	//
 
 	BOOL			SaveDocument(LPCWSTR lpszPathName) const;
-	BOOL			OpenDocument(LPCWSTR lpszPathName);
+	BOOL			OpenDocument(LPCWSTR lpszPathName, bool lazy = false);		// // //
+
+	void			UpdateModifiedFlag(BOOL bModified);		// // //
 
 #ifdef AUTOSAVE
 	void			SetupAutoSave();
@@ -140,6 +146,9 @@ private:
 	bool			m_bBackupDone = true;
 	bool			m_bExceeded = false;			// // //
 
+	mutable CModuleBlockCache m_BlockCache;		// // // encoded blocks reused by the next save
+	std::unique_ptr<CPatternPrefetcher> m_pPrefetcher;		// // // decodes lazily loaded tracks
+
 #ifdef AUTOSAVE
 	// Auto save
 	int				m_iAutoSaveCounter;
@@ -24,6 +24,7 @@
 #include "FamiTrackerDocIOCommon.h"
 #include "FamiTrackerDocOldIO.h"
 #include "DocumentFile.h" // stdafx.h
+#include "ModuleBlockCache.h"		// // //
 #include "FamiTrackerModule.h"
 #include "APU/Types.h"
 #include "SoundChipSet.h"
@@ -59,6 +60,12 @@
 #include "BookmarkCollection.h"
 #include "Bookmark.h"
 
+#include <algorithm>		// // //
+#include <future>
+#include <thread>
+#include <mutex>
+#include <map>
+
 namespace {
 
 using namespace std::string_view_literals;
@@ -105,6 +112,12 @@ void VisitSequences(const CSequenceManager *manager, F&& f) {
 	}
 }
 
+// Interprets a fixed-size field of a block view as a null-terminated string
+std::string_view ViewString(array_view<unsigned char> field) {		// // //
+	const char *str = reinterpret_cast<const char *>(field.data());
+	return {str, static_cast<std::size_t>(std::find(str, str + field.size(), '\0') - str)};
+}
+
 } // namespace
 
 // // // save/load functionality
@@ -114,7 +127,7 @@ CFamiTrackerDocIO::CFamiTrackerDocIO(CDocumentFile &file, module_error_level_t e
 {
 }
 
-bool CFamiTrackerDocIO::Load(CFamiTrackerModule &modfile) {
+bool CFamiTrackerDocIO::Load(CFamiTrackerModule &modfile, bool parallel, bool lazy) {
 	using map_t = std::unordered_map<std::string_view, void (CFamiTrackerDocIO::*)(CFamiTrackerModule &, int)>;
 	const auto FTM_READ_FUNC = map_t {
 		{FILE_BLOCK_PARAMS,			&CFamiTrackerDocIO::LoadParams},
@@ -140,6 +153,30 @@ bool CFamiTrackerDocIO::Load(CFamiTrackerModule &modfile) {
 	if (file_.GetFileVersion() < 0x0210)
 		(void)modfile.GetSong(0);
 
+	// // // Blocks that only touch their own part of the module may be decoded concurrently;
+	// blocks sharing a reader function are still decoded in file order on the same thread
+	using load_func_t = void (CFamiTrackerDocIO::*)(CFamiTrackerModule &, int);
+	const load_func_t PARALLEL_READ_FUNC[] = {
+		&CFamiTrackerDocIO::LoadInstruments,
+		&CFamiTrackerDocIO::LoadSequences,
+		&CFamiTrackerDocIO::LoadPatterns,
+		&CFamiTrackerDocIO::LoadDSamples,
+		&CFamiTrackerDocIO::LoadSequencesVRC6,
+		&CFamiTrackerDocIO::LoadSequencesN163,
+		&CFamiTrackerDocIO::LoadSequencesS5B,
+	};
+	struct deferred_block_t {
+		load_func_t fn;
+		int ver;
+		std::unique_ptr<CDocumentFile> file;
+		std::unique_ptr<CFamiTrackerDocIO> io;
+		std::exception_ptr error;
+	};
+	std::vector<deferred_block_t> deferred;
+	std::exception_ptr error;
+	parallel = parallel && file_.IsMapped();
+	lazy_ = lazy;
+
 	// Read all blocks
 	bool ErrorFlag = false;
 	while (!file_.Finished() && !ErrorFlag) {
@@ -149,14 +186,65 @@ bool CFamiTrackerDocIO::Load(CFamiTrackerModule &modfile) {
 			break;
 
 		try {
-			(this->*FTM_READ_FUNC.at(BlockID))(modfile, file_.GetBlockVersion());		// // //
+			load_func_t fn = FTM_READ_FUNC.at(BlockID);		// // //
+			if (parallel && std::find(std::begin(PARALLEL_READ_FUNC), std::end(PARALLEL_READ_FUNC), fn) != std::end(PARALLEL_READ_FUNC)) {
+				auto pFile = file_.ForkBlock();
+				auto pIO = std::make_unique<CFamiTrackerDocIO>(*pFile, err_lv_);
+				pIO->lazy_ = lazy_;
+				deferred.push_back({fn, file_.GetBlockVersion(), std::move(pFile), std::move(pIO), nullptr});
+			}
+			else
+				(this->*fn)(modfile, file_.GetBlockVersion());
 		}
-		catch (std::out_of_range) {
+		catch (const std::out_of_range &) {
 			DEBUG_BREAK();
 			if (file_.IsFileIncomplete())
 				ErrorFlag = true;
 		}
+		catch (...) {
+			if (!parallel)
+				throw;
+			error = std::current_exception();		// blocks after this one would not have been loaded
+			break;
+		}
+	}
+
+	if (!deferred.empty()) {
+		std::vector<load_func_t> groups;
+		for (const auto &job : deferred)
+			if (std::find(groups.begin(), groups.end(), job.fn) == groups.end())
+				groups.push_back(job.fn);
+
+		std::vector<std::future<void>> workers;
+		for (load_func_t fn : groups)
+			workers.push_back(std::async(std::launch::async, [&modfile, &deferred, fn] {
+				for (auto &job : deferred)
+					if (job.fn == fn) {
+						try {
+							(job.io.get()->*fn)(modfile, job.ver);
+						}
+						catch (const std::out_of_range &) {
+							DEBUG_BREAK();
+						}
+						catch (...) {
+							job.error = std::current_exception();
+							break;
+						}
+					}
+			}));
+		for (auto &x : workers)
+			x.get();
+
+		for (auto &job : deferred) {
+			if (job.error)
+				std::rethrow_exception(job.error);
+			m_vTmpSequences.insert(m_vTmpSequences.end(), job.io->m_vTmpSequences.begin(), job.io->m_vTmpSequences.end());
+			if (job.fn == &CFamiTrackerDocIO::LoadPatterns)
+				fds_adjust_arps_ = job.io->fds_adjust_arps_;
+		}
 	}
+	if (error)
+		std::rethrow_exception(error);
 
 	if (ErrorFlag)
 		return false;
@@ -165,33 +253,42 @@ bool CFamiTrackerDocIO::Load(CFamiTrackerModule &modfile) {
 	return true;
 }
 
-bool CFamiTrackerDocIO::Save(const CFamiTrackerModule &modfile) {
-	using block_info_t = std::tuple<void (CFamiTrackerDocIO::*)(const CFamiTrackerModule &, int), int, std::string_view>;
+bool CFamiTrackerDocIO::Save(const CFamiTrackerModule &modfile, CModuleBlockCache *pCache) {
+	using block_info_t = std::tuple<void (CFamiTrackerDocIO::*)(const CFamiTrackerModule &, int), int, std::string_view, module_block_t, bool>;
 	const block_info_t MODULE_WRITE_FUNC[] = {		// // //
-		{&CFamiTrackerDocIO::SaveParams,		6, FILE_BLOCK_PARAMS},
-		{&CFamiTrackerDocIO::SaveSongInfo,		1, FILE_BLOCK_INFO},
-		{&CFamiTrackerDocIO::SaveHeader,		3, FILE_BLOCK_HEADER},
-		{&CFamiTrackerDocIO::SaveInstruments,	6, FILE_BLOCK_INSTRUMENTS},
-		{&CFamiTrackerDocIO::SaveSequences,		6, FILE_BLOCK_SEQUENCES},
-		{&CFamiTrackerDocIO::SaveFrames,		3, FILE_BLOCK_FRAMES},
-		{&CFamiTrackerDocIO::SavePatterns,		5, FILE_BLOCK_PATTERNS},
-		{&CFamiTrackerDocIO::SaveDSamples,		1, FILE_BLOCK_DSAMPLES},
-		{&CFamiTrackerDocIO::SaveComments,		1, FILE_BLOCK_COMMENTS},
-		{&CFamiTrackerDocIO::SaveSequencesVRC6,	6, FILE_BLOCK_SEQUENCES_VRC6},		// // //
-		{&CFamiTrackerDocIO::SaveSequencesN163,	1, FILE_BLOCK_SEQUENCES_N163},
-		{&CFamiTrackerDocIO::SaveSequencesS5B,	1, FILE_BLOCK_SEQUENCES_S5B},
-		{&CFamiTrackerDocIO::SaveParamsExtra,	2, FILE_BLOCK_PARAMS_EXTRA},		// // //
-		{&CFamiTrackerDocIO::SaveDetuneTables,	1, FILE_BLOCK_DETUNETABLES},		// // //
-		{&CFamiTrackerDocIO::SaveGrooves,		1, FILE_BLOCK_GROOVES},				// // //
-		{&CFamiTrackerDocIO::SaveBookmarks,		1, FILE_BLOCK_BOOKMARKS},			// // //
+		{&CFamiTrackerDocIO::SaveParams,		6, FILE_BLOCK_PARAMS,			module_block_t::params,			false},
+		{&CFamiTrackerDocIO::SaveSongInfo,		1, FILE_BLOCK_INFO,				module_block_t::info,			false},
+		{&CFamiTrackerDocIO::SaveHeader,		3, FILE_BLOCK_HEADER,			module_block_t::header,			false},
+		{&CFamiTrackerDocIO::SaveInstruments,	6, FILE_BLOCK_INSTRUMENTS,		module_block_t::instruments,	false},
+		{&CFamiTrackerDocIO::SaveSequences,		6, FILE_BLOCK_SEQUENCES,		module_block_t::sequences,		true},
+		{&CFamiTrackerDocIO::SaveFrames,		3, FILE_BLOCK_FRAMES,			module_block_t::frames,			false},
+		{&CFamiTrackerDocIO::SavePatterns,		5, FILE_BLOCK_PATTERNS,			module_block_t::patterns,		true},
+		{&CFamiTrackerDocIO::SaveDSamples,		1, FILE_BLOCK_DSAMPLES,			module_block_t::dsamples,		true},
+		{&CFamiTrackerDocIO::SaveComments,		1, FILE_BLOCK_COMMENTS,			module_block_t::comments,		false},
+		{&CFamiTrackerDocIO::SaveSequencesVRC6,	6, FILE_BLOCK_SEQUENCES_VRC6,	module_block_t::sequences_vrc6,	true},		// // //
+		{&CFamiTrackerDocIO::SaveSequencesN163,	1, FILE_BLOCK_SEQUENCES_N163,	module_block_t::sequences_n163,	true},
+		{&CFamiTrackerDocIO::SaveSequencesS5B,	1, FILE_BLOCK_SEQUENCES_S5B,	module_block_t::sequences_s5b,	true},
+		{&CFamiTrackerDocIO::SaveParamsExtra,	2, FILE_BLOCK_PARAMS_EXTRA,		module_block_t::params_extra,	false},		// // //
+		{&CFamiTrackerDocIO::SaveDetuneTables,	1, FILE_BLOCK_DETUNETABLES,		module_block_t::detune_tables,	false},		// // //
+		{&CFamiTrackerDocIO::SaveGrooves,		1, FILE_BLOCK_GROOVES,			module_block_t::grooves,		false},			// // //
+		{&CFamiTrackerDocIO::SaveBookmarks,		1, FILE_BLOCK_BOOKMARKS,		module_block_t::bookmarks,		false},			// // //
 	};
 
+	if (pCache)		// // //
+		pCache->SetCompression(file_.IsCompressionEnabled());
 	file_.BeginDocument();
-	for (auto [fn, ver, name] : MODULE_WRITE_FUNC) {
-		file_.CreateBlock(name.data(), ver);
+	for (auto [fn, ver, name, block, compressible] : MODULE_WRITE_FUNC) {
+		if (pCache && !pCache->IsDirty(block)) {		// // //
+			file_.WriteBlockImage(pCache->GetImage(block));
+			continue;
+		}
+		file_.CreateBlock(name.data(), ver, compressible);		// // //
 		(this->*fn)(modfile, ver);
-		if (!file_.FlushBlock())
+		std::vector<unsigned char> image;		// // //
+		if (!(pCache ? file_.FlushBlock(image) : file_.FlushBlock()))
 			return false;
+		if (pCache)
+			pCache->SetImage(block, std::move(image));
 	}
 	file_.EndDocument();
 	return true;
@@ -359,16 +456,10 @@ void CFamiTrackerDocIO::SaveParams(const CFamiTrackerModule &modfile, int ver) {
 }
 
 void CFamiTrackerDocIO::LoadSongInfo(CFamiTrackerModule &modfile, int ver) {
-	std::array<char, CFamiTrackerModule::METADATA_FIELD_LENGTH> buf = { };
-	file_.GetBlock(buf.data(), std::size(buf));
-	buf.back() = '\0';
-	modfile.SetModuleName(buf.data());
-	file_.GetBlock(buf.data(), std::size(buf));
-	buf.back() = '\0';
-	modfile.SetModuleArtist(buf.data());
-	file_.GetBlock(buf.data(), std::size(buf));
-	buf.back() = '\0';
-	modfile.SetModuleCopyright(buf.data());
+	const std::size_t len = CFamiTrackerModule::METADATA_FIELD_LENGTH;		// // // last byte is always a terminator
+	modfile.SetModuleName(ViewString(file_.GetBlockView(len).subview(0, len - 1)));
+	modfile.SetModuleArtist(ViewString(file_.GetBlockView(len).subview(0, len - 1)));
+	modfile.SetModuleCopyright(ViewString(file_.GetBlockView(len).subview(0, len - 1)));
 }
 
 void CFamiTrackerDocIO::SaveSongInfo(const CFamiTrackerModule &modfile, int ver) {
@@ -531,9 +622,7 @@ void CFamiTrackerDocIO::LoadInstruments(CFamiTrackerModule &modfile, int ver) {
 			FTEnv.GetInstrumentService()->GetInstrumentIO(Type, err_lv_)->ReadFromModule(*pInstrument, file_);		// // //
 			// Read name
 			int size = AssertRange(file_.GetBlockInt(), 0, CInstrument::INST_NAME_MAX, "Instrument name length");
-			char Name[CInstrument::INST_NAME_MAX + 1] = { };
-			file_.GetBlock(Name, size);
-			pInstrument->SetName(Name);
+			pInstrument->SetName(ViewString(file_.GetBlockView(size)));		// // //
 			Manager.InsertInstrument(index, std::move(pInstrument));		// // // this registers the instrument content provider
 		}
 		catch (CModuleException &e) {
@@ -778,168 +867,305 @@ void CFamiTrackerDocIO::SaveFrames(const CFamiTrackerModule &modfile, int ver) {
 
 void CFamiTrackerDocIO::LoadPatterns(CFamiTrackerModule &modfile, int ver) {
 	fds_adjust_arps_ = ver < 5;		// // //
-	bool compat200 = (file_.GetFileVersion() == 0x0200);		// // //
 
 	if (ver == 1) {
 		int PatternLen = AssertRange(file_.GetBlockInt(), 0, MAX_PATTERN_LENGTH, "Pattern data count");
 		modfile.GetSong(0)->SetPatternLength(PatternLen);
 	}
 
-	const CChannelOrder &order = modfile.GetChannelOrder();		// // //
+	if (lazy_ && file_.IsMapped() && IndexPatterns(modfile, ver))		// // //
+		return;
 
 	while (!file_.BlockDone()) {
-		unsigned Track = 0;
-		if (ver > 1)
-			Track = AssertRange(file_.GetBlockInt(), 0, static_cast<int>(MAX_TRACKS) - 1, "Pattern song index");
-
-		unsigned Channel = AssertRange((unsigned)file_.GetBlockInt(), 0u, CHANID_COUNT - 1, "Pattern track index");
-		AssertRange<MODULE_ERROR_OFFICIAL>(Channel, 0u, MAX_CHANNELS - 1, "Pattern track index");
-		unsigned Pattern = AssertRange(file_.GetBlockInt(), 0, MAX_PATTERN - 1, "Pattern index");
-		unsigned Items	= AssertRange(file_.GetBlockInt(), 0, MAX_PATTERN_LENGTH, "Pattern data count");
-		stChannelID ch = order.TranslateChannel(Channel);
+		stPatternRecord rec = ReadPatternRecord(modfile, ver);		// // //
+		auto *pSong = modfile.GetSong(rec.Track);
+		LoadPatternRecord(rec, ver, [&] (unsigned Pattern, unsigned Row, const stChanNote &Note) {
+			pSong->SetPatternData(rec.Channel, Pattern, Row, Note);
+		});
+	}
+}
 
-		auto *pSong = modfile.GetSong(Track);
+CFamiTrackerDocIO::stPatternRecord CFamiTrackerDocIO::ReadPatternRecord(CFamiTrackerModule &modfile, int ver) {		// // //
+	stPatternRecord rec;
+	if (ver > 1)
+		rec.Track = AssertRange(file_.GetBlockInt(), 0, static_cast<int>(MAX_TRACKS) - 1, "Pattern song index");
+
+	unsigned Channel = AssertRange((unsigned)file_.GetBlockInt(), 0u, CHANID_COUNT - 1, "Pattern track index");
+	AssertRange<MODULE_ERROR_OFFICIAL>(Channel, 0u, MAX_CHANNELS - 1, "Pattern track index");
+	rec.ChannelIndex = Channel;
+	rec.Channel = modfile.GetChannelOrder().TranslateChannel(Channel);
+	rec.Pattern = AssertRange(file_.GetBlockInt(), 0, MAX_PATTERN - 1, "Pattern index");
+	rec.Items = AssertRange(file_.GetBlockInt(), 0, MAX_PATTERN_LENGTH, "Pattern data count");
+
+	bool compat200 = (file_.GetFileVersion() == 0x0200);
+	rec.EffectColumns = compat200 ? 1 : ver >= 6 ? MAX_EFFECT_COLUMNS :
+		modfile.GetSong(rec.Track)->GetEffectColumnCount(rec.Channel);		// // // 050B
+	rec.N163 = modfile.GetSoundChipSet().ContainsChip(sound_chip_t::N163) && rec.Channel.Chip == sound_chip_t::N163;
+	return rec;
+}
 
-		for (unsigned i = 0; i < Items; ++i) try {
-			unsigned Row;
-			if (compat200 || ver >= 6)
-				Row = static_cast<unsigned char>(file_.GetBlockChar());
-			else
-				Row = AssertRange(file_.GetBlockInt(), 0, 0xFF, "Row index");		// // //
+template <typename F>
+void CFamiTrackerDocIO::LoadPatternRecord(const stPatternRecord &rec, int ver, F put) {		// // //
+	bool compat200 = (file_.GetFileVersion() == 0x0200);
+	const unsigned Track = rec.Track;
+	const unsigned Channel = rec.ChannelIndex;
+	const unsigned Pattern = rec.Pattern;
+	const stChannelID ch = rec.Channel;
+
+	for (unsigned i = 0; i < rec.Items; ++i) try {
+		unsigned Row;
+		if (compat200 || ver >= 6)
+			Row = static_cast<unsigned char>(file_.GetBlockChar());
+		else
+			Row = AssertRange(file_.GetBlockInt(), 0, 0xFF, "Row index");		// // //
 
-			try {
-				stChanNote Note;		// // //
-
-				Note.Note = enum_cast<note_t>(AssertRange<MODULE_ERROR_STRICT>(		// // //
-					file_.GetBlockChar(), value_cast(note_t::none), value_cast(note_t::echo), "Note value"));
-				Note.Octave = AssertRange<MODULE_ERROR_STRICT>(
-					file_.GetBlockChar(), 0, OCTAVE_RANGE - 1, "Octave value");
-				int Inst = static_cast<unsigned char>(file_.GetBlockChar());
-				if (Inst != HOLD_INSTRUMENT)		// // // 050B
-					AssertRange<MODULE_ERROR_STRICT>(Inst, 0, CInstrumentManager::MAX_INSTRUMENTS, "Instrument index");
-				Note.Instrument = Inst;
-				Note.Vol = AssertRange<MODULE_ERROR_STRICT>(
-					file_.GetBlockChar(), 0, MAX_VOLUME, "Channel volume");
-
-				int FX = compat200 ? 1 : ver >= 6 ? MAX_EFFECT_COLUMNS :
-					pSong->GetEffectColumnCount(order.TranslateChannel(Channel));		// // // 050B
-				for (int n = 0; n < FX; ++n) try {
-					auto EffectNumber = (effect_t)file_.GetBlockChar();
-					if (Note.Effects[n].fx = static_cast<effect_t>(EffectNumber); Note.Effects[n].fx != effect_t::none) {
-						AssertRange<MODULE_ERROR_STRICT>(value_cast(EffectNumber), value_cast(effect_t::none), value_cast(effect_t::max), "Effect index");
-						unsigned char EffectParam = file_.GetBlockChar();
-						if (ver < 3) {
-							if (EffectNumber == effect_t::PORTAOFF) {
-								EffectNumber = effect_t::PORTAMENTO;
-								EffectParam = 0;
-							}
-							else if (EffectNumber == effect_t::PORTAMENTO) {
-								if (EffectParam < 0xFF)
-									++EffectParam;
-							}
+		try {
+			stChanNote Note;		// // //
+
+			Note.Note = enum_cast<note_t>(AssertRange<MODULE_ERROR_STRICT>(		// // //
+				file_.GetBlockChar(), value_cast(note_t::none), value_cast(note_t::echo), "Note value"));
+			Note.Octave = AssertRange<MODULE_ERROR_STRICT>(
+				file_.GetBlockChar(), 0, OCTAVE_RANGE - 1, "Octave value");
+			int Inst = static_cast<unsigned char>(file_.GetBlockChar());
+			if (Inst != HOLD_INSTRUMENT)		// // // 050B
+				AssertRange<MODULE_ERROR_STRICT>(Inst, 0, CInstrumentManager::MAX_INSTRUMENTS, "Instrument index");
+			Note.Instrument = Inst;
+			Note.Vol = AssertRange<MODULE_ERROR_STRICT>(
+				file_.GetBlockChar(), 0, MAX_VOLUME, "Channel volume");
+
+			for (int n = 0; n < rec.EffectColumns; ++n) try {
+				auto EffectNumber = (effect_t)file_.GetBlockChar();
+				if (Note.Effects[n].fx = static_cast<effect_t>(EffectNumber); Note.Effects[n].fx != effect_t::none) {
+					AssertRange<MODULE_ERROR_STRICT>(value_cast(EffectNumber), value_cast(effect_t::none), value_cast(effect_t::max), "Effect index");
+					unsigned char EffectParam = file_.GetBlockChar();
+					if (ver < 3) {
+						if (EffectNumber == effect_t::PORTAOFF) {
+							EffectNumber = effect_t::PORTAMENTO;
+							EffectParam = 0;
+						}
+						else if (EffectNumber == effect_t::PORTAMENTO) {
+							if (EffectParam < 0xFF)
+								++EffectParam;
 						}
-						Note.Effects[n].param = EffectParam; // skip on no effect
 					}
-					else if (ver < 6)
-						file_.GetBlockChar(); // unused blank parameter
-				}
-				catch (CModuleException &e) {
-					e.AppendError("At effect column fx" + conv::from_int(n + 1) + ',');
-					throw e;
+					Note.Effects[n].param = EffectParam; // skip on no effect
 				}
+				else if (ver < 6)
+					file_.GetBlockChar(); // unused blank parameter
+			}
+			catch (CModuleException &e) {
+				e.AppendError("At effect column fx" + conv::from_int(n + 1) + ',');
+				throw e;
+			}
 
 	//			if (Note.Vol > MAX_VOLUME)
 	//				Note.Vol &= 0x0F;
 
-				if (compat200) {		// // //
-					if (Note.Effects[0].fx == effect_t::SPEED && Note.Effects[0].param < 20)
-						++Note.Effects[0].param;
+			if (compat200) {		// // //
+				if (Note.Effects[0].fx == effect_t::SPEED && Note.Effects[0].param < 20)
+					++Note.Effects[0].param;
 
-					if (Note.Vol == 0)
-						Note.Vol = MAX_VOLUME;
-					else {
-						--Note.Vol;
-						Note.Vol &= 0x0F;
-					}
-
-					if (Note.Note == note_t::none)
-						Note.Instrument = MAX_INSTRUMENTS;
+				if (Note.Vol == 0)
+					Note.Vol = MAX_VOLUME;
+				else {
+					--Note.Vol;
+					Note.Vol &= 0x0F;
 				}
 
-				if (modfile.GetSoundChipSet().ContainsChip(sound_chip_t::N163) && ch.Chip == sound_chip_t::N163) {		// // //
-					for (auto &cmd : Note.Effects)
-						if (cmd.fx == effect_t::SAMPLE_OFFSET)
-							cmd.fx = effect_t::N163_WAVE_BUFFER;
+				if (Note.Note == note_t::none)
+					Note.Instrument = MAX_INSTRUMENTS;
+			}
+
+			if (rec.N163) {		// // //
+				for (auto &cmd : Note.Effects)
+					if (cmd.fx == effect_t::SAMPLE_OFFSET)
+						cmd.fx = effect_t::N163_WAVE_BUFFER;
+			}
+
+			if (ver == 3) {
+				// Fix for VRC7 portamento
+				if (ch.Chip == sound_chip_t::VRC7) {		// // //
+					for (auto &cmd : Note.Effects) {
+						switch (cmd.fx) {
+						case effect_t::PORTA_DOWN:
+							cmd.fx = effect_t::PORTA_UP;
+							break;
+						case effect_t::PORTA_UP:
+							cmd.fx = effect_t::PORTA_DOWN;
+							break;
+						}
+					}
+				}
+				// FDS pitch effect fix
+				else if (ch.Chip == sound_chip_t::FDS) {
+					for (auto &[fx, param] : Note.Effects)
+						if (fx == effect_t::PITCH && param != 0x80)
+							param = (0x100 - param) & 0xFF;
 				}
+			}
 
-				if (ver == 3) {
-					// Fix for VRC7 portamento
-					if (ch.Chip == sound_chip_t::VRC7) {		// // //
-						for (auto &cmd : Note.Effects) {
-							switch (cmd.fx) {
+			if (file_.GetFileVersion() < 0x450) {		// // // 050B
+				for (auto &cmd : Note.Effects)
+					if (cmd.fx <= effect_t::max)
+						cmd.fx = compat::EFF_CONVERSION_050.first[value_cast(cmd.fx)];
+			}
+			/*
+			if (ver < 6) {
+				// Noise pitch slide fix
+				if (IsAPUNoise(Channel)) {
+					for (int n = 0; n < MAX_EFFECT_COLUMNS; ++n) {
+						switch (Note.Effects[n].fx) {
 							case effect_t::PORTA_DOWN:
-								cmd.fx = effect_t::PORTA_UP;
+								Note.Effects[n].fx = effect_t::PORTA_UP;
+								Note.Effects[n].param = Note.Effects[n].param << 4;
 								break;
 							case effect_t::PORTA_UP:
-								cmd.fx = effect_t::PORTA_DOWN;
+								Note.Effects[n].fx = effect_t::PORTA_DOWN;
+								Note.Effects[n].param = Note.Effects[n].param << 4;
+								break;
+							case effect_t::PORTAMENTO:
+								Note.Effects[n].param = Note.Effects[n].param << 4;
+								break;
+							case effect_t::SLIDE_UP:
+								Note.Effects[n].param = Note.Effects[n].param + 0x70;
+								break;
+							case effect_t::SLIDE_DOWN:
+								Note.Effects[n].param = Note.Effects[n].param + 0x70;
 								break;
-							}
 						}
 					}
-					// FDS pitch effect fix
-					else if (ch.Chip == sound_chip_t::FDS) {
-						for (auto &[fx, param] : Note.Effects)
-							if (fx == effect_t::PITCH && param != 0x80)
-								param = (0x100 - param) & 0xFF;
-					}
 				}
+			}
+			*/
 
-				if (file_.GetFileVersion() < 0x450) {		// // // 050B
-					for (auto &cmd : Note.Effects)
-						if (cmd.fx <= effect_t::max)
-							cmd.fx = compat::EFF_CONVERSION_050.first[value_cast(cmd.fx)];
-				}
-				/*
-				if (ver < 6) {
-					// Noise pitch slide fix
-					if (IsAPUNoise(Channel)) {
-						for (int n = 0; n < MAX_EFFECT_COLUMNS; ++n) {
-							switch (Note.Effects[n].fx) {
-								case effect_t::PORTA_DOWN:
-									Note.Effects[n].fx = effect_t::PORTA_UP;
-									Note.Effects[n].param = Note.Effects[n].param << 4;
-									break;
-								case effect_t::PORTA_UP:
-									Note.Effects[n].fx = effect_t::PORTA_DOWN;
-									Note.Effects[n].param = Note.Effects[n].param << 4;
-									break;
-								case effect_t::PORTAMENTO:
-									Note.Effects[n].param = Note.Effects[n].param << 4;
-									break;
-								case effect_t::SLIDE_UP:
-									Note.Effects[n].param = Note.Effects[n].param + 0x70;
-									break;
-								case effect_t::SLIDE_DOWN:
-									Note.Effects[n].param = Note.Effects[n].param + 0x70;
-									break;
-							}
-						}
-					}
-				}
-				*/
+			put(Pattern, Row, Note);		// // //
+		}
+		catch (CModuleException &e) {
+			e.AppendError("At row " + conv::from_int_hex(Row, 2) + ',');
+			throw e;
+		}
+	}
+	catch (CModuleException &e) {
+		e.AppendError("At pattern " + conv::from_int_hex(Pattern, 2) + ", channel " + conv::from_int(Channel) + ", song " + conv::from_int(Track + 1) + ',');
+		throw e;
+	}
+}
+
+// // // decodes the pattern records of one track on demand
+
+class CFamiTrackerDocIO::CLazyPatternLoader final : public CTrackLoader {
+public:
+	using record_t = std::pair<int, stPatternRecord>;		// block position of item data, record header
 
-				pSong->SetPatternData(order.TranslateChannel(Channel), Pattern, Row, Note);		// // //
+	CLazyPatternLoader(std::shared_ptr<const CDocumentFile> pBlock, module_error_level_t err_lv, int ver, std::vector<record_t> records) :
+		pBlock_(std::move(pBlock)), err_lv_(err_lv), ver_(ver), records_(std::move(records))
+	{
+	}
+
+	void Prefetch() override {
+		std::unique_lock<std::mutex> lock {mutex_, std::try_to_lock};
+		if (lock && !prefetched_ && pBlock_) {
+			try {
+				patterns_ = Decode();
+				prefetched_ = true;
 			}
-			catch (CModuleException &e) {
-				e.AppendError("At row " + conv::from_int_hex(Row, 2) + ',');
-				throw e;
+			catch (...) {
+				// the error is raised again when the track is accessed
 			}
 		}
-		catch (CModuleException &e) {
-			e.AppendError("At pattern " + conv::from_int_hex(Pattern, 2) + ", channel " + conv::from_int(Channel) + ", song " + conv::from_int(Track + 1) + ',');
-			throw e;
+	}
+
+private:
+	std::array<CPatternData, MAX_PATTERN> LoadPatterns() override {
+		std::lock_guard<std::mutex> lock {mutex_};
+		if (!prefetched_)
+			patterns_ = Decode();
+		prefetched_ = false;
+		pBlock_.reset();		// releases the mapped file once every track is decoded
+		records_.clear();
+		return std::move(patterns_);
+	}
+
+	std::array<CPatternData, MAX_PATTERN> Decode() const {
+		std::array<CPatternData, MAX_PATTERN> patterns;
+		auto pFile = pBlock_->ForkBlock();
+		CFamiTrackerDocIO io {*pFile, err_lv_};
+		for (const auto &[pos, rec] : records_) {
+			pFile->GetBlockView(pos - pFile->GetBlockPos());
+			io.LoadPatternRecord(rec, ver_, [&] (unsigned Pattern, unsigned Row, const stChanNote &Note) {
+				patterns[Pattern].SetNoteOn(Row, Note);
+			});
 		}
+		return patterns;
 	}
+
+	std::shared_ptr<const CDocumentFile> pBlock_;
+	module_error_level_t err_lv_;
+	int ver_;
+	std::vector<record_t> records_;
+
+	std::mutex mutex_;
+	std::array<CPatternData, MAX_PATTERN> patterns_;
+	bool prefetched_ = false;
+};
+
+bool CFamiTrackerDocIO::IndexPatterns(CFamiTrackerModule &modfile, int ver) {		// // //
+	// Records where the pattern data of each track is located. Rows are validated but not stored,
+	// so decoding a track later cannot fail; if the block is invalid the caller decodes it normally
+	// to report the error.
+	std::shared_ptr<const CDocumentFile> pBlock = file_.ForkBlock();
+	auto pScan = pBlock->ForkBlock();
+	CFamiTrackerDocIO scan {*pScan, err_lv_};
+
+	std::map<std::pair<unsigned, stChannelID>, std::vector<CLazyPatternLoader::record_t>> tracks;
+	try {
+		pScan->GetBlockView(file_.GetBlockPos());
+		while (!pScan->BlockDone()) {
+			stPatternRecord rec = scan.ReadPatternRecord(modfile, ver);
+			const CTrackData *pTrack = modfile.GetSong(rec.Track)->GetTrack(rec.Channel);
+			if (!pTrack || !pTrack->IsLoaded())
+				return false;
+			tracks[{rec.Track, rec.Channel}].emplace_back(pScan->GetBlockPos(), rec);
+			scan.LoadPatternRecord(rec, ver, [] (unsigned, unsigned, const stChanNote &) { });
+		}
+	}
+	catch (CModuleException &) {
+		return false;
+	}
+
+	for (auto &[key, records] : tracks)
+		modfile.GetSong(key.first)->GetTrack(key.second)->SetLoader(
+			std::make_shared<CLazyPatternLoader>(pBlock, err_lv_, ver, std::move(records)));
+
+	return true;
+}
+
+
+
+CPatternPrefetcher::CPatternPrefetcher(const CFamiTrackerModule &modfile) {		// // //
+	std::vector<std::weak_ptr<CTrackLoader>> loaders;
+	modfile.VisitSongs([&] (const CSongData &song) {
+		song.VisitTracks([&] (const CTrackData &track) {
+			if (!track.IsLoaded())
+				loaders.push_back(track.GetLoader());
+		});
+	});
+
+	if (!loaders.empty())
+		thread_ = std::thread {[this, loaders = std::move(loaders)] {
+			for (auto &x : loaders) {
+				if (stop_)
+					break;
+				if (auto pLoader = x.lock())
+					pLoader->Prefetch();
+			}
+		}};
+}
+
+CPatternPrefetcher::~CPatternPrefetcher() noexcept {
+	stop_ = true;
+	if (thread_.joinable())
+		thread_.join();
 }
 
 void CFamiTrackerDocIO::SavePatterns(const CFamiTrackerModule &modfile, int ver) {
@@ -999,13 +1225,13 @@ void CFamiTrackerDocIO::LoadDSamples(CFamiTrackerModule &modfile, int ver) {
 			static_cast<unsigned char>(file_.GetBlockChar()), 0U, CDSampleManager::MAX_DSAMPLES - 1, "DPCM sample index");
 		try {
 			unsigned int Len = AssertRange(file_.GetBlockInt(), 0, (int)ft0cc::doc::dpcm_sample::max_name_length, "DPCM sample name length");
-			char Name[ft0cc::doc::dpcm_sample::max_name_length + 1] = { };
-			file_.GetBlock(Name, Len);
+			std::string_view Name = ViewString(file_.GetBlockView(Len));		// // //
 			int Size = AssertRange(file_.GetBlockInt(), 0, 0x7FFF, "DPCM sample size");
 			AssertFileData<MODULE_ERROR_STRICT>(Size <= 0xFF1 && Size % 0x10 == 1, "Bad DPCM sample size");
 			int TrueSize = Size + ((1 - Size) & 0x0F);		// // //
-			std::vector<uint8_t> samples(TrueSize);
-			file_.GetBlock(samples.data(), Size);
+			auto data = file_.GetBlockView(Size);		// // //
+			std::vector<uint8_t> samples(data.begin(), data.end());
+			samples.resize(TrueSize);
 
 			manager.SetDSample(Index, std::make_unique<ft0cc::doc::dpcm_sample>(samples, Name));		// // //
 		}
@@ -25,18 +25,37 @@
 
 #include <string>
 #include <vector>
+#include <thread>		// // //
+#include <atomic>
 #include "OldSequence.h"
 #include "ModuleException.h"
+#include "APU/Types.h"		// // //
 
 class CFamiTrackerModule;
 class CDocumentFile;
+class CModuleBlockCache;		// // //
 
 class CFamiTrackerDocIO {
 public:
 	CFamiTrackerDocIO(CDocumentFile &file, module_error_level_t err_lv);
 
-	bool Load(CFamiTrackerModule &modfile);
-	bool Save(const CFamiTrackerModule &modfile);
+	/*!	\brief Loads a module from the document file.
+		\param modfile The module object to load into.
+		\param parallel If true and the file is memory-mapped, instrument, sequence, pattern and DPCM
+		sample blocks are decoded on worker threads after the remaining blocks are read. Errors are
+		reported exactly as in sequential mode.
+		\param lazy If true and the file is memory-mapped, pattern data is only validated and indexed
+		when loading; each track is decoded when it is first accessed, or earlier by a
+		CPatternPrefetcher. Errors are reported exactly as in eager mode.
+		\return Whether the module was loaded successfully. */
+	bool Load(CFamiTrackerModule &modfile, bool parallel = false, bool lazy = false);		// // //
+	/*!	\brief Writes a module to the document file.
+		\param modfile The module.
+		\param pCache If not null, blocks that are not marked dirty in the cache are copied from
+		it instead of being encoded, and all encoded blocks are stored into it. Pattern, sequence
+		and DPCM sample blocks are compressed if the document file has compression enabled.
+		\return Whether the module was saved successfully. */
+	bool Save(const CFamiTrackerModule &modfile, CModuleBlockCache *pCache = nullptr);		// // //
 
 private:
 	void PostLoad(CFamiTrackerModule &modfile);
@@ -62,6 +81,23 @@ private:
 	void LoadPatterns(CFamiTrackerModule &modfile, int ver);
 	void SavePatterns(const CFamiTrackerModule &modfile, int ver);
 
+	// // // pattern records
+	struct stPatternRecord {
+		unsigned Track = 0u;
+		unsigned ChannelIndex = 0u;
+		stChannelID Channel;
+		unsigned Pattern = 0u;
+		unsigned Items = 0u;
+		int EffectColumns = 0;
+		bool N163 = false;
+	};
+	class CLazyPatternLoader;
+
+	stPatternRecord ReadPatternRecord(CFamiTrackerModule &modfile, int ver);
+	template <typename F>
+	void LoadPatternRecord(const stPatternRecord &rec, int ver, F put);
+	bool IndexPatterns(CFamiTrackerModule &modfile, int ver);
+
 	void LoadDSamples(CFamiTrackerModule &modfile, int ver);
 	void SaveDSamples(const CFamiTrackerModule &modfile, int ver);
 
@@ -101,4 +137,20 @@ private:
 
 	std::vector<COldSequence> m_vTmpSequences;		// // //
 	bool fds_adjust_arps_ = false;
+	bool lazy_ = false;		// // //
+};
+
+/*!
+	\brief Decodes the lazily loaded tracks of a module on a background thread.
+	\details The prefetcher only keeps weak references to the track loaders, so tracks may be
+	accessed or destroyed while it runs. Destroying the prefetcher stops and joins the thread.
+*/
+class CPatternPrefetcher {		// // //
+public:
+	explicit CPatternPrefetcher(const CFamiTrackerModule &modfile);
+	~CPatternPrefetcher() noexcept;
+
+private:
+	std::atomic<bool> stop_ = false;
+	std::thread thread_;
 };
@@ -40,6 +40,9 @@
 #include "ft0cc/doc/dpcm_sample.hpp"
 #include "ft0cc/doc/groove.hpp"
 #include <optional>
+#include <istream>		// // //
+#include <ostream>
+#include <cctype>
 #include "clip.h"
 
 using json = nlohmann::json;
@@ -150,10 +153,10 @@ void to_json(json &j, const stChanNote &note) {
 	for (const auto &cmd_ : note.Effects)
 		if (cmd_.fx != effect_t::none) {
 			j["effects"] = json::array();
-			for (const auto &[fx, param] : note.Effects)
-				if (fx != effect_t::none)
+			for (int i = 0; i < MAX_EFFECT_COLUMNS; ++i)		// // //
+				if (const auto &[fx, param] = note.Effects[i]; fx != effect_t::none)
 					j["effects"].push_back(json {
-						{"column", fx},
+						{"column", i},
 						{"name", std::string {EFF_CHAR[value_cast(fx)]}},
 						{"param", param},
 					});
@@ -408,6 +411,7 @@ void to_json(json &j, const CInstrument2A03 &inst) {
 	for (int n = 0; n < NOTE_COUNT; ++n)
 		if (auto d_index = inst.GetSampleIndex(n); d_index != CInstrument2A03::NO_DPCM)
 			j["dpcm_map"].push_back(json {
+				{"note", n},		// // //
 				{"dpcm_index", d_index},
 				{"pitch", inst.GetSamplePitch(n) & 0x0Fu},
 				{"loop", inst.GetSampleLoop(n)},
@@ -469,7 +473,7 @@ void to_json(json &j, const dpcm_sample &dpcm) {
 		{"samples", json::array()},
 	};
 	for (std::size_t i = 0, n = dpcm.size(); i < n; ++i)
-		j["values"].push_back(dpcm.sample_at(i));
+		j["samples"].push_back(dpcm.sample_at(i));		// // //
 }
 
 void to_json(json &j, const groove &groove) {
@@ -531,6 +535,11 @@ void from_json(const json &j, stChanNote &note) {
 
 
 
+void from_json(const json &j, stHighlight &hl) {		// // //
+	hl.First = j.at(0).get<int>();
+	hl.Second = j.at(1).get<int>();
+}
+
 namespace ft0cc::doc {
 
 void from_json(const json &j, dpcm_sample &dpcm) {
@@ -554,3 +563,657 @@ void from_json(const json &j, groove &g) {
 }
 
 } // namespace ft0cc::doc
+
+
+
+// // // streaming module export / import
+
+namespace {
+
+// Writes JSON values directly to an output stream. Object keys must be written in sorted order
+// so that the output matches the document tree serialization.
+class json_stream_writer {
+public:
+	explicit json_stream_writer(std::ostream &os) : os_(os) { }
+
+	void begin_object() {
+		prefix();
+		os_ << '{';
+		first_.push_back(true);
+	}
+	void end_object() {
+		os_ << '}';
+		first_.pop_back();
+	}
+	void begin_array() {
+		prefix();
+		os_ << '[';
+		first_.push_back(true);
+	}
+	void end_array() {
+		os_ << ']';
+		first_.pop_back();
+	}
+
+	void key(std::string_view k) {
+		separator();
+		os_ << '"' << k << "\":";
+		has_key_ = true;
+	}
+	void value(const json &j) {
+		prefix();
+		os_ << j.dump();
+	}
+
+private:
+	void prefix() {
+		if (has_key_)
+			has_key_ = false;
+		else if (!first_.empty())
+			separator();
+	}
+	void separator() {
+		if (first_.back())
+			first_.back() = false;
+		else
+			os_ << ',';
+	}
+
+	std::ostream &os_;
+	std::vector<bool> first_;
+	bool has_key_ = false;
+};
+
+// Reads JSON structure incrementally from an input stream. Values below the current level are
+// returned as small document trees.
+class json_stream_reader {
+public:
+	explicit json_stream_reader(std::istream &is) : buf_(*is.rdbuf()) { }
+
+	void begin_object() {
+		expect('{');
+		first_.push_back(true);
+	}
+	// returns false after consuming the closing brace
+	bool next_key(std::string &k) {
+		if (peek() == '}') {
+			buf_.sbumpc();
+			first_.pop_back();
+			return false;
+		}
+		separator();
+		if (peek() != '"')
+			throw std::invalid_argument {"Expected object key"};
+		k = read_value().get<std::string>();
+		expect(':');
+		return true;
+	}
+
+	void begin_array() {
+		expect('[');
+		first_.push_back(true);
+	}
+	// returns false after consuming the closing bracket
+	bool next_element() {
+		if (peek() == ']') {
+			buf_.sbumpc();
+			first_.pop_back();
+			return false;
+		}
+		separator();
+		return true;
+	}
+
+	json read_value() {
+		std::string raw;
+		scan_value(&raw);
+		return json::parse(raw);
+	}
+	void skip_value() {
+		scan_value(nullptr);
+	}
+
+private:
+	int peek() {
+		int c = buf_.sgetc();
+		while (c != traits::eof() && std::isspace(c))
+			c = buf_.snextc();
+		return c;
+	}
+	void expect(char ch) {
+		if (peek() != ch)
+			throw std::invalid_argument {"Expected '"s + ch + "' in JSON stream"};
+		buf_.sbumpc();
+	}
+	void separator() {
+		if (first_.back())
+			first_.back() = false;
+		else
+			expect(',');
+	}
+
+	void scan_value(std::string *out) {
+		int depth = 0;
+		bool in_str = false;
+		bool escaped = false;
+		for (int c = peek(); ; c = buf_.sgetc()) {
+			if (c == traits::eof()) {
+				if (depth || in_str)
+					throw std::invalid_argument {"Unexpected end of JSON stream"};
+				return;
+			}
+			if (in_str) {
+				if (escaped)
+					escaped = false;
+				else if (c == '\\')
+					escaped = true;
+				else if (c == '"')
+					in_str = false;
+			}
+			else if (c == '"')
+				in_str = true;
+			else if (c == '{' || c == '[')
+				++depth;
+			else if (c == '}' || c == ']') {
+				if (!depth)
+					return;
+				--depth;
+			}
+			else if (!depth && (c == ',' || c == ':' || std::isspace(c)))
+				return;
+			buf_.sbumpc();
+			if (out)
+				out->push_back(static_cast<char>(c));
+		}
+	}
+
+	using traits = std::char_traits<char>;
+
+	std::streambuf &buf_;
+	std::vector<bool> first_;
+};
+
+template <typename T>
+T read_between(json_stream_reader &reader, const std::string &k, T lo, T hi) {
+	return json_get_between(json {{k, reader.read_value()}}, k, lo, hi);
+}
+
+inst_type_t GetInstType(std::string_view name) {
+	for (auto inst_type : {INST_2A03, INST_VRC6, INST_VRC7, INST_FDS, INST_N163, INST_S5B})
+		if (GetChipName(inst_type) == name)
+			return inst_type;
+	throw std::invalid_argument {"Unknown chip name \"" + std::string {name} + '"'};
+}
+
+stChannelID GetChannelID(const json &chip, const json &subindex) {
+	auto name = chip.get<std::string>();
+	auto id = stChannelID { };
+	FTEnv.GetSoundChipService()->ForeachType([&] (sound_chip_t c) {
+		if (FTEnv.GetSoundChipService()->GetChipShortName(c) == name)
+			id = stChannelID {c, subindex.get<std::uint8_t>()};
+	});
+	if (id.Chip == sound_chip_t::none)
+		throw std::invalid_argument {"Unknown chip name \"" + name + '"'};
+	return id;
+}
+
+std::shared_ptr<CSequence> ReadSequence(const json &j, sequence_t seq_type) {
+	auto pSeq = std::make_shared<CSequence>(seq_type);
+	const auto &items = j.at("items");
+	pSeq->SetItemCount(std::min<std::size_t>(items.size(), MAX_SEQUENCE_ITEMS));
+	for (unsigned i = 0; i < pSeq->GetItemCount(); ++i)
+		pSeq->SetItem(i, json_get_between(items, i, -128, 127));
+	pSeq->SetLoopPoint(get_maybe<unsigned>(j, "loop", (unsigned)-1));
+	pSeq->SetReleasePoint(get_maybe<unsigned>(j, "release", (unsigned)-1));
+	pSeq->SetSetting(static_cast<seq_setting_t>(get_maybe<unsigned>(j, "setting_id")));
+	return pSeq;
+}
+
+std::unique_ptr<CInstrument> ReadInstrument(const json &j, CInstrumentManager &manager) {
+	auto pInst = manager.CreateNew(GetInstType(j.at("chip").get<std::string>()));
+	if (!pInst)
+		throw std::invalid_argument {"Unsupported instrument type"};
+	pInst->SetName(get_maybe<std::string>(j, "name"));
+
+	if (auto pSeq = dynamic_cast<CSeqInstrument *>(pInst.get()); pSeq && !dynamic_cast<CInstrumentFDS *>(pSeq))
+		json_maybe(j, "sequence_flags", [&] (const json &flags) {
+			for (const auto &fj : flags) {
+				auto seq_type = static_cast<sequence_t>(json_get_between<unsigned>(fj, "macro_id", 0u, SEQ_COUNT - 1));
+				pSeq->SetSeqEnable(seq_type, true);
+				pSeq->SetSeqIndex(seq_type, json_get_between(fj, "seq_index", 0, MAX_SEQUENCES - 1));
+			}
+		});
+
+	if (auto p2A03 = dynamic_cast<CInstrument2A03 *>(pInst.get()))
+		json_maybe(j, "dpcm_map", [&] (const json &dpcm_map) {
+			for (const auto &dj : dpcm_map) {
+				if (!dj.count("note"))
+					continue;
+				int n = json_get_between(dj, "note", 0, NOTE_COUNT - 1);
+				p2A03->SetSampleIndex(n, json_get_between<unsigned>(dj, "dpcm_index", 0u, CDSampleManager::MAX_DSAMPLES - 1));
+				p2A03->SetSamplePitch(n, json_get_between(dj, "pitch", 0, 15));
+				p2A03->SetSampleLoop(n, get_maybe<bool>(dj, "loop"));
+				p2A03->SetSampleDeltaValue(n, json_get_between(dj, "delta", -1, 127));
+			}
+		});
+	else if (auto pVRC7 = dynamic_cast<CInstrumentVRC7 *>(pInst.get()))
+		json_maybe(j, "patch", [&] (const json &patch) {
+			if (patch.is_array()) {
+				pVRC7->SetPatch(0);
+				for (int i = 0; i < 8; ++i)
+					pVRC7->SetCustomReg(i, json_get_between(patch, i, 0, 255));
+			}
+			else
+				pVRC7->SetPatch(patch.get<unsigned>());
+		});
+	else if (auto pFDS = dynamic_cast<CInstrumentFDS *>(pInst.get())) {
+		json_maybe(j, "sequences", [&] (const json &seqs) {
+			for (const auto &sj : seqs) {
+				auto seq_type = static_cast<sequence_t>(json_get_between<unsigned>(sj, "macro_id", 0u, SEQ_COUNT - 1));
+				pFDS->SetSequence(seq_type, ReadSequence(sj, seq_type));
+				pFDS->SetSeqEnable(seq_type, true);
+			}
+		});
+		json_maybe(j, "wave", [&] (std::vector<unsigned char> &&wave) {
+			pFDS->SetSamples(wave);
+		});
+		json_maybe(j, "modulation", [&] (const json &mj) {
+			pFDS->SetModulationEnable(true);
+			pFDS->SetModTable(mj.at("table").get<std::vector<unsigned char>>());
+			pFDS->SetModulationSpeed(mj.at("rate").get<int>());
+			pFDS->SetModulationDepth(mj.at("depth").get<int>());
+			pFDS->SetModulationDelay(mj.at("delay").get<int>());
+		});
+	}
+	else if (auto pN163 = dynamic_cast<CInstrumentN163 *>(pInst.get())) {
+		json_maybe(j, "waves", [&] (std::vector<std::vector<int>> &&waves) {
+			if (waves.empty())
+				return;
+			pN163->SetWaveSize(waves.front().size());
+			pN163->SetWaveCount(waves.size());
+			for (std::size_t i = 0; i < waves.size(); ++i)
+				pN163->SetSamples(i, waves[i]);
+		});
+		pN163->SetWavePos(get_maybe<int>(j, "wave_position"));
+	}
+
+	return pInst;
+}
+
+void ReadTrack(json_stream_reader &reader, CSongData &song) {
+	CTrackData track;
+	json chip, subindex;
+
+	reader.begin_object();
+	for (std::string k; reader.next_key(k); )
+		if (k == "chip")
+			chip = reader.read_value();
+		else if (k == "subindex")
+			subindex = reader.read_value();
+		else if (k == "effect_columns")
+			track.SetEffectColumnCount(reader.read_value().get<unsigned>());
+		else if (k == "frame_list") {
+			unsigned f = 0;
+			reader.begin_array();
+			while (reader.next_element()) {
+				auto p = reader.read_value().get<unsigned>();
+				if (f < MAX_FRAMES)
+					track.SetFramePattern(f++, std::min<unsigned>(p, MAX_PATTERN - 1));
+			}
+		}
+		else if (k == "patterns") {
+			reader.begin_array();
+			while (reader.next_element()) {
+				// rows are staged until the pattern index is known
+				CPatternData pattern;
+				unsigned index = 0;
+				reader.begin_object();
+				for (std::string pk; reader.next_key(pk); )
+					if (pk == "index")
+						index = read_between<unsigned>(reader, pk, 0u, MAX_PATTERN - 1);
+					else if (pk == "notes") {
+						reader.begin_array();
+						while (reader.next_element()) {
+							json rj = reader.read_value();
+							pattern.SetNoteOn(json_get_between<unsigned>(rj, "row", 0u, MAX_PATTERN_LENGTH - 1), rj.at("note").get<stChanNote>());
+						}
+					}
+					else
+						reader.skip_value();
+				track.GetPattern(index) = std::move(pattern);
+			}
+		}
+		else
+			reader.skip_value();
+
+	if (auto *pTrack = song.GetTrack(GetChannelID(chip, subindex)))
+		*pTrack = std::move(track);
+}
+
+std::unique_ptr<CSongData> ReadSong(json_stream_reader &reader) {
+	auto pSong = std::make_unique<CSongData>(CSongData::DEFAULT_ROW_COUNT);
+
+	reader.begin_object();
+	for (std::string k; reader.next_key(k); )
+		if (k == "tracks") {
+			reader.begin_array();
+			while (reader.next_element())
+				ReadTrack(reader, *pSong);
+		}
+		else if (k == "bookmarks") {
+			CBookmarkCollection bookmarks;
+			for (const auto &bj : reader.read_value()) {
+				auto pMark = std::make_unique<CBookmark>(bj.at("frame").get<unsigned>(), bj.at("row").get<unsigned>());
+				pMark->m_sName = get_maybe<std::string>(bj, "name");
+				json_maybe(bj, "highlight", [&] (const json &hj) {
+					pMark->m_Highlight = hj.get<stHighlight>();
+				});
+				pMark->m_bPersist = get_maybe<bool>(bj, "persist");
+				bookmarks.AddBookmark(std::move(pMark));
+			}
+			pSong->SetBookmarks(std::move(bookmarks));
+		}
+		else if (k == "frames")
+			pSong->SetFrameCount(read_between<unsigned>(reader, k, 1u, MAX_FRAMES));
+		else if (k == "rows")
+			pSong->SetPatternLength(read_between<unsigned>(reader, k, 1u, MAX_PATTERN_LENGTH));
+		else if (k == "speed")
+			pSong->SetSongSpeed(reader.read_value().get<unsigned>());
+		else if (k == "tempo")
+			pSong->SetSongTempo(reader.read_value().get<unsigned>());
+		else if (k == "title")
+			pSong->SetTitle(reader.read_value().get<std::string>());
+		else if (k == "uses_groove")
+			pSong->SetSongGroove(reader.read_value().get<bool>());
+		else if (k == "highlight")
+			pSong->SetRowHighlight(reader.read_value().get<stHighlight>());
+		else
+			reader.skip_value();
+
+	return pSong;
+}
+
+void ReadChannels(const json &j, CFamiTrackerModule &modfile) {
+	CSoundChipSet chips;
+	unsigned n163chs = 0;
+	for (const auto &cj : j) {
+		auto ch = GetChannelID(cj.at("chip"), cj.at("subindex"));
+		chips = chips.WithChip(ch.Chip);
+		if (ch.Chip == sound_chip_t::N163)
+			++n163chs;
+	}
+	modfile.SetChannelMap(FTEnv.GetSoundChipService()->MakeChannelMap(chips, n163chs));
+}
+
+void ReadGlobal(const json &j, CFamiTrackerModule &modfile) {
+	json_maybe(j, "machine", [&] (std::string &&machine) {
+		modfile.SetMachine(machine == "pal" ? machine_t::PAL : machine_t::NTSC);
+	});
+	json_maybe(j, "engine_speed", [&] (unsigned speed) {
+		modfile.SetEngineSpeed(speed);
+	});
+	json_maybe(j, "vibrato_style", [&] (std::string &&style) {
+		modfile.SetVibratoStyle(style == "old" ? vibrato_t::Up : vibrato_t::Bidir);
+	});
+	json_maybe(j, "linear_pitch", [&] (bool linear) {
+		modfile.SetLinearPitch(linear);
+	});
+	json_maybe(j, "fxx_split_point", [&] (unsigned split) {
+		modfile.SetSpeedSplitPoint(split);
+	});
+	json_maybe(j, "detune", [&] (const json &dj) {
+		modfile.SetTuning(get_maybe<int>(dj, "semitones"), get_maybe<int>(dj, "cents"));
+	});
+}
+
+void ReadMetadata(const json &j, CFamiTrackerModule &modfile) {
+	modfile.SetModuleName(get_maybe<std::string>(j, "title"));
+	modfile.SetModuleArtist(get_maybe<std::string>(j, "artist"));
+	modfile.SetModuleCopyright(get_maybe<std::string>(j, "copyright"));
+	modfile.SetComment(get_maybe<std::string>(j, "comment"), get_maybe<bool>(j, "show_comment_on_open"));
+}
+
+} // namespace
+
+void WriteModuleJson(std::ostream &os, const CFamiTrackerModule &modfile) {
+	json_stream_writer writer {os};
+	const auto *pManager = modfile.GetInstrumentManager();
+	const auto &order = modfile.GetChannelOrder();
+
+	writer.begin_object();
+
+	writer.key("channels");
+	writer.value(json(order));
+
+	writer.key("detunes");
+	writer.begin_array();
+	for (int i = 0; i < 6; ++i)
+		for (int n = 0; n < NOTE_COUNT; ++n)
+			if (auto offs = modfile.GetDetuneOffset(i, n))
+				writer.value(json {
+					{"table_id", i},
+					{"note", n},
+					{"offset", offs},
+				});
+	writer.end_array();
+
+	writer.key("dpcm_samples");
+	writer.begin_array();
+	for (unsigned i = 0; i < CDSampleManager::MAX_DSAMPLES; ++i)
+		if (auto sample = pManager->GetDSampleManager()->GetDSample(i)) {
+			auto dj = json(*sample);
+			dj["index"] = i;
+			writer.value(dj);
+		}
+	writer.end_array();
+
+	writer.key("global");
+	writer.value(json {
+		{"machine", modfile.GetMachine() == machine_t::PAL ? "pal" : "ntsc"},
+		{"engine_speed", modfile.GetEngineSpeed()},
+		{"vibrato_style", modfile.GetVibratoStyle() == vibrato_t::Up ? "old" : "new"},
+		{"linear_pitch", modfile.GetLinearPitch()},
+		{"fxx_split_point", modfile.GetSpeedSplitPoint()},
+		{"detune", {
+			{"semitones", modfile.GetTuningSemitone()},
+			{"cents", modfile.GetTuningCent()},
+		}},
+	});
+
+	writer.key("grooves");
+	writer.begin_array();
+	for (unsigned i = 0; i < MAX_GROOVE; ++i)
+		if (auto pGroove = modfile.GetGroove(i)) {
+			auto gj = json(*pGroove);
+			gj["index"] = i;
+			writer.value(gj);
+		}
+	writer.end_array();
+
+	writer.key("instruments");
+	writer.begin_array();
+	for (unsigned i = 0; i < MAX_INSTRUMENTS; ++i)
+		if (auto pInst = pManager->GetInstrument(i)) {
+			auto ij = json(*pInst);
+			ij["index"] = i;
+			writer.value(ij);
+		}
+	writer.end_array();
+
+	writer.key("metadata");
+	writer.value(json {
+		{"title", std::string {modfile.GetModuleName()}},
+		{"artist", std::string {modfile.GetModuleArtist()}},
+		{"copyright", std::string {modfile.GetModuleCopyright()}},
+		{"comment", std::string {modfile.GetComment()}},
+		{"show_comment_on_open", modfile.ShowsCommentOnOpen()},
+	});
+
+	writer.key("sequences");
+	writer.begin_array();
+	for (auto inst_type : {INST_2A03, INST_VRC6, INST_N163, INST_S5B}) {
+		const CSequenceManager &smanager = *pManager->GetSequenceManager(inst_type);
+		auto name = std::string {GetChipName(inst_type)};
+		for (auto t : enum_values<sequence_t>())
+			if (const auto *seqcol = smanager.GetCollection(t))
+				for (unsigned i = 0; i < MAX_SEQUENCES; ++i)
+					if (auto pSeq = seqcol->GetSequence(i)) {
+						auto sj = json(*pSeq);
+						sj["chip"] = name;
+						sj["macro_id"] = value_cast(t);
+						sj["index"] = i;
+						writer.value(sj);
+					}
+	}
+	writer.end_array();
+
+	writer.key("songs");
+	writer.begin_array();
+	modfile.VisitSongs([&] (const CSongData &song) {
+		writer.begin_object();
+		writer.key("bookmarks");
+		writer.value(json(song.GetBookmarks()));
+		writer.key("frames");
+		writer.value(song.GetFrameCount());
+		writer.key("highlight");
+		writer.value(json(song.GetRowHighlight()));
+		writer.key("rows");
+		writer.value(song.GetPatternLength());
+		writer.key("speed");
+		writer.value(song.GetSongSpeed());
+		writer.key("tempo");
+		writer.value(song.GetSongTempo());
+		writer.key("title");
+		writer.value(std::string {song.GetTitle()});
+
+		writer.key("tracks");
+		writer.begin_array();
+		song.VisitTracks([&] (const CTrackData &track, stChannelID ch) {
+			if (!order.HasChannel(ch))
+				return;
+			writer.begin_object();
+			writer.key("chip");
+			writer.value(std::string {FTEnv.GetSoundChipService()->GetChipShortName(ch.Chip)});
+			writer.key("effect_columns");
+			writer.value(track.GetEffectColumnCount());
+
+			writer.key("frame_list");
+			writer.begin_array();
+			for (unsigned f = 0; f < song.GetFrameCount(); ++f)
+				writer.value(track.GetFramePattern(f));
+			writer.end_array();
+
+			writer.key("patterns");
+			writer.begin_array();
+			track.VisitPatterns([&] (const CPatternData &pattern, std::size_t index) {
+				if (pattern.GetNoteCount() == 0)
+					return;
+				writer.begin_object();
+				writer.key("index");
+				writer.value(index);
+				writer.key("notes");
+				writer.begin_array();
+				pattern.VisitRows([&] (const stChanNote &note, unsigned row) {
+					if (note != stChanNote { })
+						writer.value(json {
+							{"row", row},
+							{"note", json(note)},
+						});
+				});
+				writer.end_array();
+				writer.end_object();
+			});
+			writer.end_array();
+
+			writer.key("subindex");
+			writer.value(ch.Subindex);
+			writer.end_object();
+		});
+		writer.end_array();
+
+		writer.key("uses_groove");
+		writer.value(song.GetSongGroove());
+		writer.end_object();
+	});
+	writer.end_array();
+
+	writer.end_object();
+}
+
+void ReadModuleJson(std::istream &is, CFamiTrackerModule &modfile) {
+	json_stream_reader reader {is};
+	json global;
+	unsigned songs = 0;
+
+	reader.begin_object();
+	for (std::string k; reader.next_key(k); ) {
+		if (k == "songs") {
+			reader.begin_array();
+			while (reader.next_element()) {
+				auto pSong = ReadSong(reader);
+				if (songs < modfile.GetSongCount())
+					modfile.ReplaceSong(songs, std::move(pSong));
+				else if (!modfile.InsertSong(songs, std::move(pSong)))
+					throw std::invalid_argument {"Too many songs"};
+				++songs;
+			}
+		}
+		else if (k == "channels")
+			ReadChannels(reader.read_value(), modfile);
+		else if (k == "global")
+			global = reader.read_value(); // applied after the channel map
+		else if (k == "metadata")
+			ReadMetadata(reader.read_value(), modfile);
+		else if (k == "instruments") {
+			auto *pManager = modfile.GetInstrumentManager();
+			reader.begin_array();
+			while (reader.next_element()) {
+				json ij = reader.read_value();
+				unsigned index = json_get_between<unsigned>(ij, "index", 0u, MAX_INSTRUMENTS - 1);
+				pManager->InsertInstrument(index, ReadInstrument(ij, *pManager));
+			}
+		}
+		else if (k == "sequences") {
+			reader.begin_array();
+			while (reader.next_element()) {
+				json sj = reader.read_value();
+				auto seq_type = static_cast<sequence_t>(json_get_between<unsigned>(sj, "macro_id", 0u, SEQ_COUNT - 1));
+				auto *pManager = modfile.GetInstrumentManager()->GetSequenceManager(GetInstType(sj.at("chip").get<std::string>()));
+				if (auto *pCol = pManager ? pManager->GetCollection(seq_type) : nullptr)
+					pCol->SetSequence(json_get_between<unsigned>(sj, "index", 0u, MAX_SEQUENCES - 1), ReadSequence(sj, seq_type));
+			}
+		}
+		else if (k == "dpcm_samples") {
+			auto *pManager = modfile.GetInstrumentManager()->GetDSampleManager();
+			reader.begin_array();
+			while (reader.next_element()) {
+				json dj = reader.read_value();
+				auto pSample = std::make_shared<ft0cc::doc::dpcm_sample>();
+				from_json(dj, *pSample);
+				pManager->SetDSample(json_get_between<unsigned>(dj, "index", 0u, CDSampleManager::MAX_DSAMPLES - 1), std::move(pSample));
+			}
+		}
+		else if (k == "grooves") {
+			reader.begin_array();
+			while (reader.next_element()) {
+				json gj = reader.read_value();
+				auto pGroove = std::make_shared<ft0cc::doc::groove>();
+				from_json(gj, *pGroove);
+				modfile.SetGroove(json_get_between<unsigned>(gj, "index", 0u, MAX_GROOVE - 1), std::move(pGroove));
+			}
+		}
+		else if (k == "detunes") {
+			reader.begin_array();
+			while (reader.next_element()) {
+				json dj = reader.read_value();
+				modfile.SetDetuneOffset(json_get_between(dj, "table_id", 0, 5),
+					json_get_between(dj, "note", 0, NOTE_COUNT - 1), dj.at("offset").get<int>());
+			}
+		}
+		else
+			reader.skip_value();
+	}
+
+	if (!global.is_null())
+		ReadGlobal(global, modfile);
+}
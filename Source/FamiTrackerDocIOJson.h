@@ -24,6 +24,7 @@
 #pragma once
 
 #include "json/json.hpp"
+#include <iosfwd>		// // //
 
 class stChanNote;
 class CPatternData;
@@ -75,6 +76,23 @@ void from_json(const nlohmann::json &j, CFamiTrackerModule &modfile);
 void from_json(const nlohmann::json &j, CSequence &seq);
 void from_json(const nlohmann::json &j, CDSampleManager &dmanager);
 
+// // // streaming module I/O
+
+/*!	\brief Writes a module as JSON without building a document tree for the whole module.
+	\details The output is identical to nlohmann::json(modfile).dump(). At most one pattern row,
+	instrument, sequence or sample is converted to a document tree at a time.
+	\param os The output stream.
+	\param modfile The module. */
+void WriteModuleJson(std::ostream &os, const CFamiTrackerModule &modfile);
+
+/*!	\brief Reads a module from JSON without parsing the entire input at once.
+	\details Accepts the output of WriteModuleJson and to_json. Pattern rows are decoded one at a
+	time into the song they belong to. Invalid values throw std::invalid_argument or
+	nlohmann::json::exception.
+	\param is The input stream.
+	\param modfile A newly created module to receive the contents. */
+void ReadModuleJson(std::istream &is, CFamiTrackerModule &modfile);
+
 namespace ft0cc::doc {
 
 class dpcm_sample;
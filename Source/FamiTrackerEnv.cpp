@@ -23,7 +23,9 @@
 #include "FamiTrackerEnv.h"
 #include "InstrumentService.h"		// // //
 #include "SoundChipService.h"		// // //
-#ifndef FT0CC_EXT_BUILD
+#ifdef FT0CC_EXT_BUILD
+#include "Settings.h"		// // //
+#else
 #include "stdafx.h"
 #include "FamiTracker.h"
 #include "FamiTrackerDoc.h"
@@ -72,7 +74,7 @@ CMIDI *CFamiTrackerEnv::GetMIDI() {
 
 CSettings *CFamiTrackerEnv::GetSettings() {
 #ifdef FT0CC_EXT_BUILD
-	return nullptr;
+	return &CSettings::GetInstance();		// // // zero-initialized, matches the defaults used by the sound driver
 #else
 	return theApp.GetSettings();
 #endif
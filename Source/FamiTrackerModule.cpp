@@ -25,7 +25,10 @@
 #include "InstrumentManager.h"
 #include "ChannelMap.h"
 #include "SongView.h"
+#include "SongFlowGraph.h"		// // //
 #include "PeriodTables.h"
+#include "DetuneTable.h"		// // //
+#include "ModuleTransform.h"		// // //
 #include <cmath>
 
 #include "InstrumentManager.h"
@@ -35,6 +38,7 @@
 
 CFamiTrackerModule::CFamiTrackerModule() :
 	m_pChannelMap(std::make_unique<CChannelMap>()),
+	m_pFlowGraphs(std::make_unique<CSongFlowGraphCache>(*this)),		// // //
 	m_pInstrumentManager(std::make_unique<CInstrumentManager>())
 {
 	AllocateSong(0);
@@ -114,6 +118,10 @@ std::unique_ptr<CConstSongView> CFamiTrackerModule::MakeSongView(unsigned index,
 	return std::make_unique<CConstSongView>(GetChannelOrder(), *GetSong(index), showSkippedRows);
 }
 
+CSongFlowGraphCache &CFamiTrackerModule::GetSongFlowGraphs() const {		// // //
+	return *m_pFlowGraphs;
+}
+
 machine_t CFamiTrackerModule::GetMachine() const {
 	return m_iMachine;
 }
@@ -168,76 +176,23 @@ void CFamiTrackerModule::SetSpeedSplitPoint(unsigned splitPoint) {
 }
 
 std::array<int, 256> CFamiTrackerModule::MakeVibratoTable() const {		// // //
-	const double NEW_VIBRATO_DEPTH[] = {
-		0.0, 1.5, 2.5, 4.0, 5.0, 7.0, 10.0, 12.0, 14.0, 17.0, 22.0, 30.0, 44.0, 64.0, 96.0, 128.0,
-	};
-
-	const double OLD_VIBRATO_DEPTH[] = {
-		0.0, 1.0, 2.0, 3.0, 4.0, 7.0, 8.0, 15.0, 16.0, 31.0, 32.0, 63.0, 64.0, 127.0, 128.0, 255.0,
-	};
-
-	std::array<int, 256> table = { };
-	const double PI = std::acos(-1);
-
-	for (int depth = 0; depth < 16; ++depth) {
-		for (int phase = 0; phase < 16; ++phase) {
-			auto t = (double)phase;
-			table[depth * 16 + phase] = (int)(GetVibratoStyle() == vibrato_t::Bidir ?
-				(std::sin(t * PI / 32.) * NEW_VIBRATO_DEPTH[depth] /*+ .5*/) :
-				(t * OLD_VIBRATO_DEPTH[depth] / 16. + 1.));
-		}
-	}
-
-	return table;
+	return CPeriodTableCache::GetVibratoTable(GetVibratoStyle() == vibrato_t::Bidir);
 }
 
 CPeriodTables CFamiTrackerModule::MakePeriodTables() const {		// // //
-	CPeriodTables table;
-
-	const double A440_NOTE = 45. - GetTuningSemitone() - GetTuningCent() / 100.;
-	const double clock_ntsc = MASTER_CLOCK_NTSC / 16.;
-	const double clock_pal  = MASTER_CLOCK_PAL / 16.;
-
-	for (int i = 0; i < NOTE_COUNT; ++i) {
-		// Frequency (in Hz)
-		double Freq = 440. * std::pow(2.0, (i - A440_NOTE) / 12.);
-		double Pitch;
-
-		// 2A07
-		Pitch = (clock_pal / Freq) - 0.5;
-		table.pal_period[i] = (unsigned int)(Pitch - GetDetuneOffset(1, i));		// // //
-
-		// 2A03 / MMC5 / VRC6
-		Pitch = (clock_ntsc / Freq) - 0.5;
-		table.ntsc_period[i] = (unsigned int)(Pitch - GetDetuneOffset(0, i));		// // //
-		table.s5b_period[i] = table.ntsc_period[i] + 1;		// correction
-
-		// VRC6 Saw
-		Pitch = ((clock_ntsc * 16.0) / (Freq * 14.0)) - 0.5;
-		table.saw_period[i] = (unsigned int)(Pitch - GetDetuneOffset(2, i));		// // //
-
-		// FDS
-		Pitch = (Freq * 65536.0) / (clock_ntsc / 1.0) + 0.5;
-		table.fds_freq[i] = (unsigned int)(Pitch + GetDetuneOffset(4, i));		// // //
-
-		// N163
-		Pitch = ((Freq * GetNamcoChannels() * 983040.0) / clock_ntsc + 0.5) / 4;		// // //
-		table.n163_freq[i] = (unsigned int)(Pitch + GetDetuneOffset(5, i));		// // //
-
-		if (table.n163_freq[i] > 0xFFFF)	// 0x3FFFF
-			table.n163_freq[i] = 0xFFFF;	// 0x3FFFF
-
-		// // // Sunsoft 5B uses NTSC table
-
-		// // // VRC7
-		if (i < NOTE_RANGE) {
-			Pitch = Freq * 262144.0 / 49716.0 + 0.5;
-			unsigned Reg = (unsigned int)(Pitch + GetDetuneOffset(3, i));
-			for (int j = 0; j < OCTAVE_RANGE; ++j)
-				table.vrc7_freq[i + j * NOTE_RANGE] = Reg;		// // //
-		}
-	}
+	auto &cache = CPeriodTableCache::GetInstance();
+	const auto GetTable = [&] (int Table, int Detune) {
+		return cache.GetTable(Table, GetTuningSemitone(), GetTuningCent(), GetNamcoChannels(), m_iDetuneTable[Detune]);
+	};
 
+	CPeriodTables table;
+	table.ntsc_period = GetTable(CDetuneTable::DETUNE_NTSC, 0);
+	table.pal_period = GetTable(CDetuneTable::DETUNE_PAL, 1);
+	table.saw_period = GetTable(CDetuneTable::DETUNE_SAW, 2);
+	table.vrc7_freq = GetTable(CDetuneTable::DETUNE_VRC7, 3);
+	table.fds_freq = GetTable(CDetuneTable::DETUNE_FDS, 4);
+	table.n163_freq = GetTable(CDetuneTable::DETUNE_N163, 5);
+	table.s5b_period = GetTable(CDetuneTable::DETUNE_S5B, 0);		// // // Sunsoft 5B uses NTSC table
 	return table;
 }
 
@@ -307,16 +262,7 @@ void CFamiTrackerModule::SwapInstruments(unsigned first, unsigned second) {
 	GetInstrumentManager()->SwapInstruments(first, second);		// // //
 
 	// Scan patterns
-	VisitSongs([&] (CSongData &song) {
-		song.VisitPatterns([&] (CPatternData &pat) {
-			pat.VisitRows([&] (stChanNote &note, unsigned row) {
-				if (note.Instrument == first)
-					note.Instrument = second;
-				else if (note.Instrument == second)
-					note.Instrument = first;
-			});
-		});
-	});
+	CModuleTransform::SwapInstruments(first, second).Apply(*this);		// // //
 }
 
 bool CFamiTrackerModule::AllocateSong(unsigned index) {
@@ -330,6 +276,7 @@ bool CFamiTrackerModule::AllocateSong(unsigned index) {
 bool CFamiTrackerModule::InsertSong(unsigned index, std::unique_ptr<CSongData> pSong) {		// // //
 	if (index <= GetSongCount() && index < MAX_TRACKS) {
 		m_pTracks.insert(m_pTracks.begin() + index, std::move(pSong));
+		m_pFlowGraphs->Clear();		// // //
 		return true;
 	}
 	return false;
@@ -337,6 +284,7 @@ bool CFamiTrackerModule::InsertSong(unsigned index, std::unique_ptr<CSongData> p
 
 std::unique_ptr<CSongData> CFamiTrackerModule::ReplaceSong(unsigned index, std::unique_ptr<CSongData> pSong) {		// // //
 	m_pTracks[index].swap(pSong);
+	m_pFlowGraphs->Clear();		// // //
 	return pSong;
 }
 
@@ -347,6 +295,7 @@ std::unique_ptr<CSongData> CFamiTrackerModule::ReleaseSong(unsigned index) {		//
 	// Move down all other tracks
 	auto song = std::move(m_pTracks[index]);
 	m_pTracks.erase(m_pTracks.cbegin() + index);		// // //
+	m_pFlowGraphs->Clear();		// // //
 	return song;
 }
 
@@ -356,6 +305,7 @@ void CFamiTrackerModule::RemoveSong(unsigned index) {
 
 void CFamiTrackerModule::SwapSongs(unsigned lhs, unsigned rhs) {
 	m_pTracks[lhs].swap(m_pTracks[rhs]);		// // //
+	m_pFlowGraphs->Clear();		// // //
 }
 
 std::shared_ptr<ft0cc::doc::groove> CFamiTrackerModule::GetGroove(unsigned index) {
@@ -39,6 +39,7 @@ class CSongView;
 class CInstrumentManager;
 class CSequenceManager;
 class CDSampleManager;
+class CSongFlowGraphCache;
 struct CPeriodTables;
 struct stHighlight;
 
@@ -83,6 +84,7 @@ public:
 
 	std::unique_ptr<CSongView> MakeSongView(unsigned index, bool showSkippedRows);
 	std::unique_ptr<CConstSongView> MakeSongView(unsigned index, bool showSkippedRows) const;
+	CSongFlowGraphCache &GetSongFlowGraphs() const;		// // //
 
 	// global info
 	machine_t GetMachine() const;
@@ -198,6 +200,7 @@ private:
 	std::unique_ptr<CChannelMap> m_pChannelMap;		// // //
 
 	std::vector<std::unique_ptr<CSongData>> m_pTracks;
+	std::unique_ptr<CSongFlowGraphCache> m_pFlowGraphs;		// // // one graph per song, kept across edits
 
 	std::unique_ptr<CInstrumentManager> m_pInstrumentManager;
 
@@ -28,6 +28,8 @@
 #include "SongData.h"		// // //
 #include "SongView.h"		// // //
 #include "ChannelOrder.h"		// // //
+#include "FamiTrackerModule.h"		// // //
+#include "SongFlowGraph.h"		// // //
 #include <unordered_map>		// // //
 
 // // // all dependencies on CMainFrame
@@ -142,6 +144,25 @@ void CFrameAction::UpdateViews(CMainFrame &MainFrm) const {		// // //
 	MainFrm.GetActiveDocument()->UpdateAllViews(NULL, UPDATE_FRAME);
 }
 
+void CFrameAction::UpdateFlowGraph(CMainFrame &MainFrm) const {		// // //
+	// frames have been inserted, removed or reordered
+	GET_VIEW()->GetModuleData()->GetSongFlowGraphs().Visit(MainFrm.GetSelectedTrack(), [] (CSongFlowGraph &graph) {
+		graph.Rebuild();
+	});
+}
+
+void CFrameAction::UpdateFlowGraphFrames(CMainFrame &MainFrm, CIntRange<int> Frames) const {		// // //
+	GET_VIEW()->GetModuleData()->GetSongFlowGraphs().Visit(MainFrm.GetSelectedTrack(), [&] (CSongFlowGraph &graph) {
+		for (int f : Frames)
+			graph.UpdateFrame(f);
+	});
+}
+
+module_block_set_t CFrameAction::GetModifiedBlocks() const {		// // //
+	// unused patterns are not saved, and bookmarks move with their frames
+	return MakeBlockSet({module_block_t::frames, module_block_t::patterns, module_block_t::bookmarks});
+}
+
 
 
 // // // built-in frame action subtypes
@@ -293,6 +314,11 @@ void CFActionSetPattern::Redo(CMainFrame &MainFrm)
 			pSongView->SetFramePattern(c, f, m_iNewPattern);
 }
 
+void CFActionSetPattern::UpdateFlowGraph(CMainFrame &MainFrm) const		// // //
+{
+	UpdateFlowGraphFrames(MainFrm, m_itFrames);
+}
+
 bool CFActionSetPattern::Merge(const CAction &Other)		// // //
 {
 	auto pAction = dynamic_cast<const CFActionSetPattern *>(&Other);
@@ -334,6 +360,11 @@ void CFActionSetPatternAll::Redo(CMainFrame &MainFrm)
 	});
 }
 
+void CFActionSetPatternAll::UpdateFlowGraph(CMainFrame &MainFrm) const		// // //
+{
+	UpdateFlowGraphFrames(MainFrm, make_int_range(m_pUndoState->Cursor.m_iFrame, m_pUndoState->Cursor.m_iFrame + 1));
+}
+
 bool CFActionSetPatternAll::Merge(const CAction &Other)		// // //
 {
 	auto pAction = dynamic_cast<const CFActionSetPatternAll *>(&Other);
@@ -385,6 +416,11 @@ void CFActionChangePattern::Redo(CMainFrame &MainFrm)
 		}
 }
 
+void CFActionChangePattern::UpdateFlowGraph(CMainFrame &MainFrm) const		// // //
+{
+	UpdateFlowGraphFrames(MainFrm, m_itFrames);
+}
+
 bool CFActionChangePattern::Merge(const CAction &Other)		// // //
 {
 	auto pAction = dynamic_cast<const CFActionChangePattern *>(&Other);
@@ -438,6 +474,11 @@ void CFActionChangePatternAll::Redo(CMainFrame &MainFrm)
 	});
 }
 
+void CFActionChangePatternAll::UpdateFlowGraph(CMainFrame &MainFrm) const		// // //
+{
+	UpdateFlowGraphFrames(MainFrm, make_int_range(m_pUndoState->Cursor.m_iFrame, m_pUndoState->Cursor.m_iFrame + 1));
+}
+
 bool CFActionChangePatternAll::Merge(const CAction &Other)		// // //
 {
 	auto pAction = dynamic_cast<const CFActionChangePatternAll *>(&Other);
@@ -474,6 +515,11 @@ void CFActionMoveDown::Redo(CMainFrame &MainFrm)
 	GET_VIEW()->SelectFrame(m_pUndoState->Cursor.m_iFrame + 1);
 }
 
+void CFActionMoveDown::UpdateFlowGraph(CMainFrame &MainFrm) const		// // //
+{
+	UpdateFlowGraphFrames(MainFrm, make_int_range(m_pUndoState->Cursor.m_iFrame, m_pUndoState->Cursor.m_iFrame + 2));
+}
+
 
 
 bool CFActionMoveUp::SaveState(const CMainFrame &MainFrm)
@@ -493,6 +539,11 @@ void CFActionMoveUp::Redo(CMainFrame &MainFrm)
 	GET_VIEW()->SelectFrame(m_pUndoState->Cursor.m_iFrame - 1);
 }
 
+void CFActionMoveUp::UpdateFlowGraph(CMainFrame &MainFrm) const		// // //
+{
+	UpdateFlowGraphFrames(MainFrm, make_int_range(m_pUndoState->Cursor.m_iFrame - 1, m_pUndoState->Cursor.m_iFrame + 1));
+}
+
 
 
 CFActionPaste::CFActionPaste(CFrameClipData Data, int Frame, bool Clone) :
@@ -88,9 +88,13 @@ protected:
 	void RestoreUndoState(CMainFrame &MainFrm) const override;		// // //
 	void RestoreRedoState(CMainFrame &MainFrm) const override;		// // //
 	void UpdateViews(CMainFrame &MainFrm) const override;		// // //
+	void UpdateFlowGraph(CMainFrame &MainFrm) const override;		// // //
+	module_block_set_t GetModifiedBlocks() const override;		// // //
 
 protected:
 	static int ClipPattern(int Pattern);
+	// // // Rescans frames of the current song's flow graph after their patterns have changed
+	void UpdateFlowGraphFrames(CMainFrame &MainFrm, CIntRange<int> Frames) const;
 
 	CIntRange<int> m_itFrames, m_itChannels;
 
@@ -167,6 +171,7 @@ private:
 	void Undo(CMainFrame &MainFrm) override;
 	void Redo(CMainFrame &MainFrm) override;
 	bool Merge(const CAction &Other) override;		// // //
+	void UpdateFlowGraph(CMainFrame &MainFrm) const override;		// // //
 private:
 	int m_iNewPattern;
 	CFrameClipData m_ClipData;
@@ -182,6 +187,7 @@ private:
 	void Undo(CMainFrame &MainFrm) override;
 	void Redo(CMainFrame &MainFrm) override;
 	bool Merge(const CAction &Other) override;		// // //
+	void UpdateFlowGraph(CMainFrame &MainFrm) const override;		// // //
 private:
 	int m_iNewPattern;
 	CFrameClipData m_RowClipData;
@@ -197,6 +203,7 @@ private:
 	void Undo(CMainFrame &MainFrm) override;
 	void Redo(CMainFrame &MainFrm) override;
 	bool Merge(const CAction &Other) override;		// // //
+	void UpdateFlowGraph(CMainFrame &MainFrm) const override;		// // //
 private:
 	int m_iPatternOffset;
 	CFrameClipData m_ClipData;
@@ -213,6 +220,7 @@ private:
 	void Undo(CMainFrame &MainFrm) override;
 	void Redo(CMainFrame &MainFrm) override;
 	bool Merge(const CAction &Other) override;		// // //
+	void UpdateFlowGraph(CMainFrame &MainFrm) const override;		// // //
 private:
 	int m_iPatternOffset;
 	CFrameClipData m_RowClipData;
@@ -227,6 +235,7 @@ private:
 	bool SaveState(const CMainFrame &MainFrm) override;
 	void Undo(CMainFrame &MainFrm) override;
 	void Redo(CMainFrame &MainFrm) override;
+	void UpdateFlowGraph(CMainFrame &MainFrm) const override;		// // //
 };
 
 class CFActionMoveUp : public CFrameAction
@@ -237,6 +246,7 @@ private:
 	bool SaveState(const CMainFrame &MainFrm) override;
 	void Undo(CMainFrame &MainFrm) override;
 	void Redo(CMainFrame &MainFrm) override;
+	void UpdateFlowGraph(CMainFrame &MainFrm) const override;		// // //
 };
 
 class CFActionClonePatterns : public CFrameAction		// // //
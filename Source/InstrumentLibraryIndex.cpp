@@ -0,0 +1,287 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2018 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+** Library General Public License for more details.  To obtain a
+** copy of the GNU Library General Public License, write to the Free
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+#include "InstrumentLibraryIndex.h"
+#include "MappedFile.h"
+#include "SimpleFile.h"
+#include "ByteReader.h"
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstring>
+#include <future>
+#include <thread>
+#include <unordered_map>
+
+namespace {
+
+const std::string_view FTI_HEADER = "FTI";
+const unsigned FTI_MAX_VERSION = 25u;		// 2.5
+
+const std::string_view CACHE_HEADER = "FTIX";
+const std::uint32_t CACHE_VERSION = 1u;
+
+constexpr unsigned MAX_WORKERS = 16u;
+
+std::uint64_t HashBytes(array_view<unsigned char> data) {
+	std::uint64_t h = 0xCBF29CE484222325ull;
+	for (unsigned char x : data) {
+		h ^= x;
+		h *= 0x100000001B3ull;
+	}
+	return h;
+}
+
+bool IsSequenceInstrument(inst_type_t type) {
+	switch (type) {
+	case INST_2A03: case INST_VRC6: case INST_N163: case INST_S5B:
+		return true;
+	default:
+		return false;
+	}
+}
+
+bool IsInstrumentFile(const fs::path &fname) {
+	auto ext = fname.extension().string();
+	std::transform(ext.begin(), ext.end(), ext.begin(), [] (unsigned char c) { return std::tolower(c); });
+	return ext == ".fti";
+}
+
+std::int64_t GetModifiedTime(const fs::path &fname, std::error_code &ec) {
+	return static_cast<std::int64_t>(fs::last_write_time(fname, ec).time_since_epoch().count());
+}
+
+std::string ToLower(std::string_view sv) {
+	std::string str {sv};
+	std::transform(str.begin(), str.end(), str.begin(), [] (unsigned char c) { return std::tolower(c); });
+	return str;
+}
+
+} // namespace
+
+CInstrumentLibraryIndex::CInstrumentLibraryIndex(fs::path root) : root_(std::move(root)) {
+}
+
+const fs::path &CInstrumentLibraryIndex::GetRoot() const {
+	return root_;
+}
+
+bool CInstrumentLibraryIndex::Load(const fs::path &cache) {
+	entries_.clear();
+
+	CMappedFile file;
+	if (!file.Open(cache))
+		return false;
+
+	CByteReader r {file.GetData()};
+	if (r.ReadBytes(CACHE_HEADER.size()) != CACHE_HEADER || r.ReadInt(4) != CACHE_VERSION)
+		return false;
+	if (r.ReadString() != root_.generic_u8string())
+		return false;
+
+	std::vector<stInstrumentLibraryEntry> entries;
+	for (std::uint32_t n = r.ReadInt(4); r.Good() && n; --n) {
+		auto &entry = entries.emplace_back();
+		entry.Path = fs::u8path(r.ReadString());
+		entry.FileSize = r.ReadInt64();
+		entry.ModifiedTime = static_cast<std::int64_t>(r.ReadInt64());
+		entry.Hash = r.ReadInt64();
+		entry.Type = static_cast<inst_type_t>(r.ReadInt(1));
+		entry.Version = r.ReadInt(1);
+		entry.Name = r.ReadString();
+		for (auto &seq : entry.Sequences) {
+			seq.Enabled = r.ReadInt(1) != 0u;
+			seq.Length = static_cast<std::uint8_t>(r.ReadInt(1));
+			seq.Loop = static_cast<std::int16_t>(r.ReadInt(2));
+			seq.Release = static_cast<std::int16_t>(r.ReadInt(2));
+		}
+	}
+	if (!r.Good() || !r.Finished())
+		return false;
+
+	entries_ = std::move(entries);
+	return true;
+}
+
+bool CInstrumentLibraryIndex::Save(const fs::path &cache) const {
+	CSimpleFile file {cache, std::ios::out | std::ios::binary};
+	if (!file)
+		return false;
+
+	const auto WriteInt64 = [&] (std::uint64_t x) {
+		file.WriteInt32(static_cast<std::int32_t>(x & 0xFFFFFFFFu));
+		file.WriteInt32(static_cast<std::int32_t>(x >> 32));
+	};
+
+	file.WriteBytes(CACHE_HEADER);
+	file.WriteInt32(CACHE_VERSION);
+	file.WriteString(root_.generic_u8string());
+	file.WriteInt32(static_cast<std::int32_t>(entries_.size()));
+	for (const auto &entry : entries_) {
+		file.WriteString(entry.Path.generic_u8string());
+		WriteInt64(entry.FileSize);
+		WriteInt64(static_cast<std::uint64_t>(entry.ModifiedTime));
+		WriteInt64(entry.Hash);
+		file.WriteInt8(static_cast<std::int8_t>(entry.Type));
+		file.WriteInt8(static_cast<std::int8_t>(entry.Version));
+		file.WriteString(entry.Name);
+		for (const auto &seq : entry.Sequences) {
+			file.WriteInt8(seq.Enabled ? 1 : 0);
+			file.WriteInt8(static_cast<std::int8_t>(seq.Length));
+			file.WriteInt16(seq.Loop);
+			file.WriteInt16(seq.Release);
+		}
+	}
+
+	return static_cast<bool>(file);
+}
+
+std::size_t CInstrumentLibraryIndex::Refresh() {
+	std::unordered_map<std::string, const stInstrumentLibraryEntry *> cached;
+	for (const auto &entry : entries_)
+		cached.try_emplace(entry.Path.generic_u8string(), &entry);
+
+	std::vector<stInstrumentLibraryEntry> entries;
+	std::vector<std::size_t> jobs;
+
+	std::error_code ec;
+	for (fs::recursive_directory_iterator it {root_, fs::directory_options::skip_permission_denied, ec}, end;
+		!ec && it != end; it.increment(ec)) {
+		std::error_code fec;
+		if (!it->is_regular_file(fec) || !IsInstrumentFile(it->path()))
+			continue;
+		const std::uint64_t size = it->file_size(fec);
+		const std::int64_t mtime = fec ? 0 : GetModifiedTime(it->path(), fec);
+		if (fec)
+			continue;
+
+		auto rel = it->path().lexically_relative(root_);
+		if (auto cit = cached.find(rel.generic_u8string()); cit != cached.end() &&
+			cit->second->FileSize == size && cit->second->ModifiedTime == mtime) {
+			entries.push_back(*cit->second);
+			continue;
+		}
+
+		auto &entry = entries.emplace_back();
+		entry.Path = std::move(rel);
+		entry.FileSize = size;
+		entry.ModifiedTime = mtime;
+		jobs.push_back(entries.size() - 1);
+	}
+
+	// each entry is written by exactly one worker
+	std::atomic<std::size_t> next {0u};
+	auto worker = [&] {
+		for (std::size_t i = next++; i < jobs.size(); i = next++) {
+			auto &entry = entries[jobs[i]];
+			if (!ParseFile(root_ / entry.Path, entry))
+				entry.Type = INST_NONE;
+		}
+	};
+
+	const unsigned workers = static_cast<unsigned>(std::min<std::size_t>(
+		std::clamp(std::thread::hardware_concurrency(), 1u, MAX_WORKERS), jobs.size()));
+	std::vector<std::future<void>> futures;
+	for (unsigned i = 1; i < workers; ++i)
+		futures.push_back(std::async(std::launch::async, worker));
+	worker();
+	for (auto &f : futures)
+		f.get();
+
+	std::sort(entries.begin(), entries.end(), [] (const auto &lhs, const auto &rhs) {
+		return lhs.Path < rhs.Path;
+	});
+
+	entries_ = std::move(entries);
+	return jobs.size();
+}
+
+const std::vector<stInstrumentLibraryEntry> &CInstrumentLibraryIndex::GetEntries() const {
+	return entries_;
+}
+
+std::vector<const stInstrumentLibraryEntry *> CInstrumentLibraryIndex::Find(inst_type_t type, std::string_view name) const {
+	const std::string needle = ToLower(name);
+	std::vector<const stInstrumentLibraryEntry *> found;
+	for (const auto &entry : entries_)
+		if (entry.Type != INST_NONE && (type == INST_NONE || entry.Type == type) &&
+			(needle.empty() || ToLower(entry.Name).find(needle) != std::string::npos))
+			found.push_back(&entry);
+	return found;
+}
+
+bool CInstrumentLibraryIndex::ParseFile(const fs::path &fname, stInstrumentLibraryEntry &entry) {
+	CMappedFile file;
+	if (!file.Open(fname))
+		return false;
+
+	CByteReader r {file.GetData()};
+	if (r.ReadBytes(FTI_HEADER.size()) != FTI_HEADER)
+		return false;
+	auto ver = r.ReadBytes(3);
+	if (ver.size() != 3 || !std::isdigit(static_cast<unsigned char>(ver[0])) || ver[1] != '.' ||
+		!std::isdigit(static_cast<unsigned char>(ver[2])))
+		return false;
+	const unsigned fti_ver = (ver[0] - '0') * 10 + (ver[2] - '0');
+	if (fti_ver > FTI_MAX_VERSION)
+		return false;
+
+	auto type = static_cast<inst_type_t>(r.ReadInt(1));
+	if (type == INST_NONE)
+		type = INST_2A03;
+	else if (type > INST_S5B)
+		return false;
+
+	entry.Version = fti_ver;
+	entry.Type = type;
+	entry.Name = r.ReadString();
+	entry.Sequences = { };
+
+	if (IsSequenceInstrument(type)) {
+		r.Skip(1); // sequence count, unused
+		for (auto &seq : entry.Sequences) {
+			if (r.ReadInt(1) != 1u)
+				continue;
+			const std::uint32_t Count = r.ReadInt(4);
+			if (Count > 0xFFu)
+				return false;
+			seq.Enabled = true;
+			seq.Length = static_cast<std::uint8_t>(std::min<std::uint32_t>(Count, MAX_SEQUENCE_ITEMS));
+			if (fti_ver < 20)
+				r.Skip(Count * 2);
+			else {
+				seq.Loop = static_cast<std::int16_t>(static_cast<std::int32_t>(r.ReadInt(4)));
+				if (fti_ver > 20) {
+					seq.Release = static_cast<std::int16_t>(static_cast<std::int32_t>(r.ReadInt(4)));
+					if (fti_ver >= 22)
+						r.Skip(4);
+				}
+				r.Skip(Count);
+			}
+		}
+	}
+
+	if (!r.Good())
+		return false;
+	entry.Hash = HashBytes(file.GetData());
+	return true;
+}
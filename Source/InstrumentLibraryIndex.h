@@ -0,0 +1,105 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2018 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+** Library General Public License for more details.  To obtain a
+** copy of the GNU Library General Public License, write to the Free
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+#pragma once
+
+#include <vector>
+#include <array>
+#include <string>
+#include <string_view>
+#include <cstdint>
+#include "Instrument.h"
+#include "Sequence.h"
+#include "ft0cc/fs.h"
+
+/*!
+	\brief Summary of an instrument file stored in the instrument library index.
+*/
+struct stInstrumentLibraryEntry {		// // //
+	struct stSequenceSummary {
+		bool Enabled = false;
+		std::uint8_t Length = 0u;
+		std::int16_t Loop = -1;
+		std::int16_t Release = -1;
+	};
+
+	fs::path Path;							// relative to the library root
+	std::uint64_t FileSize = 0u;
+	std::int64_t ModifiedTime = 0;
+	std::uint64_t Hash = 0u;				// FNV-1a over the whole file
+	inst_type_t Type = INST_NONE;			// INST_NONE if the file is not a valid instrument
+	unsigned Version = 0u;					// FTI version, e.g. 24 for 2.4
+	std::string Name;
+	std::array<stSequenceSummary, SEQ_COUNT> Sequences = { };
+};
+
+/*!
+	\brief A persistent index of the instrument files below a directory.
+	\details The index can be saved to and loaded from a cache file. Refreshing the index only parses
+	instrument files whose size or modification time differ from the cached entries; those files
+	are parsed in parallel. Files that are not valid FTI instruments are kept with the type INST_NONE
+	so that they are not parsed again until they change.
+*/
+class CInstrumentLibraryIndex {
+public:
+	/*!	\brief Constructs an empty index.
+		\param root The directory containing the instrument files. */
+	explicit CInstrumentLibraryIndex(fs::path root);
+
+	const fs::path &GetRoot() const;
+
+	/*!	\brief Replaces the index with the contents of a cache file.
+		\details Entries from a cache file created for a different root directory are discarded.
+		\param cache Path to the cache file.
+		\return Whether the cache file was read successfully. */
+	bool Load(const fs::path &cache);
+
+	/*!	\brief Writes the index to a cache file.
+		\param cache Path to the cache file.
+		\return Whether the cache file was written successfully. */
+	bool Save(const fs::path &cache) const;
+
+	/*!	\brief Rescans the root directory and updates the index.
+		\return The number of instrument files that were parsed. */
+	std::size_t Refresh();
+
+	/*!	\brief Obtains all indexed files, sorted by path. */
+	const std::vector<stInstrumentLibraryEntry> &GetEntries() const;
+
+	/*!	\brief Looks up indexed instruments.
+		\param type The instrument type to match, or INST_NONE to match any type.
+		\param name A substring of the instrument name to match case-insensitively; an empty string
+		matches any name.
+		\return Pointers to the matching valid entries, valid until the index is modified. */
+	std::vector<const stInstrumentLibraryEntry *> Find(inst_type_t type, std::string_view name = { }) const;
+
+	/*!	\brief Reads the summary of a single instrument file.
+		\param fname Path to the instrument file.
+		\param entry Receives the summary; the path, size and time members are left unchanged.
+		\return Whether the file is a valid FTI instrument. */
+	static bool ParseFile(const fs::path &fname, stInstrumentLibraryEntry &entry);
+
+private:
+	fs::path root_;
+	std::vector<stInstrumentLibraryEntry> entries_;
+};
@@ -0,0 +1,169 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2018 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+** Library General Public License for more details.  To obtain a
+** copy of the GNU Library General Public License, write to the Free
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+#include "LZCodec.h"
+#include <cstdint>
+#include <cstring>
+
+namespace {
+
+constexpr unsigned HASH_BITS = 14u;
+
+std::uint32_t Load32(const unsigned char *p) noexcept {
+	std::uint32_t x;
+	std::memcpy(&x, p, sizeof(x));
+	return x;
+}
+
+unsigned Hash(std::uint32_t x) noexcept {
+	return (x * 2654435761u) >> (32u - HASH_BITS);
+}
+
+unsigned char *PutLength(unsigned char *out, std::size_t len) noexcept {
+	for (; len >= 255u; len -= 255u)
+		*out++ = 255u;
+	*out++ = static_cast<unsigned char>(len);
+	return out;
+}
+
+unsigned char *PutCommand(unsigned char *out, const unsigned char *lit, std::size_t litlen, std::size_t offset, std::size_t matchlen) noexcept {
+	unsigned char &token = *out++;
+	token = static_cast<unsigned char>((litlen < 15u ? litlen : 15u) << 4);
+	if (litlen >= 15u)
+		out = PutLength(out, litlen - 15u);
+	if (litlen)
+		std::memcpy(out, lit, litlen);
+	out += litlen;
+
+	if (matchlen) {
+		matchlen -= lz::MIN_MATCH;
+		token |= static_cast<unsigned char>(matchlen < 15u ? matchlen : 15u);
+		*out++ = static_cast<unsigned char>(offset & 0xFFu);
+		*out++ = static_cast<unsigned char>(offset >> 8);
+		if (matchlen >= 15u)
+			out = PutLength(out, matchlen - 15u);
+	}
+	return out;
+}
+
+} // namespace
+
+namespace lz {
+
+std::vector<unsigned char> compress(array_view<unsigned char> src) {
+	std::vector<unsigned char> dest(max_compressed_size(src.size()));
+	unsigned char *out = dest.data();
+
+	const unsigned char *const begin = src.data();
+	const std::size_t n = src.size();
+	std::size_t anchor = 0u;
+
+	if (n >= MIN_MATCH) {
+		std::vector<std::uint32_t> table(std::size_t {1u} << HASH_BITS);		// position + 1, 0 if empty
+		const std::size_t last = n - MIN_MATCH;
+		std::size_t i = 0u;
+		while (i <= last) {
+			const std::uint32_t seq = Load32(begin + i);
+			std::uint32_t &slot = table[Hash(seq)];
+			const std::size_t cand = slot;
+			slot = static_cast<std::uint32_t>(i + 1u);
+
+			if (!cand || i + 1u - cand > MAX_OFFSET || Load32(begin + cand - 1u) != seq) {
+				++i;
+				continue;
+			}
+
+			const std::size_t m = cand - 1u;
+			std::size_t len = MIN_MATCH;
+			while (i + len < n && begin[m + len] == begin[i + len])
+				++len;
+
+			out = PutCommand(out, begin + anchor, i - anchor, i - m, len);
+			i += len;
+			anchor = i;
+			if (i - 2u <= last)		// keep runs of repeated data cheap to find
+				table[Hash(Load32(begin + i - 2u))] = static_cast<std::uint32_t>(i - 1u);
+		}
+	}
+
+	out = PutCommand(out, begin + anchor, n - anchor, 0u, 0u);
+	dest.resize(out - dest.data());
+	return dest;
+}
+
+bool decompress(array_view<unsigned char> src, unsigned char *dest, std::size_t size) noexcept {
+	const unsigned char *in = src.data();
+	const unsigned char *const in_end = in + src.size();
+	std::size_t pos = 0u;
+
+	const auto GetLength = [&] (std::size_t len) -> std::size_t {
+		if (len == 15u) {
+			unsigned char x;
+			do {
+				if (in == in_end)
+					return static_cast<std::size_t>(-1);
+				x = *in++;
+				len += x;
+			} while (x == 255u);
+		}
+		return len;
+	};
+
+	while (in != in_end) {
+		const unsigned char token = *in++;
+
+		std::size_t litlen = GetLength(token >> 4);
+		if (litlen > static_cast<std::size_t>(in_end - in) || litlen > size - pos)
+			return false;
+		if (litlen)
+			std::memcpy(dest + pos, in, litlen);
+		in += litlen;
+		pos += litlen;
+
+		if (in == in_end)		// final command
+			break;
+
+		if (in_end - in < 2)
+			return false;
+		const std::size_t offset = in[0] | (in[1] << 8);
+		in += 2;
+		std::size_t matchlen = GetLength(token & 0x0Fu);
+		if (matchlen == static_cast<std::size_t>(-1))
+			return false;
+		matchlen += MIN_MATCH;
+		if (!offset || offset > pos || matchlen > size - pos)
+			return false;
+
+		const unsigned char *match = dest + pos - offset;
+		unsigned char *out = dest + pos;
+		if (offset >= matchlen)
+			std::memcpy(out, match, matchlen);
+		else
+			for (std::size_t k = 0; k < matchlen; ++k)		// overlapping copy repeats the last offset bytes
+				out[k] = match[k];
+		pos += matchlen;
+	}
+
+	return pos == size;
+}
+
+} // namespace lz
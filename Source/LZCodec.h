@@ -0,0 +1,63 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2018 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+** Library General Public License for more details.  To obtain a
+** copy of the GNU Library General Public License, write to the Free
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include "array_view.h"
+
+// // // small LZ77 codec for module blocks
+//
+// The stream is a sequence of commands. Each command begins with a token byte,
+// whose high nibble holds the literal count and low nibble holds the match
+// length minus MIN_MATCH; a nibble of 15 is followed by extension bytes which
+// are added to it until one of them is not 255. The literals follow, then a
+// 2-byte little-endian match offset and the match length extension. The final
+// command contains only literals.
+
+namespace lz {
+
+inline constexpr std::size_t MIN_MATCH = 4u;
+inline constexpr std::size_t MAX_OFFSET = 0xFFFFu;
+
+/*!	\brief Obtains the largest possible size of compressed data.
+	\param size Size of the uncompressed data.
+	\return The maximum compressed size. */
+constexpr std::size_t max_compressed_size(std::size_t size) noexcept {
+	return size + size / 255u + 16u;
+}
+
+/*!	\brief Compresses a buffer.
+	\param src The uncompressed data.
+	\return The compressed data. */
+std::vector<unsigned char> compress(array_view<unsigned char> src);
+
+/*!	\brief Decompresses a buffer. Never reads or writes outside the given ranges.
+	\param src The compressed data.
+	\param dest Pointer to the output buffer.
+	\param size Exact size of the uncompressed data.
+	\return Whether the compressed data was valid and produced exactly \a size bytes. */
+bool decompress(array_view<unsigned char> src, unsigned char *dest, std::size_t size) noexcept;
+
+} // namespace lz
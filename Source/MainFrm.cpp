@@ -23,6 +23,7 @@
 #include "MainFrm.h"
 #include "version.h"		// // //
 #include <algorithm>
+#include <fstream>		// // //
 #include "FamiTrackerDoc.h"
 #include "FamiTrackerView.h"
 #include "ExportDialog.h"
@@ -85,7 +86,7 @@
 
 namespace {
 
-const unsigned MAX_UNDO_LEVELS = 64;		// // // moved
+const std::size_t MAX_UNDO_MEMORY = 32u * 1024u * 1024u;		// // // bytes
 const int INST_DIGITS = 2;		// // //
 
 const UINT indicators[] =
@@ -2023,16 +2024,13 @@ void CMainFrame::OnFileExportJson() {		// // //
 
 	auto initPath = FTEnv.GetSettings()->GetPath(PATH_NSF);		// // //
 	if (auto path = GetSavePath(Doc.GetFileTitle(), initPath.c_str(), IDS_FILTER_JSON, L"*.json")) {
-		CStdioFile f;
-		CFileException oFileException;
-		if (!f.Open(path->c_str(), CFile::modeCreate | CFile::modeWrite | CFile::typeText, &oFileException)) {
-			WCHAR szError[256];
-			oFileException.GetErrorMessage(szError, std::size(szError));
-			AfxMessageBox(szError, MB_OK | MB_ICONERROR);
+		std::ofstream f {*path, std::ios::out | std::ios::binary};		// // //
+		if (!f) {
+			AfxMessageBox(IDS_FILE_OPEN_ERROR, MB_ICONERROR);
 			return;
 		}
 
-		f.WriteString(conv::to_wide(nlohmann::json(*Doc.GetModule()).dump()).data());
+		WriteModuleJson(f, *Doc.GetModule());		// // //
 	}
 }
 
@@ -2167,7 +2165,7 @@ void CMainFrame::OnModuleBookmarkSettings()		// // //
 
 void CMainFrame::OnModuleEstimateSongLength()		// // //
 {
-	CSongLengthScanner scanner {*GetDoc().GetModule(), *GetTrackerView()->GetSongView()};
+	CSongLengthScanner scanner {*GetDoc().GetModule(), GetSelectedTrack()};
 	auto [Intro, Loop] = scanner.GetSecondsCount();
 	auto [IntroRows, LoopRows] = scanner.GetRowCount();
 
@@ -2686,36 +2684,37 @@ bool CMainFrame::AddAction(std::unique_ptr<CAction> pAction)		// // //
 {
 	ASSERT(m_pActionHandler);
 
+	const module_block_set_t Blocks = pAction ? pAction->GetModifiedBlocks() : module_block_set_t { };		// // //
 	if (!m_pActionHandler->AddAction(*this, std::move(pAction)))
 		return false;		// // //
 
 	auto &Doc = GetDoc();		// // //
-	Doc.Modify(true);
+	Doc.ModifyBlocks(Blocks);
 	if (m_pActionHandler->ActionsLost())		// // //
-		Doc.ModifyIrreversible();
+		Doc.SetExceededFlag();
 
 	return true;
 }
 
 void CMainFrame::ResetUndo()
 {
-	m_pActionHandler = std::make_unique<CActionHandler>(MAX_UNDO_LEVELS);		// // //
+	m_pActionHandler = std::make_unique<CActionHandler>(MAX_UNDO_MEMORY);		// // //
 }
 
 void CMainFrame::OnEditUndo()
 {
 	CFamiTrackerDoc	&doc = GetDoc();
-	m_pActionHandler->UndoLastAction(*this);		// // //
-	doc.SetModifiedFlag(true);
+	if (const CAction *pAction = m_pActionHandler->UndoLastAction(*this))		// // //
+		doc.ModifyBlocks(pAction->GetModifiedBlocks());
 	if (!m_pActionHandler->CanUndo() && !doc.GetExceededFlag())
 		doc.SetModifiedFlag(false);
 }
 
 void CMainFrame::OnEditRedo()
 {
-	m_pActionHandler->RedoLastAction(*this);		// // //
 	CFamiTrackerDoc	&doc = GetDoc();
-	doc.SetModifiedFlag(true); // TODO: not always
+	if (const CAction *pAction = m_pActionHandler->RedoLastAction(*this))		// // //
+		doc.ModifyBlocks(pAction->GetModifiedBlocks());
 }
 
 void CMainFrame::OnUpdateEditUndo(CCmdUI *pCmdUI)
@@ -0,0 +1,110 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2018 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+** Library General Public License for more details.  To obtain a
+** copy of the GNU Library General Public License, write to the Free
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+#include "MappedFile.h"
+#include <cstdint>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+CMappedFile::~CMappedFile() noexcept {
+	Close();
+}
+
+bool CMappedFile::Open(const fs::path &fname) noexcept {
+	Close();
+
+#ifdef _WIN32
+	HANDLE hFile = ::CreateFileW(fname.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (hFile == INVALID_HANDLE_VALUE)
+		return false;
+	LARGE_INTEGER sz = { };
+	if (!::GetFileSizeEx(hFile, &sz) || !sz.QuadPart || static_cast<unsigned long long>(sz.QuadPart) > SIZE_MAX) {
+		::CloseHandle(hFile);
+		return false;
+	}
+	HANDLE hMapping = ::CreateFileMappingW(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (!hMapping) {
+		::CloseHandle(hFile);
+		return false;
+	}
+	const void *ptr = ::MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+	if (!ptr) {
+		::CloseHandle(hMapping);
+		::CloseHandle(hFile);
+		return false;
+	}
+	hFile_ = hFile;
+	hMapping_ = hMapping;
+	data_ = static_cast<const unsigned char *>(ptr);
+	size_ = static_cast<std::size_t>(sz.QuadPart);
+#else
+	int fd = ::open(fname.c_str(), O_RDONLY);
+	if (fd == -1)
+		return false;
+	struct stat st = { };
+	if (::fstat(fd, &st) == -1 || st.st_size <= 0) {
+		::close(fd);
+		return false;
+	}
+	void *ptr = ::mmap(nullptr, static_cast<std::size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+	::close(fd);		// the mapping keeps its own reference to the file
+	if (ptr == MAP_FAILED)
+		return false;
+	data_ = static_cast<const unsigned char *>(ptr);
+	size_ = static_cast<std::size_t>(st.st_size);
+#endif
+
+	return true;
+}
+
+void CMappedFile::Close() noexcept {
+	if (!data_)
+		return;
+
+#ifdef _WIN32
+	::UnmapViewOfFile(data_);
+	::CloseHandle(static_cast<HANDLE>(hMapping_));
+	::CloseHandle(static_cast<HANDLE>(hFile_));
+	hMapping_ = hFile_ = nullptr;
+#else
+	::munmap(const_cast<unsigned char *>(data_), size_);
+#endif
+
+	data_ = nullptr;
+	size_ = 0u;
+}
+
+bool CMappedFile::IsOpen() const noexcept {
+	return data_ != nullptr;
+}
+
+array_view<unsigned char> CMappedFile::GetData() const noexcept {
+	return {data_, size_};
+}
@@ -0,0 +1,61 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2018 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+** Library General Public License for more details.  To obtain a
+** copy of the GNU Library General Public License, write to the Free
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+#pragma once
+
+#include <cstddef>
+#include "array_view.h"
+#include "ft0cc/fs.h"
+
+// // // read-only memory-mapped file
+
+class CMappedFile {
+public:
+	CMappedFile() = default;
+	~CMappedFile() noexcept;
+
+	CMappedFile(const CMappedFile &) = delete;
+	CMappedFile &operator=(const CMappedFile &) = delete;
+
+	/*!	\brief Maps an entire file into memory for reading.
+		\param fname Path to the file.
+		\return Whether the mapping succeeded; empty files cannot be mapped. */
+	bool Open(const fs::path &fname) noexcept;
+
+	/*!	\brief Unmaps the file. Views previously obtained from the object become invalid. */
+	void Close() noexcept;
+
+	bool IsOpen() const noexcept;
+
+	/*!	\brief Obtains the contents of the mapped file.
+		\return A view of the whole file, or an empty view if nothing is mapped. */
+	array_view<unsigned char> GetData() const noexcept;
+
+private:
+	const unsigned char *data_ = nullptr;
+	std::size_t size_ = 0u;
+#ifdef _WIN32
+	void *hFile_ = nullptr;
+	void *hMapping_ = nullptr;
+#endif
+};
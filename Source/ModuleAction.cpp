@@ -26,6 +26,7 @@
 #include "FamiTrackerModule.h"
 #include "InstrumentManager.h"
 #include "Instrument.h"
+#include "SongFlowGraph.h"
 
 #define GET_VIEW() MainFrm.GetTrackerView()
 #define GET_MODULE() (*GET_VIEW()->GetModuleData())
@@ -63,6 +64,10 @@ void ModuleAction::CComment::UpdateViews(CMainFrame &MainFrm) const {
 	MainFrm.SetMessageText(L"Comment settings changed");
 }
 
+module_block_set_t ModuleAction::CComment::GetModifiedBlocks() const {
+	return MakeBlockSet({module_block_t::comments});
+}
+
 
 
 ModuleAction::CTitle::CTitle(std::string_view str) :
@@ -95,6 +100,10 @@ void ModuleAction::CTitle::UpdateViews(CMainFrame &MainFrm) const {
 	MainFrm.SetSongInfo(GET_MODULE());
 }
 
+module_block_set_t ModuleAction::CTitle::GetModifiedBlocks() const {
+	return MakeBlockSet({module_block_t::info});
+}
+
 
 
 ModuleAction::CArtist::CArtist(std::string_view str) :
@@ -127,6 +136,10 @@ void ModuleAction::CArtist::UpdateViews(CMainFrame &MainFrm) const {
 	MainFrm.SetSongInfo(GET_MODULE());
 }
 
+module_block_set_t ModuleAction::CArtist::GetModifiedBlocks() const {
+	return MakeBlockSet({module_block_t::info});
+}
+
 
 
 ModuleAction::CCopyright::CCopyright(std::string_view str) :
@@ -159,6 +172,10 @@ void ModuleAction::CCopyright::UpdateViews(CMainFrame &MainFrm) const {
 	MainFrm.SetSongInfo(GET_MODULE());
 }
 
+module_block_set_t ModuleAction::CCopyright::GetModifiedBlocks() const {
+	return MakeBlockSet({module_block_t::info});
+}
+
 
 
 ModuleAction::CAddInst::CAddInst(unsigned index, std::shared_ptr<CInstrument> pInst) :
@@ -186,6 +203,14 @@ void ModuleAction::CAddInst::UpdateViews(CMainFrame &MainFrm) const {
 	MainFrm.GetActiveDocument()->UpdateAllViews(NULL, UPDATE_INSTRUMENT);
 }
 
+module_block_set_t ModuleAction::CAddInst::GetModifiedBlocks() const {
+	// instruments are created with their sequences
+	return MakeBlockSet({
+		module_block_t::instruments, module_block_t::sequences, module_block_t::sequences_vrc6,
+		module_block_t::sequences_n163, module_block_t::sequences_s5b,
+	});
+}
+
 
 
 ModuleAction::CRemoveInst::CRemoveInst(unsigned index) :
@@ -227,6 +252,14 @@ void ModuleAction::CRemoveInst::UpdateViews(CMainFrame &MainFrm) const {
 	MainFrm.GetActiveDocument()->UpdateAllViews(NULL, UPDATE_INSTRUMENT);
 }
 
+module_block_set_t ModuleAction::CRemoveInst::GetModifiedBlocks() const {
+	// sequences are shared with the removed instrument
+	return MakeBlockSet({
+		module_block_t::instruments, module_block_t::sequences, module_block_t::sequences_vrc6,
+		module_block_t::sequences_n163, module_block_t::sequences_s5b,
+	});
+}
+
 
 
 ModuleAction::CInstName::CInstName(unsigned index, std::string_view str) :
@@ -267,6 +300,10 @@ void ModuleAction::CInstName::UpdateViews(CMainFrame &MainFrm) const {
 	MainFrm.UpdateInstrumentName();
 }
 
+module_block_set_t ModuleAction::CInstName::GetModifiedBlocks() const {
+	return MakeBlockSet({module_block_t::instruments});
+}
+
 
 
 ModuleAction::CSwapInst::CSwapInst(unsigned left, unsigned right) :
@@ -296,3 +333,44 @@ void ModuleAction::CSwapInst::Redo(CMainFrame &MainFrm) {
 void ModuleAction::CSwapInst::UpdateViews(CMainFrame &MainFrm) const {
 	MainFrm.UpdateInstrumentList();
 }
+
+module_block_set_t ModuleAction::CSwapInst::GetModifiedBlocks() const {
+	return MakeBlockSet({module_block_t::instruments, module_block_t::patterns});
+}
+
+
+
+ModuleAction::CBulkTransform::CBulkTransform(CModuleTransform transform, std::vector<unsigned> songs) :
+	transform_(std::move(transform)), songs_(std::move(songs))
+{
+}
+
+bool ModuleAction::CBulkTransform::SaveState(const CMainFrame &MainFrm) {
+	delta_ = transform_.Compute(GET_MODULE(), songs_);
+	return !delta_.IsEmpty();
+}
+
+void ModuleAction::CBulkTransform::Undo(CMainFrame &MainFrm) {
+	delta_.Revert(GET_MODULE());
+}
+
+void ModuleAction::CBulkTransform::Redo(CMainFrame &MainFrm) {
+	transform_.Apply(GET_MODULE(), delta_);
+}
+
+void ModuleAction::CBulkTransform::UpdateViews(CMainFrame &MainFrm) const {
+	MainFrm.GetActiveDocument()->UpdateAllViews(NULL, UPDATE_PATTERN);
+}
+
+void ModuleAction::CBulkTransform::UpdateFlowGraph(CMainFrame &MainFrm) const {
+	for (unsigned track : songs_)
+		GET_MODULE().GetSongFlowGraphs().Reset(track);
+}
+
+module_block_set_t ModuleAction::CBulkTransform::GetModifiedBlocks() const {
+	return MakeBlockSet({module_block_t::patterns});
+}
+
+std::size_t ModuleAction::CBulkTransform::GetMemoryUsage() const {
+	return sizeof(CBulkTransform) + songs_.capacity() * sizeof(unsigned) + delta_.GetMemoryUsage();
+}
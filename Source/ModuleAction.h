@@ -24,8 +24,10 @@
 #pragma once
 
 #include "Action.h"
+#include "ModuleTransform.h"		// // //
 #include <string>
 #include <memory>
+#include <vector>
 
 class CInstrument;
 
@@ -50,6 +52,7 @@ private:
 	void Undo(CMainFrame &MainFrm) override;
 	void Redo(CMainFrame &MainFrm) override;
 	void UpdateViews(CMainFrame &MainFrm) const override;
+	module_block_set_t GetModifiedBlocks() const override;
 
 	std::string oldComment_;
 	std::string newComment_;
@@ -66,6 +69,7 @@ private:
 	void Redo(CMainFrame &MainFrm) override;
 	bool Merge(const CAction &other) override;
 	void UpdateViews(CMainFrame &MainFrm) const override;
+	module_block_set_t GetModifiedBlocks() const override;
 
 	std::string oldStr_;
 	std::string newStr_;
@@ -80,6 +84,7 @@ private:
 	void Redo(CMainFrame &MainFrm) override;
 	bool Merge(const CAction &other) override;
 	void UpdateViews(CMainFrame &MainFrm) const override;
+	module_block_set_t GetModifiedBlocks() const override;
 
 	std::string oldStr_;
 	std::string newStr_;
@@ -94,6 +99,7 @@ private:
 	void Redo(CMainFrame &MainFrm) override;
 	bool Merge(const CAction &other) override;
 	void UpdateViews(CMainFrame &MainFrm) const override;
+	module_block_set_t GetModifiedBlocks() const override;
 
 	std::string oldStr_;
 	std::string newStr_;
@@ -107,6 +113,7 @@ private:
 	void Undo(CMainFrame &MainFrm) override;
 	void Redo(CMainFrame &MainFrm) override;
 	void UpdateViews(CMainFrame &MainFrm) const override;
+	module_block_set_t GetModifiedBlocks() const override;
 
 	std::shared_ptr<CInstrument> inst_;
 	unsigned index_;
@@ -121,6 +128,7 @@ private:
 	void Undo(CMainFrame &MainFrm) override;
 	void Redo(CMainFrame &MainFrm) override;
 	void UpdateViews(CMainFrame &MainFrm) const override;
+	module_block_set_t GetModifiedBlocks() const override;
 
 	std::shared_ptr<CInstrument> inst_;
 	unsigned index_;
@@ -136,6 +144,7 @@ private:
 	void Redo(CMainFrame &MainFrm) override;
 	bool Merge(const CAction &other) override;
 	void UpdateViews(CMainFrame &MainFrm) const override;
+	module_block_set_t GetModifiedBlocks() const override;
 
 	unsigned index_;
 	std::string oldStr_;
@@ -150,9 +159,27 @@ private:
 	void Undo(CMainFrame &MainFrm) override;
 	void Redo(CMainFrame &MainFrm) override;
 	void UpdateViews(CMainFrame &MainFrm) const override;
+	module_block_set_t GetModifiedBlocks() const override;
 
 	unsigned left_;
 	unsigned right_;
 };
 
+class CBulkTransform : public CModuleAction {
+public:
+	CBulkTransform(CModuleTransform transform, std::vector<unsigned> songs);
+private:
+	bool SaveState(const CMainFrame &MainFrm) override;
+	void Undo(CMainFrame &MainFrm) override;
+	void Redo(CMainFrame &MainFrm) override;
+	void UpdateViews(CMainFrame &MainFrm) const override;
+	void UpdateFlowGraph(CMainFrame &MainFrm) const override;
+	module_block_set_t GetModifiedBlocks() const override;
+	std::size_t GetMemoryUsage() const override;
+
+	CModuleTransform transform_;
+	std::vector<unsigned> songs_;
+	CModuleDelta delta_;
+};
+
 } // namespace ModuleAction
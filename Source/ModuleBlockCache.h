@@ -0,0 +1,126 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2018 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+** Library General Public License for more details.  To obtain a
+** copy of the GNU Library General Public License, write to the Free
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+#pragma once
+
+#include <array>
+#include <bitset>
+#include <vector>
+#include <initializer_list>
+#include <utility>
+
+/*!
+	\brief Blocks written to a FamiTracker module, in the order they are saved.
+*/
+enum class module_block_t : unsigned {		// // //
+	params,
+	info,
+	header,
+	instruments,
+	sequences,
+	frames,
+	patterns,
+	dsamples,
+	comments,
+	sequences_vrc6,
+	sequences_n163,
+	sequences_s5b,
+	params_extra,
+	detune_tables,
+	grooves,
+	bookmarks,
+};
+
+inline constexpr std::size_t MODULE_BLOCK_COUNT = 16u;
+
+using module_block_set_t = std::bitset<MODULE_BLOCK_COUNT>;
+
+/*!	\brief Creates a set of module blocks.
+	\param blocks The blocks to include.
+	\return The block set. */
+inline module_block_set_t MakeBlockSet(std::initializer_list<module_block_t> blocks) {
+	module_block_set_t s;
+	for (auto b : blocks)
+		s.set(static_cast<std::size_t>(b));
+	return s;
+}
+
+/*!	\brief The set of all module blocks. */
+inline const module_block_set_t ALL_MODULE_BLOCKS = module_block_set_t { }.set();
+
+/*!
+	\brief Retains the encoded blocks of the last saved module image.
+	\details Blocks are marked dirty whenever the parts of the module they encode are modified.
+	Clean blocks can be written again byte for byte instead of being encoded from the module.
+*/
+class CModuleBlockCache
+{
+public:
+	/*!	\brief Marks blocks as modified.
+		\param blocks The blocks to mark. */
+	void MarkDirty(const module_block_set_t &blocks) {
+		dirty_ |= blocks;
+	}
+
+	/*!	\brief Checks whether a block must be encoded again.
+		\param block The block.
+		\return True if the block was modified since it was last stored. */
+	bool IsDirty(module_block_t block) const {
+		return dirty_.test(static_cast<std::size_t>(block));
+	}
+
+	/*!	\brief Obtains the stored image of a clean block.
+		\param block The block.
+		\return The block header followed by the block data, or an empty vector if the block was
+		omitted from the file. */
+	const std::vector<unsigned char> &GetImage(module_block_t block) const {
+		return images_[static_cast<std::size_t>(block)];
+	}
+
+	/*!	\brief Stores the image of a block that was just encoded and marks it as clean.
+		\param block The block.
+		\param image The block header followed by the block data. */
+	void SetImage(module_block_t block, std::vector<unsigned char> image) {
+		images_[static_cast<std::size_t>(block)] = std::move(image);
+		dirty_.reset(static_cast<std::size_t>(block));
+	}
+
+	/*!	\brief Discards all stored images. */
+	void Clear() {
+		*this = CModuleBlockCache { };
+	}
+
+	/*!	\brief Discards all stored images if they were encoded with a different compression setting.
+		\param compressed Whether blocks are being saved with compression enabled. */
+	void SetCompression(bool compressed) {
+		if (compressed != compressed_) {
+			Clear();
+			compressed_ = compressed;
+		}
+	}
+
+private:
+	std::array<std::vector<unsigned char>, MODULE_BLOCK_COUNT> images_;
+	module_block_set_t dirty_ = ALL_MODULE_BLOCKS;
+	bool compressed_ = false;
+};
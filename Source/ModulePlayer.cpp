@@ -0,0 +1,181 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2018 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+** Library General Public License for more details.  To obtain a
+** copy of the GNU Library General Public License, write to the Free
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+#include "ModulePlayer.h"
+#include "APU/APU.h"
+#include "SoundDriver.h"
+#include "TempoCounter.h"
+#include "PlayerCursor.h"
+#include "FamiTrackerModule.h"
+#include "SoundChipSet.h"
+#include "WaveRenderer.h"
+
+namespace {
+
+// Number of silent frames rendered after a track is halted by a Cxx effect
+const int HALT_TAIL_FRAMES = 5;
+
+} // namespace
+
+const int CModulePlayer::SAMPLE_RATE = 44100;
+
+CModulePlayer::CModulePlayer(const CFamiTrackerModule &modfile) :
+	modfile_(modfile),
+	apu_(std::make_unique<CAPU>()),
+	tempo_(std::make_shared<CTempoCounter>()),
+	driver_(std::make_unique<CSoundDriver>(static_cast<CSoundGenBase *>(this)))
+{
+	const machine_t Machine = modfile_.GetMachine();
+	const int Rate = modfile_.GetFrameRate();
+	frame_cycles_ = (Machine == machine_t::NTSC ? MASTER_CLOCK_NTSC : MASTER_CLOCK_PAL) / Rate;
+
+	apu_->SetCallback(*this);
+	apu_->SetupSound(SAMPLE_RATE, 1, Machine);
+	apu_->ChangeMachineRate(Machine, Rate);
+	apu_->SetExternalSound(modfile_.GetSoundChipSet());
+
+	driver_->SetupTracks();
+	driver_->AssignModule(modfile_);
+	driver_->LoadAPU(*apu_);
+	driver_->SetTempoCounter(tempo_);
+	driver_->ConfigureDocument();
+
+	// Channel state is undefined until the tracks are reset, same as CSoundGen::MakeSilent
+	apu_->Reset();
+	driver_->ResetTracks();
+}
+
+CModulePlayer::~CModulePlayer() {
+}
+
+void CModulePlayer::SetupMixer(int LowCut, int HighCut, int HighDamp, int Volume) {
+	apu_->SetupMixer(LowCut, HighCut, HighDamp, Volume);
+}
+
+void CModulePlayer::StartPlayer(unsigned Track) {
+	const CSongData &Song = *modfile_.GetSong(Track);
+	driver_->StartPlayer(std::make_unique<CPlayerCursor>(Song, Track));
+	tempo_->LoadTempo(Song);
+
+	// Same sequence as CSoundGen::ResetPlayer
+	ResetAPU();
+	apu_->Reset();
+	driver_->ResetTracks();
+}
+
+void CModulePlayer::PlayFrame() {
+	driver_->Tick();
+
+	apu_->AddTime(frame_cycles_);
+	apu_->Process();
+	apu_->EndFrame();
+
+	if (driver_->ShouldHalt())
+		HaltPlayer();
+}
+
+bool CModulePlayer::IsPlaying() const {
+	return driver_->IsPlaying();
+}
+
+void CModulePlayer::Render(CWaveRenderer &Renderer) {
+	renderer_ = &Renderer;
+	Renderer.Start();
+
+	bool Started = false;
+	int Tail = HALT_TAIL_FRAMES;
+	while (!Renderer.ShouldStopRender()) {
+		if (Renderer.ShouldStartPlayer()) {
+			StartPlayer(Renderer.GetRenderTrack());
+			Started = true;
+		}
+		PlayFrame();
+		// Time-based renderers are never told when a Cxx effect ends the track
+		if (Started && !IsPlaying() && !Tail--)
+			break;
+	}
+
+	renderer_ = nullptr;
+}
+
+const CAPU &CModulePlayer::GetAPU() const {
+	return *apu_;
+}
+
+CInstrumentManager *CModulePlayer::GetInstrumentManager() const {
+	return modfile_.GetInstrumentManager();
+}
+
+void CModulePlayer::OnTick() {
+	if (renderer_)
+		renderer_->Tick();
+}
+
+void CModulePlayer::OnStepRow() {
+	if (renderer_)
+		renderer_->StepRow();
+}
+
+void CModulePlayer::OnPlayNote(stChannelID chan, const stChanNote &note) {
+}
+
+void CModulePlayer::OnUpdateRow(int frame, int row) {
+}
+
+bool CModulePlayer::IsChannelMuted(stChannelID chan) const {
+	return false;
+}
+
+bool CModulePlayer::ShouldStopPlayer() const {
+	return renderer_ && renderer_->ShouldStopPlayer();
+}
+
+int CModulePlayer::GetArpNote(stChannelID chan) const {
+	return -1;
+}
+
+void CModulePlayer::FlushBuffer(array_view<int16_t> Buffer) {
+	if (renderer_)
+		renderer_->FlushBuffer(Buffer);
+}
+
+bool CModulePlayer::PlayBuffer() {
+	return true;
+}
+
+void CModulePlayer::ResetAPU() {
+	apu_->Reset();
+
+	// Enable all channels
+	apu_->Write(0x4015, 0x0F);
+	apu_->Write(0x4017, 0x00);
+	apu_->Write(0x4023, 0x02);		// FDS enable
+
+	// MMC5
+	apu_->Write(0x5015, 0x03);
+}
+
+void CModulePlayer::HaltPlayer() {
+	apu_->Reset();
+	driver_->ResetTracks();
+	driver_->StopPlayer();
+}
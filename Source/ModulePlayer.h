@@ -0,0 +1,90 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2018 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+** Library General Public License for more details.  To obtain a
+** copy of the GNU Library General Public License, write to the Free
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+#pragma once
+
+#include <memory>
+#include "Common.h"
+#include "SoundGenBase.h"
+
+class CFamiTrackerModule;
+class CAPU;
+class CSoundDriver;
+class CTempoCounter;
+class CWaveRenderer;
+
+/*!
+	\brief Plays a module through CSoundDriver into its own CAPU instance, without a CSoundGen.
+	\details Used by headless tools which need the tracker's sound register state or audio output.
+	Each call to PlayFrame runs the sound driver for one tick and emulates the APU for one frame.
+*/
+class CModulePlayer : CSoundGenBase, IAudioCallback {
+public:
+	explicit CModulePlayer(const CFamiTrackerModule &modfile);
+	~CModulePlayer();
+
+	/*!	\brief Changes the filter and volume settings of the APU mixer. */
+	void SetupMixer(int LowCut, int HighCut, int HighDamp, int Volume);
+
+	/*!	\brief Resets the APU and starts playing a track from the beginning.
+		\param Track Zero-based track index. */
+	void StartPlayer(unsigned Track);
+
+	/*!	\brief Plays one frame. The player stops when the track is halted by a Cxx effect. */
+	void PlayFrame();
+
+	bool IsPlaying() const;
+
+	/*!	\brief Plays the track selected by a wave renderer into its output stream until the
+		renderer finishes.
+		\param Renderer The wave renderer, which must already have an output stream. */
+	void Render(CWaveRenderer &Renderer);
+
+	/*!	\brief Obtains the APU which receives the sound driver's register writes. */
+	const CAPU &GetAPU() const;
+
+	static const int SAMPLE_RATE;
+
+private:
+	CInstrumentManager *GetInstrumentManager() const override;
+	void OnTick() override;
+	void OnStepRow() override;
+	void OnPlayNote(stChannelID chan, const stChanNote &note) override;
+	void OnUpdateRow(int frame, int row) override;
+	bool IsChannelMuted(stChannelID chan) const override;
+	bool ShouldStopPlayer() const override;
+	int GetArpNote(stChannelID chan) const override;
+
+	void FlushBuffer(array_view<int16_t> Buffer) override;
+	bool PlayBuffer() override;
+
+	void ResetAPU();
+	void HaltPlayer();
+
+private:
+	const CFamiTrackerModule &modfile_;
+	std::unique_ptr<CAPU> apu_;
+	std::shared_ptr<CTempoCounter> tempo_;
+	std::unique_ptr<CSoundDriver> driver_;
+	CWaveRenderer *renderer_ = nullptr;
+	int frame_cycles_ = 0;
+};
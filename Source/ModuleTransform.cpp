@@ -0,0 +1,193 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2018 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+** Library General Public License for more details.  To obtain a
+** copy of the GNU Library General Public License, write to the Free
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+#include "ModuleTransform.h"
+#include "FamiTrackerModule.h"
+#include "SongData.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <future>
+#include <thread>
+
+namespace {
+
+// Number of patterns claimed by a worker at a time
+constexpr std::size_t JOB_CHUNK_SIZE = 64u;
+constexpr unsigned MAX_WORKERS = 16u;
+
+struct stPatternJob {
+	std::uint16_t Song;
+	stChannelID Channel;
+	std::uint8_t Pattern;
+	const CPatternData *pPattern;
+};
+
+} // namespace
+
+void CModuleDelta::Revert(CFamiTrackerModule &modfile) const {
+	for (const auto &x : m_Cells)
+		if (CSongData *pSong = modfile.GetSong(x.Song))
+			pSong->GetPattern(x.Channel, x.Pattern).SetNoteOn(x.Row, x.Before);
+}
+
+bool CModuleDelta::IsEmpty() const {
+	return m_Cells.empty();
+}
+
+std::size_t CModuleDelta::GetChangedCount() const {
+	return m_Cells.size();
+}
+
+std::size_t CModuleDelta::GetMemoryUsage() const {
+	return sizeof(CModuleDelta) + m_Cells.capacity() * sizeof(stCellDelta);
+}
+
+
+
+CModuleTransform::CModuleTransform(note_func_t f) : f_(std::move(f)) {
+}
+
+CModuleDelta CModuleTransform::Compute(const CFamiTrackerModule &modfile, const std::vector<unsigned> &songs) const {
+	std::vector<stPatternJob> jobs;
+	for (unsigned s : songs)
+		if (const CSongData *pSong = modfile.GetSong(s))
+			pSong->VisitPatterns([&] (const CPatternData &pat, stChannelID ch, std::size_t index) {
+				jobs.push_back({static_cast<std::uint16_t>(s), ch, static_cast<std::uint8_t>(index), &pat});
+			});
+
+	// each chunk is written by exactly one worker, so results keep the job order
+	const std::size_t chunks = (jobs.size() + JOB_CHUNK_SIZE - 1) / JOB_CHUNK_SIZE;
+	std::vector<std::vector<CModuleDelta::stCellDelta>> results(chunks);
+	std::atomic<std::size_t> next {0u};
+
+	auto worker = [&] {
+		for (std::size_t c = next++; c < chunks; c = next++) {
+			auto &out = results[c];
+			const std::size_t last = std::min(jobs.size(), (c + 1) * JOB_CHUNK_SIZE);
+			for (std::size_t i = c * JOB_CHUNK_SIZE; i < last; ++i) {
+				const auto &job = jobs[i];
+				job.pPattern->VisitRows([&] (const stChanNote &note, unsigned row) {
+					stChanNote after = note;
+					f_(after, job.Channel);
+					if (after != note)
+						out.push_back({job.Song, job.Channel, job.Pattern, static_cast<std::uint16_t>(row), note});
+				});
+			}
+		}
+	};
+
+	const unsigned workers = static_cast<unsigned>(std::min<std::size_t>(
+		std::clamp(std::thread::hardware_concurrency(), 1u, MAX_WORKERS), chunks));
+	std::vector<std::future<void>> futures;
+	for (unsigned i = 1; i < workers; ++i)
+		futures.push_back(std::async(std::launch::async, worker));
+	worker();
+	for (auto &f : futures)
+		f.get();
+
+	CModuleDelta delta;
+	std::size_t count = 0u;
+	for (const auto &x : results)
+		count += x.size();
+	delta.m_Cells.reserve(count);
+	for (auto &x : results)
+		delta.m_Cells.insert(delta.m_Cells.end(), x.cbegin(), x.cend());
+	return delta;
+}
+
+CModuleDelta CModuleTransform::Compute(const CFamiTrackerModule &modfile) const {
+	std::vector<unsigned> songs(modfile.GetSongCount());
+	for (unsigned i = 0; i < songs.size(); ++i)
+		songs[i] = i;
+	return Compute(modfile, songs);
+}
+
+void CModuleTransform::Apply(CFamiTrackerModule &modfile, const CModuleDelta &delta) const {
+	for (const auto &x : delta.m_Cells)
+		if (CSongData *pSong = modfile.GetSong(x.Song)) {
+			stChanNote after = x.Before;
+			f_(after, x.Channel);
+			pSong->GetPattern(x.Channel, x.Pattern).SetNoteOn(x.Row, after);
+		}
+}
+
+void CModuleTransform::Apply(CFamiTrackerModule &modfile) const {
+	modfile.VisitSongs([&] (CSongData &song) {
+		song.VisitPatterns([&] (CPatternData &pat, stChannelID ch, std::size_t) {
+			pat.VisitRows([&] (stChanNote &note) {
+				f_(note, ch);
+			});
+		});
+	});
+}
+
+CModuleTransform CModuleTransform::Transpose(int semitones, const bool *disabled) {
+	std::array<bool, MAX_INSTRUMENTS> skip = { };
+	if (disabled)
+		std::copy_n(disabled, MAX_INSTRUMENTS, skip.begin());
+
+	return CModuleTransform {[semitones, skip] (stChanNote &note, stChannelID ch) {
+		if (IsAPUNoise(ch) || IsDPCM(ch))
+			return;
+		if (note.Instrument == MAX_INSTRUMENTS || note.Instrument == HOLD_INSTRUMENT)
+			return;
+		if (is_note(note.Note) && !skip[note.Instrument]) {
+			int MIDI = std::clamp(note.ToMidiNote() + semitones, 0, NOTE_COUNT - 1);
+			note.Octave = ft0cc::doc::oct_from_midi(MIDI);
+			note.Note = ft0cc::doc::pitch_from_midi(MIDI);
+		}
+	}};
+}
+
+CModuleTransform CModuleTransform::ReplaceInstrument(unsigned from, unsigned to) {
+	return CModuleTransform {[from, to] (stChanNote &note, stChannelID) {
+		if (note.Instrument == from)
+			note.Instrument = static_cast<unsigned char>(to);
+	}};
+}
+
+CModuleTransform CModuleTransform::SwapInstruments(unsigned first, unsigned second) {
+	return CModuleTransform {[first, second] (stChanNote &note, stChannelID) {
+		if (note.Instrument == first)
+			note.Instrument = static_cast<unsigned char>(second);
+		else if (note.Instrument == second)
+			note.Instrument = static_cast<unsigned char>(first);
+	}};
+}
+
+CModuleTransform CModuleTransform::ScaleVolume(unsigned percent) {
+	return CModuleTransform {[percent] (stChanNote &note, stChannelID) {
+		if (note.Vol < MAX_VOLUME)
+			note.Vol = static_cast<unsigned char>(std::min((note.Vol * percent + 50u) / 100u, MAX_VOLUME - 1u));
+	}};
+}
+
+CModuleTransform CModuleTransform::RemapEffect(effect_t from, effect_t to) {
+	return CModuleTransform {[from, to] (stChanNote &note, stChannelID) {
+		if (from == effect_t::none)
+			return;
+		for (auto &cmd : note.Effects)
+			if (cmd.fx == from)
+				cmd.fx = to;
+	}};
+}
@@ -0,0 +1,127 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2018 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+** Library General Public License for more details.  To obtain a
+** copy of the GNU Library General Public License, write to the Free
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+#pragma once
+
+#include <vector>
+#include <functional>
+#include <cstdint>
+#include "PatternNote.h"
+#include "APU/Types.h"
+
+class CFamiTrackerModule;
+
+/*!
+	\brief Stores the pattern cells changed by a module-wide transformation.
+	\details Cells are addressed by song, channel, pattern and row, so the delta can be reverted
+	from the module directly without copying entire tracks. Only the cells before the
+	transformation are stored; CModuleTransform::Apply recomputes the cells after it.
+*/
+class CModuleDelta		// // //
+{
+public:
+	/*!	\brief Writes the cells before the transformation back into the module.
+		\param modfile The module the delta was computed from. */
+	void Revert(CFamiTrackerModule &modfile) const;
+
+	/*!	\brief Checks whether the transformation left every pattern unchanged.
+		\return True if the delta records no cells. */
+	bool IsEmpty() const;
+
+	/*!	\brief Obtains the number of cells recorded by the delta.
+		\return Changed cell count. */
+	std::size_t GetChangedCount() const;
+
+	/*!	\brief Obtains the approximate number of bytes held by the delta.
+		\return Memory usage in bytes. */
+	std::size_t GetMemoryUsage() const;
+
+private:
+	friend class CModuleTransform;
+
+	struct stCellDelta {
+		std::uint16_t Song;
+		stChannelID Channel;
+		std::uint8_t Pattern;
+		std::uint16_t Row;
+		stChanNote Before;
+	};
+
+	std::vector<stCellDelta> m_Cells;
+};
+
+/*!
+	\brief A transformation applied independently to every note of a module's patterns.
+	\details Patterns are distributed among worker threads; each worker only reads from the
+	module, and the resulting changes are collected into a single CModuleDelta. Operations that
+	move rows within a pattern, such as stretching, do not map a note onto itself and are not
+	module transforms.
+*/
+class CModuleTransform		// // //
+{
+public:
+	using note_func_t = std::function<void (stChanNote &note, stChannelID ch)>;
+
+	explicit CModuleTransform(note_func_t f);
+
+	/*!	\brief Computes the changes made by the transformation without modifying the module.
+		\param modfile The module.
+		\param songs Indices of the songs to visit.
+		\return The changed cells, ordered by song, channel, pattern and row. */
+	CModuleDelta Compute(const CFamiTrackerModule &modfile, const std::vector<unsigned> &songs) const;
+
+	/*!	\brief Computes the changes made by the transformation over all songs of a module.
+		\param modfile The module.
+		\return The changed cells. */
+	CModuleDelta Compute(const CFamiTrackerModule &modfile) const;
+
+	/*!	\brief Writes the transformed cells recorded by a delta into the module.
+		\param modfile The module the delta was computed from.
+		\param delta A delta computed by this transformation. */
+	void Apply(CFamiTrackerModule &modfile, const CModuleDelta &delta) const;
+
+	/*!	\brief Transforms every note of a module in place without recording any changes.
+		\param modfile The module. */
+	void Apply(CFamiTrackerModule &modfile) const;
+
+	/*!	\brief Transposes notes by a number of semitones, skipping noise and DPCM channels.
+		\param semitones Transposition amount.
+		\param disabled Instruments whose notes are left untouched, may be null. */
+	static CModuleTransform Transpose(int semitones, const bool *disabled = nullptr);
+
+	/*!	\brief Replaces all occurrences of one instrument index with another. */
+	static CModuleTransform ReplaceInstrument(unsigned from, unsigned to);
+
+	/*!	\brief Exchanges two instrument indices in all patterns. */
+	static CModuleTransform SwapInstruments(unsigned first, unsigned second);
+
+	/*!	\brief Scales all volume column values.
+		\param percent Scaling factor in percent; results are clamped to the volume range. */
+	static CModuleTransform ScaleVolume(unsigned percent);
+
+	/*!	\brief Changes every effect of a given type to another type, keeping its parameter. */
+	static CModuleTransform RemapEffect(effect_t from, effect_t to);
+
+private:
+	note_func_t f_;
+};
@@ -0,0 +1,244 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2018 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+** Library General Public License for more details.  To obtain a
+** copy of the GNU Library General Public License, write to the Free
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+#include "NSFPlayer.h"
+#include "APU/APU.h"
+#include "APU/Types.h"
+#include "SoundChipSet.h"
+#include <algorithm>
+#include <iterator>
+
+namespace {
+
+const std::size_t NSF_HEADER_SIZE = 0x80;
+const int PLAYER_SAMPLE_RATE = 44100;
+
+const unsigned INIT_CYCLE_LIMIT = MASTER_CLOCK_NTSC;		// one second
+const unsigned PLAY_CYCLE_LIMIT = 10;		// in frames
+
+unsigned ReadWord(array_view<unsigned char> Data, std::size_t Offset) {
+	return Data[Offset] | (Data[Offset + 1] << 8);
+}
+
+} // namespace
+
+CNSFPlayer::CNSFPlayer() :
+	m_pAPU(std::make_unique<CAPU>()),
+	m_CPU(*this)
+{
+}
+
+CNSFPlayer::~CNSFPlayer() {
+}
+
+bool CNSFPlayer::Load(array_view<unsigned char> NSF) {
+	const unsigned char IDENT[] = {'N', 'E', 'S', 'M', 0x1A};
+	if (NSF.size() <= NSF_HEADER_SIZE || !std::equal(std::begin(IDENT), std::end(IDENT), NSF.begin()))
+		return false;
+
+	unsigned LoadAddress = ReadWord(NSF, 0x08);
+	m_iTrackCount = NSF[0x06];
+	m_iInitAddress = ReadWord(NSF, 0x0A);
+	m_iPlayAddress = ReadWord(NSF, 0x0C);
+	m_bPAL = (NSF[0x7A] & 0x03) == 0x01;
+	m_iPlaySpeed = ReadWord(NSF, m_bPAL ? 0x78 : 0x6E);
+	m_iChips = NSF[0x7B];
+	m_bBankswitched = false;
+	for (int i = 0; i < 8; ++i) {
+		m_iInitialBanks[i] = NSF[0x70 + i];
+		if (m_iInitialBanks[i])
+			m_bBankswitched = true;
+	}
+	if (LoadAddress < 0x8000)
+		return false;
+
+	// Without bankswitching the image is laid out linearly from $8000
+	auto Data = NSF.subview(NSF_HEADER_SIZE);
+	std::size_t Padding = m_bBankswitched ? (LoadAddress & (BANK_SIZE - 1)) : LoadAddress - 0x8000;
+	std::size_t Size = (Padding + Data.size() + BANK_SIZE - 1) / BANK_SIZE * BANK_SIZE;
+	m_vROM.assign(std::max(Size, BANK_SIZE * 8), 0);
+	std::copy(Data.begin(), Data.end(), m_vROM.begin() + Padding);
+
+	return true;
+}
+
+bool CNSFPlayer::Init(unsigned Track) {
+	const unsigned Clock = m_bPAL ? MASTER_CLOCK_PAL : MASTER_CLOCK_NTSC;
+	m_iFrameBudget = static_cast<unsigned>(static_cast<std::uint64_t>(m_iPlaySpeed) * Clock / 1000000u);
+	m_iCallCycles = 0;
+	if (m_vROM.empty() || !m_iFrameBudget)
+		return false;
+
+	m_pAPU->SetupSound(PLAYER_SAMPLE_RATE, 1, m_bPAL ? machine_t::PAL : machine_t::NTSC);
+	m_pAPU->SetExternalSound(CSoundChipSet::FromNSFFlag(m_iChips));
+	m_pAPU->Reset();
+
+	m_vRAM.assign(0x800, 0);
+	m_vWRAM.assign(0x2000, 0);
+	m_vFDSRAM.clear();
+	if (m_iChips & 0x04)
+		m_vFDSRAM.assign(0xA000, 0);
+	for (unsigned i = 0; i < 8; ++i)
+		SwitchBank(i + 2, m_bBankswitched ? m_iInitialBanks[i] : i);
+	if (m_bBankswitched) {		// FDS images also receive the last two banks at $6000-$7FFF
+		SwitchBank(0, m_iInitialBanks[6]);
+		SwitchBank(1, m_iInitialBanks[7]);
+	}
+	m_CPU.reset();
+	m_iAPUTime = m_iAPUFrameTime = m_iTimeBase = 0;
+
+	// Initial sound register state required by the NSF specification
+	for (std::uint16_t Address = 0x4000; Address <= 0x4013; ++Address)
+		write(Address, 0x00);
+	write(0x4015, 0x00);
+	write(0x4015, 0x0F);
+	write(0x4017, 0x40);
+
+	m_CPU.regs().a = static_cast<std::uint8_t>(Track);
+	m_CPU.regs().x = m_bPAL ? 1 : 0;
+	if (!m_CPU.call(m_iInitAddress, INIT_CYCLE_LIMIT))
+		return false;
+	m_iCallCycles = static_cast<unsigned>(m_CPU.cycles());
+
+	m_iFrameStart = m_iTimeBase + m_CPU.cycles();
+	AdvanceAPU(m_iFrameStart);
+	return true;
+}
+
+bool CNSFPlayer::Play() {
+	const std::uint64_t Start = m_CPU.cycles();
+	m_iTimeBase = m_iFrameStart - Start;
+
+	bool Returned = m_CPU.call(m_iPlayAddress, static_cast<std::uint64_t>(m_iFrameBudget) * PLAY_CYCLE_LIMIT);
+	m_iCallCycles = static_cast<unsigned>(m_CPU.cycles() - Start);
+	if (!Returned)
+		return false;
+
+	// An overrun delays the next frame
+	m_iFrameStart += std::max(m_iFrameBudget, m_iCallCycles);
+	AdvanceAPU(m_iFrameStart);
+	return true;
+}
+
+unsigned CNSFPlayer::GetCallCycles() const {
+	return m_iCallCycles;
+}
+
+unsigned CNSFPlayer::GetFrameBudget() const {
+	return m_iFrameBudget;
+}
+
+std::uint16_t CNSFPlayer::GetInitAddress() const {
+	return m_iInitAddress;
+}
+
+std::uint16_t CNSFPlayer::GetPlayAddress() const {
+	return m_iPlayAddress;
+}
+
+unsigned CNSFPlayer::GetTrackCount() const {
+	return m_iTrackCount;
+}
+
+bool CNSFPlayer::IsPAL() const {
+	return m_bPAL;
+}
+
+CSoundChipSet CNSFPlayer::GetExpansionChips() const {
+	return CSoundChipSet::FromNSFFlag(m_iChips);
+}
+
+ft0cc::cpu::mos6502 &CNSFPlayer::GetCPU() {
+	return m_CPU;
+}
+
+const CAPU &CNSFPlayer::GetAPU() const {
+	return *m_pAPU;
+}
+
+std::uint8_t CNSFPlayer::read(std::uint16_t addr) {
+	if (addr < 0x2000)
+		return m_vRAM[addr & 0x7FF];
+	if (addr >= 0x6000 && !m_vFDSRAM.empty())
+		return m_vFDSRAM[addr - 0x6000];
+	if (addr >= 0x8000) {
+		std::size_t Offset = m_iBanks[(addr - 0x8000) / BANK_SIZE] * BANK_SIZE + (addr & (BANK_SIZE - 1));
+		return Offset < m_vROM.size() ? m_vROM[Offset] : 0;
+	}
+	if (addr >= 0x6000)
+		return m_vWRAM[addr - 0x6000];
+	if (addr == 0x4015 || (addr >= 0x4040 && addr < 0x5FF6)) {		// 2A03 status and expansion chips
+		AdvanceAPU(m_iTimeBase + m_CPU.cycles());
+		return m_pAPU->Read(addr);
+	}
+	return static_cast<std::uint8_t>(addr >> 8);		// open bus
+}
+
+void CNSFPlayer::write(std::uint16_t addr, std::uint8_t value) {
+	if (addr < 0x2000)
+		m_vRAM[addr & 0x7FF] = value;
+	else if (addr >= 0x5FF6 && addr < 0x6000)
+		SwitchBank(addr - 0x5FF6, value);
+	else if (addr >= 0x6000 && !m_vFDSRAM.empty()) {		// FDS images are stored in RAM
+		m_vFDSRAM[addr - 0x6000] = value;
+		if (addr >= 0x8000)		// expansion chips may share the address range
+			WriteAPU(addr, value);
+	}
+	else if (addr >= 0x6000 && addr < 0x8000)
+		m_vWRAM[addr - 0x6000] = value;
+	else if (addr >= 0x4000)
+		WriteAPU(addr, value);
+}
+
+void CNSFPlayer::WriteAPU(std::uint16_t addr, std::uint8_t value) {
+	AdvanceAPU(m_iTimeBase + m_CPU.cycles());
+	m_pAPU->Write(addr, value);
+}
+
+void CNSFPlayer::SwitchBank(unsigned Page, unsigned Bank) {
+	// Page 0 is at $6000; the FDS copies banks into its RAM, other images map $8000-$FFFF only
+	if (!m_vFDSRAM.empty()) {
+		const std::size_t Offset = Bank * BANK_SIZE;
+		auto it = m_vFDSRAM.begin() + Page * BANK_SIZE;
+		if (Offset < m_vROM.size())
+			std::copy_n(m_vROM.begin() + Offset, BANK_SIZE, it);
+		else
+			std::fill_n(it, BANK_SIZE, 0);
+	}
+	else if (Page >= 2)
+		m_iBanks[Page - 2] = Bank;
+}
+
+void CNSFPlayer::AdvanceAPU(std::uint64_t Time) {
+	// Split long intervals so that the APU never renders more than one frame at a time
+	while (m_iAPUTime < Time) {
+		auto Step = std::min(Time - m_iAPUTime, m_iFrameBudget - m_iAPUFrameTime);
+		m_pAPU->AddTime(static_cast<int32_t>(Step));
+		m_pAPU->Process();
+		m_iAPUTime += Step;
+		m_iAPUFrameTime += Step;
+		if (m_iAPUFrameTime >= m_iFrameBudget) {
+			m_pAPU->EndFrame();
+			m_iAPUFrameTime = 0;
+		}
+	}
+}
@@ -0,0 +1,115 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2018 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+** Library General Public License for more details.  To obtain a
+** copy of the GNU Library General Public License, write to the Free
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include "array_view.h"
+#include "ft0cc/cpu/mos6502.hpp"
+
+class CAPU;
+class CSoundChipSet;
+
+/*!
+	\brief Plays an exported NSF on an emulated 2A03.
+	\details All sound register writes are routed into a CAPU instance, whose clock follows the
+	emulated CPU. Bankswitching and WRAM are supported, as is the RAM of FDS images at $6000-$FFFF;
+	DPCM DMA and interrupts are not emulated.
+*/
+class CNSFPlayer : ft0cc::cpu::bus {
+public:
+	CNSFPlayer();
+	~CNSFPlayer();
+
+	/*!	\brief Loads an NSF file image.
+		\param NSF Contents of the NSF file.
+		\return Whether the file was recognized. */
+	bool Load(array_view<unsigned char> NSF);
+
+	/*!	\brief Resets the machine and calls the NSF's INIT routine.
+		\param Track Zero-based track index.
+		\return Whether INIT returned within the cycle limit. */
+	bool Init(unsigned Track);
+
+	/*!	\brief Calls the NSF's PLAY routine once and advances the APU to the start of the next frame.
+		\details A PLAY call longer than the frame budget delays the next frame.
+		\return Whether PLAY returned within the cycle limit. */
+	bool Play();
+
+	/*!	\brief Obtains the number of CPU cycles taken by the last INIT or PLAY call. */
+	unsigned GetCallCycles() const;
+
+	/*!	\brief Obtains the number of CPU cycles between two PLAY calls. */
+	unsigned GetFrameBudget() const;
+
+	std::uint16_t GetInitAddress() const;
+	std::uint16_t GetPlayAddress() const;
+	unsigned GetTrackCount() const;
+	bool IsPAL() const;
+	CSoundChipSet GetExpansionChips() const;
+
+	/*!	\brief Obtains the emulated CPU, for example to attach a call listener. */
+	ft0cc::cpu::mos6502 &GetCPU();
+
+	/*!	\brief Obtains the APU which receives the NSF's sound register writes. */
+	const CAPU &GetAPU() const;
+
+private:
+	std::uint8_t read(std::uint16_t addr) override;
+	void write(std::uint16_t addr, std::uint8_t value) override;
+
+	void WriteAPU(std::uint16_t addr, std::uint8_t value);
+	void SwitchBank(unsigned Page, unsigned Bank);
+	void AdvanceAPU(std::uint64_t Time);
+
+	static constexpr std::size_t BANK_SIZE = 0x1000;
+
+	std::unique_ptr<CAPU> m_pAPU;
+	ft0cc::cpu::mos6502 m_CPU;
+
+	// NSF image
+	std::vector<unsigned char> m_vROM;		// padded to whole banks
+	std::uint16_t m_iInitAddress = 0;
+	std::uint16_t m_iPlayAddress = 0;
+	unsigned m_iPlaySpeed = 0;				// microseconds per frame
+	unsigned m_iTrackCount = 0;
+	unsigned char m_iInitialBanks[8] = { };
+	unsigned char m_iChips = 0;
+	bool m_bPAL = false;
+	bool m_bBankswitched = false;
+
+	// Memory
+	std::vector<unsigned char> m_vRAM;
+	std::vector<unsigned char> m_vWRAM;
+	std::vector<unsigned char> m_vFDSRAM;		// $6000-$FFFF, empty unless the FDS is enabled
+	unsigned m_iBanks[8] = { };
+
+	// Timing
+	unsigned m_iFrameBudget = 0;
+	unsigned m_iCallCycles = 0;
+	std::uint64_t m_iFrameStart = 0;		// APU time at which the next PLAY call begins
+	std::uint64_t m_iAPUTime = 0;			// cycles passed to the APU so far
+	std::uint64_t m_iAPUFrameTime = 0;		// cycles passed to the APU since its last frame
+	std::uint64_t m_iTimeBase = 0;			// APU time minus CPU cycle count
+};
@@ -0,0 +1,183 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2018 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+** Library General Public License for more details.  To obtain a
+** copy of the GNU Library General Public License, write to the Free
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+#include "NSFProfiler.h"
+#include "NumConv.h"
+#include <algorithm>
+
+namespace {
+
+const unsigned HISTOGRAM_BUCKETS = 10;		// per frame budget
+
+} // namespace
+
+CNSFProfiler::CNSFProfiler() {
+}
+
+CNSFProfiler::~CNSFProfiler() {
+}
+
+bool CNSFProfiler::Load(array_view<unsigned char> NSF) {
+	return m_Player.Load(NSF);
+}
+
+void CNSFProfiler::AddSymbol(std::uint16_t Address, std::string Name, std::uint16_t Size) {
+	m_vSymbols.push_back({Address, Size, std::move(Name)});
+}
+
+CNSFProfiler::stProfile CNSFProfiler::Run(unsigned Track, unsigned Frames) {
+	stProfile Profile;
+	auto &CPU = m_Player.GetCPU();
+	m_Routines.clear();
+	m_vCallStack.clear();
+
+	bool Initialized = m_Player.Init(Track);
+	Profile.FrameBudget = m_Player.GetFrameBudget();
+	if (!Initialized)
+		return Profile;
+	Profile.InitCycles = m_Player.GetCallCycles();
+
+	Profile.Completed = true;
+	CPU.set_listener(this);
+	for (unsigned i = 0; i < Frames; ++i) {
+		m_iLastEvent = CPU.cycles();
+		EnterRoutine(m_Player.GetPlayAddress(), static_cast<std::uint8_t>(CPU.regs().s - 2));
+
+		bool Returned = m_Player.Play();
+		Profile.FrameCycles.push_back(m_Player.GetCallCycles());
+		if (!Returned) {
+			Profile.Completed = false;
+			break;
+		}
+	}
+	CPU.set_listener(nullptr);
+
+	ChargeCycles();
+	LeaveRoutines(0x100);		// routines that did not return
+
+	for (const auto &x : m_Routines)
+		Profile.Routines.push_back(x.second);
+	std::stable_sort(Profile.Routines.begin(), Profile.Routines.end(), [] (const stRoutine &a, const stRoutine &b) {
+		return a.Exclusive > b.Exclusive;
+	});
+
+	return Profile;
+}
+
+std::string CNSFProfiler::GetSymbolName(std::uint16_t Address) const {
+	for (const auto &sym : m_vSymbols)
+		if (sym.Address == Address)
+			return sym.Name;
+	for (const auto &sym : m_vSymbols)
+		if (Address > sym.Address && Address - sym.Address < sym.Size)
+			return "$" + conv::from_uint_hex(Address, 4) + " (" + sym.Name + "+$" + conv::from_uint_hex(Address - sym.Address) + ")";
+	return "$" + conv::from_uint_hex(Address, 4);
+}
+
+std::string CNSFProfiler::FormatReport(const stProfile &Profile, std::size_t WorstFrames) const {
+	const auto Budget = std::max(Profile.FrameBudget, 1u);
+	const auto Percent = [&] (std::uint64_t Cycles, std::uint64_t Total) {
+		return conv::from_uint(Total ? Cycles * 100 / Total : 0) + "%";
+	};
+	const auto &Frames = Profile.FrameCycles;
+
+	std::string str = "NSF driver profile: " + conv::from_uint(Frames.size()) + " frame(s), " +
+		conv::from_uint(Profile.FrameBudget) + " cycles per frame\n";
+	if (!Profile.Completed)
+		str += " * Warning: the driver hung or executed an invalid instruction, the profile is incomplete\n";
+	str += " * INIT: " + conv::from_uint(Profile.InitCycles) + " cycles\n";
+	if (Frames.empty())
+		return str;
+
+	std::uint64_t Total = 0;
+	for (unsigned x : Frames)
+		Total += x;
+	const auto Worst = std::max_element(Frames.begin(), Frames.end());
+	const auto Overruns = std::count_if(Frames.begin(), Frames.end(), [&] (unsigned x) { return x > Budget; });
+	str += " * PLAY: average " + conv::from_uint(Total / Frames.size()) + " cycles (" + Percent(Total / Frames.size(), Budget) +
+		"), maximum " + conv::from_uint(*Worst) + " cycles (" + Percent(*Worst, Budget) +
+		") in frame " + conv::from_uint(Worst - Frames.begin()) + "\n";
+	str += " * Frames over budget: " + conv::from_uint(Overruns) + "\n";
+
+	// Histogram of the frame budget used by each frame, the last bucket holds all overruns
+	std::vector<std::size_t> Buckets(HISTOGRAM_BUCKETS + 1);
+	for (unsigned x : Frames)
+		++Buckets[x > Budget ? HISTOGRAM_BUCKETS : std::min<std::size_t>(x * HISTOGRAM_BUCKETS / Budget, HISTOGRAM_BUCKETS - 1)];
+	str += " * CPU usage histogram:\n";
+	for (std::size_t i = 0; i < HISTOGRAM_BUCKETS; ++i)
+		str += "   " + conv::from_uint(i * 100 / HISTOGRAM_BUCKETS) + "-" + conv::from_uint((i + 1) * 100 / HISTOGRAM_BUCKETS) +
+			"%: " + conv::from_uint(Buckets[i]) + "\n";
+	str += "   over 100%: " + conv::from_uint(Buckets[HISTOGRAM_BUCKETS]) + "\n";
+
+	std::vector<std::size_t> Order(Frames.size());
+	for (std::size_t i = 0; i < Order.size(); ++i)
+		Order[i] = i;
+	WorstFrames = std::min(WorstFrames, Order.size());
+	std::partial_sort(Order.begin(), Order.begin() + WorstFrames, Order.end(), [&] (std::size_t a, std::size_t b) {
+		return Frames[a] > Frames[b] || (Frames[a] == Frames[b] && a < b);
+	});
+	str += " * Worst frames:\n";
+	for (std::size_t i = 0; i < WorstFrames; ++i)
+		str += "   frame " + conv::from_uint(Order[i]) + ": " + conv::from_uint(Frames[Order[i]]) + " cycles (" +
+			Percent(Frames[Order[i]], Budget) + ")\n";
+
+	str += " * Routines (exclusive / inclusive cycles):\n";
+	for (const auto &r : Profile.Routines)
+		str += "   " + GetSymbolName(r.Address) + ": " + conv::from_uint(r.Exclusive) + " (" + Percent(r.Exclusive, Total) + ") / " +
+			conv::from_uint(r.Inclusive) + " (" + Percent(r.Inclusive, Total) + "), " + conv::from_uint(r.Calls) + " call(s)\n";
+
+	return str;
+}
+
+void CNSFProfiler::on_call(std::uint16_t target, std::uint8_t sp) {
+	EnterRoutine(target, sp);
+}
+
+void CNSFProfiler::on_return(std::uint8_t sp) {
+	ChargeCycles();
+	LeaveRoutines(sp);
+}
+
+void CNSFProfiler::EnterRoutine(std::uint16_t Address, std::uint8_t SP) {
+	ChargeCycles();
+	m_vCallStack.push_back({Address, SP, m_Player.GetCPU().cycles()});
+	auto &Routine = m_Routines[Address];
+	Routine.Address = Address;
+	++Routine.Calls;
+}
+
+void CNSFProfiler::LeaveRoutines(unsigned SP) {
+	// Pulling the return address leaves the stack pointer above the caller's frame; routines
+	// that discard their return address are left together with their caller
+	while (!m_vCallStack.empty() && m_vCallStack.back().SP < SP) {
+		const auto &Frame = m_vCallStack.back();
+		m_Routines[Frame.Address].Inclusive += m_Player.GetCPU().cycles() - Frame.Start;
+		m_vCallStack.pop_back();
+	}
+}
+
+void CNSFProfiler::ChargeCycles() {
+	std::uint64_t Now = m_Player.GetCPU().cycles();
+	if (!m_vCallStack.empty())
+		m_Routines[m_vCallStack.back().Address].Exclusive += Now - m_iLastEvent;
+	m_iLastEvent = Now;
+}
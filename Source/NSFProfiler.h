@@ -0,0 +1,112 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2018 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+** Library General Public License for more details.  To obtain a
+** copy of the GNU Library General Public License, write to the Free
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include <map>
+#include <cstdint>
+#include "array_view.h"
+#include "NSFPlayer.h"
+
+/*!
+	\brief Runs an exported NSF on an emulated 2A03 to measure how much CPU time the driver needs.
+	\details The NSF's INIT routine is called once, then PLAY is called once per frame. Each PLAY
+	call is timed against the frame budget given by the NSF's play rate, and cycles are attributed
+	to every subroutine entered through JSR.
+*/
+class CNSFProfiler : ft0cc::cpu::call_listener {
+public:
+	struct stRoutine {
+		std::uint16_t Address = 0;		// entry point
+		unsigned Calls = 0;
+		std::uint64_t Inclusive = 0;	// cycles including called subroutines
+		std::uint64_t Exclusive = 0;	// cycles spent in the routine itself
+	};
+
+	struct stProfile {
+		unsigned FrameBudget = 0;			// cycles between two PLAY calls
+		unsigned InitCycles = 0;
+		std::vector<unsigned> FrameCycles;	// cycles taken by PLAY in each frame
+		std::vector<stRoutine> Routines;	// sorted by exclusive cycles
+		bool Completed = false;				// false if the driver hung or hit an invalid opcode
+	};
+
+	CNSFProfiler();
+	~CNSFProfiler();
+
+	/*!	\brief Loads an NSF file image.
+		\param NSF Contents of the NSF file.
+		\return Whether the file was recognized. */
+	bool Load(array_view<unsigned char> NSF);
+
+	/*!	\brief Names an address for the profiler report.
+		\param Address CPU address of the symbol.
+		\param Name Name of the symbol.
+		\param Size Number of bytes covered by the symbol, addresses inside are named relative to it. */
+	void AddSymbol(std::uint16_t Address, std::string Name, std::uint16_t Size = 0);
+
+	/*!	\brief Plays a track of the loaded NSF and measures the driver's CPU usage.
+		\param Track Zero-based track index.
+		\param Frames Number of times the PLAY routine is called.
+		\return The measured profile. */
+	stProfile Run(unsigned Track, unsigned Frames);
+
+	/*!	\brief Obtains a printable name for an address. */
+	std::string GetSymbolName(std::uint16_t Address) const;
+
+	/*!	\brief Formats a profile as a text report with a histogram of per-frame CPU usage, the worst
+		frames, and the time spent in each routine.
+		\param Profile The profile returned by Run.
+		\param WorstFrames Number of frames to list individually. */
+	std::string FormatReport(const stProfile &Profile, std::size_t WorstFrames = 5) const;
+
+private:
+	void on_call(std::uint16_t target, std::uint8_t sp) override;
+	void on_return(std::uint8_t sp) override;
+
+	void EnterRoutine(std::uint16_t Address, std::uint8_t SP);
+	void LeaveRoutines(unsigned SP);
+	void ChargeCycles();
+
+	struct stSymbol {
+		std::uint16_t Address;
+		std::uint16_t Size;
+		std::string Name;
+	};
+
+	struct stCallFrame {
+		std::uint16_t Address;
+		std::uint8_t SP;
+		std::uint64_t Start;
+	};
+
+	CNSFPlayer m_Player;
+
+	// Profiling
+	std::map<std::uint16_t, stRoutine> m_Routines;
+	std::vector<stCallFrame> m_vCallStack;
+	std::uint64_t m_iLastEvent = 0;
+	std::vector<stSymbol> m_vSymbols;
+};
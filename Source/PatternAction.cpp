@@ -31,6 +31,7 @@
 #include "SelectionRange.h"		// // //
 #include "FamiTrackerModule.h"		// // //
 #include "SongView.h"		// // //
+#include "SongFlowGraph.h"		// // //
 
 // // // all dependencies on CMainFrame
 #define GET_VIEW() MainFrm.GetTrackerView()
@@ -39,6 +40,28 @@
 #define GET_PATTERN_EDITOR() GET_VIEW()->GetPatternEditor()
 #define UPDATE_CONTROLS() MainFrm.UpdateControls()
 
+namespace {
+
+std::size_t GetClipMemoryUsage(const CPatternClipData &ClipData) {		// // //
+	return ClipData.Size * sizeof(stChanNote);
+}
+
+std::size_t GetSongMemoryUsage(const CSongData *pSong) {		// // //
+	if (!pSong)
+		return 0u;
+	std::size_t Size = sizeof(CSongData);
+	pSong->VisitTracks([&] (const CTrackData &) {
+		Size += sizeof(CTrackData);
+	});
+	pSong->VisitPatterns([&] (const CPatternData &pattern) {
+		if (!pattern.IsEmpty())
+			Size += pattern.GetMaximumSize() * sizeof(stChanNote);
+	});
+	return Size;
+}
+
+} // namespace
+
 // // // Pattern editor state class
 
 CPatternEditorState::CPatternEditorState(const CPatternEditor &Editor) :
@@ -216,6 +239,35 @@ void CPatternAction::UpdateViews(CMainFrame &MainFrm) const		// // //
 	MainFrm.GetActiveDocument()->UpdateAllViews(NULL, UPDATE_FRAME); // cursor might have moved to different channel
 }
 
+void CPatternAction::UpdateFlowGraph(CMainFrame &MainFrm) const		// // //
+{
+	CSongView *pSongView = GET_SONG_VIEW();
+	GET_MODULE()->GetSongFlowGraphs().Visit(MainFrm.GetSelectedTrack(), [&] (CSongFlowGraph &graph) {
+		if (!m_bDeltaRegion)
+			return graph.Rebuild();
+
+		// rescanning a row visits every frame, so rescan the whole song for large regions
+		const int Frames = pSongView->GetSong().GetFrameCount();
+		const int Length = pSongView->GetSong().GetPatternLength();
+		auto [b, e] = CPatternIterator::FromSelection(m_DeltaRegion, *pSongView);
+		if ((e.m_iFrame - b.m_iFrame) * Length + e.m_iRow - b.m_iRow >= Length)
+			return graph.Rebuild();
+		do
+			graph.UpdateRow((b.m_iFrame % Frames + Frames) % Frames, b.m_iRow);
+		while (++b <= e);
+	});
+}
+
+void CPatternAction::UpdateFlowGraphRows(CMainFrame &MainFrm, int Frame, int RowStart, int RowEnd) const		// // //
+{
+	const int Frames = GET_SONG_VIEW()->GetSong().GetFrameCount();
+	Frame = (Frame % Frames + Frames) % Frames;
+	GET_MODULE()->GetSongFlowGraphs().Visit(MainFrm.GetSelectedTrack(), [&] (CSongFlowGraph &graph) {
+		for (int Row = RowStart; Row <= RowEnd; ++Row)
+			graph.UpdateRow(Frame, Row);
+	});
+}
+
 std::pair<CPatternIterator, CPatternIterator> CPatternAction::GetIterators(CSongView &view) const
 {
 	return m_pUndoState->IsSelecting ?
@@ -238,6 +290,16 @@ void CPatternAction::SaveUndoState(const CMainFrame &MainFrm)		// // //
 void CPatternAction::SaveRedoState(const CMainFrame &MainFrm)		// // //
 {
 	m_pRedoState = std::make_unique<CPatternEditorState>(*GET_PATTERN_EDITOR());
+
+	if (m_bDeltaRegion && m_UndoClipData.ContainsData()) {
+		CPatternClipDelta Delta {m_UndoClipData, GET_PATTERN_EDITOR()->CopyRaw(m_DeltaRegion)};
+		if (Delta.GetMemoryUsage() < GetClipMemoryUsage(m_UndoClipData)) {		// dense edits keep the full copy
+			m_Delta = std::move(Delta);
+			m_UndoClipData = CPatternClipData { };
+			m_bHasDelta = true;
+			ReleaseUndoData();
+		}
+	}
 }
 
 void CPatternAction::RestoreUndoState(CMainFrame &MainFrm) const		// // //
@@ -252,6 +314,57 @@ void CPatternAction::RestoreRedoState(CMainFrame &MainFrm) const		// // //
 		m_pRedoState->ApplyState(*GET_PATTERN_EDITOR());
 }
 
+std::size_t CPatternAction::GetMemoryUsage() const		// // //
+{
+	std::size_t Size = sizeof(CPatternAction) + GetClipMemoryUsage(m_ClipData) + GetClipMemoryUsage(m_UndoClipData);
+	if (m_pUndoState)
+		Size += sizeof(CPatternEditorState);
+	if (m_pRedoState)
+		Size += sizeof(CPatternEditorState);
+	if (m_bHasDelta)
+		Size += m_Delta.GetMemoryUsage();
+	return Size;
+}
+
+module_block_set_t CPatternAction::GetModifiedBlocks() const		// // //
+{
+	return MakeBlockSet({module_block_t::patterns});
+}
+
+// Compact undo history
+
+void CPatternAction::SaveDeltaRegion(const CSelection &Region)		// // //
+{
+	m_DeltaRegion = Region.GetNormalized();
+	m_bDeltaRegion = true;
+}
+
+bool CPatternAction::UndoDelta(CMainFrame &MainFrm) const		// // //
+{
+	if (!m_bHasDelta)
+		return false;
+	CPatternEditor *pPatternEditor = GET_PATTERN_EDITOR();
+	auto ClipData = pPatternEditor->CopyRaw(m_DeltaRegion);
+	m_Delta.Exchange(ClipData);
+	pPatternEditor->PasteRaw(ClipData, m_DeltaRegion.m_cpStart);
+	return true;
+}
+
+bool CPatternAction::RedoDelta(CMainFrame &MainFrm) const		// // //
+{
+	if (!m_bHasDelta)
+		return false;
+	CPatternEditor *pPatternEditor = GET_PATTERN_EDITOR();
+	auto ClipData = pPatternEditor->CopyRaw(m_DeltaRegion);
+	m_Delta.Exchange(ClipData);
+	pPatternEditor->PasteRaw(ClipData, m_DeltaRegion.m_cpStart);
+	return true;
+}
+
+void CPatternAction::ReleaseUndoData()		// // //
+{
+}
+
 
 
 CPSelectionAction::~CPSelectionAction() {
@@ -261,15 +374,24 @@ bool CPSelectionAction::SaveState(const CMainFrame &MainFrm)
 {
 	const CPatternEditor *pPatternEditor = GET_PATTERN_EDITOR();
 	m_UndoClipData = pPatternEditor->CopyRaw(m_pUndoState->Selection);
+	SaveDeltaRegion(m_pUndoState->Selection);		// // //
 	return true;
 }
 
 void CPSelectionAction::Undo(CMainFrame &MainFrm)
 {
+	if (UndoDelta(MainFrm))		// // //
+		return;
 	CPatternEditor *pPatternEditor = GET_PATTERN_EDITOR();
 	pPatternEditor->PasteRaw(m_UndoClipData, m_pUndoState->Selection.m_cpStart);
 }
 
+void CPSelectionAction::Redo(CMainFrame &MainFrm)		// // //
+{
+	if (!RedoDelta(MainFrm))
+		RedoSelection(MainFrm);
+}
+
 
 
 // // // built-in pattern action subtypes
@@ -300,6 +422,11 @@ void CPActionEditNote::Redo(CMainFrame &MainFrm)
 		.SetNoteOn(m_pUndoState->Cursor.Ypos.Row, m_NewNote);		// // //
 }
 
+void CPActionEditNote::UpdateFlowGraph(CMainFrame &MainFrm) const		// // //
+{
+	UpdateFlowGraphRows(MainFrm, m_pUndoState->Cursor.Ypos.Frame, m_pUndoState->Cursor.Ypos.Row, m_pUndoState->Cursor.Ypos.Row);
+}
+
 
 
 CPActionReplaceNote::CPActionReplaceNote(const stChanNote &Note, int Frame, int Row, int Channel) :
@@ -323,6 +450,11 @@ void CPActionReplaceNote::Redo(CMainFrame &MainFrm)
 	GET_SONG_VIEW()->GetPatternOnFrame(m_iChannel, m_iFrame).SetNoteOn(m_iRow, m_NewNote);		// // //
 }
 
+void CPActionReplaceNote::UpdateFlowGraph(CMainFrame &MainFrm) const		// // //
+{
+	UpdateFlowGraphRows(MainFrm, m_iFrame, m_iRow, m_iRow);
+}
+
 
 
 bool CPActionInsertRow::SaveState(const CMainFrame &MainFrm)
@@ -347,6 +479,12 @@ void CPActionInsertRow::Redo(CMainFrame &MainFrm)
 	GET_SONG_VIEW()->InsertRow(m_pUndoState->Cursor.Xpos.Track, m_pUndoState->Cursor.Ypos.Frame, m_pUndoState->Cursor.Ypos.Row);
 }
 
+void CPActionInsertRow::UpdateFlowGraph(CMainFrame &MainFrm) const		// // //
+{
+	UpdateFlowGraphRows(MainFrm, m_pUndoState->Cursor.Ypos.Frame, m_pUndoState->Cursor.Ypos.Row,
+		GET_SONG_VIEW()->GetSong().GetPatternLength() - 1);
+}
+
 
 
 CPActionDeleteRow::CPActionDeleteRow(bool PullUp, bool Backspace) :
@@ -420,6 +558,12 @@ void CPActionDeleteRow::Redo(CMainFrame &MainFrm)
 		pSongView->PullUp(m_pUndoState->Cursor.Xpos.Track, m_pUndoState->Cursor.Ypos.Frame, m_iRow);
 }
 
+void CPActionDeleteRow::UpdateFlowGraph(CMainFrame &MainFrm) const		// // //
+{
+	UpdateFlowGraphRows(MainFrm, m_pUndoState->Cursor.Ypos.Frame, m_iRow,
+		m_bPullUp ? GET_SONG_VIEW()->GetSong().GetPatternLength() - 1 : m_iRow);
+}
+
 
 
 CPActionScrollField::CPActionScrollField(int Amount) :		// // //
@@ -482,6 +626,11 @@ void CPActionScrollField::Redo(CMainFrame &MainFrm)
 		.SetNoteOn(m_pUndoState->Cursor.Ypos.Row, m_NewNote);		// // //
 }
 
+void CPActionScrollField::UpdateFlowGraph(CMainFrame &MainFrm) const		// // //
+{
+	UpdateFlowGraphRows(MainFrm, m_pUndoState->Cursor.Ypos.Frame, m_pUndoState->Cursor.Ypos.Row, m_pUndoState->Cursor.Ypos.Row);
+}
+
 
 
 // // // TODO: move stuff in CPatternAction::SetTargetSelection to the redo state
@@ -515,23 +664,31 @@ bool CPActionPaste::SaveState(const CMainFrame &MainFrm) {
 	if (!SetTargetSelection(MainFrm, m_newSelection))		// // //
 		return false;
 	m_UndoClipData = GET_PATTERN_EDITOR()->CopyRaw();
+	SaveDeltaRegion(m_newSelection);		// // //
 	return true;
 }
 
 void CPActionPaste::Undo(CMainFrame &MainFrm) {
 	CPatternEditor *pPatternEditor = GET_PATTERN_EDITOR();
 	pPatternEditor->SetSelection(m_newSelection);		// // //
-	pPatternEditor->PasteRaw(m_UndoClipData);
+	if (!UndoDelta(MainFrm))		// // //
+		pPatternEditor->PasteRaw(m_UndoClipData);
 }
 
 void CPActionPaste::Redo(CMainFrame &MainFrm) {
+	if (RedoDelta(MainFrm))		// // //
+		return;
 	CPatternEditor *pPatternEditor = GET_PATTERN_EDITOR();
 	pPatternEditor->Paste(m_ClipData, m_iPasteMode, m_iPastePos);		// // //
 }
 
+void CPActionPaste::ReleaseUndoData() {		// // //
+	m_ClipData = CPatternClipData { };
+}
 
 
-void CPActionClearSel::Redo(CMainFrame &MainFrm)
+
+void CPActionClearSel::RedoSelection(CMainFrame &MainFrm)
 {
 	DeleteSelection(*GET_SONG_VIEW(), m_pUndoState->Selection);
 }
@@ -562,11 +719,22 @@ bool CPActionDeleteAtSel::SaveState(const CMainFrame &MainFrm)
 			m_pUndoState->Selection.m_cpEnd.Xpos.Column,
 			m_cpTailPos.Ypos.Frame
 		}});
+
+	CSelection Region {m_pUndoState->Selection.m_cpStart, CCursorPos {		// // //
+		Length,
+		m_pUndoState->Selection.m_cpEnd.Xpos.Track,
+		m_pUndoState->Selection.m_cpEnd.Xpos.Column,
+		m_cpTailPos.Ypos.Frame
+	}};
+	m_UndoClipData = pPatternEditor->CopyRaw(Region);
+	SaveDeltaRegion(Region);
 	return true;
 }
 
 void CPActionDeleteAtSel::Undo(CMainFrame &MainFrm)
 {
+	if (UndoDelta(MainFrm))		// // //
+		return;
 	CPatternEditor *pPatternEditor = GET_PATTERN_EDITOR();
 	pPatternEditor->PasteRaw(m_UndoHead, m_pUndoState->Selection.m_cpStart);
 	if (m_UndoTail.ContainsData())
@@ -576,6 +744,10 @@ void CPActionDeleteAtSel::Undo(CMainFrame &MainFrm)
 void CPActionDeleteAtSel::Redo(CMainFrame &MainFrm)
 {
 	CPatternEditor *pPatternEditor = GET_PATTERN_EDITOR();
+	if (RedoDelta(MainFrm)) {		// // //
+		pPatternEditor->CancelSelection();
+		return;
+	}
 
 	CSelection Sel(m_pUndoState->Selection);
 	Sel.m_cpEnd.Ypos.Row = pPatternEditor->GetCurrentPatternLength(Sel.m_cpEnd.Ypos.Frame) - 1;
@@ -585,6 +757,18 @@ void CPActionDeleteAtSel::Redo(CMainFrame &MainFrm)
 	pPatternEditor->CancelSelection();
 }
 
+void CPActionDeleteAtSel::ReleaseUndoData()		// // //
+{
+	m_UndoHead = CPatternClipData { };
+	m_UndoTail = CPatternClipData { };
+}
+
+std::size_t CPActionDeleteAtSel::GetMemoryUsage() const		// // //
+{
+	return CPatternAction::GetMemoryUsage() + sizeof(*this) - sizeof(CPatternAction) +
+		GetClipMemoryUsage(m_UndoHead) + GetClipMemoryUsage(m_UndoTail);
+}
+
 
 
 CPActionInsertAtSel::~CPActionInsertAtSel()
@@ -621,11 +805,21 @@ bool CPActionInsertAtSel::SaveState(const CMainFrame &MainFrm)
 		}
 	}
 
+	CSelection Region {m_pUndoState->Selection.m_cpStart, CCursorPos {		// // //
+		m_cpTailPos.Ypos.Row,
+		m_pUndoState->Selection.m_cpEnd.Xpos.Track,
+		m_pUndoState->Selection.m_cpEnd.Xpos.Column,
+		m_cpTailPos.Ypos.Frame
+	}};
+	m_UndoClipData = pPatternEditor->CopyRaw(Region);
+	SaveDeltaRegion(Region);
 	return true;
 }
 
 void CPActionInsertAtSel::Undo(CMainFrame &MainFrm)
 {
+	if (UndoDelta(MainFrm))		// // //
+		return;
 	CPatternEditor *pPatternEditor = GET_PATTERN_EDITOR();
 	pPatternEditor->PasteRaw(m_UndoTail, m_cpTailPos);
 	if (m_UndoHead.ContainsData())
@@ -634,6 +828,8 @@ void CPActionInsertAtSel::Undo(CMainFrame &MainFrm)
 
 void CPActionInsertAtSel::Redo(CMainFrame &MainFrm)
 {
+	if (RedoDelta(MainFrm))		// // //
+		return;
 	CPatternEditor *pPatternEditor = GET_PATTERN_EDITOR();
 
 	CSelection Sel(m_pUndoState->Selection);
@@ -643,13 +839,25 @@ void CPActionInsertAtSel::Redo(CMainFrame &MainFrm)
 		pPatternEditor->PasteRaw(m_UndoHead, m_cpHeadPos);
 }
 
+void CPActionInsertAtSel::ReleaseUndoData()		// // //
+{
+	m_UndoHead = CPatternClipData { };
+	m_UndoTail = CPatternClipData { };
+}
+
+std::size_t CPActionInsertAtSel::GetMemoryUsage() const		// // //
+{
+	return CPatternAction::GetMemoryUsage() + sizeof(*this) - sizeof(CPatternAction) +
+		GetClipMemoryUsage(m_UndoHead) + GetClipMemoryUsage(m_UndoTail);
+}
+
 
 
 CPActionTranspose::CPActionTranspose(int Amount) : m_iTransposeAmount(Amount)
 {
 }
 
-void CPActionTranspose::Redo(CMainFrame &MainFrm)
+void CPActionTranspose::RedoSelection(CMainFrame &MainFrm)
 {
 	CSongView *pSongView = GET_SONG_VIEW();
 	auto [b, e] = GetIterators(*pSongView);
@@ -703,7 +911,7 @@ CPActionScrollValues::CPActionScrollValues(int Amount) : m_iAmount(Amount)
 {
 }
 
-void CPActionScrollValues::Redo(CMainFrame &MainFrm)
+void CPActionScrollValues::RedoSelection(CMainFrame &MainFrm)
 {
 	CPatternEditor *pPatternEditor = GET_PATTERN_EDITOR();
 	CSongView *pSongView = GET_SONG_VIEW();
@@ -789,7 +997,7 @@ bool CPActionInterpolate::SaveState(const CMainFrame &MainFrm)
 	return CPSelectionAction::SaveState(MainFrm);
 }
 
-void CPActionInterpolate::Redo(CMainFrame &MainFrm)
+void CPActionInterpolate::RedoSelection(CMainFrame &MainFrm)
 {
 	CSongView *pSongView = GET_SONG_VIEW();
 	auto [b, e] = GetIterators(*pSongView);
@@ -890,7 +1098,7 @@ bool CPActionReverse::SaveState(const CMainFrame &MainFrm)
 	return CPSelectionAction::SaveState(MainFrm);
 }
 
-void CPActionReverse::Redo(CMainFrame &MainFrm)
+void CPActionReverse::RedoSelection(CMainFrame &MainFrm)
 {
 	CSongView *pSongView = GET_SONG_VIEW();
 	auto [b, e] = GetIterators(*pSongView);
@@ -935,7 +1143,7 @@ bool CPActionReplaceInst::SaveState(const CMainFrame &MainFrm)
 	return CPSelectionAction::SaveState(MainFrm);
 }
 
-void CPActionReplaceInst::Redo(CMainFrame &MainFrm)
+void CPActionReplaceInst::RedoSelection(CMainFrame &MainFrm)
 {
 	auto [b, e] = GetIterators(*GET_SONG_VIEW());
 	const CSelection &Sel = m_pUndoState->Selection;
@@ -969,6 +1177,8 @@ bool CPActionDragDrop::SaveState(const CMainFrame &MainFrm)
 	if (!SetTargetSelection(MainFrm, m_newSelection))		// // //
 		return false;
 	m_UndoClipData = pPatternEditor->CopyRaw();
+	if (!m_bDragDelete)		// // // the source and target regions are unrelated otherwise
+		SaveDeltaRegion(m_newSelection);
 	return true;
 }
 
@@ -976,6 +1186,8 @@ void CPActionDragDrop::Undo(CMainFrame &MainFrm)
 {
 	CPatternEditor *pPatternEditor = GET_PATTERN_EDITOR();
 	pPatternEditor->SetSelection(m_newSelection);
+	if (UndoDelta(MainFrm))		// // //
+		return;
 	pPatternEditor->PasteRaw(m_UndoClipData);
 	if (m_bDragDelete)
 		pPatternEditor->PasteRaw(m_AuxiliaryClipData, m_pUndoState->Selection.m_cpStart);
@@ -983,12 +1195,25 @@ void CPActionDragDrop::Undo(CMainFrame &MainFrm)
 
 void CPActionDragDrop::Redo(CMainFrame &MainFrm)
 {
+	if (RedoDelta(MainFrm))		// // //
+		return;
 	if (m_bDragDelete)
 		DeleteSelection(*GET_SONG_VIEW(), m_pUndoState->Selection);		// // //
 //	GET_PATTERN_EDITOR()->Paste(m_ClipData, m_iPasteMode, m_iPastePos);		// // //
 	GET_PATTERN_EDITOR()->DragPaste(m_ClipData, m_dragTarget, m_bDragMix);
 }
 
+void CPActionDragDrop::ReleaseUndoData()		// // //
+{
+	m_ClipData = CPatternClipData { };
+}
+
+std::size_t CPActionDragDrop::GetMemoryUsage() const		// // //
+{
+	return CPatternAction::GetMemoryUsage() + sizeof(*this) - sizeof(CPatternAction) +
+		GetClipMemoryUsage(m_AuxiliaryClipData);
+}
+
 
 
 bool CPActionPatternLen::SaveState(const CMainFrame &MainFrm)
@@ -1020,6 +1245,11 @@ bool CPActionPatternLen::Merge(const CAction &Other)		// // //
 	return true;
 }
 
+module_block_set_t CPActionPatternLen::GetModifiedBlocks() const		// // //
+{
+	return MakeBlockSet({module_block_t::frames});
+}
+
 
 
 CPActionStretch::CPActionStretch(const std::vector<int> &Stretch) :
@@ -1036,7 +1266,7 @@ bool CPActionStretch::SaveState(const CMainFrame &MainFrm)
 	return CPSelectionAction::SaveState(MainFrm);
 }
 
-void CPActionStretch::Redo(CMainFrame &MainFrm)
+void CPActionStretch::RedoSelection(CMainFrame &MainFrm)
 {
 	CSongView *pSongView = GET_SONG_VIEW();
 	auto [b, e] = GetIterators(*pSongView);
@@ -1102,6 +1332,11 @@ void CPActionEffColumn::UpdateViews(CMainFrame &MainFrm) const		// // //
 	MainFrm.GetActiveDocument()->UpdateAllViews(NULL, UPDATE_COLUMNS);
 }
 
+module_block_set_t CPActionEffColumn::GetModifiedBlocks() const		// // //
+{
+	return MakeBlockSet({module_block_t::header, module_block_t::patterns});
+}
+
 
 
 CPActionHighlight::CPActionHighlight(const stHighlight &Hl) :		// // //
@@ -1130,6 +1365,11 @@ void CPActionHighlight::UpdateViews(CMainFrame &MainFrm) const
 	MainFrm.GetActiveDocument()->UpdateAllViews(NULL, UPDATE_HIGHLIGHT);
 }
 
+module_block_set_t CPActionHighlight::GetModifiedBlocks() const		// // //
+{
+	return MakeBlockSet({module_block_t::params, module_block_t::header});
+}
+
 
 
 bool CPActionUniquePatterns::SaveState(const CMainFrame &MainFrm) {
@@ -1169,6 +1409,15 @@ void CPActionUniquePatterns::UpdateViews(CMainFrame &MainFrm) const {
 	MainFrm.GetActiveDocument()->UpdateAllViews(NULL, UPDATE_FRAME);
 }
 
+std::size_t CPActionUniquePatterns::GetMemoryUsage() const {		// // //
+	return CPatternAction::GetMemoryUsage() + sizeof(*this) - sizeof(CPatternAction) +
+		GetSongMemoryUsage(song_.get()) + GetSongMemoryUsage(songNew_.get());
+}
+
+module_block_set_t CPActionUniquePatterns::GetModifiedBlocks() const {		// // //
+	return CAction::GetModifiedBlocks(); // replaces the entire song
+}
+
 
 
 bool CPActionClearAll::SaveState(const CMainFrame &MainFrm) {
@@ -1195,3 +1444,12 @@ void CPActionClearAll::UpdateViews(CMainFrame &MainFrm) const {
 	MainFrm.GetActiveDocument()->UpdateAllViews(NULL, UPDATE_TRACK);
 	MainFrm.GetActiveDocument()->UpdateAllViews(NULL, UPDATE_FRAME);
 }
+
+std::size_t CPActionClearAll::GetMemoryUsage() const {		// // //
+	return CPatternAction::GetMemoryUsage() + sizeof(*this) - sizeof(CPatternAction) +
+		GetSongMemoryUsage(song_.get()) + GetSongMemoryUsage(songNew_.get());
+}
+
+module_block_set_t CPActionClearAll::GetModifiedBlocks() const {		// // //
+	return CAction::GetModifiedBlocks(); // replaces the entire song
+}
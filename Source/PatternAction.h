@@ -30,6 +30,7 @@
 #include <vector>		// // //
 #include <memory>		// // //
 #include "PatternClipData.h"		// // //
+#include "PatternClipDelta.h"		// // //
 
 class CPatternEditor;		// // //
 class CPatternIterator;		// // //
@@ -77,8 +78,12 @@ public:
 	void RestoreUndoState(CMainFrame &MainFrm) const override;		// // //
 	void RestoreRedoState(CMainFrame &MainFrm) const override;		// // //
 
+	std::size_t GetMemoryUsage() const override;		// // //
+	module_block_set_t GetModifiedBlocks() const override;		// // //
+
 private:
 	void UpdateViews(CMainFrame &MainFrm) const override;		// // //
+	void UpdateFlowGraph(CMainFrame &MainFrm) const override;		// // //
 
 protected:
 	bool SetTargetSelection(const CMainFrame &MainFrm, CSelection &Sel);		// // //
@@ -86,6 +91,27 @@ protected:
 	bool ValidateSelection(const CPatternEditor &Editor) const;		// // //
 	std::pair<CPatternIterator, CPatternIterator> GetIterators(CSongView &view) const;		// // //
 
+	/*!	\brief Marks m_UndoClipData as a copy of a region that contains every cell the action
+		modifies.
+		\details Once the action is committed, the region is compared against its new contents,
+		and the full copy is replaced by a delta holding only the changed cells, unless the delta
+		would not be smaller.
+		\param Region The pattern region, as passed to CPatternEditor::CopyRaw. */
+	void SaveDeltaRegion(const CSelection &Region);		// // //
+	/*!	\brief Reverts the region using the recorded delta.
+		\return Whether a delta was available. */
+	bool UndoDelta(CMainFrame &MainFrm) const;		// // //
+	/*!	\brief Reapplies the region using the recorded delta.
+		\return Whether a delta was available. */
+	bool RedoDelta(CMainFrame &MainFrm) const;		// // //
+	/*!	\brief Releases data that is no longer needed once a delta has been recorded. */
+	virtual void ReleaseUndoData();		// // //
+	/*!	\brief Rescans rows of the current song's flow graph.
+		\param Frame The frame index.
+		\param RowStart The first row to rescan.
+		\param RowEnd The last row to rescan. */
+	void UpdateFlowGraphRows(CMainFrame &MainFrm, int Frame, int RowStart, int RowEnd) const;		// // //
+
 protected:
 	std::unique_ptr<CPatternEditorState> m_pUndoState;		// // //
 	std::unique_ptr<CPatternEditorState> m_pRedoState;
@@ -100,6 +126,12 @@ protected:
 	CSelection m_selection, m_newSelection;		// // //
 
 	CSelection m_dragTarget;
+
+private:
+	CSelection m_DeltaRegion;		// // //
+	mutable CPatternClipDelta m_Delta;		// holds the state not currently in the document
+	bool m_bDeltaRegion = false;
+	bool m_bHasDelta = false;
 };
 
 /*!
@@ -113,8 +145,9 @@ protected:
 protected:
 	bool SaveState(const CMainFrame &MainFrm) override;
 	void Undo(CMainFrame &MainFrm) override;
-protected:
-	CPatternClipData m_UndoClipData;
+	void Redo(CMainFrame &MainFrm) final;		// // //
+	// // // Modifies the selection, reading the original contents from m_UndoClipData
+	virtual void RedoSelection(CMainFrame &MainFrm) = 0;
 };
 
 // // // built-in pattern action subtypes
@@ -127,6 +160,7 @@ private:
 	bool SaveState(const CMainFrame &MainFrm) override;
 	void Undo(CMainFrame &MainFrm) override;
 	void Redo(CMainFrame &MainFrm) override;
+	void UpdateFlowGraph(CMainFrame &MainFrm) const override;		// // //
 
 	stChanNote m_NewNote, m_OldNote;
 };
@@ -139,6 +173,7 @@ private:
 	bool SaveState(const CMainFrame &MainFrm) override;
 	void Undo(CMainFrame &MainFrm) override;
 	void Redo(CMainFrame &MainFrm) override;
+	void UpdateFlowGraph(CMainFrame &MainFrm) const override;		// // //
 
 	stChanNote m_NewNote, m_OldNote;
 	int m_iFrame, m_iRow, m_iChannel;
@@ -149,6 +184,7 @@ class CPActionInsertRow : public CPatternAction
 	bool SaveState(const CMainFrame &MainFrm) override;
 	void Undo(CMainFrame &MainFrm) override;
 	void Redo(CMainFrame &MainFrm) override;
+	void UpdateFlowGraph(CMainFrame &MainFrm) const override;		// // //
 
 	stChanNote m_OldNote;
 };
@@ -161,6 +197,7 @@ private:
 	bool SaveState(const CMainFrame &MainFrm) override;
 	void Undo(CMainFrame &MainFrm) override;
 	void Redo(CMainFrame &MainFrm) override;
+	void UpdateFlowGraph(CMainFrame &MainFrm) const override;		// // //
 
 	stChanNote m_NewNote, m_OldNote;
 	int m_iRow;
@@ -175,6 +212,7 @@ private:
 	bool SaveState(const CMainFrame &MainFrm) override;
 	void Undo(CMainFrame &MainFrm) override;
 	void Redo(CMainFrame &MainFrm) override;
+	void UpdateFlowGraph(CMainFrame &MainFrm) const override;		// // //
 
 	stChanNote m_NewNote, m_OldNote;
 	int m_iAmount;
@@ -187,11 +225,12 @@ private:
 	bool SaveState(const CMainFrame &MainFrm) override;
 	void Undo(CMainFrame &MainFrm) override;
 	void Redo(CMainFrame &MainFrm) override;
+	void ReleaseUndoData() override;		// // //
 };
 
 class CPActionClearSel : public CPSelectionAction
 {
-	void Redo(CMainFrame &MainFrm) override;
+	void RedoSelection(CMainFrame &MainFrm) override;
 };
 
 class CPActionDeleteAtSel : public CPatternAction
@@ -202,6 +241,8 @@ private:
 	bool SaveState(const CMainFrame &MainFrm) override;
 	void Undo(CMainFrame &MainFrm) override;
 	void Redo(CMainFrame &MainFrm) override;
+	void ReleaseUndoData() override;		// // //
+	std::size_t GetMemoryUsage() const override;		// // //
 
 	CCursorPos m_cpTailPos;
 	CPatternClipData m_UndoHead;
@@ -216,6 +257,8 @@ private:
 	bool SaveState(const CMainFrame &MainFrm) override;
 	void Undo(CMainFrame &MainFrm) override;
 	void Redo(CMainFrame &MainFrm) override;
+	void ReleaseUndoData() override;		// // //
+	std::size_t GetMemoryUsage() const override;		// // //
 
 	CCursorPos m_cpHeadPos, m_cpTailPos;
 	CPatternClipData m_UndoHead;
@@ -227,7 +270,7 @@ class CPActionTranspose : public CPSelectionAction
 public:
 	CPActionTranspose(int Amount);
 private:
-	void Redo(CMainFrame &MainFrm) override;
+	void RedoSelection(CMainFrame &MainFrm) override;
 
 	int m_iTransposeAmount;		// // //
 };
@@ -237,7 +280,7 @@ class CPActionScrollValues : public CPSelectionAction
 public:
 	CPActionScrollValues(int Amount);
 private:
-	void Redo(CMainFrame &MainFrm) override;
+	void RedoSelection(CMainFrame &MainFrm) override;
 
 	int m_iAmount;
 };
@@ -245,7 +288,7 @@ private:
 class CPActionInterpolate : public CPSelectionAction
 {
 	bool SaveState(const CMainFrame &MainFrm) override;
-	void Redo(CMainFrame &MainFrm) override;
+	void RedoSelection(CMainFrame &MainFrm) override;
 
 	int m_iSelectionSize;
 };
@@ -253,7 +296,7 @@ class CPActionInterpolate : public CPSelectionAction
 class CPActionReverse : public CPSelectionAction
 {
 	bool SaveState(const CMainFrame &MainFrm) override;
-	void Redo(CMainFrame &MainFrm) override;
+	void RedoSelection(CMainFrame &MainFrm) override;
 };
 
 class CPActionReplaceInst : public CPSelectionAction
@@ -262,7 +305,7 @@ public:
 	CPActionReplaceInst(unsigned Index);
 private:
 	bool SaveState(const CMainFrame &MainFrm) override;
-	void Redo(CMainFrame &MainFrm) override;
+	void RedoSelection(CMainFrame &MainFrm) override;
 private:
 	unsigned m_iInstrumentIndex;
 };
@@ -275,6 +318,8 @@ private:
 	bool SaveState(const CMainFrame &MainFrm) override;
 	void Undo(CMainFrame &MainFrm) override;
 	void Redo(CMainFrame &MainFrm) override;
+	void ReleaseUndoData() override;		// // //
+	std::size_t GetMemoryUsage() const override;		// // //
 private:
 //	const CPatternClipData *m_pClipData;
 	CPatternClipData m_AuxiliaryClipData; // TODO: remove
@@ -293,6 +338,7 @@ private:
 	void Undo(CMainFrame &MainFrm) override;
 	void Redo(CMainFrame &MainFrm) override;
 	bool Merge(const CAction &Other) override;		// // //
+	module_block_set_t GetModifiedBlocks() const override;		// // //
 private:
 	int m_iOldPatternLen, m_iNewPatternLen;
 };
@@ -303,7 +349,7 @@ public:
 	CPActionStretch(const std::vector<int> &Stretch);
 private:
 	bool SaveState(const CMainFrame &MainFrm) override;
-	void Redo(CMainFrame &MainFrm) override;
+	void RedoSelection(CMainFrame &MainFrm) override;
 
 	std::vector<int> m_iStretchMap;
 };
@@ -317,6 +363,7 @@ private:
 	void Undo(CMainFrame &MainFrm) override;
 	void Redo(CMainFrame &MainFrm) override;
 	void UpdateViews(CMainFrame &MainFrm) const override;
+	module_block_set_t GetModifiedBlocks() const override;		// // //
 
 	unsigned m_iChannel;
 	unsigned m_iOldColumns, m_iNewColumns;
@@ -331,6 +378,7 @@ private:
 	void Undo(CMainFrame &MainFrm) override;
 	void Redo(CMainFrame &MainFrm) override;
 	void UpdateViews(CMainFrame &MainFrm) const override;
+	module_block_set_t GetModifiedBlocks() const override;		// // //
 
 	stHighlight m_OldHighlight, m_NewHighlight;
 };
@@ -343,6 +391,8 @@ private:
 	void Undo(CMainFrame &MainFrm) override;
 	void Redo(CMainFrame &MainFrm) override;
 	void UpdateViews(CMainFrame &MainFrm) const override;
+	std::size_t GetMemoryUsage() const override;		// // //
+	module_block_set_t GetModifiedBlocks() const override;		// // //
 
 	std::unique_ptr<CSongData> song_;
 	std::unique_ptr<CSongData> songNew_;
@@ -357,6 +407,8 @@ private:
 	void Undo(CMainFrame &MainFrm) override;
 	void Redo(CMainFrame &MainFrm) override;
 	void UpdateViews(CMainFrame &MainFrm) const override;
+	std::size_t GetMemoryUsage() const override;		// // //
+	module_block_set_t GetModifiedBlocks() const override;		// // //
 
 	std::unique_ptr<CSongData> song_;
 	std::unique_ptr<CSongData> songNew_;
@@ -0,0 +1,57 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2018 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+** Library General Public License for more details.  To obtain a
+** copy of the GNU Library General Public License, write to the Free
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+#include "PatternClipDelta.h"
+#include "PatternClipData.h"
+#include "Assertion.h"
+#include <algorithm>
+#include <utility>
+
+CPatternClipDelta::CPatternClipDelta(const CPatternClipData &Before, const CPatternClipData &After) :
+	m_iChannels(Before.ClipInfo.Channels), m_iRows(Before.ClipInfo.Rows)
+{
+	Assert(After.ClipInfo.Channels == m_iChannels);
+	Assert(After.ClipInfo.Rows == m_iRows);
+
+	const int Size = std::min(Before.Size, After.Size);
+	for (int i = 0; i < Size; ++i)
+		if (Before.pPattern[i] != After.pPattern[i])
+			m_Cells.push_back({static_cast<std::uint32_t>(i), Before.pPattern[i]});
+	m_Cells.shrink_to_fit();
+}
+
+void CPatternClipDelta::Exchange(CPatternClipData &ClipData) {
+	Assert(ClipData.ClipInfo.Channels == m_iChannels);
+	Assert(ClipData.ClipInfo.Rows == m_iRows);
+
+	for (auto &x : m_Cells)
+		if (x.Index < static_cast<std::uint32_t>(ClipData.Size))
+			std::swap(ClipData.pPattern[x.Index], x.Note);
+}
+
+std::size_t CPatternClipDelta::GetChangedCount() const {
+	return m_Cells.size();
+}
+
+std::size_t CPatternClipDelta::GetMemoryUsage() const {
+	return sizeof(CPatternClipDelta) + m_Cells.capacity() * sizeof(stCellDelta);
+}
@@ -0,0 +1,73 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2018 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+** Library General Public License for more details.  To obtain a
+** copy of the GNU Library General Public License, write to the Free
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include "PatternNote.h"
+
+class CPatternClipData;
+
+/*!
+	\brief Stores the cells that differ between two pattern clips of identical dimensions.
+	\details Cells that an action leaves unchanged are not copied at all; they are shared with
+	the document itself, which holds the same values both before and after the action. Only one
+	state of each changed cell is stored, namely the one not currently held by the document;
+	undoing and redoing exchange it with the document's contents.
+*/
+class CPatternClipDelta		// // //
+{
+public:
+	CPatternClipDelta() = default;
+
+	/*!	\brief Computes the delta between two clips.
+		\details The delta stores the changed cells of the region before the action.
+		\param Before Contents of the region before the action.
+		\param After Contents of the same region after the action. */
+	CPatternClipDelta(const CPatternClipData &Before, const CPatternClipData &After);
+
+	/*!	\brief Exchanges the stored cells with those of a clip.
+		\details Applied to a copy of the region after the action, this turns it into the region
+		before the action, and vice versa. Calls must alternate between both states.
+		\param ClipData Clip data with the same dimensions as the ones used to create the delta. */
+	void Exchange(CPatternClipData &ClipData);
+
+	/*!	\brief Obtains the number of cells recorded by the delta.
+		\return Changed cell count. */
+	std::size_t GetChangedCount() const;
+
+	/*!	\brief Obtains the approximate number of bytes held by the delta.
+		\return Memory usage in bytes. */
+	std::size_t GetMemoryUsage() const;
+
+private:
+	struct stCellDelta {
+		std::uint32_t Index;
+		stChanNote Note;
+	};
+
+	int m_iChannels = 0;
+	int m_iRows = 0;
+	std::vector<stCellDelta> m_Cells;
+};
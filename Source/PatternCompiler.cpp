@@ -32,7 +32,9 @@
 #include "InstrumentManager.h"		// // //
 #include "SongData.h"		// // //
 #include "NumConv.h"		// // //
+#include "array_view.h"		// // //
 #include <algorithm>		// // //
+#include <array>		// // //
 #include "FamiTrackerEnv.h"		// // //
 #include "SoundChipService.h"		// // //
 
@@ -126,6 +128,34 @@ enum command_t {
 
 const unsigned char CMD_LOOP_POINT = 26;	// Currently unused
 
+namespace {
+
+// // // Appends integer values to a cache key in little-endian order
+class CInputKey {
+public:
+	CInputKey &Put8(unsigned x) {
+		key_.push_back(static_cast<char>(x & 0xFFu));
+		return *this;
+	}
+	CInputKey &Put32(std::uint32_t x) {
+		for (int i = 0; i < 4; ++i)
+			Put8(x >> (i * 8));
+		return *this;
+	}
+	CInputKey &PutBytes(array_view<unsigned char> x) {
+		key_.append(reinterpret_cast<const char *>(x.data()), x.size());
+		return *this;
+	}
+	std::string Get() && {
+		return std::move(key_);
+	}
+
+private:
+	std::string key_;
+};
+
+} // namespace
+
 CPatternCompiler::CPatternCompiler(const CFamiTrackerModule &ModFile, const std::vector<unsigned> &InstList, const DPCM_List_t *pDPCMList, std::shared_ptr<CCompilerLog> pLogger) :		// // //
 	m_iInstrumentList(InstList),
 	m_pDPCMList(pDPCMList),
@@ -149,10 +179,9 @@ void CPatternCompiler::CompileData(int Track, int Pattern, stChannelID Channel)
 	// Global init
 	m_iHash = 0;
 	m_iDuration = 0;
-	m_iCurrentDefaultDuration = 0xFF;
-
 	m_vData.clear();
 	m_vCompressedData.clear();
+	m_vDurationPos.clear();		// // //
 
 	// Local init
 	unsigned int iPatternLen = pSong->GetPatternLength();
@@ -199,40 +228,6 @@ void CPatternCompiler::CompileData(int Track, int Pattern, stChannelID Channel)
 			}
 		}
 
-#ifdef OPTIMIZE_DURATIONS
-
-		// Determine length of space between notes
-		stSpacingInfo SpaceInfo = ScanNoteLengths(Track, i, Pattern, Channel);		// // //
-
-		if (SpaceInfo.SpaceCount > 2) {
-			if (SpaceInfo.SpaceSize != m_iCurrentDefaultDuration && SpaceInfo.SpaceCount != 0xFF) {
-				// Enable compressed durations
-				WriteDuration();
-				m_iCurrentDefaultDuration = SpaceInfo.SpaceSize;
-				WriteData(Command(CMD_SET_DURATION));
-				WriteData(m_iCurrentDefaultDuration);
-			}
-		}
-		else {
-			if (m_iCurrentDefaultDuration != 0xFF && m_iCurrentDefaultDuration != SpaceInfo.SpaceSize) {
-				// Disable compressed durations
-				WriteDuration();
-				m_iCurrentDefaultDuration = 0xFF;
-				WriteData(Command(CMD_RESET_DURATION));
-			}
-		}
-
-#endif /* OPTIMIZE_DURATIONS */
-/*
-		if (SpaceInfo.SpaceCount > 2 && SpaceInfo.SpaceSize != CurrentDefaultDuration) {
-			CurrentDefaultDuration = SpaceInfo.SpaceSize;
-			WriteData(CMD_SET_DURATION);
-			WriteData(CurrentDefaultDuration);
-		}
-		else if (SpaceInfo.SpaceCount < 2 && SpaceInfo.SpaceSize == CurrentDefaultDuration) {
-		}
-		else
-*/
 		if (Note != note_t::halt && Note != note_t::release) {		// // //
 			if (Instrument != LastInstrument && Instrument < MAX_INSTRUMENTS) {
 				LastInstrument = Instrument;
@@ -650,9 +645,64 @@ void CPatternCompiler::CompileData(int Track, int Pattern, stChannelID Channel)
 
 	WriteDuration();
 
+#ifdef OPTIMIZE_DURATIONS
+	OptimizeDurations();		// // //
+#endif /* OPTIMIZE_DURATIONS */
 //	OptimizeString();
 }
 
+std::string CPatternCompiler::GetCacheKey(int Track, int Pattern, stChannelID Channel) const {		// // //
+	const auto *pSong = modfile_.GetSong(Track);
+	if (!pSong)
+		return { };
+	const auto *pInstManager = modfile_.GetInstrumentManager();
+
+	const int EffColumns = pSong->GetEffectColumnCount(Channel);
+	const unsigned int iPatternLen = pSong->GetPatternLength();
+
+	CInputKey k;
+	k.Put32(Channel.ToInteger()).Put32(Pattern);		// pattern index appears in messages
+	k.Put8(modfile_.GetSoundChipSet().GetNSFFlag()).Put32(modfile_.GetSpeedSplitPoint()).Put8(modfile_.GetLinearPitch());
+	k.Put8(pSong->GetSongTempo() != 0u).Put32(iPatternLen).Put8(EffColumns);
+	for (unsigned i = 0; i < MAX_GROOVE; ++i) {
+		const auto pGroove = modfile_.GetGroove(i);
+		k.Put32(pGroove ? pGroove->compiled_size() : 0u);
+	}
+
+	bool DPCMInstUsed[MAX_INSTRUMENTS] = {true};		// DPCM notes before the first instrument use instrument 0
+	const auto &pattern = pSong->GetPattern(Channel, Pattern);
+	for (unsigned int i = 0; i < iPatternLen; ++i) {
+		const stChanNote &ChanNote = pattern.GetNoteOn(i);
+		k.Put8(value_cast(ChanNote.Note)).Put8(ChanNote.Octave).Put8(ChanNote.Vol).Put8(ChanNote.Instrument).Put8(FindInstrument(ChanNote.Instrument));
+		if (ChanNote.Instrument != MAX_INSTRUMENTS && ChanNote.Instrument != HOLD_INSTRUMENT) {
+			k.Put8(pInstManager->GetInstrumentType(ChanNote.Instrument));
+			if (ChanNote.Instrument < MAX_INSTRUMENTS)
+				DPCMInstUsed[ChanNote.Instrument] = true;
+		}
+		for (int j = 0; j < EffColumns; ++j)
+			k.Put8(value_cast(ChanNote.Effects[j].fx)).Put8(ChanNote.Effects[j].param);
+	}
+
+	// sample lookups of every instrument the DPCM channel may select
+	if (IsDPCM(Channel) && m_pDPCMList)
+		for (unsigned i = 0; i < MAX_INSTRUMENTS; ++i)
+			if (DPCMInstUsed[i])
+				k.Put8(i).PutBytes((*m_pDPCMList)[i]);
+
+	return std::move(k).Get();
+}
+
+std::uint32_t CPatternCompiler::GetBuildFlags() {		// // //
+	return 0u
+#ifdef OPTIMIZE_DURATIONS
+		| 0x01u
+#endif /* OPTIMIZE_DURATIONS */
+#ifdef PACKED_INST_CHANGE
+		| 0x02u
+#endif /* PACKED_INST_CHANGE */
+		;
+}
+
 unsigned char CPatternCompiler::Command(int cmd) const {
 	CSoundChipSet Chip = modfile_.GetSoundChipSet();		// // //
 
@@ -689,51 +739,6 @@ unsigned int CPatternCompiler::FindSample(int Instrument, int MidiNote) const		/
 	return (*m_pDPCMList)[Instrument][MidiNote];
 }
 
-CPatternCompiler::stSpacingInfo CPatternCompiler::ScanNoteLengths(int Track, unsigned int StartRow, int Pattern, stChannelID Channel) {		// // //
-	const auto *pSong = modfile_.GetSong(Track);		// // //
-	if (!pSong)
-		return { };
-
-	int StartSpace = -1, Space = 0, SpaceCount = 0;
-
-	for (unsigned i = StartRow; i < pSong->GetPatternLength(); ++i) {
-		const auto &NoteData = pSong->GetPattern(Channel, Pattern).GetNoteOn(i);		// // //
-		bool NoteUsed = false;
-
-		if (NoteData.Note != note_t::none)
-			NoteUsed = true;
-		else if (NoteData.Instrument < MAX_INSTRUMENTS || NoteData.Instrument == HOLD_INSTRUMENT)		// // //
-			NoteUsed = true;
-		else if (NoteData.Vol < MAX_VOLUME)
-			NoteUsed = true;
-		else for (unsigned j = 0, Count = pSong->GetEffectColumnCount(Channel); j < Count; ++j)
-			if (NoteData.Effects[j].fx != effect_t::none)
-				NoteUsed = true;
-
-		if (i == StartRow && !NoteUsed)
-			return {0xFF, StartSpace};
-
-		if (i > StartRow) {
-			if (NoteUsed) {
-				if (StartSpace == -1)
-					StartSpace = Space;
-				else if (StartSpace == Space)
-					++SpaceCount;
-				else
-					return {SpaceCount, StartSpace};
-				Space = 0;
-			}
-			else
-				++Space;
-		}
-	}
-
-	if (StartSpace == Space)
-		++SpaceCount;
-
-	return {SpaceCount, StartSpace};
-}
-
 void CPatternCompiler::WriteData(unsigned char Value)
 {
 	m_vData.push_back(Value);
@@ -749,16 +754,101 @@ void CPatternCompiler::AccumulateDuration()
 
 void CPatternCompiler::WriteDuration()
 {
-	if (m_iCurrentDefaultDuration == 0xFF) {
-		if (!m_vData.size() && m_iDuration > 0)
-			WriteData(0x00);
-		if (m_iDuration > 0)
-			WriteData(m_iDuration - 1);
+	if (!m_vData.size() && m_iDuration > 0)
+		WriteData(0x00);
+	if (m_iDuration > 0) {
+		m_vDurationPos.push_back(m_vData.size());		// // //
+		WriteData(m_iDuration - 1);
 	}
 
 	m_iDuration = 0;
 }
 
+void CPatternCompiler::OptimizeDurations()		// // //
+{
+	// Every note is followed by its duration byte unless a fixed duration has been enabled with
+	// CMD_SET_DURATION. Find the cheapest placement of the duration commands: after each note
+	// the fixed duration is either disabled or equal to that note's duration, so only these two
+	// states are tracked.
+
+	const std::size_t Count = m_vDurationPos.size();
+	if (!Count)
+		return;
+
+	const unsigned char NO_DURATION = 0xFF;		// disabled value in the driver
+	const unsigned INF = 0x10000;
+
+	const unsigned char EXPLICIT = 0, FIXED = 1;
+	std::vector<std::array<unsigned char, 2>> Parent(Count);
+	unsigned Cost[2] = {0, INF};
+
+	for (std::size_t i = 0; i < Count; ++i) {
+		const unsigned char Duration = m_vData[m_vDurationPos[i]];
+		const bool Same = i && m_vData[m_vDurationPos[i - 1]] == Duration;
+		unsigned Next[2];
+
+		// duration byte, preceded by CMD_RESET_DURATION when leaving fixed durations
+		Next[EXPLICIT] = Cost[EXPLICIT] + 1;
+		Parent[i][EXPLICIT] = EXPLICIT;
+		if (Cost[FIXED] + 2 < Next[EXPLICIT]) {
+			Next[EXPLICIT] = Cost[FIXED] + 2;
+			Parent[i][EXPLICIT] = FIXED;
+		}
+
+		// no duration byte, preceded by CMD_SET_DURATION unless the duration is already fixed
+		Next[FIXED] = INF;
+		if (Duration != NO_DURATION) {
+			Next[FIXED] = Cost[EXPLICIT] + 2;
+			Parent[i][FIXED] = EXPLICIT;
+			if (Cost[FIXED] + (Same ? 0 : 2) < Next[FIXED]) {
+				Next[FIXED] = Cost[FIXED] + (Same ? 0 : 2);
+				Parent[i][FIXED] = FIXED;
+			}
+		}
+
+		Cost[EXPLICIT] = Next[EXPLICIT];
+		Cost[FIXED] = Next[FIXED];
+	}
+
+	std::vector<unsigned char> State(Count);
+	unsigned char s = Cost[FIXED] < Cost[EXPLICIT] ? FIXED : EXPLICIT;
+	for (std::size_t i = Count; i-- > 0; ) {
+		State[i] = s;
+		s = Parent[i][s];
+	}
+
+	// Rewrite the pattern data
+	const auto Data = std::move(m_vData);
+	m_vData.clear();
+	m_iHash = 0;
+
+	std::size_t Pos = 0;
+	for (std::size_t i = 0; i < Count; ++i) {
+		const std::size_t NotePos = m_vDurationPos[i] - 1;
+		const unsigned char Duration = Data[m_vDurationPos[i]];
+		const unsigned char Prev = i ? State[i - 1] : EXPLICIT;
+		while (Pos < NotePos)
+			WriteData(Data[Pos++]);
+
+		if (State[i] == FIXED) {
+			if (Prev == EXPLICIT || Data[m_vDurationPos[i - 1]] != Duration) {
+				WriteData(Command(CMD_SET_DURATION));
+				WriteData(Duration);
+			}
+			WriteData(Data[NotePos]);
+		}
+		else {
+			if (Prev == FIXED)
+				WriteData(Command(CMD_RESET_DURATION));
+			WriteData(Data[NotePos]);
+			WriteData(Duration);
+		}
+		Pos = m_vDurationPos[i] + 1;
+	}
+	while (Pos < Data.size())
+		WriteData(Data[Pos++]);
+}
+
 // Returns the size of the block at 'position' in the data array. A block is terminated by a note
 int CPatternCompiler::GetBlockSize(int Position)
 {
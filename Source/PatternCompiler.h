@@ -27,7 +27,9 @@
 #include "FamiTrackerDefines.h"		// // //
 #include "APU/Types_fwd.h"		// // //
 #include <memory>		// // //
+#include <string>		// // //
 #include <string_view>		// // //
+#include <cstdint>		// // //
 
 class CFamiTrackerModule;		// // //
 class CCompilerLog;
@@ -42,6 +44,18 @@ public:
 
 	void			CompileData(int Track, int Pattern, stChannelID Channel);
 
+	/*!	\brief Serializes every input that CompileData reads for a pattern.
+		\details Two patterns with equal keys compile to the same data and messages with the same
+		compiler build, which allows compiled patterns to be cached across exports.
+		\param Track The track index.
+		\param Pattern The pattern index.
+		\param Channel The channel identifier.
+		\return The pattern cells and their instrument and effect context as a byte string. */
+	std::string		GetCacheKey(int Track, int Pattern, stChannelID Channel) const;		// // //
+
+	/*!	\brief Obtains the compile-time options that affect the generated pattern data. */
+	static std::uint32_t GetBuildFlags();		// // //
+
 	unsigned int	GetHash() const;
 	bool			CompareData(const std::vector<unsigned char> &data) const;		// // //
 
@@ -51,12 +65,6 @@ public:
 	unsigned int	GetDataSize() const;
 	unsigned int	GetCompressedDataSize() const;
 
-private:
-	struct stSpacingInfo {
-		int SpaceCount = 0;
-		int SpaceSize = 0;
-	};
-
 private:
 	unsigned int	FindInstrument(int Instrument) const;
 	unsigned int	FindSample(int Instrument, int MidiNote) const;		// // //
@@ -66,9 +74,9 @@ private:
 	void			WriteData(unsigned char Value);
 	void			WriteDuration();
 	void			AccumulateDuration();
+	void			OptimizeDurations();		// // //
 	void			OptimizeString();
 	int				GetBlockSize(int Position);
-	stSpacingInfo	ScanNoteLengths(int Track, unsigned int StartRow, int Pattern, stChannelID Channel);		// // //
 
 	// Debugging
 	void			Print(std::string_view text) const;		// // //
@@ -76,9 +84,9 @@ private:
 private:
 	std::vector<unsigned char> m_vData;		// // //
 	std::vector<unsigned char> m_vCompressedData;
+	std::vector<std::size_t> m_vDurationPos;		// // // positions of note duration bytes
 
 	unsigned int	m_iDuration;
-	unsigned int	m_iCurrentDefaultDuration;
 	bool			m_bDSamplesAccessed[OCTAVE_RANGE * NOTE_RANGE] = { }; // <- check the range, its not optimal right now
 	unsigned int	m_iHash;
 	const std::vector<unsigned> &m_iInstrumentList;		// // //
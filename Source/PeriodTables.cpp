@@ -23,17 +23,146 @@
 #include "PeriodTables.h"
 #include "DetuneTable.h"
 #include "Assertion.h"
+#include "APU/Types.h"		// // //
+#include <algorithm>		// // //
+#include <tuple>		// // //
+#include <cmath>		// // //
 
 unsigned CPeriodTables::ReadTable(int Index, int Table) const {
-	switch (Table) {
-	case CDetuneTable::DETUNE_NTSC: return ntsc_period[Index]; break;
-	case CDetuneTable::DETUNE_PAL:  return pal_period[Index]; break;
-	case CDetuneTable::DETUNE_SAW:  return saw_period[Index]; break;
-	case CDetuneTable::DETUNE_VRC7: return vrc7_freq[Index]; break;
-	case CDetuneTable::DETUNE_FDS:  return fds_freq[Index]; break;
-	case CDetuneTable::DETUNE_N163: return n163_freq[Index]; break;
-	case CDetuneTable::DETUNE_S5B:  return s5b_period[Index]; break;
+	const auto GetTable = [&] () -> const std::shared_ptr<const table_t> & {		// // //
+		switch (Table) {
+		case CDetuneTable::DETUNE_NTSC: return ntsc_period;
+		case CDetuneTable::DETUNE_PAL:  return pal_period;
+		case CDetuneTable::DETUNE_SAW:  return saw_period;
+		case CDetuneTable::DETUNE_VRC7: return vrc7_freq;
+		case CDetuneTable::DETUNE_FDS:  return fds_freq;
+		case CDetuneTable::DETUNE_N163: return n163_freq;
+		case CDetuneTable::DETUNE_S5B:  return s5b_period;
+		}
+		DEBUG_BREAK();
+		return ntsc_period;
+	};
+
+	const auto &pTable = GetTable();
+	return pTable ? (*pTable)[Index] : 0u;
+}
+
+// // // CPeriodTableCache
+
+bool CPeriodTableCache::stKey::operator<(const stKey &other) const {
+	return std::tie(Table, Semitone, Cent, NamcoChannels, Detune) <
+		std::tie(other.Table, other.Semitone, other.Cent, other.NamcoChannels, other.Detune);
+}
+
+CPeriodTableCache &CPeriodTableCache::GetInstance() {
+	static CPeriodTableCache cache;
+	return cache;
+}
+
+std::shared_ptr<const CPeriodTables::table_t>
+CPeriodTableCache::GetTable(int Table, int Semitone, int Cent, int NamcoChannels, array_view<int> Detune) {
+	stKey Key {Table, Semitone, Cent, Table == CDetuneTable::DETUNE_N163 ? NamcoChannels : 0, { }};
+	std::copy_n(Detune.begin(), std::min(Detune.size(), Key.Detune.size()), Key.Detune.begin());
+
+	std::lock_guard<std::mutex> lock {m_Lock};
+	auto &pEntry = m_Tables[Key];
+	if (auto pTable = pEntry.lock())
+		return pTable;
+
+	// Drop tables which are no longer used by anyone
+	for (auto it = m_Tables.begin(); it != m_Tables.end(); )
+		if (it->second.expired() && &it->second != &pEntry)
+			it = m_Tables.erase(it);
+		else
+			++it;
+
+	auto pTable = std::make_shared<const CPeriodTables::table_t>(MakeTable(Key));
+	pEntry = pTable;
+	return pTable;
+}
+
+const std::array<int, 256> &CPeriodTableCache::GetVibratoTable(bool Bidir) {
+	static const auto MakeVibratoTable = [] (bool Bidir) {
+		const double NEW_VIBRATO_DEPTH[] = {
+			0.0, 1.5, 2.5, 4.0, 5.0, 7.0, 10.0, 12.0, 14.0, 17.0, 22.0, 30.0, 44.0, 64.0, 96.0, 128.0,
+		};
+
+		const double OLD_VIBRATO_DEPTH[] = {
+			0.0, 1.0, 2.0, 3.0, 4.0, 7.0, 8.0, 15.0, 16.0, 31.0, 32.0, 63.0, 64.0, 127.0, 128.0, 255.0,
+		};
+
+		std::array<int, 256> table = { };
+		const double PI = std::acos(-1);
+
+		for (int depth = 0; depth < 16; ++depth) {
+			for (int phase = 0; phase < 16; ++phase) {
+				auto t = (double)phase;
+				table[depth * 16 + phase] = (int)(Bidir ?
+					(std::sin(t * PI / 32.) * NEW_VIBRATO_DEPTH[depth] /*+ .5*/) :
+					(t * OLD_VIBRATO_DEPTH[depth] / 16. + 1.));
+			}
+		}
+
+		return table;
+	};
+
+	static const std::array<int, 256> TABLES[] = {MakeVibratoTable(false), MakeVibratoTable(true)};
+	return TABLES[Bidir ? 1 : 0];
+}
+
+CPeriodTables::table_t CPeriodTableCache::MakeTable(const stKey &Key) {
+	CPeriodTables::table_t table = { };
+
+	const double A440_NOTE = 45. - Key.Semitone - Key.Cent / 100.;
+	const double clock_ntsc = MASTER_CLOCK_NTSC / 16.;
+	const double clock_pal  = MASTER_CLOCK_PAL / 16.;
+
+	for (int i = 0; i < NOTE_COUNT; ++i) {
+		// Frequency (in Hz)
+		double Freq = 440. * std::pow(2.0, (i - A440_NOTE) / 12.);
+		double Pitch;
+
+		switch (Key.Table) {
+		case CDetuneTable::DETUNE_PAL:
+			// 2A07
+			Pitch = (clock_pal / Freq) - 0.5;
+			table[i] = (unsigned int)(Pitch - Key.Detune[i]);
+			break;
+		case CDetuneTable::DETUNE_NTSC:
+		case CDetuneTable::DETUNE_S5B:
+			// 2A03 / MMC5 / VRC6
+			Pitch = (clock_ntsc / Freq) - 0.5;
+			table[i] = (unsigned int)(Pitch - Key.Detune[i]);
+			if (Key.Table == CDetuneTable::DETUNE_S5B)
+				++table[i];		// correction
+			break;
+		case CDetuneTable::DETUNE_SAW:
+			// VRC6 Saw
+			Pitch = ((clock_ntsc * 16.0) / (Freq * 14.0)) - 0.5;
+			table[i] = (unsigned int)(Pitch - Key.Detune[i]);
+			break;
+		case CDetuneTable::DETUNE_FDS:
+			// FDS
+			Pitch = (Freq * 65536.0) / (clock_ntsc / 1.0) + 0.5;
+			table[i] = (unsigned int)(Pitch + Key.Detune[i]);
+			break;
+		case CDetuneTable::DETUNE_N163:
+			// N163
+			Pitch = ((Freq * Key.NamcoChannels * 983040.0) / clock_ntsc + 0.5) / 4;
+			table[i] = (unsigned int)(Pitch + Key.Detune[i]);
+			if (table[i] > 0xFFFF)	// 0x3FFFF
+				table[i] = 0xFFFF;	// 0x3FFFF
+			break;
+		case CDetuneTable::DETUNE_VRC7:
+			if (i < NOTE_RANGE) {
+				Pitch = Freq * 262144.0 / 49716.0 + 0.5;
+				unsigned Reg = (unsigned int)(Pitch + Key.Detune[i]);
+				for (int j = 0; j < OCTAVE_RANGE; ++j)
+					table[i + j * NOTE_RANGE] = Reg;
+			}
+			break;
+		}
 	}
-	DEBUG_BREAK();
-	return ntsc_period[Index];
+
+	return table;
 }
@@ -24,17 +24,68 @@
 #pragma once
 
 #include "FamiTrackerDefines.h"
+#include "array_view.h"		// // //
+#include <array>		// // //
+#include <memory>		// // //
+#include <map>		// // //
+#include <mutex>		// // //
 
 // // // TODO: use CDetuneTable eventually
 
 struct CPeriodTables {
-	unsigned ntsc_period[NOTE_COUNT] = { };
-	unsigned pal_period[NOTE_COUNT] = { };
-	unsigned saw_period[NOTE_COUNT] = { };
-	unsigned vrc7_freq[NOTE_COUNT] = { };
-	unsigned fds_freq[NOTE_COUNT] = { };
-	unsigned n163_freq[NOTE_COUNT] = { };
-	unsigned s5b_period[NOTE_COUNT] = { };
+	using table_t = std::array<unsigned, NOTE_COUNT>;		// // //
+
+	// // // immutable tables shared through CPeriodTableCache
+	std::shared_ptr<const table_t> ntsc_period;
+	std::shared_ptr<const table_t> pal_period;
+	std::shared_ptr<const table_t> saw_period;
+	std::shared_ptr<const table_t> vrc7_freq;
+	std::shared_ptr<const table_t> fds_freq;
+	std::shared_ptr<const table_t> n163_freq;
+	std::shared_ptr<const table_t> s5b_period;
 
 	unsigned ReadTable(int Index, int Table) const;
 };
+
+/*!
+	\brief A process-wide cache of period tables.
+	\details Every chip's period table is looked up separately, keyed by the tuning and that chip's
+	detune offsets, so changing the detune offsets of one chip only rebuilds the period table of
+	that chip. Sound drivers playing modules with identical settings share the same table objects.
+	A table is kept for as long as a CPeriodTables object refers to it.
+*/
+class CPeriodTableCache {
+public:
+	static CPeriodTableCache &GetInstance();
+
+	/*!	\brief Obtains a period table, building it if it is not in the cache.
+		\param Table The detune table type, as defined in CDetuneTable.
+		\param Semitone The tuning offset in semitones.
+		\param Cent The tuning offset in cents.
+		\param NamcoChannels The number of N163 channels, only used by the N163 table.
+		\param Detune The detune offsets of the chip, one for each note.
+		\return A pointer to the period table. */
+	std::shared_ptr<const CPeriodTables::table_t> GetTable(int Table, int Semitone, int Cent,
+		int NamcoChannels, array_view<int> Detune);
+
+	/*!	\brief Obtains the vibrato table for a vibrato style.
+		\param Bidir True for the new vibrato style, false for the old style. */
+	static const std::array<int, 256> &GetVibratoTable(bool Bidir);
+
+private:
+	CPeriodTableCache() = default;
+
+	struct stKey {
+		int Table;
+		int Semitone;
+		int Cent;
+		int NamcoChannels;
+		std::array<int, NOTE_COUNT> Detune;
+		bool operator<(const stKey &other) const;
+	};
+
+	static CPeriodTables::table_t MakeTable(const stKey &Key);
+
+	std::mutex m_Lock;
+	std::map<stKey, std::weak_ptr<const CPeriodTables::table_t>> m_Tables;
+};
@@ -94,18 +94,23 @@ void CSeqInstHandler::UpdateInstrument()
 	for (auto &[_, info] : m_SequenceInfo) {
 		(void)_;
 		const auto &pSeq = info.m_pSequence;
-		if (!pSeq || pSeq->GetItemCount() == 0)
+		if (!pSeq)
+			continue;
+		if (!info.m_Envelope.IsCompiled(*pSeq))		// // //
+			info.m_Envelope.Compile(*pSeq);
+		const CSequenceEnvelope &Env = info.m_Envelope;
+		if (Env.GetItemCount() == 0)
 			continue;
 		switch (info.m_iSeqState) {
 		case seq_state_t::Running:
-			ProcessSequence(*pSeq, info.m_iSeqPointer);
+			ProcessSequence(Env, info.m_iSeqPointer);
 			info.Step(m_pInterface->IsReleasing());
 			break;
 
 		case seq_state_t::End:
-			switch (pSeq->GetSequenceType()) {
+			switch (Env.GetSequenceType()) {
 			case sequence_t::Arpeggio:
-				if (pSeq->GetSetting() == SETTING_ARP_FIXED)
+				if (Env.GetSetting() == SETTING_ARP_FIXED)
 					m_pInterface->SetPeriod(m_pInterface->TriggerNote(m_pInterface->GetNote()));
 				break;
 			}
@@ -122,12 +127,12 @@ void CSeqInstHandler::UpdateInstrument()
 	}
 }
 
-bool CSeqInstHandler::ProcessSequence(const CSequence &Seq, int Pos)
+bool CSeqInstHandler::ProcessSequence(const CSequenceEnvelope &Env, int Pos)		// // //
 {
-	int Value = Seq.GetItem(Pos);
-	seq_setting_t Setting = Seq.GetSetting();
+	int Value = Env.GetValue(Pos);
+	seq_setting_t Setting = Env.GetSetting();
 
-	switch (Seq.GetSequenceType()) {
+	switch (Env.GetSequenceType()) {
 	// Volume modifier
 	case sequence_t::Volume:
 		m_pInterface->SetVolume(Value);
@@ -146,20 +151,16 @@ bool CSeqInstHandler::ProcessSequence(const CSequence &Seq, int Pos)
 			m_pInterface->SetPeriod(m_pInterface->TriggerNote(m_pInterface->GetNote()));
 			return true;
 		case SETTING_ARP_SCHEME:		// // //
-			if (Value < 0) Value += 256;
-			int lim = Value % 0x40, scheme = Value / 0x40;
-			if (lim > ARPSCHEME_MAX)
-				lim -= 64;
 			{
 				unsigned char Param = m_pInterface->GetArpParam();
-				switch (scheme) {
-				case 0: break;
-				case 1: lim += Param >> 4;   break;
-				case 2: lim += Param & 0x0F; break;
-				case 3: lim -= Param & 0x0F; break;
+				switch (Env.GetSchemeMode(Pos)) {
+				case arp_scheme_mode_t::none: break;
+				case arp_scheme_mode_t::X:    Value += Param >> 4;   break;
+				case arp_scheme_mode_t::Y:    Value += Param & 0x0F; break;
+				case arp_scheme_mode_t::NegY: Value -= Param & 0x0F; break;
 				}
 			}
-			m_pInterface->SetPeriod(m_pInterface->TriggerNote(m_pInterface->GetNote() + lim));
+			m_pInterface->SetPeriod(m_pInterface->TriggerNote(m_pInterface->GetNote() + Value));
 			return true;
 		}
 		return false;
@@ -188,7 +189,12 @@ bool CSeqInstHandler::ProcessSequence(const CSequence &Seq, int Pos)
 
 void CSeqInstHandler::SetupSequence(sequence_t Index, std::shared_ptr<const CSequence> pSequence)		// // //
 {
-	m_SequenceInfo[Index] = {std::move(pSequence), seq_state_t::Running, 0};
+	auto &info = m_SequenceInfo[Index];
+	info.m_pSequence = std::move(pSequence);
+	info.m_iSeqState = seq_state_t::Running;
+	info.m_iSeqPointer = 0;
+	if (info.m_pSequence)
+		info.m_Envelope.Compile(*info.m_pSequence);		// // //
 }
 
 void CSeqInstHandler::ClearSequence(sequence_t Index)
@@ -214,27 +220,15 @@ void CSeqInstHandler::seq_info_t::Release() {
 }
 
 void CSeqInstHandler::seq_info_t::Step(bool isReleasing) {
-	++m_iSeqPointer;
-	int Release = m_pSequence->GetReleasePoint();
-	int Items = m_pSequence->GetItemCount();
-	int Loop = m_pSequence->GetLoopPoint();
-	if (m_iSeqPointer == (Release + 1) || m_iSeqPointer >= Items) {
-		// End point reached
-		if (Loop != -1 && !(isReleasing && Release != -1) && Loop < Release) {		// // //
-			m_iSeqPointer = Loop;
-		}
-		else if (m_iSeqPointer >= Items) {
-			// End of sequence
-			if (Loop >= Release && Loop != -1)		// // //
-				m_iSeqPointer = Loop;
-			else
-				m_iSeqState = seq_state_t::End;
-		}
-		else if (!isReleasing) {
-			// Waiting for release
-			--m_iSeqPointer;
-		}
+	// // // loop and release points are resolved by the compiled envelope
+	int Next = m_Envelope.GetNext(m_iSeqPointer, isReleasing);
+	if (Next == CSequenceEnvelope::END) {
+		// End of sequence
+		++m_iSeqPointer;
+		m_iSeqState = seq_state_t::End;
 	}
+	else
+		m_iSeqPointer = Next;
 #ifndef FT0CC_EXT_BUILD
 	FTEnv.GetSoundGenerator()->SetSequencePlayPos(m_pSequence, m_iSeqPointer);
 #endif
@@ -24,7 +24,7 @@
 #pragma once
 
 #include "InstHandler.h"
-#include "Sequence.h"
+#include "SequenceEnvelope.h"		// // //
 #include <unordered_map>
 
 class CSeqInstrument;
@@ -60,9 +60,9 @@ public:
 protected:
 	/*!	\brief Processes the value retrieved from a sequence.
 		\return True if the sequence has finished processing.
-		\param Seq Reference to the sequence.
+		\param Env Reference to the compiled sequence.
 		\param Pos Sequence position. */
-	virtual bool ProcessSequence(const CSequence &Seq, int Pos);
+	virtual bool ProcessSequence(const CSequenceEnvelope &Env, int Pos);		// // //
 
 	/*!	\brief Prepares a sequence type for use by CSeqInstHandler::UpdateInstrument.
 		\param Index The sequence type.
@@ -86,6 +86,8 @@ protected:
 		seq_state_t m_iSeqState = seq_state_t::Disabled;
 		/*!	\brief Tick index of the current sequence type. */
 		int m_iSeqPointer = 0;
+		/*!	\brief Compiled form of the sequence, rebuilt whenever the sequence is modified. */
+		CSequenceEnvelope m_Envelope;		// // //
 	};
 	/*! \brief Sequence states for the default sequence types. */
 	std::unordered_map<sequence_t, seq_info_t> m_SequenceInfo;
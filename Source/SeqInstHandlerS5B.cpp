@@ -24,15 +24,15 @@
 #include "ChannelHandlerInterface.h"
 #include "Sequence.h"
 
-bool CSeqInstHandlerS5B::ProcessSequence(const CSequence &Seq, int Pos)
+bool CSeqInstHandlerS5B::ProcessSequence(const CSequenceEnvelope &Env, int Pos)		// // //
 {
-	switch (Seq.GetSequenceType()) {
+	switch (Env.GetSequenceType()) {
 	case sequence_t::DutyCycle:
 		if (auto pChan = dynamic_cast<CChannelHandlerInterfaceS5B *>(m_pInterface)) {
-			m_pInterface->SetDutyPeriod(Seq.GetItem(Pos) & 0xE0);
-			pChan->SetNoiseFreq(Seq.GetItem(Pos) & 0x1F);
+			m_pInterface->SetDutyPeriod(Env.GetValue(Pos) & 0xE0);
+			pChan->SetNoiseFreq(Env.GetValue(Pos) & 0x1F);
 			return true;
 		}
 	}
-	return CSeqInstHandler::ProcessSequence(Seq, Pos);
+	return CSeqInstHandler::ProcessSequence(Env, Pos);
 }
@@ -23,6 +23,15 @@
 #include "Sequence.h"
 #include <stdexcept>		// // //
 #include <algorithm>		// // //
+#include <atomic>		// // //
+
+namespace {
+
+// // // Revisions are unique across all sequences, so copies of a sequence share a revision only
+// while their contents are equal
+std::atomic<unsigned int> LastRevision {0u};
+
+} // namespace
 
 bool CSequence::operator==(const CSequence &other)		// // //
 {
@@ -37,12 +46,14 @@ bool CSequence::operator==(const CSequence &other)		// // //
 void CSequence::Clear() {
 	SetItemCount(0);		// // //
 	m_cValues.fill(0);
+	m_iRevision = ++LastRevision;		// // //
 	SetSetting(SETTING_DEFAULT);
 }
 
 void CSequence::SetItem(int Index, int8_t Value)		// // //
 {
 	m_cValues[Index] = Value;
+	m_iRevision = ++LastRevision;		// // //
 }
 
 void CSequence::SetItemCount(unsigned int Count)
@@ -53,6 +64,7 @@ void CSequence::SetItemCount(unsigned int Count)
 #endif
 
 	m_iItemCount = Count;
+	m_iRevision = ++LastRevision;		// // //
 
 	if (m_iLoopPoint >= m_iItemCount)
 		m_iLoopPoint = -1;
@@ -63,6 +75,7 @@ void CSequence::SetItemCount(unsigned int Count)
 void CSequence::SetLoopPoint(unsigned int Point)
 {
 	m_iLoopPoint = Point;
+	m_iRevision = ++LastRevision;		// // //
 	if (m_iLoopPoint >= m_iItemCount)		// // //
 		m_iLoopPoint = -1;
 }
@@ -70,6 +83,7 @@ void CSequence::SetLoopPoint(unsigned int Point)
 void CSequence::SetReleasePoint(unsigned int Point)
 {
 	m_iReleasePoint = Point;
+	m_iRevision = ++LastRevision;		// // //
 	if (m_iReleasePoint >= m_iItemCount)		// // //
 		m_iReleasePoint = -1;
 }
@@ -77,10 +91,12 @@ void CSequence::SetReleasePoint(unsigned int Point)
 void CSequence::SetSetting(seq_setting_t Setting)		// // //
 {
 	m_iSetting = Setting;
+	m_iRevision = ++LastRevision;		// // //
 }
 
 void CSequence::SetSequenceType(sequence_t SeqType) {		// // //
 	seq_type_ = SeqType;
+	m_iRevision = ++LastRevision;		// // //
 }
 
 int8_t CSequence::GetItem(int Index) const		// // //
@@ -111,3 +127,7 @@ seq_setting_t CSequence::GetSetting() const		// // //
 sequence_t CSequence::GetSequenceType() const {		// // //
 	return seq_type_;
 }
+
+unsigned int CSequence::GetRevision() const {		// // //
+	return m_iRevision;
+}
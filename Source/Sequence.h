@@ -117,6 +117,7 @@ public:
 	unsigned int GetReleasePoint() const;
 	seq_setting_t GetSetting() const;		// // //
 	sequence_t	 GetSequenceType() const;		// // //
+	unsigned int GetRevision() const;		// // // unique to the current contents, kept by copies
 	void		 SetItem(int Index, int8_t Value);		// // //
 	void		 SetItemCount(unsigned int Count);
 	void		 SetLoopPoint(unsigned int Point);
@@ -131,5 +132,6 @@ private:
 	unsigned int m_iLoopPoint = -1;
 	unsigned int m_iReleasePoint = -1;
 	seq_setting_t m_iSetting = SETTING_DEFAULT;		// // //
+	unsigned int m_iRevision = 0;		// // //
 	std::array<int8_t, MAX_SEQUENCE_ITEMS> m_cValues = { };		// // //
 };
@@ -0,0 +1,100 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2018 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+** Library General Public License for more details.  To obtain a
+** copy of the GNU Library General Public License, write to the Free
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+#include "SequenceEnvelope.h"
+
+const int CSequenceEnvelope::END = -1;
+
+namespace {
+
+int NextPosition(int Pos, bool Releasing, int Items, int Loop, int Release) {
+	++Pos;
+	if (Pos == (Release + 1) || Pos >= Items) {
+		// End point reached
+		if (Loop != -1 && !(Releasing && Release != -1) && Loop < Release)
+			return Loop;
+		if (Pos >= Items)
+			// End of sequence
+			return Loop >= Release && Loop != -1 ? Loop : CSequenceEnvelope::END;
+		if (!Releasing)
+			// Waiting for release
+			return Pos - 1;
+	}
+	return Pos;
+}
+
+} // namespace
+
+void CSequenceEnvelope::Compile(const CSequence &Seq) {
+	m_iItemCount = Seq.GetItemCount();
+	m_iType = Seq.GetSequenceType();
+	m_iSetting = Seq.GetSetting();
+	m_iRevision = Seq.GetRevision();
+
+	const bool IsScheme = m_iType == sequence_t::Arpeggio && m_iSetting == SETTING_ARP_SCHEME;
+	const int Loop = Seq.GetLoopPoint();
+	const int Release = Seq.GetReleasePoint();
+
+	for (int i = 0; i < MAX_SEQUENCE_ITEMS; ++i) {
+		stTick &Tick = m_Ticks[i];
+		int Value = Seq.GetItem(i);
+		Tick.Scheme = arp_scheme_mode_t::none;
+		if (IsScheme) {
+			if (Value < 0) Value += 256;
+			Tick.Scheme = static_cast<arp_scheme_mode_t>(Value & 0xC0);
+			Value %= 0x40;
+			if (Value > ARPSCHEME_MAX)
+				Value -= 64;
+		}
+		Tick.Value = static_cast<int8_t>(Value);
+		Tick.Next = static_cast<int16_t>(NextPosition(i, false, m_iItemCount, Loop, Release));
+		Tick.NextReleasing = static_cast<int16_t>(NextPosition(i, true, m_iItemCount, Loop, Release));
+	}
+}
+
+bool CSequenceEnvelope::IsCompiled(const CSequence &Seq) const {
+	return m_iType != sequence_t::none && m_iType == Seq.GetSequenceType() && m_iRevision == Seq.GetRevision();
+}
+
+unsigned CSequenceEnvelope::GetItemCount() const {
+	return m_iItemCount;
+}
+
+sequence_t CSequenceEnvelope::GetSequenceType() const {
+	return m_iType;
+}
+
+seq_setting_t CSequenceEnvelope::GetSetting() const {
+	return m_iSetting;
+}
+
+int CSequenceEnvelope::GetValue(int Pos) const {
+	return m_Ticks[Pos].Value;
+}
+
+arp_scheme_mode_t CSequenceEnvelope::GetSchemeMode(int Pos) const {
+	return m_Ticks[Pos].Scheme;
+}
+
+int CSequenceEnvelope::GetNext(int Pos, bool Releasing) const {
+	return Releasing ? m_Ticks[Pos].NextReleasing : m_Ticks[Pos].Next;
+}
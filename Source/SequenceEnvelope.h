@@ -0,0 +1,78 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2018 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+** Library General Public License for more details.  To obtain a
+** copy of the GNU Library General Public License, write to the Free
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+#pragma once
+
+#include "Sequence.h"
+
+/*!
+	\brief A sequence flattened into a table which can be played back one tick at a time.
+	\details The tick following every sequence position is resolved in advance for both the
+	held and the released state of a note, so that loop and release points need not be checked
+	during playback. Arpeggio scheme entries are decoded into note offsets and scheme modes.
+*/
+class CSequenceEnvelope {
+public:
+	/*!	\brief Position value indicating that the sequence has finished. */
+	static const int END;
+
+	/*!	\brief Builds the envelope table from a sequence.
+		\param Seq The sequence. */
+	void Compile(const CSequence &Seq);
+
+	/*!	\brief Checks whether the envelope was built from the current contents of a sequence.
+		\details This also holds for copies of the compiled sequence, until either one is modified.
+		\param Seq The sequence. */
+	bool IsCompiled(const CSequence &Seq) const;
+
+	unsigned GetItemCount() const;
+	sequence_t GetSequenceType() const;
+	seq_setting_t GetSetting() const;
+
+	/*!	\brief Obtains the value of a sequence position.
+		\details For arpeggio schemes this is the note offset without the scheme mode. */
+	int GetValue(int Pos) const;
+
+	/*!	\brief Obtains the arpeggio scheme mode of a sequence position. */
+	arp_scheme_mode_t GetSchemeMode(int Pos) const;
+
+	/*!	\brief Obtains the sequence position of the next tick.
+		\param Pos The current sequence position.
+		\param Releasing Whether the note has been released.
+		\return The next position, or CSequenceEnvelope::END if the sequence has finished. */
+	int GetNext(int Pos, bool Releasing) const;
+
+private:
+	struct stTick {
+		int8_t Value = 0;
+		arp_scheme_mode_t Scheme = arp_scheme_mode_t::none;
+		int16_t Next = 0;
+		int16_t NextReleasing = 0;
+	};
+
+	std::array<stTick, MAX_SEQUENCE_ITEMS> m_Ticks;
+	unsigned m_iItemCount = 0;
+	sequence_t m_iType = sequence_t::none;
+	seq_setting_t m_iSetting = SETTING_DEFAULT;
+	unsigned m_iRevision = 0;
+};
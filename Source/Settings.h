@@ -89,6 +89,7 @@ public:
 
 	struct {
 		module_error_level_t iErrorLevel;
+		bool	bCompressBlocks;		// // //
 	} Version;		// // //
 
 	struct {
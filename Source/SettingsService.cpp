@@ -278,6 +278,7 @@ void CSettingsService::SetupSettings() {
 
 	// // // Version / Compatibility info
 	NewSetting(L"Version", L"Module error level", MODULE_ERROR_DEFAULT, s.Version.iErrorLevel);
+	NewSetting(L"Version", L"Compress module blocks", false, s.Version.bCompressBlocks);		// // //
 
 	// Keys
 	NewSetting(L"Keys", L"Note cut", (int)'1', s.Keys.iKeyNoteCut);
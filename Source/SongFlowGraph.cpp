@@ -0,0 +1,339 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2018 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+** Library General Public License for more details.  To obtain a
+** copy of the GNU Library General Public License, write to the Free
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+#include "SongFlowGraph.h"
+#include "FamiTrackerModule.h"
+#include "SongData.h"
+#include "TrackData.h"
+#include "PatternData.h"
+#include "ChannelOrder.h"
+#include "ft0cc/doc/groove.hpp"
+#include <bitset>
+#include <algorithm>
+#include <cmath>
+
+CSongFlowGraph::CSongFlowGraph(const CFamiTrackerModule &modfile, const CConstSongView &view) :
+	modfile_(modfile), song_view_(view.GetChannelOrder().Canonicalize(), view.GetSong(), false)
+{
+	Rebuild();
+}
+
+void CSongFlowGraph::UpdateRow(unsigned Frame, unsigned Row) {
+	if (Frame >= frames_.size() || Row >= rows_)
+		return;
+
+	const std::size_t Tracks = song_view_.GetChannelOrder().GetChannelCount();
+	for (unsigned f = 0; f < frames_.size(); ++f)
+		for (std::size_t i = 0; i < Tracks; ++i)
+			if (song_view_.GetFramePattern(i, f) == song_view_.GetFramePattern(i, Frame)) {
+				SetRow(f, Row);
+				break;
+			}
+	timeline_.reset();
+}
+
+void CSongFlowGraph::UpdateFrame(unsigned Frame) {
+	if (Frame >= frames_.size())
+		return;
+
+	frames_[Frame].clear();
+	for (unsigned r = 0; r < rows_; ++r)
+		if (auto row = ScanRow(Frame, r))
+			frames_[Frame].push_back(std::move(*row));
+	timeline_.reset();
+}
+
+void CSongFlowGraph::Rebuild() {
+	const auto &song = song_view_.GetSong();
+	rows_ = song.GetPatternLength();
+	frames_.assign(song.GetFrameCount(), { });
+	for (unsigned f = 0; f < frames_.size(); ++f)
+		UpdateFrame(f);
+}
+
+void CSongFlowGraph::Invalidate() {
+	timeline_.reset();
+}
+
+std::pair<unsigned, unsigned> CSongFlowGraph::GetRowCount() {
+	const auto &timeline = GetTimeline();
+	return {timeline.Rows[0] - timeline.Rows[1], timeline.Rows[1]};
+}
+
+std::pair<double, double> CSongFlowGraph::GetSecondsCount() {
+	const auto &timeline = GetTimeline();
+	return {(timeline.Time[0] - timeline.Time[1]) * 2.5, timeline.Time[1] * 2.5};
+}
+
+std::optional<double> CSongFlowGraph::GetTimeAtPosition(unsigned Frame, unsigned Row) {
+	const auto &timeline = GetTimeline();
+	const auto &segments = timeline.Passes[0];
+
+	auto it = std::upper_bound(timeline.ByPosition.begin(), timeline.ByPosition.end(), std::make_pair(Frame, Row),
+		[&] (const std::pair<unsigned, unsigned> &pos, std::size_t i) {
+			return pos < std::make_pair(segments[i].Frame, segments[i].Row);
+		});
+	if (it == timeline.ByPosition.begin())
+		return std::nullopt;
+
+	const stSegment &seg = segments[*--it];
+	if (seg.Frame != Frame || Row >= seg.Row + seg.Rows)
+		return std::nullopt;
+	return (seg.Start + (Row - seg.Row) * seg.RowTime) * 2.5;
+}
+
+std::optional<std::pair<unsigned, unsigned>> CSongFlowGraph::GetPositionAtTime(double Seconds) {
+	const auto &timeline = GetTimeline();
+	if (Seconds < 0.)
+		return std::nullopt;
+
+	double Time = Seconds / 2.5;
+	int Pass = 0;
+	if (Time >= timeline.Time[0]) {
+		if (timeline.Passes[1].empty() || !(timeline.Time[1] > 0.))
+			return std::nullopt;
+		Time = std::fmod(Time - timeline.Time[0], timeline.Time[1]);
+		Pass = 1;
+	}
+
+	const auto &segments = timeline.Passes[Pass];
+	auto it = std::upper_bound(segments.begin(), segments.end(), Time,
+		[] (double t, const stSegment &seg) { return t < seg.Start; });
+	if (it == segments.begin())
+		return std::nullopt;
+
+	const stSegment &seg = *--it;
+	unsigned Offset = seg.RowTime > 0. ? static_cast<unsigned>((Time - seg.Start) / seg.RowTime) : 0u;
+	return std::make_pair(seg.Frame, seg.Row + std::min(Offset, seg.Rows - 1));
+}
+
+std::optional<CSongFlowGraph::stRowEffects> CSongFlowGraph::ScanRow(unsigned Frame, unsigned Row) const {
+	stRowEffects effects;
+	effects.Row = Row;
+	bool Found = false;
+
+	song_view_.ForeachTrack([&] (const CTrackData &track) {
+		const auto &Note = track.GetPatternOnFrame(Frame).GetNoteOn(Row);		// // //
+		for (unsigned l = 0, m = track.GetEffectColumnCount(); l < m; ++l) {
+			switch (Note.Effects[l].fx) {
+			case effect_t::JUMP:
+				effects.Bxx = Note.Effects[l].param;
+				Found = true;
+				break;
+			case effect_t::SKIP:
+				effects.Dxx = Note.Effects[l].param;
+				Found = true;
+				break;
+			case effect_t::HALT:
+				effects.Cxx = true;
+				Found = true;
+				break;
+			case effect_t::SPEED: case effect_t::GROOVE:
+				effects.Tempo.push_back(Note.Effects[l]);
+				Found = true;
+				break;
+			default:
+				break;
+			}
+		}
+	});
+
+	if (!Found)
+		return std::nullopt;
+	return effects;
+}
+
+void CSongFlowGraph::SetRow(unsigned Frame, unsigned Row) {
+	auto &rows = frames_[Frame];
+	auto it = std::lower_bound(rows.begin(), rows.end(), Row,
+		[] (const stRowEffects &x, unsigned r) { return x.Row < r; });
+	const bool Exists = it != rows.end() && it->Row == Row;
+
+	if (auto row = ScanRow(Frame, Row)) {
+		if (Exists)
+			*it = std::move(*row);
+		else
+			rows.insert(it, std::move(*row));
+	}
+	else if (Exists)
+		rows.erase(it);
+}
+
+const CSongFlowGraph::stRowEffects *CSongFlowGraph::FindRow(unsigned Frame, unsigned Row) const {
+	const auto &rows = frames_[Frame];
+	auto it = std::lower_bound(rows.begin(), rows.end(), Row,
+		[] (const stRowEffects &x, unsigned r) { return x.Row < r; });
+	return it != rows.end() && it->Row == Row ? &*it : nullptr;
+}
+
+const CSongFlowGraph::stTimeline &CSongFlowGraph::GetTimeline() {
+	const auto &song = song_view_.GetSong();
+	if (song.GetFrameCount() != frames_.size() || song.GetPatternLength() != rows_)
+		Rebuild();
+	if (!timeline_)
+		BuildTimeline();
+	return *timeline_;
+}
+
+void CSongFlowGraph::BuildTimeline() {
+	stTimeline &timeline = timeline_.emplace();
+
+	const auto &song = song_view_.GetSong();
+	const unsigned FrameCount = frames_.size();
+	const unsigned Rows = rows_;
+
+	double Tempo = song.GetSongTempo();
+	if (!Tempo)
+		Tempo = 2.5 * modfile_.GetFrameRate();
+	const bool AllowTempo = song.GetSongTempo() != 0;
+	const int Split = modfile_.GetSpeedSplitPoint();
+	int Speed = song.GetSongSpeed();
+	int GrooveIndex = song.GetSongGroove() ? Speed : -1;
+	int GroovePointer = 0;
+
+	if (GrooveIndex != -1 && !modfile_.HasGroove(Speed)) {
+		GrooveIndex = -1;
+		Speed = DEFAULT_SPEED;
+	}
+
+	const auto fxhandler = [&] (stEffectCommand cmd) {
+		switch (cmd.fx) {
+		case effect_t::SPEED:
+			if (AllowTempo && cmd.param >= Split)
+				Tempo = cmd.param;
+			else {
+				GrooveIndex = -1;
+				Speed = cmd.param;
+			}
+			break;
+		case effect_t::GROOVE:
+			if (modfile_.HasGroove(cmd.param)) {
+				GrooveIndex = cmd.param;
+				GroovePointer = 0;
+			}
+			break;
+		default:
+			break;
+		}
+	};
+
+	unsigned f = 0;
+	unsigned r = 0;
+	std::vector<std::bitset<MAX_PATTERN_LENGTH>> RowVisited;		// // //
+
+	for (int Pass = 0; Pass < 2 && FrameCount && Rows; ++Pass) {
+		auto &segments = timeline.Passes[Pass];
+		double Time = 0.;
+		unsigned Count = 0;
+		RowVisited.assign(FrameCount, { });
+
+		while (!RowVisited[f][r]) {
+			RowVisited[f][r] = true;
+
+			const stRowEffects *pRow = FindRow(f, r);
+			if (pRow)
+				for (const auto &cmd : pRow->Tempo)
+					fxhandler(cmd);
+
+			const bool Cxx = pRow && pRow->Cxx;
+			if (Cxx && Pass)
+				break;
+
+			if (auto pGroove = modfile_.GetGroove(GrooveIndex))
+				Speed = pGroove->entry(GroovePointer++);
+			const double RowTime = Speed / Tempo;
+			if (!segments.empty() && segments.back().Frame == f &&
+				segments.back().Row + segments.back().Rows == r && segments.back().RowTime == RowTime)
+				++segments.back().Rows;
+			else
+				segments.push_back({f, r, 1, Time, RowTime});
+			Time += RowTime;
+			++Count;
+
+			if (Cxx)
+				break;
+
+			if (pRow && pRow->Bxx != -1) {
+				f = std::min(static_cast<unsigned int>(pRow->Bxx), FrameCount - 1);
+				r = 0;
+			}
+			else if (pRow && pRow->Dxx != -1) {
+				if (++f >= FrameCount)
+					f = 0;
+				r = std::min(static_cast<unsigned int>(pRow->Dxx), Rows - 1);
+			}
+			else if (++r >= Rows) {		// // //
+				r = 0;
+				if (++f >= FrameCount)
+					f = 0;
+			}
+		}
+
+		timeline.Rows[Pass] = Count;
+		timeline.Time[Pass] = Time;
+	}
+
+	const auto &segments = timeline.Passes[0];
+	timeline.ByPosition.resize(segments.size());
+	for (std::size_t i = 0; i < segments.size(); ++i)
+		timeline.ByPosition[i] = i;
+	std::sort(timeline.ByPosition.begin(), timeline.ByPosition.end(), [&] (std::size_t a, std::size_t b) {
+		return std::make_pair(segments[a].Frame, segments[a].Row) < std::make_pair(segments[b].Frame, segments[b].Row);
+	});
+}
+
+CSongFlowGraphCache::CSongFlowGraphCache(const CFamiTrackerModule &modfile) :
+	modfile_(modfile)
+{
+}
+
+CSongFlowGraphCache::~CSongFlowGraphCache() = default;
+
+void CSongFlowGraphCache::Reset(unsigned Track) {
+	std::lock_guard<std::mutex> lock {m_};
+	if (Track < graphs_.size())
+		graphs_[Track] = stEntry { };
+}
+
+void CSongFlowGraphCache::Clear() {
+	std::lock_guard<std::mutex> lock {m_};
+	graphs_.clear();
+}
+
+CSongFlowGraph &CSongFlowGraphCache::Get(unsigned Track) {
+	auto pSongView = modfile_.MakeSongView(Track, false);
+	const CSongData &song = pSongView->GetSong();
+	const std::size_t Channels = pSongView->GetChannelOrder().GetChannelCount();
+
+	if (Track >= graphs_.size())
+		graphs_.resize(Track + 1);
+	stEntry &entry = graphs_[Track];
+	if (!entry.pGraph || entry.pSong != &song || entry.Frames != song.GetFrameCount() ||
+		entry.Rows != song.GetPatternLength() || entry.Channels != Channels) {
+		entry.pSong = &song;
+		entry.Frames = song.GetFrameCount();
+		entry.Rows = song.GetPatternLength();
+		entry.Channels = Channels;
+		entry.pGraph = std::make_unique<CSongFlowGraph>(modfile_, *pSongView);
+	}
+	return *entry.pGraph;
+}
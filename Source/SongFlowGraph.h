@@ -0,0 +1,168 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2018 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+** Library General Public License for more details.  To obtain a
+** copy of the GNU Library General Public License, write to the Free
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+#pragma once
+
+#include <vector>
+#include <optional>
+#include <utility>
+#include <memory>
+#include <mutex>
+#include "SongView.h"
+#include "PatternNote.h"
+
+class CFamiTrackerModule;
+class CSongData;
+
+/*!
+	\brief A cached control-flow graph of a song.
+	\details The graph keeps the rows of a song which contain Bxx, Dxx or Cxx jump effects or
+	Fxx and Oxx tempo effects in any track. Playback order and row durations are derived from
+	these rows alone, so song length and timeline queries do not scan any patterns. After the
+	effect columns are edited, only the affected rows have to be rescanned.
+
+	The timeline consists of two passes over the song:
+	the first pass plays the intro and one iteration of the loop, the second pass plays only the
+	loop. Both passes are stored as runs of consecutive rows with equal durations.
+*/
+class CSongFlowGraph {
+public:
+	/*!	\brief Constructor of the song flow graph.
+		\param modfile The module containing the song.
+		\param view The song view. Tracks are always visited in canonical channel order. */
+	CSongFlowGraph(const CFamiTrackerModule &modfile, const CConstSongView &view);
+
+	/*!	\brief Rescans a row after its effect columns have been edited.
+		\details The row is rescanned in every frame that shares a pattern with the given frame.
+		\param Frame The frame index.
+		\param Row The row index. */
+	void UpdateRow(unsigned Frame, unsigned Row);
+	/*!	\brief Rescans all rows of a frame after its pattern indices have been changed.
+		\param Frame The frame index. */
+	void UpdateFrame(unsigned Frame);
+	/*!	\brief Rescans the whole song. */
+	void Rebuild();
+	/*!	\brief Discards the timeline after the song speed, the song tempo, the grooves, or the
+		speed split point have been changed. */
+	void Invalidate();
+
+	/*!	\brief Obtains the song length in rows.
+		\return The number of rows of the intro and of the loop. */
+	std::pair<unsigned, unsigned> GetRowCount();
+	/*!	\brief Obtains the song length in seconds.
+		\return The durations of the intro and of the loop. */
+	std::pair<double, double> GetSecondsCount();
+
+	/*!	\brief Obtains the time when a row is first played.
+		\param Frame The frame index.
+		\param Row The row index.
+		\return The time in seconds, or nothing if the row is never played. */
+	std::optional<double> GetTimeAtPosition(unsigned Frame, unsigned Row);
+	/*!	\brief Obtains the row played at a given time.
+		\details Times past the end of the first loop iteration wrap around the loop.
+		\param Seconds The time in seconds.
+		\return The frame and row indices, or nothing if the song has halted by then. */
+	std::optional<std::pair<unsigned, unsigned>> GetPositionAtTime(double Seconds);
+
+private:
+	struct stRowEffects {
+		unsigned Row = 0;
+		int Bxx = -1;
+		int Dxx = -1;
+		bool Cxx = false;
+		std::vector<stEffectCommand> Tempo;		// Fxx and Oxx effects in playback order
+	};
+
+	struct stSegment {
+		unsigned Frame = 0;
+		unsigned Row = 0;
+		unsigned Rows = 0;
+		double Start = 0.;		// time before the first row within the pass
+		double RowTime = 0.;	// duration of every row in the segment
+	};
+
+	struct stTimeline {
+		std::vector<stSegment> Passes[2];
+		std::vector<std::size_t> ByPosition;	// first pass segments sorted by frame and row
+		unsigned Rows[2] = { };
+		double Time[2] = { };
+	};
+
+	std::optional<stRowEffects> ScanRow(unsigned Frame, unsigned Row) const;
+	void SetRow(unsigned Frame, unsigned Row);
+	const stRowEffects *FindRow(unsigned Frame, unsigned Row) const;
+	const stTimeline &GetTimeline();
+	void BuildTimeline();
+
+	const CFamiTrackerModule &modfile_;
+	CConstSongView song_view_;
+	unsigned rows_ = 0;
+	std::vector<std::vector<stRowEffects>> frames_;		// rows with effects, sorted by row
+	std::optional<stTimeline> timeline_;
+};
+
+/*!
+	\brief The flow graphs of all songs in a module.
+	\details A graph is created when its song is first queried, and is rebuilt whenever the frame
+	count, the pattern length, or the channel count of the song has changed since. Other edits
+	must be reported to the graph through its update methods, or by resetting the graph.
+*/
+class CSongFlowGraphCache {
+public:
+	/*!	\brief Constructor of the song flow graph cache.
+		\param modfile The module containing the songs. */
+	explicit CSongFlowGraphCache(const CFamiTrackerModule &modfile);
+	~CSongFlowGraphCache();
+
+	/*!	\brief Calls a function with the flow graph of a song.
+		\details The cache is locked while the function runs.
+		\param Track The song index.
+		\param f A function object taking a CSongFlowGraph reference.
+		\return The return value of the function object. */
+	template <typename F>
+	decltype(auto) Visit(unsigned Track, F f) {
+		std::lock_guard<std::mutex> lock {m_};
+		return f(Get(Track));
+	}
+
+	/*!	\brief Discards the flow graph of a song.
+		\param Track The song index. */
+	void Reset(unsigned Track);
+	/*!	\brief Discards the flow graphs of all songs. */
+	void Clear();
+
+private:
+	struct stEntry {
+		const CSongData *pSong = nullptr;
+		unsigned Frames = 0;
+		unsigned Rows = 0;
+		std::size_t Channels = 0;
+		std::unique_ptr<CSongFlowGraph> pGraph;
+	};
+
+	CSongFlowGraph &Get(unsigned Track);
+
+	const CFamiTrackerModule &modfile_;
+	std::vector<stEntry> graphs_;
+	std::mutex m_;
+};
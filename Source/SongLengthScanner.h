@@ -26,23 +26,14 @@
 #include <utility>
 
 class CFamiTrackerModule;
-class CConstSongView;
 
 class CSongLengthScanner {
 public:
-	CSongLengthScanner(const CFamiTrackerModule &modfile, const CConstSongView &view);
+	CSongLengthScanner(const CFamiTrackerModule &modfile, unsigned track);		// // //
 	std::pair<unsigned, unsigned> GetRowCount();
 	std::pair<double, double> GetSecondsCount();
 
 private:
-	void Compute();
-
-	const CFamiTrackerModule &modfile_;
-	const CConstSongView &song_view_;
-
-	unsigned rows1_ = 0;
-	unsigned rows2_ = 0;
-	double sec1_ = 0.;
-	double sec2_ = 0.;
-	bool scanned_ = false;
+	const CFamiTrackerModule &modfile_;		// // // queries the module's cached song flow graph
+	unsigned track_;
 };
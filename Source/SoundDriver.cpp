@@ -292,7 +292,7 @@ int CSoundDriver::ReadVibratoTable(int index) const {
 }
 
 void CSoundDriver::SetupVibrato() {
-	m_iVibratoTable = modfile_->MakeVibratoTable();		// // //
+	m_iVibratoTable = modfile_->MakeVibratoTable();		// // // cached by CPeriodTableCache
 }
 
 void CSoundDriver::SetupPeriodTables() {
@@ -303,20 +303,20 @@ void CSoundDriver::SetupPeriodTables() {
 		switch (ch.Chip) {
 		case sound_chip_t::APU:
 			if (!IsAPUNoise(ch) && !IsDPCM(ch))
-				return modfile_->GetMachine() == machine_t::PAL ? m_iNoteLookupTable.pal_period : m_iNoteLookupTable.ntsc_period;
+				return modfile_->GetMachine() == machine_t::PAL ? *m_iNoteLookupTable.pal_period : *m_iNoteLookupTable.ntsc_period;
 			break;
 		case sound_chip_t::VRC6:
-			return IsVRC6Sawtooth(ch) ? m_iNoteLookupTable.saw_period : m_iNoteLookupTable.ntsc_period;
+			return IsVRC6Sawtooth(ch) ? *m_iNoteLookupTable.saw_period : *m_iNoteLookupTable.ntsc_period;
 		case sound_chip_t::VRC7:
-			return m_iNoteLookupTable.vrc7_freq;
+			return *m_iNoteLookupTable.vrc7_freq;
 		case sound_chip_t::FDS:
-			return m_iNoteLookupTable.fds_freq;
+			return *m_iNoteLookupTable.fds_freq;
 		case sound_chip_t::MMC5:
-			return m_iNoteLookupTable.ntsc_period;
+			return *m_iNoteLookupTable.ntsc_period;
 		case sound_chip_t::N163:
-			return m_iNoteLookupTable.n163_freq;
+			return *m_iNoteLookupTable.n163_freq;
 		case sound_chip_t::S5B:
-			return m_iNoteLookupTable.s5b_period;
+			return *m_iNoteLookupTable.s5b_period;
 		}
 		return { };
 	};
@@ -0,0 +1,514 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2018 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+** Library General Public License for more details.  To obtain a
+** copy of the GNU Library General Public License, write to the Free
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+#include "TextCodec.h"
+#include "MappedFile.h"
+#include "NumConv.h"
+#include "ft0cc/doc/pitch.hpp"
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+namespace {
+
+enum : unsigned char {
+	CC_SPACE = 0x01u,		// skipped before tokens
+	CC_DELIM = 0x02u,		// terminates unquoted tokens
+};
+
+constexpr auto CHAR_CLASS = [] {
+	std::array<unsigned char, 256> table = { };
+	table[' '] = table['\t'] = table['\r'] = CC_SPACE | CC_DELIM;
+	table['\n'] = table['\"'] = CC_DELIM;
+	return table;
+}();
+
+constexpr unsigned NO_DIGIT = 0xFFu;
+
+constexpr auto HEX_VALUE = [] {
+	std::array<unsigned char, 256> table = { };
+	for (unsigned ch = 0; ch < table.size(); ++ch) {
+		unsigned x = conv::from_digit(static_cast<char>(ch));
+		table[ch] = x < 16u ? x : NO_DIGIT;
+	}
+	return table;
+}();
+
+constexpr auto NOTE_LETTER = [] {
+	std::array<signed char, 256> table = { };
+	const auto put = [&] (char ch, note_t n) {
+		table[static_cast<unsigned char>(ch)] = table[static_cast<unsigned char>(ch - 'A' + 'a')] = static_cast<signed char>(value_cast(n));
+	};
+	put('C', note_t::C);
+	put('D', note_t::D);
+	put('E', note_t::E);
+	put('F', note_t::F);
+	put('G', note_t::G);
+	put('A', note_t::A);
+	put('B', note_t::B);
+	return table;
+}();
+
+constexpr signed char NO_ACCIDENTAL = 0x7F;
+
+constexpr auto NOTE_ACCIDENTAL = [] {
+	std::array<signed char, 256> table = { };
+	for (auto &x : table)
+		x = NO_ACCIDENTAL;
+	table['-'] = table['.'] = 0;
+	table['#'] = table['+'] = 1;
+	table['b'] = table['f'] = -1;
+	return table;
+}();
+
+constexpr char HEX_DIGIT[] = "0123456789ABCDEF";
+
+constexpr char NOTE_NAME[][2] = {
+	{'C', '-'}, {'C', '#'}, {'D', '-'}, {'D', '#'}, {'E', '-'}, {'F', '-'},
+	{'F', '#'}, {'G', '-'}, {'G', '#'}, {'A', '-'}, {'A', '#'}, {'B', '-'},
+};
+
+constexpr char NOTE_NAME_FLAT[][2] = {
+	{'C', '-'}, {'D', 'b'}, {'D', '-'}, {'E', 'b'}, {'E', '-'}, {'F', '-'},
+	{'G', 'b'}, {'G', '-'}, {'A', 'b'}, {'A', '-'}, {'B', 'b'}, {'B', '-'},
+};
+
+// note + instrument + volume + effects, with room for oversized octave and volume values
+constexpr std::size_t MAX_CELL_TEXT = 3 + 3 + 2 + 4 * MAX_EFFECT_COLUMNS + 8;
+
+char *PutHex(char *out, unsigned x, unsigned places) noexcept {
+	unsigned digits = 1;
+	for (unsigned y = x >> 4; y; y >>= 4)
+		++digits;
+	if (digits < places)
+		digits = places;
+	for (unsigned i = digits; i-- > 0; x >>= 4)
+		out[i] = HEX_DIGIT[x & 0x0Fu];
+	return out + digits;
+}
+
+char *PutDecimal(char *out, unsigned x) noexcept {
+	char buf[10];
+	unsigned n = 0;
+	do
+		buf[n++] = static_cast<char>('0' + x % 10);
+	while (x /= 10);
+	while (n)
+		*out++ = buf[--n];
+	return out;
+}
+
+char *FormatCell(char *out, const stChanNote &note, unsigned nEffects, bool bNoise, bool bFlats) noexcept {
+	if (bNoise && (is_note(note.Note) || note.Note == note_t::echo)) {
+		*out++ = HEX_DIGIT[note.ToMidiNote() & 0x0F];
+		*out++ = '-';
+		*out++ = '#';
+	}
+	else if (is_note(note.Note)) {
+		const auto &name = (bFlats ? NOTE_NAME_FLAT : NOTE_NAME)[value_cast(note.Note) - 1];
+		*out++ = name[0];
+		*out++ = name[1];
+		out = PutDecimal(out, note.Octave);
+	}
+	else {
+		switch (note.Note) {
+		case note_t::halt:    std::memcpy(out, "---", 3); out += 3; break;
+		case note_t::release: std::memcpy(out, "===", 3); out += 3; break;
+		case note_t::echo:
+			*out++ = '^';
+			*out++ = '-';
+			out = PutDecimal(out, note.Octave);
+			break;
+		default:              std::memcpy(out, "...", 3); out += 3; break;
+		}
+	}
+
+	*out++ = ' ';
+	if (note.Instrument == MAX_INSTRUMENTS) {
+		*out++ = '.';
+		*out++ = '.';
+	}
+	else if (note.Instrument == HOLD_INSTRUMENT) {		// // // 050B
+		*out++ = '&';
+		*out++ = '&';
+	}
+	else
+		out = PutHex(out, note.Instrument, 2);
+
+	*out++ = ' ';
+	if (note.Vol == MAX_VOLUME)
+		*out++ = '.';
+	else
+		out = PutHex(out, note.Vol, 1);
+
+	for (unsigned e = 0; e < nEffects && e < MAX_EFFECT_COLUMNS; ++e) {
+		*out++ = ' ';
+		if (const auto &cmd = note.Effects[e]; cmd.fx == effect_t::none) {
+			std::memcpy(out, "...", 3);
+			out += 3;
+		}
+		else {
+			*out++ = EFF_CHAR[value_cast(cmd.fx)];
+			out = PutHex(out, cmd.param, 2);
+		}
+	}
+
+	return out;
+}
+
+} // namespace
+
+
+
+bool TextEqualsNoCase(std::string_view lhs, std::string_view rhs) noexcept {
+	if (lhs.size() != rhs.size())
+		return false;
+	for (std::size_t i = 0; i < lhs.size(); ++i) {
+		char l = lhs[i];
+		char r = rhs[i];
+		if (l >= 'a' && l <= 'z')
+			l = l - 'a' + 'A';
+		if (r >= 'a' && r <= 'z')
+			r = r - 'a' + 'A';
+		if (l != r)
+			return false;
+	}
+	return true;
+}
+
+void AppendCellText(std::string &str, const stChanNote &note, unsigned nEffects, bool bNoise, bool bFlats) {
+	char buf[MAX_CELL_TEXT];
+	str.append(buf, FormatCell(buf, note, nEffects, bNoise, bFlats));
+}
+
+
+
+CTextTokenizer::CTextTokenizer(std::string_view text) noexcept : text_(text) {
+}
+
+CTextTokenizer::CTextTokenizer(const fs::path &fname) : file_(std::make_unique<CMappedFile>()) {
+	if (file_->Open(fname)) {
+		auto data = file_->GetData();
+		text_ = std::string_view {reinterpret_cast<const char *>(data.data()), data.size()};
+		return;
+	}
+
+	// empty files cannot be mapped
+	file_.reset();
+	std::ifstream f {fname, std::ios::binary};
+	if (!f)
+		throw std::runtime_error {"Unable to open file:\n" + fname.u8string()};
+	owned_.assign(std::istreambuf_iterator<char> {f}, std::istreambuf_iterator<char> { });
+	text_ = owned_;
+}
+
+CTextTokenizer::~CTextTokenizer() noexcept = default;
+
+void CTextTokenizer::Reset() noexcept {
+	pos_ = linestart_ = 0u;
+	line_ = 1;
+}
+
+void CTextTokenizer::FinishLine() noexcept {
+	if (auto newpos = text_.find('\n', pos_); newpos != std::string_view::npos) {
+		++line_;
+		pos_ = newpos + 1;
+	}
+	else
+		pos_ = text_.size();
+	linestart_ = pos_;
+}
+
+bool CTextTokenizer::Finished() const noexcept {
+	return pos_ >= text_.size();
+}
+
+int CTextTokenizer::GetLine() const noexcept {
+	return line_;
+}
+
+int CTextTokenizer::GetColumn() const noexcept {
+	return static_cast<int>(1 + pos_ - linestart_);
+}
+
+std::string_view CTextTokenizer::ReadToken() {
+	ConsumeSpace();
+
+	if (!TrimChar('\"')) {
+		std::size_t b = pos_;
+		while (!Finished() && !(CHAR_CLASS[static_cast<unsigned char>(text_[pos_])] & CC_DELIM))
+			++pos_;
+		return text_.substr(b, pos_ - b);
+	}
+
+	// quoted strings are returned in place unless they contain escaped quotes
+	// or stray carriage returns
+	scratch_.clear();
+	bool copied = false;
+	std::size_t b = pos_;
+	std::size_t e = pos_;
+	while (true) {
+		if (Finished()) {
+			e = pos_;
+			break;
+		}
+		char c = text_[pos_];
+		if (c == '\n')
+			throw MakeError("incomplete quoted string.");
+		if (c == '\r') {
+			scratch_.append(text_, b, pos_ - b);
+			copied = true;
+			b = ++pos_;
+			continue;
+		}
+		if (c == '\"') {
+			e = pos_++;
+			if (!TrimChar('\"'))
+				break;
+			scratch_.append(text_, b, pos_ - b - 1);
+			copied = true;
+			b = pos_;
+			continue;
+		}
+		++pos_;
+	}
+
+	if (!copied)
+		return text_.substr(b, e - b);
+	scratch_.append(text_, b, e - b);
+	return scratch_;
+}
+
+int CTextTokenizer::ReadInt(int range_min, int range_max) {
+	if (auto t = ReadToken(); !t.empty()) {
+		if (auto i = conv::to_int(t)) {
+			if (*i >= range_min && *i <= range_max)
+				return *i;
+			throw MakeError("expected integer in range [%d,%d], %d found.", range_min, range_max, *i);
+		}
+		throw MakeError("expected integer, '%.*s' found.", static_cast<int>(t.size()), t.data());
+	}
+	throw MakeError("expected integer, no token found.");
+}
+
+unsigned CTextTokenizer::ReadHex(unsigned range_min, unsigned range_max) {
+	if (auto t = ReadToken(); !t.empty()) {
+		if (auto i = conv::to_uint(t, 16)) {
+			if (*i >= range_min && *i <= range_max)
+				return *i;
+			throw MakeError("expected hexadecimal in range [%X,%X], %X found.", range_min, range_max, *i);
+		}
+		throw MakeError("expected hexadecimal, '%.*s' found.", static_cast<int>(t.size()), t.data());
+	}
+	throw MakeError("expected hexadecimal, no token found.");
+}
+
+void CTextTokenizer::ReadSymbol(std::string_view symbol) {
+	if (auto t = ReadToken(); t != symbol)
+		throw MakeError("expected '%.*s', '%.*s' found.", static_cast<int>(symbol.size()), symbol.data(),
+			static_cast<int>(t.size()), t.data());
+}
+
+void CTextTokenizer::ReadEOL() {
+	if (auto t = ReadToken(); !t.empty())
+		throw MakeError("expected end of line, '%.*s' found.", static_cast<int>(t.size()), t.data());
+	if (!Finished()) {
+		if (char eol = text_[pos_]; eol != '\n')
+			throw MakeError("expected end of line, '%c' found.", eol);
+		FinishLine();
+	}
+}
+
+bool CTextTokenizer::IsEOL() {
+	ConsumeSpace();
+	if (Finished())
+		return true;
+
+	if (TrimChar('\n')) {		// // //
+		++line_;
+		linestart_ = pos_;
+		return true;
+	}
+
+	return false;
+}
+
+stChanNote CTextTokenizer::ReadCell(unsigned fxMax, bool bNoise, const text_effect_table_t &effects) {
+	const auto hex = [] (char ch) {
+		return HEX_VALUE[static_cast<unsigned char>(ch)];
+	};
+
+	stChanNote Cell;
+
+	auto sNote = ReadToken();
+	if (sNote == "...") { Cell.Note = note_t::none; }
+	else if (sNote == "---") { Cell.Note = note_t::halt; }
+	else if (sNote == "===") { Cell.Note = note_t::release; }
+	else {
+		if (sNote.size() != 3)
+			throw MakeError("note column should be 3 characters wide, '%.*s' found.", static_cast<int>(sNote.size()), sNote.data());
+
+		if (bNoise) {		// // // noise
+			unsigned h = hex(sNote[0]);
+			if (h == NO_DIGIT)
+				throw MakeError("hexadecimal number expected, '%c' found.", sNote[0]);
+			Cell.Note = ft0cc::doc::pitch_from_midi(h);
+			Cell.Octave = ft0cc::doc::oct_from_midi(h);
+
+			// importer is very tolerant about the second and third characters
+			// in a noise note, they can be anything
+		}
+		else if (sNote[0] == '^' && sNote[1] == '-') {		// // //
+			unsigned o = sNote[2] - '0';
+			if (o >= ECHO_BUFFER_LENGTH)
+				throw MakeError("out-of-bound echo buffer accessed.");
+			Cell.Note = note_t::echo;
+			Cell.Octave = o;
+		}
+		else {
+			int n = NOTE_LETTER[static_cast<unsigned char>(sNote[0])];
+			int acc = NOTE_ACCIDENTAL[static_cast<unsigned char>(sNote[1])];
+			if (!n || acc == NO_ACCIDENTAL)
+				throw MakeError("unrecognized note '%.*s'.", 3, sNote.data());
+			n += acc;
+			while (n < value_cast(note_t::C)) n += NOTE_RANGE;
+			while (n > value_cast(note_t::B)) n -= NOTE_RANGE;
+			Cell.Note = enum_cast<note_t>(n);
+
+			int o = sNote[2] - '0';
+			if (o < 0 || o >= OCTAVE_RANGE)
+				throw MakeError("unrecognized octave '%.*s'.", 3, sNote.data());
+			Cell.Octave = o;
+		}
+	}
+
+	auto sInst = ReadToken();
+	if (sInst == "..") { Cell.Instrument = MAX_INSTRUMENTS; }
+	else if (sInst == "&&") { Cell.Instrument = HOLD_INSTRUMENT; }		// // // 050B
+	else {
+		if (sInst.size() != 2)
+			throw MakeError("instrument column should be 2 characters wide, '%.*s' found.", static_cast<int>(sInst.size()), sInst.data());
+		unsigned hi = hex(sInst[0]);
+		unsigned lo = hex(sInst[1]);
+		if (hi == NO_DIGIT || lo == NO_DIGIT)
+			throw MakeError("hexadecimal number expected, '%.*s' found.", 2, sInst.data());
+		if (unsigned h = (hi << 4) | lo; h < MAX_INSTRUMENTS)
+			Cell.Instrument = h;
+		else
+			throw MakeError("instrument '%.*s' is out of bounds.", 2, sInst.data());
+	}
+
+	auto sVol = ReadToken();
+	if (sVol == ".")
+		Cell.Vol = MAX_VOLUME;
+	else if (sVol.size() == 1 && hex(sVol[0]) != NO_DIGIT)
+		Cell.Vol = hex(sVol[0]);
+	else
+		throw MakeError("unrecognized volume token '%.*s'.", static_cast<int>(sVol.size()), sVol.data());
+
+	for (unsigned e = 0; e < fxMax; ++e) {		// // //
+		auto sEff = ReadToken();
+		if (sEff.size() != 3)
+			throw MakeError("effect column should be 3 characters wide, '%.*s' found.", static_cast<int>(sEff.size()), sEff.data());
+
+		if (sEff != "...") {
+			effect_t Eff = effects[static_cast<unsigned char>(sEff[0])];
+			if (Eff == effect_t::none)
+				throw MakeError("unrecognized effect '%.*s'.", 3, sEff.data());
+			unsigned hi = hex(sEff[1]);
+			unsigned lo = hex(sEff[2]);
+			if (hi == NO_DIGIT || lo == NO_DIGIT)
+				throw MakeError("hexadecimal number expected, '%.*s' found.", 2, sEff.data() + 1);
+			Cell.Effects[e] = {Eff, static_cast<uint8_t>((hi << 4) | lo)};		// // //
+		}
+	}
+
+	return Cell;
+}
+
+std::runtime_error CTextTokenizer::MakeErrorImpl(std::string_view msg) const {
+	std::string str = "Line " + std::to_string(line_) + " column " + std::to_string(GetColumn()) + ": ";
+	str += msg;
+	return std::runtime_error {str};
+}
+
+bool CTextTokenizer::TrimChar(char ch) noexcept {
+	if (!Finished() && text_[pos_] == ch) {
+		++pos_;
+		return true;
+	}
+	return false;
+}
+
+void CTextTokenizer::ConsumeSpace() noexcept {
+	while (!Finished() && (CHAR_CLASS[static_cast<unsigned char>(text_[pos_])] & CC_SPACE))
+		++pos_;
+}
+
+
+
+CTextWriter::CTextWriter(std::ostream &os, std::size_t bufsize) :
+	os_(os), buf_(bufsize > MAX_CELL_TEXT ? bufsize : MAX_CELL_TEXT)
+{
+}
+
+CTextWriter::~CTextWriter() noexcept {
+	try {
+		Flush();
+	}
+	catch (...) {
+	}
+}
+
+void CTextWriter::Flush() {
+	if (len_) {
+		os_.write(buf_.data(), len_);
+		len_ = 0u;
+	}
+}
+
+CTextWriter &CTextWriter::Write(std::string_view str) {
+	if (str.size() > buf_.size() - len_) {
+		Flush();
+		if (str.size() >= buf_.size()) {
+			os_.write(str.data(), str.size());
+			return *this;
+		}
+	}
+	std::memcpy(buf_.data() + len_, str.data(), str.size());
+	len_ += str.size();
+	return *this;
+}
+
+CTextWriter &CTextWriter::Put(char ch) {
+	if (len_ == buf_.size())
+		Flush();
+	buf_[len_++] = ch;
+	return *this;
+}
+
+CTextWriter &CTextWriter::WriteCell(const stChanNote &note, unsigned nEffects, bool bNoise, bool bFlats) {
+	if (buf_.size() - len_ < MAX_CELL_TEXT)
+		Flush();
+	len_ = FormatCell(buf_.data() + len_, note, nEffects, bNoise, bFlats) - buf_.data();
+	return *this;
+}
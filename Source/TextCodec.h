@@ -0,0 +1,177 @@
+/*
+** FamiTracker - NES/Famicom sound tracker
+** Copyright (C) 2005-2014  Jonathan Liss
+**
+** 0CC-FamiTracker is (C) 2014-2018 HertzDevil
+**
+** This program is free software; you can redistribute it and/or modify
+** it under the terms of the GNU General Public License as published by
+** the Free Software Foundation; either version 2 of the License, or
+** (at your option) any later version.
+**
+** This program is distributed in the hope that it will be useful,
+** but WITHOUT ANY WARRANTY; without even the implied warranty of
+** MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+** Library General Public License for more details.  To obtain a
+** copy of the GNU Library General Public License, write to the Free
+** Software Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+**
+** Any permitted reproduction of these routines, in whole or in part,
+** must bear this legend.
+*/
+
+
+#pragma once
+
+#include <array>
+#include <cstdio>
+#include <iosfwd>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "ft0cc/fs.h"
+#include "PatternNote.h"
+
+class CMappedFile;
+
+// // // portable codec for the text module format
+
+/*!	\brief Maps every character to the effect it names, for a single sound chip. */
+using text_effect_table_t = std::array<effect_t, 256>;
+
+/*!	\brief Builds an effect lookup table. Effect names are case-insensitive.
+	\param translate A callable which converts an upper-case effect character to an effect. */
+template <typename F>
+text_effect_table_t MakeTextEffectTable(F translate) {
+	text_effect_table_t table = { };
+	for (unsigned ch = 0; ch < table.size(); ++ch)
+		table[ch] = translate(static_cast<char>(ch >= 'a' && ch <= 'z' ? ch - 'a' + 'A' : ch));
+	return table;
+}
+
+/*!	\brief Compares two strings without regard to ASCII letter case. */
+bool TextEqualsNoCase(std::string_view lhs, std::string_view rhs) noexcept;
+
+/*!	\brief Appends the text representation of a pattern cell to a string.
+	\param str The output string.
+	\param note The pattern cell.
+	\param nEffects Number of effect columns to write.
+	\param bNoise Whether the cell belongs to the 2A03 noise channel.
+	\param bFlats Whether note names use flats instead of sharps. */
+void AppendCellText(std::string &str, const stChanNote &note, unsigned nEffects, bool bNoise, bool bFlats);
+
+// // // tokenizer over an in-memory text buffer
+
+class CTextTokenizer {
+public:
+	/*!	\brief Tokenizes a buffer owned by the caller. */
+	explicit CTextTokenizer(std::string_view text) noexcept;
+	/*!	\brief Maps a file into memory and tokenizes its contents.
+		\exception std::runtime_error Thrown if the file cannot be read. */
+	explicit CTextTokenizer(const fs::path &fname);
+	~CTextTokenizer() noexcept;
+
+	CTextTokenizer(const CTextTokenizer &) = delete;
+	CTextTokenizer &operator=(const CTextTokenizer &) = delete;
+
+	void Reset() noexcept;
+	void FinishLine() noexcept;
+	bool Finished() const noexcept;
+	int GetLine() const noexcept;
+	int GetColumn() const noexcept;
+
+	/*!	\brief Reads the next token on the current line. Quoted strings are unescaped.
+		\return A view of the token, valid until the next token is read; empty at the end of a line. */
+	std::string_view ReadToken();
+	int ReadInt(int range_min, int range_max);
+	unsigned ReadHex(unsigned range_min, unsigned range_max);
+	/*!	\brief Reads a token and ensures it is equal to the given symbol. */
+	void ReadSymbol(std::string_view symbol);
+	/*!	\brief Ensures nothing other than whitespace remains on the current line, then finishes it. */
+	void ReadEOL();
+	/*!	\brief Checks whether the current line has ended; finishes the line if so. */
+	bool IsEOL();
+
+	/*!	\brief Reads the note, instrument, volume and effect columns of a pattern cell.
+		\param fxMax Number of effect columns.
+		\param bNoise Whether the cell belongs to the 2A03 noise channel.
+		\param effects Effect lookup table for the channel's sound chip. */
+	stChanNote ReadCell(unsigned fxMax, bool bNoise, const text_effect_table_t &effects);
+
+	/*!	\brief Creates an exception whose message is prefixed with the current position. */
+	template <typename... Args>
+	std::runtime_error MakeError(const char *fmt, Args&&... args) const {
+		if constexpr (sizeof...(Args) == 0)
+			return MakeErrorImpl(fmt);
+		else {
+			char buf[256];
+			std::snprintf(buf, sizeof(buf), fmt, std::forward<Args>(args)...);
+			return MakeErrorImpl(buf);
+		}
+	}
+
+private:
+	std::runtime_error MakeErrorImpl(std::string_view msg) const;
+	bool TrimChar(char ch) noexcept;
+	void ConsumeSpace() noexcept;
+
+	std::unique_ptr<CMappedFile> file_;
+	std::string owned_;
+	std::string_view text_;
+	std::string scratch_;
+	std::size_t pos_ = 0u;
+	std::size_t linestart_ = 0u;
+	int line_ = 1;
+};
+
+// // // buffered text writer
+
+class CTextWriter {
+public:
+	/*!	\brief Creates a writer which forwards its output to a stream in large blocks. */
+	explicit CTextWriter(std::ostream &os, std::size_t bufsize = 65536u);
+	/*!	\brief Flushes any buffered output; errors are left in the stream's state. */
+	~CTextWriter() noexcept;
+
+	CTextWriter(const CTextWriter &) = delete;
+	CTextWriter &operator=(const CTextWriter &) = delete;
+
+	void Flush();
+
+	CTextWriter &Write(std::string_view str);
+	CTextWriter &Put(char ch);
+	/*!	\brief Writes a pattern cell, in the same format as AppendCellText. */
+	CTextWriter &WriteCell(const stChanNote &note, unsigned nEffects, bool bNoise, bool bFlats);
+
+	/*!	\brief Writes printf-style formatted text directly into the buffer. */
+	template <typename... Args>
+	CTextWriter &Format(const char *fmt, Args&&... args) {
+		if constexpr (sizeof...(Args) == 0)
+			return Write(fmt);
+		else {
+			std::size_t avail = buf_.size() - len_;
+			int n = std::snprintf(buf_.data() + len_, avail, fmt, args...);
+			if (n < 0)
+				return *this;
+			if (static_cast<std::size_t>(n) < avail) {
+				len_ += n;
+				return *this;
+			}
+			Flush();
+			if (static_cast<std::size_t>(n) < buf_.size()) {
+				len_ = std::snprintf(buf_.data(), buf_.size(), fmt, args...);
+				return *this;
+			}
+			std::string str(n + 1, '\0');
+			std::snprintf(str.data(), str.size(), fmt, args...);
+			return Write(std::string_view {str.data(), static_cast<std::size_t>(n)});
+		}
+	}
+
+private:
+	std::ostream &os_;
+	std::vector<char> buf_;
+	std::size_t len_ = 0u;
+};
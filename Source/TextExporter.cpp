@@ -32,6 +32,8 @@
 #include "str_conv/str_conv.hpp"		// // //
 #include "NumConv.h"		// // //
 #include "NoteName.h"		// // //
+#include "TextCodec.h"		// // //
+#include "Settings.h"		// // //
 
 #include "ft0cc/doc/dpcm_sample.hpp"		// // //
 #include "ft0cc/doc/groove.hpp"		// // //
@@ -47,6 +49,7 @@
 #include "SoundChipSet.h"		// // //
 
 #include <type_traits>		// // //
+#include <fstream>		// // //
 
 #define DEBUG_OUT(...) { OutputDebugString(FormattedA(__VA_ARGS__)); }
 
@@ -167,300 +170,10 @@ const char *CT[CT_COUNT] = {
 
 // =============================================================================
 
-class Tokenizer
-{
-public:
-	explicit Tokenizer(const fs::path &FileName) : text(ReadFromFile(FileName)) { }
-	~Tokenizer() = default;
-
-	void Reset() {
-		last_pos_ = pos = 0;
-		line = 1;
-		linestart = 0;
-	}
-
-	void FinishLine() {
-		if (int newpos = text.Find('\n', pos); newpos >= 0) {		// // //
-			++line;
-			pos = newpos + 1;
-		}
-		else
-			pos = text.GetLength();
-		last_pos_ = linestart = pos;
-	}
-
-	int GetColumn() const {
-		return 1 + pos - linestart;
-	}
-
-	bool Finished() const {
-		return pos >= text.GetLength();
-	}
-
-	CStringA ReadToken() {
-		ConsumeSpace();
-		CStringA t = "";
-
-		bool isQuoted = TrimChar('\"');		// // //
-		while (!Finished())
-			switch (char c = text.GetAt(pos)) {
-			case '\r': case '\n':
-				if (isQuoted)
-					throw MakeError("incomplete quoted string.");
-				goto outer;
-			case '\"':
-				if (!isQuoted)
-					goto outer;
-				++pos;
-				if (!TrimChar('\"'))
-					goto outer;
-				t += c;
-				break;
-			case ' ': case '\t':
-				if (!isQuoted)
-					goto outer;
-				[[fallthrough]];
-			default:
-				t += c;
-				++pos;
-			}
-		outer:
-
-		//DEBUG_OUT("ReadToken(%d,%d): '%s'\n", line, GetColumn(), t);
-		last_pos_ = pos;
-		return t;
-	}
-
-	int ReadInt(int range_min, int range_max) {
-		if (CStringA t = ReadToken(); !t.IsEmpty()) {
-			if (auto i = conv::to_int(t)) {
-				if (*i >= range_min && *i <= range_max) {
-					last_pos_ = pos;
-					return *i;
-				}
-				throw MakeError("expected integer in range [%d,%d], %d found.", range_min, range_max, *i);
-			}
-			throw MakeError("expected integer, '%s' found.", (LPCSTR)t);
-		}
-		throw MakeError("expected integer, no token found.");
-	}
-
-	unsigned ReadHex(unsigned range_min, unsigned range_max) {
-		if (CStringA t = ReadToken(); !t.IsEmpty()) {
-			if (auto i = conv::to_uint(t, 16)) {
-				if (*i >= range_min && *i <= range_max) {
-					last_pos_ = pos;
-					return *i;
-				}
-				throw MakeError("expected hexadecimal in range [%X,%X], %X found.", range_min, range_max, *i);
-			}
-			throw MakeError("expected hexadecimal, '%s' found.", (LPCSTR)t);
-		}
-		throw MakeError("expected hexadecimal, no token found.");
-	}
-
-	// note: finishes line if found
-	void ReadEOL() {
-		ConsumeSpace();
-		if (CStringA s = ReadToken(); !s.IsEmpty())
-			throw MakeError("expected end of line, '%s' found.", (LPCSTR)s);
-		if (!Finished()) {
-			if (char eol = text.GetAt(pos); eol != '\r' && eol != '\n')
-				throw MakeError("expected end of line, '%c' found.", eol);
-			FinishLine();
-		}
-		last_pos_ = pos;
-	}
-
-	// note: finishes line if found
-	bool IsEOL() {
-		ConsumeSpace();
-		if (Finished()) {
-			last_pos_ = pos;
-			return true;
-		}
-
-		if (TrimChar('\n')) {		// // //
-			++line;
-			last_pos_ = linestart = pos;
-			return true;
-		}
-
-		return false;
-	}
-
-	int ImportHex(const CStringA &sToken) {		// // //
-		auto x = conv::to_int(sToken, 16);
-		if (!x)
-			throw MakeError("hexadecimal number expected, '%s' found.", (LPCSTR)sToken);
-		return *x;
-	}
-
-	template <typename... Args>
-	auto MakeError(LPCSTR fmt, Args&&... args) const {		// // //
-		CStringA str = FormattedA("Line %d column %d: ", line, GetColumn());
-		AppendFormatA(str, fmt, std::forward<Args>(args)...);
-		return std::runtime_error {(LPCSTR)str};
-	}
-
-	stChanNote ImportCellText(unsigned fxMax, stChannelID chan) {		// // //
-		stChanNote Cell;		// // //
-
-		CStringA sNote = ReadToken();
-		if (sNote == "...") { Cell.Note = note_t::none; }
-		else if (sNote == "---") { Cell.Note = note_t::halt; }
-		else if (sNote == "===") { Cell.Note = note_t::release; }
-		else {
-			if (sNote.GetLength() != 3)
-				throw MakeError("note column should be 3 characters wide, '%s' found.", (LPCSTR)sNote);
-
-			if (IsAPUNoise(chan)) {		// // // noise
-				int h = ImportHex(sNote.Left(1));		// // //
-				Cell.Note = ft0cc::doc::pitch_from_midi(h);
-				Cell.Octave = ft0cc::doc::oct_from_midi(h);
-
-				// importer is very tolerant about the second and third characters
-				// in a noise note, they can be anything
-			}
-			else if (sNote.GetAt(0) == '^' && sNote.GetAt(1) == '-') {		// // //
-				unsigned o = sNote.GetAt(2) - '0';
-				if (o >= ECHO_BUFFER_LENGTH)
-					throw MakeError("out-of-bound echo buffer accessed.");
-				Cell.Note = note_t::echo;
-				Cell.Octave = o;
-			}
-			else {
-				int n = 1;
-				switch (sNote.GetAt(0)) {
-				case 'c': case 'C': n = value_cast(note_t::C); break;
-				case 'd': case 'D': n = value_cast(note_t::D); break;
-				case 'e': case 'E': n = value_cast(note_t::E); break;
-				case 'f': case 'F': n = value_cast(note_t::F); break;
-				case 'g': case 'G': n = value_cast(note_t::G); break;
-				case 'a': case 'A': n = value_cast(note_t::A); break;
-				case 'b': case 'B': n = value_cast(note_t::B); break;
-				default:
-					throw MakeError("unrecognized note '%s'.", (LPCSTR)sNote);
-				}
-				switch (sNote.GetAt(1)) {
-				case '-': case '.': break;
-				case '#': case '+': ++n; break;
-				case 'b': case 'f': --n; break;
-				default:
-					throw MakeError("unrecognized note '%s'.", (LPCSTR)sNote);
-				}
-				while (n < value_cast(note_t::C)) n += NOTE_RANGE;
-				while (n > value_cast(note_t::B)) n -= NOTE_RANGE;
-				Cell.Note = enum_cast<note_t>(n);
-
-				int o = sNote.GetAt(2) - '0';
-				if (o < 0 || o >= OCTAVE_RANGE) {
-					throw MakeError("unrecognized octave '%s'.", (LPCSTR)sNote);
-				}
-				Cell.Octave = o;
-			}
-		}
-
-		CStringA sInst = ReadToken();
-		if (sInst == "..") { Cell.Instrument = MAX_INSTRUMENTS; }
-		else if (sInst == "&&") { Cell.Instrument = HOLD_INSTRUMENT; }		// // // 050B
-		else {
-			if (sInst.GetLength() != 2)
-				throw MakeError("instrument column should be 2 characters wide, '%s' found.", (LPCSTR)sInst);
-			int h = ImportHex(sInst);		// // //
-			if (h >= MAX_INSTRUMENTS)
-				throw MakeError("instrument '%s' is out of bounds.", (LPCSTR)sInst);
-			Cell.Instrument = h;
-		}
-
-		Cell.Vol = [&] (const CStringA &str) -> unsigned {
-			if (str == ".")
-				return MAX_VOLUME;
-			const LPCSTR VOL_TEXT[] = {
-				"0", "1", "2", "3", "4", "5", "6", "7",
-				"8", "9", "A", "B", "C", "D", "E", "F",
-			};
-			unsigned v = 0;
-			for (; v < std::size(VOL_TEXT); ++v)
-				if (str == VOL_TEXT[v])
-					return v;
-			throw MakeError("unrecognized volume token '%s'.", (LPCSTR)str);
-		}(ReadToken().MakeUpper());
-
-		for (unsigned int e = 0; e < fxMax; ++e) {		// // //
-			CStringA sEff = ReadToken().MakeUpper();
-			if (sEff.GetLength() != 3)
-				throw MakeError("effect column should be 3 characters wide, '%s' found.", (LPCSTR)sEff);
-
-			if (sEff != "...") {
-				effect_t Eff = FTEnv.GetSoundChipService()->TranslateEffectName(sEff.GetAt(0), chan.Chip);		// // //
-				if (Eff == effect_t::none)
-					throw MakeError("unrecognized effect '%s'.", (LPCSTR)sEff);
-				Cell.Effects[e] = {Eff, static_cast<uint8_t>(ImportHex(sEff.Right(2)))};		// // //
-			}
-		}
-
-		last_pos_ = pos;
-		return Cell;
-	}
-
-private:
-	bool TrimChar(char ch) {
-		if (!Finished())
-			if (char x = text.GetAt(pos); x == ch) {
-				++pos;
-				return true;
-			}
-		return false;
-	}
-
-	void ConsumeSpace() {
-		while (TrimChar(' ') || TrimChar('\t'))		// // //
-			;
-	}
-
-	CStringA ReadFromFile(const fs::path &FileName) {
-		CFileException oFileException;
-		if (CStdioFile f; f.Open(FileName.c_str(), CFile::modeRead | CFile::typeBinary, &oFileException)) {
-			CStringA str;
-			while (f.GetPosition() < f.GetLength()) {
-				char buf[1024] = { };
-				ULONGLONG sz = std::min(f.GetLength() - f.GetPosition(), (ULONGLONG)std::size(buf));
-				f.Read(buf, (UINT)sz);
-				CStringA part(buf, (int)sz);
-				part.Replace("\r", "");
-				str += part;
-			}
-			f.Close();
-			return str;
-		}
-
-		WCHAR szError[256];
-		oFileException.GetErrorMessage(szError, std::size(szError));
-		throw std::runtime_error {"Unable to open file:\n" + conv::to_utf8(szError)};
-	}
-
-public:
-	int line = 1;
-
-private:
-	const CStringA text; // TODO: move outside and use string_view
-	int pos = 0;
-	int linestart = 0;
-	int last_pos_ = 0;		// // //
-};
-
-// =============================================================================
-
-CStringA CTextExport::ExportString(const CStringA &s)
-{
-	return ExportString(std::string_view {(LPCSTR)s});
-}
-
-CStringA CTextExport::ExportString(std::string_view s)		// // //
+std::string CTextExport::ExportString(std::string_view s)		// // //
 {
 	// puts " at beginning and end of string, replace " with ""
-	CStringA r = "\"";
+	std::string r = "\"";
 	for (char c : s) {
 		if (c == '\"')
 			r += c;
@@ -474,34 +187,14 @@ CStringA CTextExport::ExportString(std::string_view s)		// // //
 
 CStringA CTextExport::ExportCellText(const stChanNote &stCell, unsigned int nEffects, bool bNoise)		// // //
 {
-	CStringA s = "...";
-	if (bNoise && (is_note(stCell.Note) || stCell.Note == note_t::echo))		// // //
-		s = FormattedA("%01X-#", stCell.ToMidiNote() & 0x0F);
-	else if (stCell.Note <= note_t::echo)
-		s = GetNoteString(stCell).data();
-
-	s += (stCell.Instrument == MAX_INSTRUMENTS) ? CStringA(" ..") :
-		(stCell.Instrument == HOLD_INSTRUMENT) ? CStringA(" &&") : FormattedA(" %02X", stCell.Instrument);		// // // 050B
-
-	s += (stCell.Vol == 0x10) ? CStringA(" .") : FormattedA(" %01X", stCell.Vol);		// // //
-
-	for (unsigned int e=0; e < nEffects; ++e)
-		if (stCell.Effects[e].fx == effect_t::none)
-			s.Append(" ...");
-		else
-			AppendFormatA(s, " %c%02X", EFF_CHAR[value_cast(stCell.Effects[e].fx)], stCell.Effects[e].param);
-
-	return s;
+	std::string s;
+	AppendCellText(s, stCell, nEffects, bNoise, FTEnv.GetSettings()->Appearance.bDisplayFlats);
+	return CStringA(s.data(), static_cast<int>(s.size()));
 }
 
 // =============================================================================
 
-#define CHECK_SYMBOL(x) do { \
-		if (CStringA symbol_ = t.ReadToken(); symbol_ != x) \
-			throw t.MakeError("expected '%s', '%s' found.", (LPCSTR)x, (LPCSTR)symbol_); \
-	} while (false)
-
-#define CHECK_COLON() CHECK_SYMBOL(":")
+#define CHECK_COLON() t.ReadSymbol(":")
 
 void CTextExport::ImportFile(const fs::path &FileName, CFamiTrackerDoc &Doc) {
 	// begin a new document
@@ -509,7 +202,7 @@ void CTextExport::ImportFile(const fs::path &FileName, CFamiTrackerDoc &Doc) {
 		throw std::runtime_error {"Unable to create new Famitracker document."};
 
 	// parse the file
-	Tokenizer t(FileName);		// // //
+	CTextTokenizer t {FileName};		// // //
 
 	auto &modfile = *Doc.GetModule();		// // //
 	auto &InstManager = *modfile.GetInstrumentManager();
@@ -521,14 +214,23 @@ void CTextExport::ImportFile(const fs::path &FileName, CFamiTrackerDoc &Doc) {
 	unsigned int pattern = 0;
 	int N163count = -1;		// // //
 	bool UseGroove[MAX_TRACKS] = {};		// // //
+	std::array<std::unique_ptr<text_effect_table_t>, SOUND_CHIP_COUNT> EffectTables;		// // //
+	const auto GetEffectTable = [&] (sound_chip_t chip) -> const text_effect_table_t & {
+		auto &pTable = EffectTables[value_cast(chip)];
+		if (!pTable)
+			pTable = std::make_unique<text_effect_table_t>(MakeTextEffectTable([chip] (char ch) {
+				return FTEnv.GetSoundChipService()->TranslateEffectName(ch, chip);
+			}));
+		return *pTable;
+	};
 	while (!t.Finished()) {
 		// read first token on line
 		if (t.IsEOL()) continue; // blank line
-		CStringA command = t.ReadToken().MakeUpper();		// // //
+		std::string_view command = t.ReadToken();		// // //
 
 		int c = 0;
 		for (; c < CT_COUNT; ++c)
-			if (command == CT[c]) break;
+			if (TextEqualsNoCase(command, CT[c])) break;
 
 		//DEBUG_OUT("Command read: %s\n", command);
 		switch (c) {
@@ -536,15 +238,15 @@ void CTextExport::ImportFile(const fs::path &FileName, CFamiTrackerDoc &Doc) {
 			t.FinishLine();
 			break;
 		case CT_TITLE:
-			modfile.SetModuleName(LPCSTR(t.ReadToken()));
+			modfile.SetModuleName(t.ReadToken());
 			t.ReadEOL();
 			break;
 		case CT_AUTHOR:
-			modfile.SetModuleArtist(LPCSTR(t.ReadToken()));
+			modfile.SetModuleArtist(t.ReadToken());
 			t.ReadEOL();
 			break;
 		case CT_COPYRIGHT:
-			modfile.SetModuleCopyright(LPCSTR(t.ReadToken()));
+			modfile.SetModuleCopyright(t.ReadToken());
 			t.ReadEOL();
 			break;
 		case CT_COMMENT:
@@ -641,7 +343,7 @@ void CTextExport::ImportFile(const fs::path &FileName, CFamiTrackerDoc &Doc) {
 			dpcm_index = t.ReadInt(0, MAX_DSAMPLES - 1);
 			dpcm_size = t.ReadInt(0, ft0cc::doc::dpcm_sample::max_size);
 			dpcm_sample = std::make_shared<ft0cc::doc::dpcm_sample>();		// // //
-			dpcm_sample->rename(LPCSTR(t.ReadToken()));
+			dpcm_sample->rename(t.ReadToken());
 
 			t.ReadEOL();
 		}
@@ -720,7 +422,7 @@ void CTextExport::ImportFile(const fs::path &FileName, CFamiTrackerDoc &Doc) {
 				pInstN163->SetWavePos(t.ReadInt(0, 256 - 16 * N163count - 1));
 				pInstN163->SetWaveCount(t.ReadInt(1, CInstrumentN163::MAX_WAVE_COUNT));
 			}
-			seqInst->SetName(LPCSTR(t.ReadToken()));
+			seqInst->SetName(t.ReadToken());
 			InstManager.InsertInstrument(inst_index, std::move(pInst));
 			t.ReadEOL();
 		}
@@ -732,7 +434,7 @@ void CTextExport::ImportFile(const fs::path &FileName, CFamiTrackerDoc &Doc) {
 			pInst->SetPatch(t.ReadInt(0, 15));
 			for (int r = 0; r < 8; ++r)
 				pInst->SetCustomReg(r, t.ReadHex(0x00, 0xFF));
-			pInst->SetName(LPCSTR(t.ReadToken()));
+			pInst->SetName(t.ReadToken());
 			InstManager.InsertInstrument(inst_index, std::move(pInst));
 			t.ReadEOL();
 		}
@@ -745,7 +447,7 @@ void CTextExport::ImportFile(const fs::path &FileName, CFamiTrackerDoc &Doc) {
 			pInst->SetModulationSpeed(t.ReadInt(0, 4095));
 			pInst->SetModulationDepth(t.ReadInt(0, 63));
 			pInst->SetModulationDelay(t.ReadInt(0, 255));
-			pInst->SetName(LPCSTR(t.ReadToken()));
+			pInst->SetName(t.ReadToken());
 			InstManager.InsertInstrument(inst_index, std::move(pInst));
 			t.ReadEOL();
 		}
@@ -846,7 +548,7 @@ void CTextExport::ImportFile(const fs::path &FileName, CFamiTrackerDoc &Doc) {
 			pSong->SetSongGroove(UseGroove[track]);		// // //
 			pSong->SetSongSpeed(t.ReadInt(0, MAX_TEMPO));
 			pSong->SetSongTempo(t.ReadInt(0, MAX_TEMPO));
-			pSong->SetTitle((LPCSTR)t.ReadToken());		// // //
+			pSong->SetTitle(t.ReadToken());		// // //
 
 			t.ReadEOL();
 			++track;
@@ -888,14 +590,14 @@ void CTextExport::ImportFile(const fs::path &FileName, CFamiTrackerDoc &Doc) {
 			modfile.GetChannelOrder().ForeachChannel([&] (stChannelID c) {
 				CHECK_COLON();
 				auto *pTrack = modfile.GetSong(track - 1)->GetTrack(c);		// // //
-				pTrack->GetPattern(pattern).SetNoteOn(row, t.ImportCellText(pTrack->GetEffectColumnCount(), c));
+				pTrack->GetPattern(pattern).SetNoteOn(row, t.ReadCell(pTrack->GetEffectColumnCount(), IsAPUNoise(c), GetEffectTable(c.Chip)));
 			});
 			t.ReadEOL();
 		}
 		break;
 		case CT_COUNT:
 		default:
-			throw t.MakeError("Unrecognized command: '%s'.", (LPCSTR)command);
+			throw t.MakeError("Unrecognized command: '%.*s'.", static_cast<int>(command.size()), command.data());
 		}
 	}
 
@@ -914,21 +616,12 @@ void CTextExport::ImportFile(const fs::path &FileName, CFamiTrackerDoc &Doc) {
 // =============================================================================
 
 CStringA CTextExport::ExportRows(const fs::path &FileName, const CFamiTrackerModule &modfile) {		// // //
-	CStdioFile f;
-	CFileException oFileException;
-	if (!f.Open(FileName.c_str(), CFile::modeCreate | CFile::modeWrite | CFile::typeText, &oFileException))
-	{
-		WCHAR szError[256];
-		oFileException.GetErrorMessage(szError, std::size(szError));
-
-		return FormattedA("Unable to open file:\n%s", conv::to_utf8(szError).data());
-	}
-
-	const auto WriteString = [&] (const CStringA &str) { // TODO: don't use CStdioFile
-		f.Write(str.GetString(), str.GetLength());
-	};
+	std::ofstream f {FileName};		// // //
+	if (!f)
+		return FormattedA("Unable to open file:\n%s", conv::to_utf8(FileName.native()).data());
+	CTextWriter w {f};
 
-	WriteString("ID,SONG,CHIP,SUBINDEX,PATTERN,ROW,NOTE,OCTAVE,INST,VOLUME,FX1,FX1PARAM,FX2,FX2PARAM,FX3,FX3PARAM,FX4,FX4PARAM\n");
+	w.Write("ID,SONG,CHIP,SUBINDEX,PATTERN,ROW,NOTE,OCTAVE,INST,VOLUME,FX1,FX1PARAM,FX2,FX2PARAM,FX3,FX3PARAM,FX4,FX4PARAM\n");
 
 	const LPCSTR FMT = "%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d\n";
 	int id = 0;
@@ -939,48 +632,43 @@ CStringA CTextExport::ExportRows(const fs::path &FileName, const CFamiTrackerMod
 			if (song.IsPatternInUse(c, p))
 				pat.VisitRows(rows, [&] (const stChanNote &stCell, unsigned r) {
 					if (stCell != stChanNote { })
-						WriteString(FormattedA(FMT, id++, t, value_cast(c.Chip), c.Subindex, p, r,
+						w.Format(FMT, id++, t, value_cast(c.Chip), c.Subindex, p, r,
 							stCell.Note, stCell.Octave, stCell.Instrument, stCell.Vol,
 							stCell.Effects[0].fx, stCell.Effects[0].param,
 							stCell.Effects[1].fx, stCell.Effects[1].param,
 							stCell.Effects[2].fx, stCell.Effects[2].param,
-							stCell.Effects[3].fx, stCell.Effects[3].param));
+							stCell.Effects[3].fx, stCell.Effects[3].param);
 				});
 		});
 	});
 
+	w.Flush();
+	if (!f)
+		return FormattedA("Unable to write file:\n%s", conv::to_utf8(FileName.native()).data());		// // //
 	return "";
 }
 
 CStringA CTextExport::ExportFile(const fs::path &FileName, CFamiTrackerDoc &Doc) {		// // //
-	CStdioFile f;
-	CFileException oFileException;
-	if (!f.Open(FileName.c_str(), CFile::modeCreate | CFile::modeWrite | CFile::typeText, &oFileException)) {
-		WCHAR szError[256];
-		oFileException.GetErrorMessage(szError, std::size(szError));
-
-		return FormattedA("Unable to open file:\n%s", conv::to_utf8(szError).data());
-	}
+	std::ofstream f {FileName};		// // //
+	if (!f)
+		return FormattedA("Unable to open file:\n%s", conv::to_utf8(FileName.native()).data());
+	CTextWriter w {f};
 
 	auto &modfile = *Doc.GetModule();		// // //
 
-	const auto WriteString = [&] (const CStringA &str) { // TODO: don't use CStdioFile
-		f.Write(str.GetString(), str.GetLength());
-	};
+	w.Format("# 0CC-FamiTracker text export %s\n\n", Get0CCFTVersionString());		// // //
 
-	WriteString(FormattedA("# 0CC-FamiTracker text export %s\n\n", Get0CCFTVersionString()));		// // //
+	w.Write("# Module information\n");
+	w.Format("%-15s %s\n", CT[CT_TITLE],     ExportString(modfile.GetModuleName()).data());
+	w.Format("%-15s %s\n", CT[CT_AUTHOR],    ExportString(modfile.GetModuleArtist()).data());
+	w.Format("%-15s %s\n", CT[CT_COPYRIGHT], ExportString(modfile.GetModuleCopyright()).data());
+	w.Write("\n");
 
-	WriteString("# Module information\n");
-	WriteString(FormattedA("%-15s %s\n", CT[CT_TITLE],     (LPCSTR)ExportString(modfile.GetModuleName())));
-	WriteString(FormattedA("%-15s %s\n", CT[CT_AUTHOR],    (LPCSTR)ExportString(modfile.GetModuleArtist())));
-	WriteString(FormattedA("%-15s %s\n", CT[CT_COPYRIGHT], (LPCSTR)ExportString(modfile.GetModuleCopyright())));
-	WriteString("\n");
-
-	WriteString("# Module comment\n");
+	w.Write("# Module comment\n");
 	std::string_view sComment = modfile.GetComment();		// // //
 	while (true) {
 		auto n = sComment.find_first_of("\r\n");
-		WriteString(FormattedA("%s %s\n", CT[CT_COMMENT], (LPCSTR)ExportString(sComment.substr(0, n))));
+		w.Format("%s %s\n", CT[CT_COMMENT], ExportString(sComment.substr(0, n)).data());
 		if (n == std::string_view::npos)
 			break;
 		sComment.remove_prefix(n);
@@ -989,30 +677,30 @@ CStringA CTextExport::ExportFile(const fs::path &FileName, CFamiTrackerDoc &Doc)
 		if (!sComment.empty() && sComment.front() == '\n')
 			sComment.remove_prefix(1);
 	}
-	WriteString("\n");
-
-	WriteString("# Global settings\n");
-	WriteString(FormattedA("%-15s %d\n", CT[CT_MACHINE],   modfile.GetMachine()));
-	WriteString(FormattedA("%-15s %d\n", CT[CT_FRAMERATE], modfile.GetEngineSpeed()));
-	WriteString(FormattedA("%-15s %d\n", CT[CT_EXPANSION], modfile.GetSoundChipSet().GetNSFFlag()));		// // //
-	WriteString(FormattedA("%-15s %d\n", CT[CT_VIBRATO],   modfile.GetVibratoStyle()));
-	WriteString(FormattedA("%-15s %d\n", CT[CT_SPLIT],     modfile.GetSpeedSplitPoint()));
-//	WriteString(FormattedA("%-15s %d %d\n", CT[CT_PLAYBACKRATE]));
+	w.Write("\n");
+
+	w.Write("# Global settings\n");
+	w.Format("%-15s %d\n", CT[CT_MACHINE],   modfile.GetMachine());
+	w.Format("%-15s %d\n", CT[CT_FRAMERATE], modfile.GetEngineSpeed());
+	w.Format("%-15s %d\n", CT[CT_EXPANSION], modfile.GetSoundChipSet().GetNSFFlag());		// // //
+	w.Format("%-15s %d\n", CT[CT_VIBRATO],   modfile.GetVibratoStyle());
+	w.Format("%-15s %d\n", CT[CT_SPLIT],     modfile.GetSpeedSplitPoint());
+//	w.Format("%-15s %d %d\n", CT[CT_PLAYBACKRATE]);
 	if (modfile.GetTuningSemitone() || modfile.GetTuningCent())		// // // 050B
-		WriteString(FormattedA("%-15s %d %d\n", CT[CT_TUNING], modfile.GetTuningSemitone(), modfile.GetTuningCent()));
-	WriteString("\n");
+		w.Format("%-15s %d %d\n", CT[CT_TUNING], modfile.GetTuningSemitone(), modfile.GetTuningCent());
+	w.Write("\n");
 
 	int N163count = -1;		// // //
 	if (modfile.HasExpansionChip(sound_chip_t::N163)) {
 		N163count = modfile.GetNamcoChannels();
 		modfile.SetChannelMap(FTEnv.GetSoundChipService()->MakeChannelMap(modfile.GetSoundChipSet(), MAX_CHANNELS_N163));
-		WriteString(FormattedA("# Namco 163 global settings\n"
+		w.Format("# Namco 163 global settings\n"
 			"%-15s %d\n"
 			"\n",
-			CT[CT_N163CHANNELS], N163count));
+			CT[CT_N163CHANNELS], N163count);
 	}
 
-	WriteString("# Macros\n");
+	w.Write("# Macros\n");
 	const auto &InstManager = *modfile.GetInstrumentManager();
 	const inst_type_t CHIP_MACRO[4] = { INST_2A03, INST_VRC6, INST_N163, INST_S5B };
 	for (int c=0; c<4; ++c) {
@@ -1020,81 +708,80 @@ CStringA CTextExport::ExportFile(const fs::path &FileName, CFamiTrackerDoc &Doc)
 			for (int seq = 0; seq < MAX_SEQUENCES; ++seq) {
 				const auto pSequence = InstManager.GetSequence(CHIP_MACRO[c], st, seq);
 				if (pSequence && pSequence->GetItemCount() > 0) {
-					WriteString(FormattedA("%-9s %3d %3d %3d %3d %3d :",
+					w.Format("%-9s %3d %3d %3d %3d %3d :",
 						CT[CT_MACRO + c],
 						st,
 						seq,
 						pSequence->GetLoopPoint(),
 						pSequence->GetReleasePoint(),
-						pSequence->GetSetting()));
+						pSequence->GetSetting());
 					for (unsigned int i = 0; i < pSequence->GetItemCount(); ++i)
-						WriteString(FormattedA(" %d", pSequence->GetItem(i)));
-					WriteString("\n");
+						w.Format(" %d", pSequence->GetItem(i));
+					w.Write("\n");
 				}
 			}
 		}
 	}
-	WriteString("\n");
+	w.Write("\n");
 
-	WriteString("# DPCM samples\n");
+	w.Write("# DPCM samples\n");
 	for (int smp=0; smp < MAX_DSAMPLES; ++smp)
 	{
 		if (auto pSample = modfile.GetDSampleManager()->GetDSample(smp)) {		// // //
 			const unsigned int size = pSample->size();
-			WriteString(FormattedA("%s %3d %5d %s\n",
+			w.Format("%s %3d %5d %s\n",
 				CT[CT_DPCMDEF],
 				smp,
 				size,
-				(LPCSTR)ExportString(pSample->name())));
+				ExportString(pSample->name()).data());
 
 			for (unsigned int i=0; i < size; i += 32)
 			{
-				WriteString(FormattedA("%s :", CT[CT_DPCM]));
+				w.Format("%s :", CT[CT_DPCM]);
 				for (unsigned int j=0; j<32 && (i+j)<size; ++j)
-					WriteString(FormattedA(" %02X", pSample->sample_at(i + j)));
-				WriteString("\n");
+					w.Format(" %02X", pSample->sample_at(i + j));
+				w.Write("\n");
 			}
 		}
 	}
-	WriteString("\n");
+	w.Write("\n");
 
-	WriteString("# Detune settings\n");		// // //
+	w.Write("# Detune settings\n");		// // //
 	for (int i = 0; i < 6; ++i) for (int j = 0; j < NOTE_COUNT; ++j) {
 		int Offset = modfile.GetDetuneOffset(i, j);
 		if (Offset != 0) {
-			WriteString(FormattedA("%s %3d %3d %3d %5d\n", CT[CT_DETUNE], i, j / NOTE_RANGE, j % NOTE_RANGE, Offset));
+			w.Format("%s %3d %3d %3d %5d\n", CT[CT_DETUNE], i, j / NOTE_RANGE, j % NOTE_RANGE, Offset);
 		}
 	}
-	WriteString("\n");
+	w.Write("\n");
 
-	WriteString("# Grooves\n");		// // //
+	w.Write("# Grooves\n");		// // //
 	for (int i = 0; i < MAX_GROOVE; ++i) {
 		if (const auto pGroove = modfile.GetGroove(i)) {
-			WriteString(FormattedA("%s %3d %3d :", CT[CT_GROOVE], i, pGroove->size()));
+			w.Format("%s %3d %3d :", CT[CT_GROOVE], i, pGroove->size());
 			for (uint8_t entry : *pGroove)
-				WriteString(FormattedA(" %d", entry));
-			WriteString("\n");
+				w.Format(" %d", entry);
+			w.Write("\n");
 		}
 	}
-	WriteString("\n");
+	w.Write("\n");
 
-	WriteString("# Tracks using default groove\n");		// // //
+	w.Write("# Tracks using default groove\n");		// // //
 	bool UsedGroove = false;
 	modfile.VisitSongs([&] (const CSongData &song) {
 		if (song.GetSongGroove())
 			UsedGroove = true;
 	});
 	if (UsedGroove) {
-		CStringA s = FormattedA("%s :", CT[CT_USEGROOVE]);
+		w.Format("%s :", CT[CT_USEGROOVE]);
 		modfile.VisitSongs([&] (const CSongData &song, unsigned index) {
 			if (song.GetSongGroove())
-				AppendFormatA(s, " %d", index + 1);
+				w.Format(" %d", index + 1);
 		});
-		WriteString(s);
-		WriteString("\n\n");
+		w.Write("\n\n");
 	}
 
-	WriteString("# Instruments\n");
+	w.Write("# Instruments\n");
 	for (unsigned int i=0; i<MAX_INSTRUMENTS; ++i) {
 		auto pInst = InstManager.GetInstrument(i);
 		if (!pInst) continue;
@@ -1110,14 +797,12 @@ CStringA CTextExport::ExportFile(const fs::path &FileName, CFamiTrackerDoc &Doc)
 		case INST_NONE: default:
 			continue;
 		}
-		WriteString(FormattedA("%-8s %3d   ", CTstr, i));
+		w.Format("%-8s %3d   ", CTstr, i);
 
 		if (auto seqInst = std::dynamic_pointer_cast<CSeqInstrument>(pInst)) {
 			if (seqInst->GetType() != INST_FDS) {
-				CStringA s;
 				for (auto j : enum_values<sequence_t>())
-					AppendFormatA(s, "%3d ", seqInst->GetSeqEnable(j) ? seqInst->GetSeqIndex(j) : -1);
-				WriteString(s);
+					w.Format("%3d ", seqInst->GetSeqEnable(j) ? seqInst->GetSeqIndex(j) : -1);
 			}
 		}
 
@@ -1126,35 +811,34 @@ CStringA CTextExport::ExportFile(const fs::path &FileName, CFamiTrackerDoc &Doc)
 		case INST_N163:
 			{
 				auto pDI = std::static_pointer_cast<CInstrumentN163>(pInst);
-				WriteString(FormattedA("%3d %3d %3d ",
+				w.Format("%3d %3d %3d ",
 					pDI->GetWaveSize(),
 					pDI->GetWavePos(),
-					pDI->GetWaveCount()));
+					pDI->GetWaveCount());
 			}
 			break;
 		case INST_VRC7:
 			{
 				auto pDI = std::static_pointer_cast<CInstrumentVRC7>(pInst);
-				CStringA patch = FormattedA("%3d ", pDI->GetPatch());
+				w.Format("%3d ", pDI->GetPatch());
 				for (int j = 0; j < 8; ++j)
-					AppendFormatA(patch, "%02X ", pDI->GetCustomReg(j));
-				WriteString(patch);
+					w.Format("%02X ", pDI->GetCustomReg(j));
 			}
 			break;
 		case INST_FDS:
 			{
 				auto pDI = std::static_pointer_cast<CInstrumentFDS>(pInst);
-				WriteString(FormattedA("%3d %3d %3d %3d ",
+				w.Format("%3d %3d %3d %3d ",
 					pDI->GetModulationEnable(),
 					pDI->GetModulationSpeed(),
 					pDI->GetModulationDepth(),
-					pDI->GetModulationDelay()));
+					pDI->GetModulationDelay());
 			}
 			break;
 		}
 
-		WriteString((LPCSTR)ExportString(pInst->GetName()));
-		WriteString("\n");
+		w.Write(ExportString(pInst->GetName()));
+		w.Write("\n");
 
 		switch (pInst->GetType())
 		{
@@ -1164,7 +848,7 @@ CStringA CTextExport::ExportFile(const fs::path &FileName, CFamiTrackerDoc &Doc)
 				for (int n = 0; n < NOTE_COUNT; ++n) {
 					if (unsigned smp = pDI->GetSampleIndex(n); smp != CInstrument2A03::NO_DPCM) {
 						int d = pDI->GetSampleDeltaValue(n);
-						WriteString(FormattedA("%s %3d %3d %3d   %3u %3d %3d %5d %3d\n",
+						w.Format("%s %3d %3d %3d   %3u %3d %3d %5d %3d\n",
 							CT[CT_KEYDPCM],
 							i,
 							ft0cc::doc::oct_from_midi(n), value_cast(ft0cc::doc::pitch_from_midi(n)) - 1,
@@ -1172,7 +856,7 @@ CStringA CTextExport::ExportFile(const fs::path &FileName, CFamiTrackerDoc &Doc)
 							pDI->GetSamplePitch(n) & 0x0F,
 							pDI->GetSampleLoop(n) ? 1 : 0,
 							pDI->GetSampleLoopOffset(n),
-							(d >= 0 && d <= 127) ? d : -1));
+							(d >= 0 && d <= 127) ? d : -1);
 					}
 				}
 			}
@@ -1180,78 +864,79 @@ CStringA CTextExport::ExportFile(const fs::path &FileName, CFamiTrackerDoc &Doc)
 		case INST_N163:
 			{
 				auto pDI = std::static_pointer_cast<CInstrumentN163>(pInst);
-				for (int w=0; w < pDI->GetWaveCount(); ++w)
+				for (int iw = 0; iw < pDI->GetWaveCount(); ++iw)		// // //
 				{
-					WriteString(FormattedA("%s %3d %3d :", CT[CT_N163WAVE], i, w));
+					w.Format("%s %3d %3d :", CT[CT_N163WAVE], i, iw);
 
-					for (int smp : pDI->GetSamples(w))		// // //
-						WriteString(FormattedA(" %d", smp));
-					WriteString("\n");
+					for (int smp : pDI->GetSamples(iw))		// // //
+						w.Format(" %d", smp);
+					w.Write("\n");
 				}
 			}
 			break;
 		case INST_FDS:
 			{
 				auto pDI = std::static_pointer_cast<CInstrumentFDS>(pInst);
-				WriteString(FormattedA("%-8s %3d :", CT[CT_FDSWAVE], i));
+				w.Format("%-8s %3d :", CT[CT_FDSWAVE], i);
 				for (unsigned char smp : pDI->GetSamples())		// // //
-					WriteString(FormattedA(" %2d", smp));
-				WriteString("\n");
+					w.Format(" %2d", smp);
+				w.Write("\n");
 
-				WriteString(FormattedA("%-8s %3d :", CT[CT_FDSMOD], i));
+				w.Format("%-8s %3d :", CT[CT_FDSMOD], i);
 				for (unsigned char m : pDI->GetModTable()) {		// // //
-					WriteString(FormattedA(" %2d", m));
+					w.Format(" %2d", m);
 				}
-				WriteString("\n");
+				w.Write("\n");
 
 				for (auto seq : enum_values<sequence_t>()) {
 					const auto pSequence = pDI->GetSequence(seq);		// // //
 					if (!pSequence || pSequence->GetItemCount() < 1)
 						continue;
 
-					WriteString(FormattedA("%-8s %3d %3d %3d %3d %3d :",
+					w.Format("%-8s %3d %3d %3d %3d %3d :",
 						CT[CT_FDSMACRO],
 						i,
 						seq,
 						pSequence->GetLoopPoint(),
 						pSequence->GetReleasePoint(),
-						pSequence->GetSetting()));
+						pSequence->GetSetting());
 					for (unsigned int j=0; j < pSequence->GetItemCount(); ++j)
-						WriteString(FormattedA(" %d", pSequence->GetItem(j)));
-					WriteString("\n");
+						w.Format(" %d", pSequence->GetItem(j));
+					w.Write("\n");
 				}
 			}
 			break;
 		}
 	}
-	WriteString("\n");
+	w.Write("\n");
 
-	WriteString("# Tracks\n\n");
+	w.Write("# Tracks\n\n");
 
 	const CChannelOrder &order = modfile.GetChannelOrder();		// // //
+	const bool bFlats = FTEnv.GetSettings()->Appearance.bDisplayFlats;		// // //
 
 	modfile.VisitSongs([&] (const CSongData &song) {
-		WriteString(FormattedA("%s %3d %3d %3d %s\n",
+		w.Format("%s %3d %3d %3d %s\n",
 			CT[CT_TRACK],
 			song.GetPatternLength(),
 			song.GetSongSpeed(),
 			song.GetSongTempo(),
-			(LPCSTR)ExportString(song.GetTitle())));
+			ExportString(song.GetTitle()).data());
 
-		WriteString(FormattedA("%s :", CT[CT_COLUMNS]));
+		w.Format("%s :", CT[CT_COLUMNS]);
 		order.ForeachChannel([&] (stChannelID c) {
-			WriteString(FormattedA(" %d", song.GetEffectColumnCount(c)));
+			w.Format(" %d", song.GetEffectColumnCount(c));
 		});
-		WriteString("\n\n");
+		w.Write("\n\n");
 
 		for (unsigned int o=0; o < song.GetFrameCount(); ++o) {
-			WriteString(FormattedA("%s %02X :", CT[CT_ORDER], o));
+			w.Format("%s %02X :", CT[CT_ORDER], o);
 			order.ForeachChannel([&] (stChannelID c) {
-				WriteString(FormattedA(" %02X", song.GetFramePattern(o, c)));
+				w.Format(" %02X", song.GetFramePattern(o, c));
 			});
-			WriteString("\n");
+			w.Write("\n");
 		}
-		WriteString("\n");
+		w.Write("\n");
 
 		for (int p=0; p < MAX_PATTERN; ++p)
 		{
@@ -1264,24 +949,28 @@ CStringA CTextExport::ExportFile(const fs::path &FileName, CFamiTrackerDoc &Doc)
 			if (!bUsed)
 				continue;
 
-			WriteString(FormattedA("%s %02X\n", CT[CT_PATTERN], p));
+			w.Format("%s %02X\n", CT[CT_PATTERN], p);
 
 			for (unsigned int r=0; r < song.GetPatternLength(); ++r) {
-				WriteString(FormattedA("%s %02X", CT[CT_ROW], r));
+				w.Format("%s %02X", CT[CT_ROW], r);
 				order.ForeachChannel([&] (stChannelID c) {
-					WriteString(" : ");
-					WriteString(ExportCellText(song.GetPattern(c, p).GetNoteOn(r), song.GetEffectColumnCount(c), IsAPUNoise(c)));		// // //
+					w.Write(" : ");
+					w.WriteCell(song.GetPattern(c, p).GetNoteOn(r), song.GetEffectColumnCount(c), IsAPUNoise(c), bFlats);		// // //
 				});
-				WriteString("\n");
+				w.Write("\n");
 			}
-			WriteString("\n");
+			w.Write("\n");
 		}
 	});
 
 	if (N163count != -1)		// // //
 		modfile.SetChannelMap(FTEnv.GetSoundChipService()->MakeChannelMap(modfile.GetSoundChipSet(), N163count));
-	WriteString("# End of export\n");
+	w.Write("# End of export\n");
 	FTEnv.GetSoundGenerator()->ModuleChipChanged();		// // //
+
+	w.Flush();
+	if (!f)
+		return FormattedA("Unable to write file:\n%s", conv::to_utf8(FileName.native()).data());		// // //
 	return "";
 }
 
@@ -24,6 +24,7 @@
 #pragma once
 
 #include "stdafx.h"		// // //
+#include <string>		// // //
 #include <string_view>		// // //
 #include "ft0cc/fs.h"		// // //
 
@@ -41,6 +42,5 @@ struct CTextExport {
 	CStringA ExportRows(const fs::path &FileName, const CFamiTrackerModule &modfile);		// // //
 
 private:		// // //
-	static CStringA ExportString(const CStringA &s);
-	static CStringA ExportString(std::string_view s);
+	static std::string ExportString(std::string_view s);
 };
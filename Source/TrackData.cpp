@@ -22,19 +22,54 @@
 
 #include "TrackData.h"
 
+void CTrackLoader::LoadInto(std::array<CPatternData, MAX_PATTERN> &patterns) {		// // //
+	std::call_once(once_, [&] {
+		patterns = LoadPatterns();
+		loaded_ = true;
+	});
+}
+
+bool CTrackLoader::IsLoaded() const {
+	return loaded_;
+}
+
+
+
+CTrackData::CTrackData(const CTrackData &other) :		// // //
+	m_iFrameList(other.m_iFrameList), m_iEffectColumns(other.m_iEffectColumns)
+{
+	other.EnsureLoaded();
+	m_pPatternData = other.m_pPatternData;
+}
+
+CTrackData &CTrackData::operator=(const CTrackData &other) {		// // //
+	if (this != &other) {
+		other.EnsureLoaded();
+		m_pPatternData = other.m_pPatternData;
+		m_pLoader.reset();
+		m_iFrameList = other.m_iFrameList;
+		m_iEffectColumns = other.m_iEffectColumns;
+	}
+	return *this;
+}
+
 CPatternData &CTrackData::GetPattern(unsigned Pattern) {
+	EnsureLoaded();		// // //
 	return m_pPatternData.at(Pattern);
 }
 
 const CPatternData &CTrackData::GetPattern(unsigned Pattern) const {
+	EnsureLoaded();		// // //
 	return m_pPatternData.at(Pattern);
 }
 
 CPatternData &CTrackData::GetPatternOnFrame(unsigned Frame) {
+	EnsureLoaded();		// // //
 	return m_pPatternData.at(GetFramePattern(Frame));
 }
 
 const CPatternData &CTrackData::GetPatternOnFrame(unsigned Frame) const {
+	EnsureLoaded();		// // //
 	return m_pPatternData.at(GetFramePattern(Frame));
 }
 
@@ -54,3 +89,28 @@ unsigned CTrackData::GetEffectColumnCount() const {
 void CTrackData::SetEffectColumnCount(unsigned Count) {
 	m_iEffectColumns = Count;
 }
+
+void CTrackData::SetLoader(std::shared_ptr<CTrackLoader> pLoader) {		// // //
+	m_pLoader = std::move(pLoader);
+}
+
+std::weak_ptr<CTrackLoader> CTrackData::GetLoader() const {
+	return m_pLoader;
+}
+
+bool CTrackData::IsLoaded() const {
+	return !m_pLoader || m_pLoader->IsLoaded();
+}
+
+void CTrackData::EnsureLoaded() {
+	if (m_pLoader) {
+		m_pLoader->LoadInto(m_pPatternData);
+		m_pLoader.reset();
+	}
+}
+
+void CTrackData::EnsureLoaded() const {
+	// the loader is only released by non-const accesses, which must not run concurrently with other accesses
+	if (m_pLoader)
+		m_pLoader->LoadInto(m_pPatternData);
+}
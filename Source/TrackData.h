@@ -24,10 +24,40 @@
 #pragma once
 
 #include <array>
+#include <memory>		// // //
+#include <mutex>
+#include <atomic>
 #include "PatternData.h"
 
+// // // supplies the pattern data of a track the first time it is accessed
+class CTrackLoader {
+public:
+	virtual ~CTrackLoader() noexcept = default;
+
+	// decodes the patterns exactly once, even if several threads access the track at the same time;
+	// if decoding throws, the exception propagates and the next access tries again
+	void LoadInto(std::array<CPatternData, MAX_PATTERN> &patterns);
+	bool IsLoaded() const;
+
+	// decodes the patterns ahead of time without touching the track
+	virtual void Prefetch() { }
+
+private:
+	virtual std::array<CPatternData, MAX_PATTERN> LoadPatterns() = 0;
+
+	std::once_flag once_;
+	std::atomic<bool> loaded_ = false;
+};
+
 class CTrackData {
 public:
+	CTrackData() = default;
+	// // // copies decode the source track first and never share its loader
+	CTrackData(const CTrackData &other);
+	CTrackData(CTrackData &&other) = default;
+	CTrackData &operator=(const CTrackData &other);
+	CTrackData &operator=(CTrackData &&other) = default;
+
 	CPatternData &GetPattern(unsigned Pattern);		// // //
 	const CPatternData &GetPattern(unsigned Pattern) const;		// // //
 
@@ -40,9 +70,15 @@ public:
 	unsigned GetEffectColumnCount() const;
 	void SetEffectColumnCount(unsigned Count);
 
+	// // // lazy loading
+	void SetLoader(std::shared_ptr<CTrackLoader> pLoader);
+	std::weak_ptr<CTrackLoader> GetLoader() const;
+	bool IsLoaded() const;
+
 	// void (*F)(CPatternData &pattern [, std::size_t p_index])
 	template <typename F>
 	void VisitPatterns(F f) {
+		EnsureLoaded();		// // //
 		if constexpr (std::is_invocable_v<F, CPatternData &, std::size_t>) {
 			std::size_t p_index = 0;
 			for (auto &pattern : m_pPatternData)
@@ -59,6 +95,7 @@ public:
 	// void (*F)(const CPatternData &pattern [, std::size_t p_index])
 	template <typename F>
 	void VisitPatterns(F f) const {
+		EnsureLoaded();		// // //
 		if constexpr (std::is_invocable_v<F, const CPatternData &, std::size_t>) {
 			std::size_t p_index = 0;
 			for (auto &pattern : m_pPatternData)
@@ -73,7 +110,12 @@ public:
 	}
 
 private:
-	std::array<CPatternData, MAX_PATTERN> m_pPatternData = { };
+	void EnsureLoaded();		// // //
+	void EnsureLoaded() const;
+
+private:
+	mutable std::array<CPatternData, MAX_PATTERN> m_pPatternData = { };		// // // filled in once by m_pLoader
+	std::shared_ptr<CTrackLoader> m_pLoader;		// // //
 	std::array<unsigned int, MAX_FRAMES> m_iFrameList = { };
 	unsigned char m_iEffectColumns = 1;		// // //
 };
@@ -23,15 +23,12 @@
 #include "TransposeDlg.h"
 #include "FamiTrackerDoc.h"
 #include "FamiTrackerModule.h"
-#include "SongData.h"
 #include "FamiTrackerViewMessage.h"
-#include "PatternNote.h"
+#include "ModuleAction.h"		// // //
 #include "Instrument.h"
 #include "InstrumentManager.h"
 #include "MainFrm.h"
 #include "DPI.h"
-#include "APU/Types.h"
-#include <algorithm>
 
 // CTransposeDlg dialog
 
@@ -56,22 +53,6 @@ void CTransposeDlg::DoDataExchange(CDataExchange* pDX)
 	CDialog::DoDataExchange(pDX);
 }
 
-void CTransposeDlg::Transpose(int Trsp, CSongData &song) {
-	song.VisitPatterns([&] (CPatternData &pat, stChannelID c, unsigned) {
-		if (IsAPUNoise(c) || IsDPCM(c))
-			return;
-		pat.VisitRows([&] (stChanNote &note) {
-			if (note.Instrument == MAX_INSTRUMENTS || note.Instrument == HOLD_INSTRUMENT)
-				return;
-			if (is_note(note.Note) && !s_bDisableInst[note.Instrument]) {
-				int MIDI = std::clamp(note.ToMidiNote() + Trsp, 0, NOTE_COUNT - 1);
-				note.Octave = ft0cc::doc::oct_from_midi(MIDI);
-				note.Note = ft0cc::doc::pitch_from_midi(MIDI);
-			}
-		});
-	});
-}
-
 BEGIN_MESSAGE_MAP(CTransposeDlg, CDialog)
 	ON_BN_CLICKED(IDOK, &CTransposeDlg::OnBnClickedOk)
 	ON_CONTROL_RANGE(BN_CLICKED, BUTTON_ID, BUTTON_ID + MAX_INSTRUMENTS - 1, OnBnClickedInst)
@@ -124,17 +105,15 @@ void CTransposeDlg::OnBnClickedOk()
 		Trsp = -Trsp;
 
 	if (Trsp) {
-		auto *pModule = m_pDocument->GetModule();
+		std::vector<unsigned> songs;		// // //
 		if (All)
-			pModule->VisitSongs([Trsp] (CSongData &song) {
-				Transpose(Trsp, song);
-			});
+			for (unsigned i = 0, n = m_pDocument->GetModule()->GetSongCount(); i < n; ++i)
+				songs.push_back(i);
 		else
-			Transpose(Trsp, *pModule->GetSong(m_iTrack));
+			songs.push_back(m_iTrack);
 
-		m_pDocument->UpdateAllViews(NULL, UPDATE_PATTERN);
-		m_pDocument->ModifyIrreversible();
-		((CMainFrame *)AfxGetMainWnd())->ResetUndo();
+		static_cast<CMainFrame *>(AfxGetMainWnd())->AddAction(std::make_unique<ModuleAction::CBulkTransform>(
+			CModuleTransform::Transpose(Trsp, s_bDisableInst), std::move(songs)));
 	}
 
 	CDialog::OnOK();
@@ -28,7 +28,6 @@
 #include "FamiTrackerDefines.h"
 
 class CFamiTrackerDoc;
-class CSongData;
 
 // CTransposeDlg dialog
 
@@ -50,8 +49,6 @@ protected:
 	virtual void DoDataExchange(CDataExchange* pDX);    // DDX/DDV support
 
 private:
-	static void Transpose(int Trsp, CSongData &song);
-
 	CFamiTrackerDoc *m_pDocument;
 	int m_iTrack;
 
@@ -24,13 +24,11 @@
 #include "WaveRenderer.h"
 #include "FamiTrackerModule.h"
 #include "SongLengthScanner.h"
-#include "SongView.h"
 
 std::unique_ptr<CWaveRenderer> CWaveRendererFactory::Make(const CFamiTrackerModule &modfile, unsigned track, render_type_t renderType, unsigned param) {
 	switch (renderType) {
 	case render_type_t::Loops: {
-		auto pSongView = modfile.MakeSongView(track, false);
-		CSongLengthScanner scanner {modfile, *pSongView};
+		CSongLengthScanner scanner {modfile, track};		// // //
 		auto [FirstLoop, SecondLoop] = scanner.GetRowCount();
 		auto rows = FirstLoop + SecondLoop * param;
 		return rows ? std::make_unique<CWaveRendererRow>(rows) : nullptr;
@@ -0,0 +1,104 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * 0CC-FamiTracker is (C) 2014-2018 HertzDevil
+ *
+ * Alternatively, the contents of this file may be used under the terms
+ * of the GNU General Public License Version 2, as described below:
+ *
+ * This file is free software: you may copy, redistribute and/or modify
+ * it under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/. */
+
+
+#pragma once
+
+#include <cstdint>
+
+namespace ft0cc::cpu {
+
+// Memory map seen by the CPU.
+class bus {
+public:
+	virtual ~bus() noexcept = default;
+	virtual std::uint8_t read(std::uint16_t addr) = 0;
+	virtual void write(std::uint16_t addr, std::uint8_t value) = 0;
+};
+
+// Observes subroutine calls, used for profiling.
+class call_listener {
+public:
+	virtual ~call_listener() noexcept = default;
+	// sp is the stack pointer after the return address is pushed.
+	virtual void on_call(std::uint16_t target, std::uint8_t sp) = 0;
+	// sp is the stack pointer after the return address is pulled.
+	virtual void on_return(std::uint8_t sp) = 0;
+};
+
+// Cycle-counting 6502 core with the official instruction set of the 2A03.
+// Decimal mode is ignored, and undocumented opcodes halt the CPU. DMA and
+// interrupt lines are not emulated.
+class mos6502 {
+public:
+	enum flag : std::uint8_t {
+		C = 0x01, Z = 0x02, I = 0x04, D = 0x08, B = 0x10, U = 0x20, V = 0x40, N = 0x80,
+	};
+
+	struct registers {
+		std::uint8_t a = 0u;
+		std::uint8_t x = 0u;
+		std::uint8_t y = 0u;
+		std::uint8_t s = 0xFDu;
+		std::uint8_t p = I | U;
+		std::uint16_t pc = 0u;
+	};
+
+	explicit mos6502(bus &b) noexcept;
+
+	void reset() noexcept;
+
+	// Executes one instruction and returns the number of cycles it took.
+	unsigned step();
+
+	// Runs the subroutine at addr until it returns, as if it was called from
+	// outside the address space. Returns false if the CPU halts or the routine
+	// does not return within max_cycles.
+	bool call(std::uint16_t addr, std::uint64_t max_cycles);
+
+	registers &regs() noexcept;
+	const registers &regs() const noexcept;
+	std::uint64_t cycles() const noexcept;
+	bool halted() const noexcept;
+
+	void set_listener(call_listener *listener) noexcept;
+
+private:
+	std::uint8_t fetch();
+	std::uint16_t fetch_word();
+	std::uint16_t read_word(std::uint16_t addr, bool page_wrap);
+	void push(std::uint8_t value);
+	std::uint8_t pull();
+
+	void set_flag(flag f, bool value) noexcept;
+	void set_nz(std::uint8_t value) noexcept;
+	void add(std::uint8_t value) noexcept;
+	void compare(std::uint8_t reg, std::uint8_t value) noexcept;
+
+	bus &bus_;
+	call_listener *listener_ = nullptr;
+	registers regs_;
+	std::uint64_t cycles_ = 0u;
+	bool halted_ = false;
+};
+
+} // namespace ft0cc::cpu
@@ -0,0 +1,472 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * 0CC-FamiTracker is (C) 2014-2018 HertzDevil
+ *
+ * Alternatively, the contents of this file may be used under the terms
+ * of the GNU General Public License Version 2, as described below:
+ *
+ * This file is free software: you may copy, redistribute and/or modify
+ * it under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/. */
+
+#include "ft0cc/cpu/mos6502.hpp"
+#include <array>
+#include <utility>
+
+using namespace ft0cc::cpu;
+
+namespace {
+
+enum class op : std::uint8_t {
+	jam,
+	adc, and_, asl, bcc, bcs, beq, bit, bmi, bne, bpl, brk, bvc, bvs, clc,
+	cld, cli, clv, cmp, cpx, cpy, dec, dex, dey, eor, inc, inx, iny, jmp,
+	jsr, lda, ldx, ldy, lsr, nop, ora, pha, php, pla, plp, rol, ror, rti,
+	rts, sbc, sec, sed, sei, sta, stx, sty, tax, tay, tsx, txa, txs, tya,
+};
+
+enum class mode : std::uint8_t {
+	imp, acc, imm, zp, zpx, zpy, abs, abx, aby, ind, izx, izy, rel,
+};
+
+struct opcode_info {
+	op code = op::jam;
+	mode addressing = mode::imp;
+	std::uint8_t cycles = 2u;
+	bool page_penalty = false; // one extra cycle if indexing crosses a page
+};
+
+constexpr std::uint16_t RETURN_ADDR = 0x0000u; // pc after returning from call()
+
+constexpr std::array<opcode_info, 256> make_opcode_table() noexcept {
+	std::array<opcode_info, 256> t { };
+	auto set = [&t] (unsigned code, op o, mode m, unsigned cycles, bool penalty = false) {
+		t[code] = opcode_info {o, m, static_cast<std::uint8_t>(cycles), penalty};
+	};
+
+	// ORA, AND, EOR, ADC, LDA, CMP, SBC share their addressing modes
+	for (auto [base, o] : {std::pair {0x00u, op::ora}, {0x20u, op::and_}, {0x40u, op::eor},
+		{0x60u, op::adc}, {0xA0u, op::lda}, {0xC0u, op::cmp}, {0xE0u, op::sbc}}) {
+		set(base + 0x01u, o, mode::izx, 6u);
+		set(base + 0x05u, o, mode::zp, 3u);
+		set(base + 0x09u, o, mode::imm, 2u);
+		set(base + 0x0Du, o, mode::abs, 4u);
+		set(base + 0x11u, o, mode::izy, 5u, true);
+		set(base + 0x15u, o, mode::zpx, 4u);
+		set(base + 0x19u, o, mode::aby, 4u, true);
+		set(base + 0x1Du, o, mode::abx, 4u, true);
+	}
+	set(0x81u, op::sta, mode::izx, 6u);
+	set(0x85u, op::sta, mode::zp, 3u);
+	set(0x8Du, op::sta, mode::abs, 4u);
+	set(0x91u, op::sta, mode::izy, 6u);
+	set(0x95u, op::sta, mode::zpx, 4u);
+	set(0x99u, op::sta, mode::aby, 5u);
+	set(0x9Du, op::sta, mode::abx, 5u);
+
+	// read-modify-write instructions
+	for (auto [base, o] : {std::pair {0x00u, op::asl}, {0x20u, op::rol}, {0x40u, op::lsr},
+		{0x60u, op::ror}, {0xC0u, op::dec}, {0xE0u, op::inc}}) {
+		set(base + 0x06u, o, mode::zp, 5u);
+		set(base + 0x0Eu, o, mode::abs, 6u);
+		set(base + 0x16u, o, mode::zpx, 6u);
+		set(base + 0x1Eu, o, mode::abx, 7u);
+	}
+	set(0x0Au, op::asl, mode::acc, 2u);
+	set(0x2Au, op::rol, mode::acc, 2u);
+	set(0x4Au, op::lsr, mode::acc, 2u);
+	set(0x6Au, op::ror, mode::acc, 2u);
+
+	set(0xA2u, op::ldx, mode::imm, 2u);
+	set(0xA6u, op::ldx, mode::zp, 3u);
+	set(0xAEu, op::ldx, mode::abs, 4u);
+	set(0xB6u, op::ldx, mode::zpy, 4u);
+	set(0xBEu, op::ldx, mode::aby, 4u, true);
+	set(0xA0u, op::ldy, mode::imm, 2u);
+	set(0xA4u, op::ldy, mode::zp, 3u);
+	set(0xACu, op::ldy, mode::abs, 4u);
+	set(0xB4u, op::ldy, mode::zpx, 4u);
+	set(0xBCu, op::ldy, mode::abx, 4u, true);
+	set(0x86u, op::stx, mode::zp, 3u);
+	set(0x8Eu, op::stx, mode::abs, 4u);
+	set(0x96u, op::stx, mode::zpy, 4u);
+	set(0x84u, op::sty, mode::zp, 3u);
+	set(0x8Cu, op::sty, mode::abs, 4u);
+	set(0x94u, op::sty, mode::zpx, 4u);
+	set(0xE0u, op::cpx, mode::imm, 2u);
+	set(0xE4u, op::cpx, mode::zp, 3u);
+	set(0xECu, op::cpx, mode::abs, 4u);
+	set(0xC0u, op::cpy, mode::imm, 2u);
+	set(0xC4u, op::cpy, mode::zp, 3u);
+	set(0xCCu, op::cpy, mode::abs, 4u);
+	set(0x24u, op::bit, mode::zp, 3u);
+	set(0x2Cu, op::bit, mode::abs, 4u);
+
+	set(0x10u, op::bpl, mode::rel, 2u);
+	set(0x30u, op::bmi, mode::rel, 2u);
+	set(0x50u, op::bvc, mode::rel, 2u);
+	set(0x70u, op::bvs, mode::rel, 2u);
+	set(0x90u, op::bcc, mode::rel, 2u);
+	set(0xB0u, op::bcs, mode::rel, 2u);
+	set(0xD0u, op::bne, mode::rel, 2u);
+	set(0xF0u, op::beq, mode::rel, 2u);
+
+	set(0x00u, op::brk, mode::imp, 7u);
+	set(0x20u, op::jsr, mode::abs, 6u);
+	set(0x40u, op::rti, mode::imp, 6u);
+	set(0x60u, op::rts, mode::imp, 6u);
+	set(0x4Cu, op::jmp, mode::abs, 3u);
+	set(0x6Cu, op::jmp, mode::ind, 5u);
+	set(0x08u, op::php, mode::imp, 3u);
+	set(0x28u, op::plp, mode::imp, 4u);
+	set(0x48u, op::pha, mode::imp, 3u);
+	set(0x68u, op::pla, mode::imp, 4u);
+
+	set(0x18u, op::clc, mode::imp, 2u);
+	set(0x38u, op::sec, mode::imp, 2u);
+	set(0x58u, op::cli, mode::imp, 2u);
+	set(0x78u, op::sei, mode::imp, 2u);
+	set(0xB8u, op::clv, mode::imp, 2u);
+	set(0xD8u, op::cld, mode::imp, 2u);
+	set(0xF8u, op::sed, mode::imp, 2u);
+	set(0x88u, op::dey, mode::imp, 2u);
+	set(0xCAu, op::dex, mode::imp, 2u);
+	set(0xC8u, op::iny, mode::imp, 2u);
+	set(0xE8u, op::inx, mode::imp, 2u);
+	set(0x8Au, op::txa, mode::imp, 2u);
+	set(0x98u, op::tya, mode::imp, 2u);
+	set(0x9Au, op::txs, mode::imp, 2u);
+	set(0xA8u, op::tay, mode::imp, 2u);
+	set(0xAAu, op::tax, mode::imp, 2u);
+	set(0xBAu, op::tsx, mode::imp, 2u);
+	set(0xEAu, op::nop, mode::imp, 2u);
+
+	return t;
+}
+
+constexpr auto OPCODES = make_opcode_table();
+
+constexpr bool crosses_page(std::uint16_t a, std::uint16_t b) noexcept {
+	return (a & 0xFF00u) != (b & 0xFF00u);
+}
+
+} // namespace
+
+mos6502::mos6502(bus &b) noexcept : bus_(b) {
+}
+
+void mos6502::reset() noexcept {
+	regs_ = registers { };
+	cycles_ = 0u;
+	halted_ = false;
+}
+
+unsigned mos6502::step() {
+	if (halted_)
+		return 0u;
+
+	const auto &info = OPCODES[fetch()];
+	unsigned cycles = info.cycles;
+
+	std::uint16_t addr = 0u;
+	const auto indexed = [&] (std::uint16_t base, std::uint8_t index) {
+		std::uint16_t x = base + index;
+		if (info.page_penalty && crosses_page(base, x))
+			++cycles;
+		return x;
+	};
+
+	switch (info.addressing) {
+	case mode::imp: case mode::acc:
+		break;
+	case mode::imm:
+		addr = regs_.pc++;
+		break;
+	case mode::zp:
+		addr = fetch();
+		break;
+	case mode::zpx:
+		addr = static_cast<std::uint8_t>(fetch() + regs_.x);
+		break;
+	case mode::zpy:
+		addr = static_cast<std::uint8_t>(fetch() + regs_.y);
+		break;
+	case mode::abs:
+		addr = fetch_word();
+		break;
+	case mode::abx:
+		addr = indexed(fetch_word(), regs_.x);
+		break;
+	case mode::aby:
+		addr = indexed(fetch_word(), regs_.y);
+		break;
+	case mode::ind:
+		addr = read_word(fetch_word(), true);
+		break;
+	case mode::izx:
+		addr = read_word(static_cast<std::uint8_t>(fetch() + regs_.x), true);
+		break;
+	case mode::izy:
+		addr = indexed(read_word(fetch(), true), regs_.y);
+		break;
+	case mode::rel: {
+		auto offset = static_cast<std::int8_t>(fetch());
+		addr = static_cast<std::uint16_t>(regs_.pc + offset);
+		break;
+	}
+	}
+
+	const auto branch = [&] (bool taken) {
+		if (taken) {
+			cycles += crosses_page(regs_.pc, addr) ? 2u : 1u;
+			regs_.pc = addr;
+		}
+	};
+	bool called = false;
+	bool returned = false;
+	const auto modify = [&] (auto f) {
+		if (info.addressing == mode::acc)
+			regs_.a = f(regs_.a);
+		else
+			bus_.write(addr, f(bus_.read(addr)));
+	};
+
+	switch (info.code) {
+	case op::jam:
+		halted_ = true;
+		--regs_.pc;
+		return 0u;
+
+	case op::lda: set_nz(regs_.a = bus_.read(addr)); break;
+	case op::ldx: set_nz(regs_.x = bus_.read(addr)); break;
+	case op::ldy: set_nz(regs_.y = bus_.read(addr)); break;
+	case op::sta: bus_.write(addr, regs_.a); break;
+	case op::stx: bus_.write(addr, regs_.x); break;
+	case op::sty: bus_.write(addr, regs_.y); break;
+
+	case op::adc: add(bus_.read(addr)); break;
+	case op::sbc: add(~bus_.read(addr)); break;
+	case op::and_: set_nz(regs_.a &= bus_.read(addr)); break;
+	case op::ora: set_nz(regs_.a |= bus_.read(addr)); break;
+	case op::eor: set_nz(regs_.a ^= bus_.read(addr)); break;
+	case op::cmp: compare(regs_.a, bus_.read(addr)); break;
+	case op::cpx: compare(regs_.x, bus_.read(addr)); break;
+	case op::cpy: compare(regs_.y, bus_.read(addr)); break;
+	case op::bit: {
+		std::uint8_t value = bus_.read(addr);
+		set_flag(Z, !(regs_.a & value));
+		set_flag(V, value & V);
+		set_flag(N, value & N);
+		break;
+	}
+
+	case op::asl:
+		modify([&] (std::uint8_t x) {
+			set_flag(C, x & 0x80u);
+			set_nz(x <<= 1);
+			return x;
+		});
+		break;
+	case op::lsr:
+		modify([&] (std::uint8_t x) {
+			set_flag(C, x & 0x01u);
+			set_nz(x >>= 1);
+			return x;
+		});
+		break;
+	case op::rol:
+		modify([&] (std::uint8_t x) {
+			std::uint8_t result = (x << 1) | (regs_.p & C);
+			set_flag(C, x & 0x80u);
+			set_nz(result);
+			return result;
+		});
+		break;
+	case op::ror:
+		modify([&] (std::uint8_t x) {
+			std::uint8_t result = (x >> 1) | ((regs_.p & C) << 7);
+			set_flag(C, x & 0x01u);
+			set_nz(result);
+			return result;
+		});
+		break;
+	case op::inc: modify([&] (std::uint8_t x) { set_nz(++x); return x; }); break;
+	case op::dec: modify([&] (std::uint8_t x) { set_nz(--x); return x; }); break;
+	case op::inx: set_nz(++regs_.x); break;
+	case op::iny: set_nz(++regs_.y); break;
+	case op::dex: set_nz(--regs_.x); break;
+	case op::dey: set_nz(--regs_.y); break;
+
+	case op::tax: set_nz(regs_.x = regs_.a); break;
+	case op::tay: set_nz(regs_.y = regs_.a); break;
+	case op::txa: set_nz(regs_.a = regs_.x); break;
+	case op::tya: set_nz(regs_.a = regs_.y); break;
+	case op::tsx: set_nz(regs_.x = regs_.s); break;
+	case op::txs: regs_.s = regs_.x; break;
+
+	case op::bpl: branch(!(regs_.p & N)); break;
+	case op::bmi: branch(regs_.p & N); break;
+	case op::bvc: branch(!(regs_.p & V)); break;
+	case op::bvs: branch(regs_.p & V); break;
+	case op::bcc: branch(!(regs_.p & C)); break;
+	case op::bcs: branch(regs_.p & C); break;
+	case op::bne: branch(!(regs_.p & Z)); break;
+	case op::beq: branch(regs_.p & Z); break;
+
+	case op::jmp:
+		regs_.pc = addr;
+		break;
+	case op::jsr: {
+		std::uint16_t ret = regs_.pc - 1u;
+		push(ret >> 8);
+		push(ret & 0xFFu);
+		regs_.pc = addr;
+		called = true;
+		break;
+	}
+	case op::rts: {
+		std::uint8_t lo = pull();
+		regs_.pc = ((pull() << 8) | lo) + 1u;
+		returned = true;
+		break;
+	}
+	case op::rti: {
+		regs_.p = (pull() & ~B) | U;
+		std::uint8_t lo = pull();
+		regs_.pc = (pull() << 8) | lo;
+		break;
+	}
+	case op::brk: {
+		std::uint16_t ret = regs_.pc + 1u;
+		push(ret >> 8);
+		push(ret & 0xFFu);
+		push(regs_.p | B | U);
+		set_flag(I, true);
+		regs_.pc = read_word(0xFFFEu, false);
+		break;
+	}
+
+	case op::pha: push(regs_.a); break;
+	case op::php: push(regs_.p | B | U); break;
+	case op::pla: set_nz(regs_.a = pull()); break;
+	case op::plp: regs_.p = (pull() & ~B) | U; break;
+
+	case op::clc: set_flag(C, false); break;
+	case op::sec: set_flag(C, true); break;
+	case op::cli: set_flag(I, false); break;
+	case op::sei: set_flag(I, true); break;
+	case op::clv: set_flag(V, false); break;
+	case op::cld: set_flag(D, false); break;
+	case op::sed: set_flag(D, true); break;
+	case op::nop: break;
+	}
+
+	cycles_ += cycles;
+
+	// JSR cycles belong to the caller, RTS cycles to the callee
+	if (listener_) {
+		if (called)
+			listener_->on_call(regs_.pc, regs_.s);
+		else if (returned)
+			listener_->on_return(regs_.s);
+	}
+
+	return cycles;
+}
+
+bool mos6502::call(std::uint16_t addr, std::uint64_t max_cycles) {
+	const std::uint8_t sp = regs_.s;
+	const auto ret = static_cast<std::uint16_t>(RETURN_ADDR - 1u);
+	push(ret >> 8);
+	push(ret & 0xFFu);
+	regs_.pc = addr;
+
+	const std::uint64_t limit = cycles_ + max_cycles;
+	while (!(regs_.pc == RETURN_ADDR && regs_.s == sp)) {
+		if (halted_ || cycles_ >= limit) {
+			regs_.s = sp;
+			return false;
+		}
+		step();
+	}
+	return true;
+}
+
+mos6502::registers &mos6502::regs() noexcept {
+	return regs_;
+}
+
+const mos6502::registers &mos6502::regs() const noexcept {
+	return regs_;
+}
+
+std::uint64_t mos6502::cycles() const noexcept {
+	return cycles_;
+}
+
+bool mos6502::halted() const noexcept {
+	return halted_;
+}
+
+void mos6502::set_listener(call_listener *listener) noexcept {
+	listener_ = listener;
+}
+
+std::uint8_t mos6502::fetch() {
+	return bus_.read(regs_.pc++);
+}
+
+std::uint16_t mos6502::fetch_word() {
+	std::uint8_t lo = fetch();
+	return (fetch() << 8) | lo;
+}
+
+std::uint16_t mos6502::read_word(std::uint16_t addr, bool page_wrap) {
+	// indirect jumps and zero page pointers do not carry into the high byte
+	std::uint16_t next = page_wrap ? (addr & 0xFF00u) | ((addr + 1u) & 0xFFu) : addr + 1u;
+	std::uint8_t lo = bus_.read(addr);
+	return (bus_.read(next) << 8) | lo;
+}
+
+void mos6502::push(std::uint8_t value) {
+	bus_.write(0x100u | regs_.s--, value);
+}
+
+std::uint8_t mos6502::pull() {
+	return bus_.read(0x100u | ++regs_.s);
+}
+
+void mos6502::set_flag(flag f, bool value) noexcept {
+	if (value)
+		regs_.p |= f;
+	else
+		regs_.p &= ~f;
+}
+
+void mos6502::set_nz(std::uint8_t value) noexcept {
+	set_flag(Z, !value);
+	set_flag(N, value & 0x80u);
+}
+
+void mos6502::add(std::uint8_t value) noexcept {
+	unsigned sum = regs_.a + value + (regs_.p & C);
+	set_flag(C, sum > 0xFFu);
+	set_flag(V, ~(regs_.a ^ value) & (regs_.a ^ sum) & 0x80u);
+	set_nz(regs_.a = static_cast<std::uint8_t>(sum));
+}
+
+void mos6502::compare(std::uint8_t reg, std::uint8_t value) noexcept {
+	set_flag(C, reg >= value);
+	set_nz(static_cast<std::uint8_t>(reg - value));
+}
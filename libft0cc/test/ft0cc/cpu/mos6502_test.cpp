@@ -0,0 +1,196 @@
+/* This Source Code Form is subject to the terms of the Mozilla Public
+ * License, v. 2.0. If a copy of the MPL was not distributed with this
+ * file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ *
+ * 0CC-FamiTracker is (C) 2014-2018 HertzDevil
+ *
+ * Alternatively, the contents of this file may be used under the terms
+ * of the GNU General Public License Version 2, as described below:
+ *
+ * This file is free software: you may copy, redistribute and/or modify
+ * it under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 2 of the License, or (at your
+ * option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see http://www.gnu.org/licenses/. */
+
+#include "ft0cc/cpu/mos6502.hpp"
+#include "gtest/gtest.h"
+#include <array>
+#include <initializer_list>
+#include <utility>
+#include <vector>
+
+using mos6502 = ft0cc::cpu::mos6502;
+
+namespace {
+
+class ram_bus : public ft0cc::cpu::bus {
+public:
+	std::uint8_t read(std::uint16_t addr) override {
+		return mem[addr];
+	}
+	void write(std::uint16_t addr, std::uint8_t value) override {
+		mem[addr] = value;
+	}
+
+	void load(std::uint16_t addr, std::initializer_list<std::uint8_t> bytes) {
+		for (std::uint8_t x : bytes)
+			mem[addr++] = x;
+	}
+
+	std::array<std::uint8_t, 0x10000> mem = { };
+};
+
+class call_log : public ft0cc::cpu::call_listener {
+public:
+	void on_call(std::uint16_t target, std::uint8_t sp) override {
+		events.emplace_back(target, sp);
+	}
+	void on_return(std::uint8_t sp) override {
+		events.emplace_back(0xFFFFu, sp);
+	}
+
+	std::vector<std::pair<unsigned, unsigned>> events;
+};
+
+} // namespace
+
+TEST(Mos6502, LoadFlags) {
+	ram_bus mem;
+	mem.load(0x8000u, {0xA9u, 0x00u, 0xA9u, 0x80u}); // LDA #$00; LDA #$80
+	mos6502 cpu {mem};
+	cpu.regs().pc = 0x8000u;
+
+	EXPECT_EQ(cpu.step(), 2u);
+	EXPECT_TRUE(cpu.regs().p & mos6502::Z);
+	EXPECT_FALSE(cpu.regs().p & mos6502::N);
+	EXPECT_EQ(cpu.step(), 2u);
+	EXPECT_FALSE(cpu.regs().p & mos6502::Z);
+	EXPECT_TRUE(cpu.regs().p & mos6502::N);
+	EXPECT_EQ(cpu.regs().a, 0x80u);
+	EXPECT_EQ(cpu.cycles(), 4u);
+}
+
+TEST(Mos6502, Arithmetic) {
+	ram_bus mem;
+	mem.load(0x8000u, {
+		0x18u, 0xA9u, 0x7Fu, 0x69u, 0x01u, // CLC; LDA #$7F; ADC #$01
+		0x38u, 0xE9u, 0x81u,               // SEC; SBC #$81
+	});
+	mos6502 cpu {mem};
+	cpu.regs().pc = 0x8000u;
+
+	for (int i = 0; i < 3; ++i)
+		cpu.step();
+	EXPECT_EQ(cpu.regs().a, 0x80u);
+	EXPECT_TRUE(cpu.regs().p & mos6502::V);
+	EXPECT_TRUE(cpu.regs().p & mos6502::N);
+	EXPECT_FALSE(cpu.regs().p & mos6502::C);
+
+	cpu.step();
+	cpu.step();
+	EXPECT_EQ(cpu.regs().a, 0xFFu);
+	EXPECT_FALSE(cpu.regs().p & mos6502::C);
+	EXPECT_FALSE(cpu.regs().p & mos6502::V);
+}
+
+TEST(Mos6502, PageCrossing) {
+	ram_bus mem;
+	mem.load(0x8000u, {
+		0xA2u, 0x20u,        // LDX #$20
+		0xBDu, 0xD0u, 0x12u, // LDA $12D0,X
+		0xBDu, 0xF0u, 0x12u, // LDA $12F0,X
+		0x9Du, 0xD0u, 0x12u, // STA $12D0,X
+		0x9Du, 0xF0u, 0x12u, // STA $12F0,X
+	});
+	mem.mem[0x1310u] = 0x42u;
+	mos6502 cpu {mem};
+	cpu.regs().pc = 0x8000u;
+
+	EXPECT_EQ(cpu.step(), 2u);
+	EXPECT_EQ(cpu.step(), 4u);
+	EXPECT_EQ(cpu.step(), 5u);
+	EXPECT_EQ(cpu.regs().a, 0x42u);
+	EXPECT_EQ(cpu.step(), 5u);
+	EXPECT_EQ(cpu.step(), 5u);
+}
+
+TEST(Mos6502, Branches) {
+	ram_bus mem;
+	mem.load(0x80F0u, {
+		0xA9u, 0x00u, // LDA #$00
+		0xD0u, 0x10u, // BNE +16 (not taken)
+		0xF0u, 0x00u, // BEQ +0
+		0xF0u, 0x10u, // BEQ +16, crosses into $8108
+	});
+	mos6502 cpu {mem};
+	cpu.regs().pc = 0x80F0u;
+
+	EXPECT_EQ(cpu.step(), 2u);
+	EXPECT_EQ(cpu.step(), 2u);
+	EXPECT_EQ(cpu.step(), 3u);
+	EXPECT_EQ(cpu.step(), 4u);
+	EXPECT_EQ(cpu.regs().pc, 0x8108u);
+}
+
+TEST(Mos6502, IndirectJump) {
+	ram_bus mem;
+	mem.load(0x8000u, {0x6Cu, 0xFFu, 0x10u}); // JMP ($10FF)
+	mem.mem[0x10FFu] = 0x34u;
+	mem.mem[0x1000u] = 0x12u;
+	mem.mem[0x1100u] = 0x56u;
+	mos6502 cpu {mem};
+	cpu.regs().pc = 0x8000u;
+
+	EXPECT_EQ(cpu.step(), 5u);
+	EXPECT_EQ(cpu.regs().pc, 0x1234u);
+}
+
+TEST(Mos6502, Call) {
+	ram_bus mem;
+	mem.load(0x8000u, {0x20u, 0x10u, 0x80u, 0x60u}); // JSR $8010; RTS
+	mem.load(0x8010u, {0xA9u, 0x01u, 0x60u});        // LDA #$01; RTS
+	mos6502 cpu {mem};
+	call_log log;
+	cpu.set_listener(&log);
+
+	const auto sp = cpu.regs().s;
+	EXPECT_TRUE(cpu.call(0x8000u, 1000u));
+	EXPECT_EQ(cpu.cycles(), 20u);
+	EXPECT_EQ(cpu.regs().a, 1u);
+	EXPECT_EQ(cpu.regs().s, sp);
+
+	ASSERT_EQ(log.events.size(), 3u);
+	EXPECT_EQ(log.events[0], (std::pair<unsigned, unsigned> {0x8010u, sp - 4u}));
+	EXPECT_EQ(log.events[1], (std::pair<unsigned, unsigned> {0xFFFFu, sp - 2u}));
+	EXPECT_EQ(log.events[2], (std::pair<unsigned, unsigned> {0xFFFFu, sp}));
+}
+
+TEST(Mos6502, CallFailure) {
+	ram_bus mem;
+	mem.load(0x8000u, {0x4Cu, 0x00u, 0x80u}); // JMP $8000
+	mem.load(0x9000u, {0xEAu, 0x02u});        // NOP; undocumented
+	mos6502 cpu {mem};
+
+	const auto sp = cpu.regs().s;
+	EXPECT_FALSE(cpu.call(0x8000u, 300u));
+	EXPECT_GE(cpu.cycles(), 300u);
+	EXPECT_EQ(cpu.regs().s, sp);
+	EXPECT_FALSE(cpu.halted());
+
+	EXPECT_FALSE(cpu.call(0x9000u, 300u));
+	EXPECT_TRUE(cpu.halted());
+	EXPECT_EQ(cpu.regs().pc, 0x9001u);
+	EXPECT_EQ(cpu.step(), 0u);
+
+	cpu.reset();
+	EXPECT_FALSE(cpu.halted());
+	EXPECT_EQ(cpu.cycles(), 0u);
+}